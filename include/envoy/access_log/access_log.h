@@ -59,7 +59,9 @@ enum ResponseFlag {
   // Abort with error code was injected.
   FaultInjected = 0x400,
   // Request was ratelimited locally by rate limit filter.
-  RateLimited = 0x800
+  RateLimited = 0x800,
+  // Request timed out waiting for a connection in an upstream connection pool.
+  UpstreamPendingTimeout = 0x1000
 };
 
 /**
@@ -78,6 +78,18 @@ public:
      * Called when the async HTTP stream is reset.
      */
     virtual void onReset() PURE;
+
+    /**
+     * Called when the upstream connection can not accept more request data without buffering it.
+     * The caller should stop sending data until onBelowWriteBufferLowWatermark() is called.
+     */
+    virtual void onAboveWriteBufferHighWatermark() PURE;
+
+    /**
+     * Called when the upstream connection has drained enough buffered request data to resume
+     * sending after a previous onAboveWriteBufferHighWatermark().
+     */
+    virtual void onBelowWriteBufferLowWatermark() PURE;
   };
 
   /**
@@ -92,7 +92,10 @@ enum class StreamResetReason {
   // If the stream was locally reset due to connection termination.
   ConnectionTermination,
   // The stream was reset because of a resource overflow.
-  Overflow
+  Overflow,
+  // If the stream was locally reset by a connection pool because it waited too long for a
+  // connection.
+  PendingTimeout
 };
 
 /**
@@ -32,7 +32,9 @@ enum class PoolFailureReason {
   // A resource overflowed and policy prevented a new stream from being created.
   Overflow,
   // A connection failure took place and the stream could not be bound.
-  ConnectionFailure
+  ConnectionFailure,
+  // The stream waited longer than the cluster's maximum pending time for a connection.
+  Timeout
 };
 
 /**
@@ -20,6 +20,10 @@
 #include "common/protobuf/utility.h"
 
 namespace Envoy {
+namespace Upstream {
+struct InternedClusterName;
+} // namespace Upstream
+
 namespace Router {
 
 /**
@@ -276,6 +280,13 @@ public:
    */
   virtual const std::vector<MetadataMatchCriterionConstSharedPtr>&
   metadataMatchCriteria() const PURE;
+
+  /*
+   * @return uint64_t an identifier assigned to the criteria when the route configuration is
+   * loaded. Identifiers are never reused within a process, so they can be used as cache keys
+   * in place of the criteria themselves.
+   */
+  virtual uint64_t id() const PURE;
 };
 
 /**
@@ -290,6 +301,12 @@ public:
    */
   virtual const std::string& clusterName() const PURE;
 
+  /**
+   * @return const Upstream::InternedClusterName* the interned clusterName(), or nullptr if the
+   *         cluster is only known per request, such as for routes that use cluster_header.
+   */
+  virtual const Upstream::InternedClusterName* internedClusterName() const PURE;
+
   /**
    * @return const CorsPolicy* the CORS policy for this virtual host.
    */
@@ -1,31 +1,70 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 
-#include "envoy/http/message.h"
+#include "envoy/buffer/buffer.h"
+#include "envoy/http/header_map.h"
 
 namespace Envoy {
 namespace Router {
 
 /**
- * Interface used to shadow complete requests to an alternate upstream cluster in a "fire and
- * forget" fashion. Right now this interface takes a fully buffered request and cannot be used for
- * streaming. This is sufficient for current use cases.
+ * A request that is being streamed to an alternate upstream cluster. The shadow response is
+ * discarded.
+ */
+class ShadowStream {
+public:
+  virtual ~ShadowStream() {}
+
+  /**
+   * Send request body data to the shadow cluster. While the shadow upstream is not keeping up the
+   * data is held by the stream; if the held data goes over the stream's buffer limit the shadow is
+   * cancelled.
+   * @param data supplies the data to send. It will be drained.
+   * @param end_stream supplies whether this is the last part of the request.
+   * @return bool whether the shadow is still active. If false, the request has been cancelled and
+   *         the stream must not be used again.
+   */
+  virtual bool sendData(Buffer::Instance& data, bool end_stream) PURE;
+
+  /**
+   * Send request trailers to the shadow cluster. This ends the request.
+   * @param trailers supplies the trailers to send.
+   */
+  virtual void sendTrailers(const Http::HeaderMap& trailers) PURE;
+
+  /**
+   * Abort the shadowed request.
+   */
+  virtual void cancel() PURE;
+};
+
+/**
+ * Interface used to shadow requests to an alternate upstream cluster in a "fire and forget"
+ * fashion. Requests are streamed, so the caller does not need to buffer the request body.
  */
 class ShadowWriter {
 public:
   virtual ~ShadowWriter() {}
 
   /**
-   * Shadow a request.
+   * Start shadowing a request.
    * @param cluster supplies the cluster name to shadow to.
-   * @param message supplies the complete request to shadow.
+   * @param headers supplies the request headers to shadow.
+   * @param end_stream supplies whether the request is headers only.
    * @param timeout supplies the shadowed request timeout.
+   * @param buffer_limit supplies the maximum number of request body bytes to hold while the shadow
+   *        upstream is not accepting data, or 0 for no limit.
+   * @return ShadowStream* the stream to send the rest of the request on, or nullptr if end_stream
+   *         is true. The stream is owned by the writer and must not be used once the request has
+   *         been ended or cancelled.
    */
-  virtual void shadow(const std::string& cluster, Http::MessagePtr&& request,
-                      std::chrono::milliseconds timeout) PURE;
+  virtual ShadowStream* shadow(const std::string& cluster, Http::HeaderMapPtr&& headers,
+                               bool end_stream, std::chrono::milliseconds timeout,
+                               uint32_t buffer_limit) PURE;
 };
 
 typedef std::unique_ptr<ShadowWriter> ShadowWriterPtr;
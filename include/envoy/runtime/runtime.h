@@ -96,6 +96,13 @@ public:
    * @return uint64_t the runtime value or the default value.
    */
   virtual uint64_t getInteger(const std::string& key, uint64_t default_value) const PURE;
+
+  /**
+   * @return uint64_t an identifier for this snapshot. A newly loaded snapshot never has the same
+   *         generation as any snapshot before it, so callers that cache values read from a
+   *         snapshot can compare generations to tell when they need to read them again.
+   */
+  virtual uint64_t generation() const PURE;
 };
 
 /**
@@ -12,6 +12,7 @@
 #include "envoy/http/conn_pool.h"
 #include "envoy/local_info/local_info.h"
 #include "envoy/runtime/runtime.h"
+#include "envoy/upstream/health_checker.h"
 #include "envoy/upstream/load_balancer.h"
 #include "envoy/upstream/thread_local_cluster.h"
 #include "envoy/upstream/upstream.h"
@@ -22,6 +23,24 @@
 namespace Envoy {
 namespace Upstream {
 
+/**
+ * A cluster name interned by ClusterManager::internClusterName(). Interned names are immutable, so
+ * they can be shared by all threads. A name is released once its last reference goes away, after
+ * which its index may be reused for another name.
+ */
+struct InternedClusterName {
+  InternedClusterName(const std::string& name, uint32_t index, uint64_t id)
+      : name_(name), index_(index), id_(id) {}
+
+  const std::string name_;
+  // Dense index of the name within its cluster manager, used instead of hashing the name.
+  const uint32_t index_;
+  // Unique for the lifetime of the cluster manager, unlike index_.
+  const uint64_t id_;
+};
+
+typedef std::shared_ptr<const InternedClusterName> InternedClusterNameConstSharedPtr;
+
 /**
  * Manages connection pools and load balancing for upstream clusters. The cluster manager is
  * persistent and shared among multiple ongoing requests/connections.
@@ -65,6 +84,23 @@ public:
    */
   virtual ThreadLocalCluster* get(const std::string& cluster) PURE;
 
+  /**
+   * Intern a cluster name, so that the cluster can later be looked up without hashing its name.
+   * The cluster does not need to exist. This must only be called on the main thread, typically when
+   * loading configuration.
+   * @param cluster supplies the cluster name.
+   * @return InternedClusterNameConstSharedPtr the interned name. While it is referenced, the same
+   *         name is always interned to the same object.
+   */
+  virtual InternedClusterNameConstSharedPtr internClusterName(const std::string& cluster) PURE;
+
+  /**
+   * Same as get(const std::string&), for a cluster name interned by this cluster manager. Lookups
+   * are cached per thread and the cache is invalidated whenever a thread local cluster is removed
+   * or replaced, so this is also safe across CDS updates.
+   */
+  virtual ThreadLocalCluster* get(const InternedClusterName& cluster) PURE;
+
   /**
    * Allocate a load balanced HTTP connection pool for a cluster. This is *per-thread* so that
    * callers do not need to worry about per thread synchronization. The load balancing policy that
@@ -126,6 +162,12 @@ public:
    * @return GrpcMux& ADS API provider referencee.
    */
   virtual Config::GrpcMux& adsMux() PURE;
+
+  /**
+   * @return SharedHealthCheckSessionMap& the health check sessions that are shared between the
+   *         health checkers of all clusters. This must only be used on the main thread.
+   */
+  virtual SharedHealthCheckSessionMap& sharedHealthCheckSessions() PURE;
 };
 
 typedef std::unique_ptr<ClusterManager> ClusterManagerPtr;
@@ -2,6 +2,8 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #include "envoy/upstream/upstream.h"
 
@@ -38,5 +40,20 @@ public:
 
 typedef std::shared_ptr<HealthChecker> HealthCheckerSharedPtr;
 
+/**
+ * A health check session that runs the checks for an endpoint on behalf of the health checkers of
+ * several clusters. See the "health_check.shared_sessions" runtime key.
+ */
+class SharedHealthCheckSession {
+public:
+  virtual ~SharedHealthCheckSession() {}
+};
+
+/**
+ * Shared health check sessions by a key that identifies everything that makes the checks of two
+ * clusters for an endpoint equivalent. This is only used on the main thread.
+ */
+typedef std::unordered_map<std::string, SharedHealthCheckSession*> SharedHealthCheckSessionMap;
+
 } // namespace Upstream
 } // namespace Envoy
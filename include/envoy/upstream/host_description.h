@@ -1,8 +1,11 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 
+#include "envoy/common/time.h"
 #include "envoy/network/address.h"
 #include "envoy/stats/stats_macros.h"
 #include "envoy/upstream/health_check_host_monitor.h"
@@ -19,6 +22,9 @@ namespace Upstream {
  * {rq_success, rq_error} have specific semantics driven by the needs of EDS load reporting. See
  * envoy.api.v2.UpstreamLocalityStats for the definitions of success/error. These are latched by
  * LoadStatsReporter, independent of the normal stats sink flushing.
+ *
+ * rq_time_ewma is the host's response time average in microseconds as of its last response. It is
+ * 0 until the first response is recorded. See HostDescription::recordResponseTime().
  */
 // clang-format off
 #define ALL_HOST_STATS(COUNTER, GAUGE)                                                             \
@@ -29,7 +35,8 @@ namespace Upstream {
   COUNTER(rq_timeout)                                                                              \
   COUNTER(rq_success)                                                                              \
   COUNTER(rq_error)                                                                                \
-  GAUGE  (rq_active)
+  GAUGE  (rq_active)                                                                               \
+  GAUGE  (rq_time_ewma)
 // clang-format on
 
 /**
@@ -89,6 +96,22 @@ public:
    */
   virtual const HostStats& stats() const PURE;
 
+  /**
+   * Fold a response time into the host's response time average. This can be called from any
+   * thread.
+   * @param response_time supplies the response time.
+   * @param now supplies the time the response completed.
+   */
+  virtual void recordResponseTime(std::chrono::microseconds response_time,
+                                  MonotonicTime now) const PURE;
+
+  /**
+   * @param now supplies the current time.
+   * @return the host's response time average in microseconds, or 0 if no response has been
+   *         recorded. The average decays towards 0 while the host gets no responses.
+   */
+  virtual uint64_t responseTimeAverage(MonotonicTime now) const PURE;
+
   /**
    * @return the locality of the host (deployment specific). This will be the default instance if
    *         unknown.
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 
@@ -73,6 +74,26 @@ public:
    * @return Resource& active retries.
    */
   virtual Resource& retries() PURE;
+
+  /**
+   * @return bool whether retries are currently limited by a retry budget (a percentage of
+   *         outstanding requests) rather than by the static max_retries threshold.
+   */
+  virtual bool retryBudgetActive() PURE;
+
+  /**
+   * @return Resource& outstanding requests admitted by the adaptive concurrency limit. A request
+   *         holds this resource from when the router accepts it until it completes, including any
+   *         retries. Its maximum is derived from request round trip times rather than configured.
+   */
+  virtual Resource& adaptiveRequests() PURE;
+
+  /**
+   * Record the round trip time of a completed upstream request. This drives the maximum of
+   * adaptiveRequests().
+   * @param rtt supplies the time from the request being sent to the response being received.
+   */
+  virtual void recordRequestRtt(std::chrono::microseconds rtt) PURE;
 };
 
 } // namespace Upstream
@@ -1,5 +1,10 @@
 #pragma once
 
+#include "envoy/http/conn_pool.h"
+#include "envoy/upstream/load_balancer.h"
+#include "envoy/upstream/resource_manager.h"
+#include "envoy/upstream/upstream.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -29,6 +34,15 @@ public:
    * @return LoadBalancer& the backing load balancer.
    */
   virtual LoadBalancer& loadBalancer() PURE;
+
+  /**
+   * Allocate a load balanced HTTP connection pool for the cluster. This is the same as
+   * ClusterManager::httpConnPoolForCluster(), without looking the cluster up by name again.
+   *
+   * Can return nullptr if there is no host available in the cluster.
+   */
+  virtual Http::ConnectionPool::Instance* httpConnPool(ResourcePriority priority,
+                                                       LoadBalancerContext* context) PURE;
 };
 
 } // namespace Upstream
@@ -168,6 +168,13 @@ public:
    * @return same as hostsPerLocality but only contains healthy hosts.
    */
   virtual const std::vector<std::vector<HostSharedPtr>>& healthyHostsPerLocality() const PURE;
+
+  /**
+   * @return the load balancing weight of each locality in hostsPerLocality(), in the same order.
+   * This is empty if localities are not weighted. A locality with weight 0 receives no traffic
+   * while any other locality is weighted.
+   */
+  virtual const std::vector<uint32_t>& localityWeights() const PURE;
 };
 
 /**
@@ -195,6 +202,7 @@ public:
   COUNTER  (upstream_cx_http2_total)                                                               \
   COUNTER  (upstream_cx_connect_fail)                                                              \
   COUNTER  (upstream_cx_connect_timeout)                                                           \
+  COUNTER  (upstream_cx_idle_timeout)                                                              \
   COUNTER  (upstream_cx_overflow)                                                                  \
   HISTOGRAM(upstream_cx_connect_ms)                                                                \
   HISTOGRAM(upstream_cx_length_ms)                                                                 \
@@ -218,7 +226,10 @@ public:
   COUNTER  (upstream_rq_pending_overflow)                                                          \
   COUNTER  (upstream_rq_pending_failure_eject)                                                     \
   GAUGE    (upstream_rq_pending_active)                                                            \
+  COUNTER  (upstream_rq_pending_timeout)                                                           \
+  HISTOGRAM(upstream_rq_pending_ms)                                                                \
   COUNTER  (upstream_rq_cancelled)                                                                 \
+  COUNTER  (upstream_rq_concurrency_limited)                                                       \
   COUNTER  (upstream_rq_maintenance_mode)                                                          \
   COUNTER  (upstream_rq_timeout)                                                                   \
   COUNTER  (upstream_rq_per_try_timeout)                                                           \
@@ -227,6 +238,7 @@ public:
   COUNTER  (upstream_rq_retry)                                                                     \
   COUNTER  (upstream_rq_retry_success)                                                             \
   COUNTER  (upstream_rq_retry_overflow)                                                            \
+  COUNTER  (upstream_rq_retry_budget_exhausted)                                                    \
   COUNTER  (upstream_flow_control_paused_reading_total)                                            \
   COUNTER  (upstream_flow_control_resumed_reading_total)                                           \
   COUNTER  (upstream_flow_control_backed_up_total)                                                 \
@@ -296,6 +308,20 @@ public:
    */
   virtual uint32_t perConnectionBufferLimitBytes() const PURE;
 
+  /**
+   * @return the idle timeout for upstream connections that belong to this cluster. Connection
+   *         pools close connections that have had no active requests for this long. If not set,
+   *         idle connections are kept open.
+   */
+  virtual const Optional<std::chrono::milliseconds>& idleTimeout() const PURE;
+
+  /**
+   * @return the maximum time that a request may wait in a connection pool for a connection to a
+   *         host that belongs to this cluster before it is failed. If not set, requests wait until
+   *         a connection is available or they are cancelled.
+   */
+  virtual const Optional<std::chrono::milliseconds>& maxPendingTime() const PURE;
+
   /**
    * @return uint64_t features supported by the cluster. @see Features.
    */
@@ -343,6 +369,12 @@ public:
    */
   virtual Ssl::ClientContext* sslContext() const PURE;
 
+  /**
+   * @return uint64_t a hash of the cluster's TLS context config, or 0 if it does not use TLS.
+   *         Clusters with the same hash make identical TLS connections.
+   */
+  virtual uint64_t tlsContextHash() const PURE;
+
   /**
    * @return ClusterStats& strongly named stats for this cluster.
    */
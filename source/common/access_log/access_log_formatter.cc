@@ -27,6 +27,7 @@ const std::string ResponseFlagUtils::NO_ROUTE_FOUND = "NR";
 const std::string ResponseFlagUtils::DELAY_INJECTED = "DI";
 const std::string ResponseFlagUtils::FAULT_INJECTED = "FI";
 const std::string ResponseFlagUtils::RATE_LIMITED = "RL";
+const std::string ResponseFlagUtils::UPSTREAM_PENDING_TIMEOUT = "UQ";
 
 void ResponseFlagUtils::appendString(std::string& result, const std::string& append) {
   if (result.empty()) {
@@ -87,6 +88,10 @@ const std::string ResponseFlagUtils::toShortString(const RequestInfo& request_in
     appendString(result, RATE_LIMITED);
   }
 
+  if (request_info.getResponseFlag(ResponseFlag::UpstreamPendingTimeout)) {
+    appendString(result, UPSTREAM_PENDING_TIMEOUT);
+  }
+
   return result.empty() ? NONE : result;
 }
 
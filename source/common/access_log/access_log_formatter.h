@@ -33,6 +33,7 @@ private:
   const static std::string DELAY_INJECTED;
   const static std::string FAULT_INJECTED;
   const static std::string RATE_LIMITED;
+  const static std::string UPSTREAM_PENDING_TIMEOUT;
 };
 
 /**
@@ -9,11 +9,13 @@ namespace Envoy {
 class HashUtil {
 public:
   /**
-   * Return 64-bit hash with seed of 0 from the xxHash algorithm.
+   * Return 64-bit hash from the xxHash algorithm.
    * See https://github.com/Cyan4973/xxHash for details.
+   * @param input supplies the string to hash.
+   * @param seed supplies the hash seed, which defaults to 0.
    */
-  static uint64_t xxHash64(const std::string& input) {
-    return XXH64(input.c_str(), input.size(), 0);
+  static uint64_t xxHash64(const std::string& input, uint64_t seed = 0) {
+    return XXH64(input.c_str(), input.size(), seed);
   }
 };
 
@@ -95,6 +95,8 @@ class HttpFilterNameValues {
 public:
   // Buffer filter
   const std::string BUFFER = "envoy.buffer";
+  // Cache filter
+  const std::string CACHE = "envoy.cache";
   // CORS filter
   const std::string CORS = "envoy.cors";
   // Dynamo filter
@@ -111,6 +113,8 @@ public:
   const std::string IP_TAGGING = "envoy.ip_tagging";
   // Rate limit filter
   const std::string RATE_LIMIT = "envoy.rate_limit";
+  // Request coalescing filter
+  const std::string REQUEST_COALESCING = "envoy.request_coalescing";
   // Router filter
   const std::string ROUTER = "envoy.router";
   // Health checking filter
@@ -122,8 +126,9 @@ public:
   const V1Converter v1_converter_;
 
   HttpFilterNameValues()
-      : v1_converter_({BUFFER, CORS, DYNAMO, FAULT, GRPC_HTTP1_BRIDGE, GRPC_JSON_TRANSCODER,
-                       GRPC_WEB, HEALTH_CHECK, IP_TAGGING, RATE_LIMIT, ROUTER, LUA}) {}
+      : v1_converter_({BUFFER, CACHE, CORS, DYNAMO, FAULT, GRPC_HTTP1_BRIDGE,
+                       GRPC_JSON_TRANSCODER, GRPC_WEB, HEALTH_CHECK, IP_TAGGING, RATE_LIMIT,
+                       REQUEST_COALESCING, ROUTER, LUA}) {}
 };
 
 typedef ConstSingleton<HttpFilterNameValues> HttpFilterNames;
@@ -180,6 +180,10 @@ public:
     streamError(Status::GrpcStatus::Internal);
   }
 
+  // Flow control is not exposed to gRPC callers; messages are always written through.
+  void onAboveWriteBufferHighWatermark() override {}
+  void onBelowWriteBufferLowWatermark() override {}
+
   // Grpc::AsyncStream
   void sendMessage(const RequestType& request, bool end_stream) override {
     stream_->sendData(*Common::serializeBody(request), end_stream);
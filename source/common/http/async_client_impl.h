@@ -142,6 +142,7 @@ private:
 
     // Router::RouteEntry
     const std::string& clusterName() const override { return cluster_name_; }
+    const Upstream::InternedClusterName* internedClusterName() const override { return nullptr; }
     const Router::CorsPolicy* corsPolicy() const override { return nullptr; }
     void finalizeRequestHeaders(Http::HeaderMap&, const AccessLog::RequestInfo&) const override {}
     const Router::HashPolicy* hashPolicy() const override { return nullptr; }
@@ -213,8 +214,12 @@ private:
   void encodeHeaders(HeaderMapPtr&& headers, bool end_stream) override;
   void encodeData(Buffer::Instance& data, bool end_stream) override;
   void encodeTrailers(HeaderMapPtr&& trailers) override;
-  void onDecoderFilterAboveWriteBufferHighWatermark() override {}
-  void onDecoderFilterBelowWriteBufferLowWatermark() override {}
+  void onDecoderFilterAboveWriteBufferHighWatermark() override {
+    stream_callbacks_.onAboveWriteBufferHighWatermark();
+  }
+  void onDecoderFilterBelowWriteBufferLowWatermark() override {
+    stream_callbacks_.onBelowWriteBufferLowWatermark();
+  }
   void addDownstreamWatermarkCallbacks(DownstreamWatermarkCallbacks&) override {}
   void removeDownstreamWatermarkCallbacks(DownstreamWatermarkCallbacks&) override {}
   void setDecoderBufferLimit(uint32_t) override {}
@@ -251,6 +256,8 @@ private:
   void onData(Buffer::Instance& data, bool end_stream) override;
   void onTrailers(HeaderMapPtr&& trailers) override;
   void onReset() override;
+  void onAboveWriteBufferHighWatermark() override {}
+  void onBelowWriteBufferLowWatermark() override {}
 
   // Http::StreamDecoderFilterCallbacks
   const Buffer::Instance* decodingBuffer() override { return request_->body().get(); }
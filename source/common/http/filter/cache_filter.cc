@@ -0,0 +1,410 @@
+#include "common/http/filter/cache_filter.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "envoy/http/codes.h"
+#include "envoy/router/router.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
+#include "common/common/empty_string.h"
+#include "common/common/enum_to_int.h"
+#include "common/common/utility.h"
+#include "common/http/headers.h"
+#include "common/http/utility.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Http {
+
+namespace {
+
+std::vector<std::string> splitHeaderTokens(const std::string& value) {
+  std::vector<std::string> tokens;
+  for (std::string token : StringUtil::split(value, ',')) {
+    const size_t start = token.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+      continue;
+    }
+    token = token.substr(start);
+    StringUtil::rtrim(token);
+    std::transform(token.begin(), token.end(), token.begin(), ::tolower);
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+
+bool parseSeconds(const std::string& directive, const std::string& name,
+                  Optional<std::chrono::seconds>& out) {
+  if (directive.size() <= name.size() + 1 || !StringUtil::startsWith(directive.c_str(), name) ||
+      directive[name.size()] != '=') {
+    return false;
+  }
+
+  uint64_t seconds;
+  if (StringUtil::atoul(directive.c_str() + name.size() + 1, seconds)) {
+    out.value(std::chrono::seconds(seconds));
+  }
+  return true;
+}
+
+} // namespace
+
+const std::string CacheFilter::ROUTE_OPAQUE_CONFIG_KEY = "cache";
+
+CacheControl CacheControl::parse(const HeaderEntry* header) {
+  CacheControl ret;
+  if (header == nullptr) {
+    return ret;
+  }
+
+  const auto& values = Headers::get().CacheControlValues;
+  Optional<std::chrono::seconds> max_age;
+  Optional<std::chrono::seconds> shared_max_age;
+  for (const std::string& directive : splitHeaderTokens(header->value().c_str())) {
+    if (directive == values.NoCache) {
+      ret.no_cache_ = true;
+    } else if (directive == values.NoStore) {
+      ret.no_store_ = true;
+    } else if (directive == values.Private) {
+      ret.private_ = true;
+    } else if (!parseSeconds(directive, values.SharedMaxAge, shared_max_age)) {
+      parseSeconds(directive, values.MaxAge, max_age);
+    }
+  }
+
+  ret.max_age_ = shared_max_age.valid() ? shared_max_age : max_age;
+  return ret;
+}
+
+CachedResponse::CachedResponse(const HeaderMap& headers, const std::string& body,
+                               MonotonicTime response_time, std::chrono::seconds max_age,
+                               const std::vector<std::pair<LowerCaseString, std::string>>& vary)
+    : headers_(new HeaderMapImpl(headers)), body_(body), response_time_(response_time),
+      max_age_(max_age), vary_(vary) {
+  const HeaderEntry* age = headers_->get(Headers::get().Age);
+  if (age) {
+    uint64_t seconds;
+    if (StringUtil::atoul(age->value().c_str(), seconds)) {
+      initial_age_ = std::chrono::seconds(seconds);
+    }
+    headers_->remove(Headers::get().Age);
+  }
+}
+
+bool CachedResponse::varyMatches(const HeaderMap& request_headers) const {
+  for (const auto& vary : vary_) {
+    const HeaderEntry* entry = request_headers.get(vary.first);
+    if ((entry == nullptr ? EMPTY_STRING : std::string(entry->value().c_str())) != vary.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+CachedResponseConstSharedPtr ResponseCache::lookup(const std::string& key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->second;
+}
+
+void ResponseCache::insert(const std::string& key, CachedResponseConstSharedPtr response) {
+  remove(key);
+
+  const uint64_t size = response->byteSize();
+  if (size > max_bytes_) {
+    return;
+  }
+
+  while (bytes_ + size > max_bytes_) {
+    ASSERT(!lru_.empty());
+    erase(std::prev(lru_.end()));
+    stats_.evict_.inc();
+  }
+
+  lru_.emplace_front(key, response);
+  entries_[key] = lru_.begin();
+  bytes_ += size;
+  stats_.insert_.inc();
+}
+
+void ResponseCache::remove(const std::string& key) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    erase(it->second);
+  }
+}
+
+void ResponseCache::erase(LruList::iterator it) {
+  bytes_ -= it->second->byteSize();
+  entries_.erase(it->first);
+  lru_.erase(it);
+}
+
+CacheFilterConfig::CacheFilterConfig(const Json::Object& json_config,
+                                     const std::string& stats_prefix, Stats::Scope& scope,
+                                     ThreadLocal::SlotAllocator& tls,
+                                     MonotonicTimeSource& time_source)
+    : Json::Validator(json_config, Json::Schema::CACHE_HTTP_FILTER_SCHEMA),
+      stats_(generateStats(stats_prefix, scope)),
+      max_cache_bytes_(json_config.getInteger("max_cache_bytes")),
+      max_entry_bytes_(json_config.getInteger("max_entry_bytes", 1024 * 1024)),
+      time_source_(time_source), tls_slot_(tls.allocateSlot()) {
+  const uint64_t max_cache_bytes = max_cache_bytes_;
+  const CacheFilterStats stats = stats_;
+  tls_slot_->set(
+      [max_cache_bytes, stats](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+        return std::make_shared<ThreadLocalCache>(max_cache_bytes, stats);
+      });
+}
+
+CacheFilterStats CacheFilterConfig::generateStats(const std::string& prefix, Stats::Scope& scope) {
+  std::string final_prefix = prefix + "cache.";
+  return {ALL_CACHE_FILTER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
+}
+
+CacheFilter::CacheFilter(CacheFilterConfigSharedPtr config) : config_(config) {}
+
+bool CacheFilter::cacheableRequest(const HeaderMap& headers, bool end_stream) {
+  Router::RouteConstSharedPtr route = decoder_callbacks_->route();
+  if (!route || !route->routeEntry()) {
+    return false;
+  }
+
+  const auto& opaque_config = route->routeEntry()->opaqueConfig();
+  const auto it = opaque_config.find(ROUTE_OPAQUE_CONFIG_KEY);
+  if (it == opaque_config.end() || it->second != "true") {
+    return false;
+  }
+
+  // Only header only GET requests without credentials are served from or stored in the cache.
+  if (!end_stream || !headers.Method() || !headers.Path() || !headers.Host() ||
+      headers.Method()->value() != Headers::get().MethodValues.Get.c_str() ||
+      headers.Authorization()) {
+    return false;
+  }
+
+  return !CacheControl::parse(headers.get(Headers::get().CacheControl)).no_store_;
+}
+
+FilterHeadersStatus CacheFilter::decodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (!cacheableRequest(headers, end_stream)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  request_headers_ = &headers;
+  key_ = fmt::format("{}{}", headers.Host()->value().c_str(), headers.Path()->value().c_str());
+  cacheable_request_ = true;
+
+  CachedResponseConstSharedPtr cached = config_->cache().lookup(key_);
+  if (cached && cached->varyMatches(headers)) {
+    const CacheControl cache_control =
+        CacheControl::parse(headers.get(Headers::get().CacheControl));
+    if (!cache_control.no_cache_ && cached->fresh(config_->timeSource().currentTime())) {
+      config_->stats().rq_hit_.inc();
+      cacheable_request_ = false;
+      serveFromCache(*cached);
+      return FilterHeadersStatus::StopIteration;
+    }
+
+    // If the client is not already making a conditional request, revalidate the stale response
+    // with the upstream so that a 304 can be served from the cache.
+    if (!headers.get(Headers::get().IfNoneMatch) && !headers.get(Headers::get().IfModifiedSince)) {
+      const HeaderEntry* etag = cached->headers_->get(Headers::get().Etag);
+      const HeaderEntry* last_modified = cached->headers_->get(Headers::get().LastModified);
+      if (etag) {
+        headers.addCopy(Headers::get().IfNoneMatch, etag->value().c_str());
+      }
+      if (last_modified) {
+        headers.addCopy(Headers::get().IfModifiedSince, last_modified->value().c_str());
+      }
+      if (etag || last_modified) {
+        validating_response_ = cached;
+      }
+    }
+  }
+
+  config_->stats().rq_miss_.inc();
+  return FilterHeadersStatus::Continue;
+}
+
+void CacheFilter::serveFromCache(const CachedResponse& response) {
+  HeaderMapPtr headers{new HeaderMapImpl(*response.headers_)};
+  const std::chrono::seconds age = response.age(config_->timeSource().currentTime());
+  headers->addCopy(Headers::get().Age, static_cast<uint64_t>(age.count()));
+
+  const bool headers_only = response.body_.empty();
+  decoder_callbacks_->encodeHeaders(std::move(headers), headers_only);
+  if (!headers_only) {
+    Buffer::OwnedImpl body(response.body_);
+    decoder_callbacks_->encodeData(body, true);
+  }
+}
+
+FilterHeadersStatus CacheFilter::encodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (!cacheable_request_) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  const uint64_t response_code = Utility::getResponseStatus(headers);
+  const CacheControl cache_control = CacheControl::parse(headers.get(Headers::get().CacheControl));
+  if (validating_response_) {
+    if (response_code == enumToInt(Code::NotModified)) {
+      config_->stats().rq_validated_.inc();
+      cacheable_request_ = false;
+
+      // The stored response is still valid. Refresh its freshness lifetime and replace the 304
+      // with the stored response. The 304's Age applies to the refreshed response.
+      HeaderMapImpl refreshed_headers(*validating_response_->headers_);
+      const HeaderEntry* age = headers.get(Headers::get().Age);
+      if (age) {
+        refreshed_headers.addCopy(Headers::get().Age, age->value().c_str());
+      }
+      const MonotonicTime now = config_->timeSource().currentTime();
+      CachedResponseConstSharedPtr refreshed = std::make_shared<const CachedResponse>(
+          refreshed_headers, validating_response_->body_, now,
+          cache_control.max_age_.valid() ? cache_control.max_age_.value()
+                                         : validating_response_->max_age_,
+          validating_response_->vary_);
+      config_->cache().insert(key_, refreshed);
+
+      std::vector<LowerCaseString> keys;
+      headers.iterate(
+          [](const HeaderEntry& header, void* context) -> HeaderMap::Iterate {
+            static_cast<std::vector<LowerCaseString>*>(context)->emplace_back(
+                header.key().c_str());
+            return HeaderMap::Iterate::Continue;
+          },
+          &keys);
+      for (const LowerCaseString& key : keys) {
+        headers.remove(key);
+      }
+      refreshed->headers_->iterate(
+          [](const HeaderEntry& header, void* context) -> HeaderMap::Iterate {
+            static_cast<HeaderMap*>(context)->addCopy(LowerCaseString(header.key().c_str()),
+                                                      header.value().c_str());
+            return HeaderMap::Iterate::Continue;
+          },
+          &headers);
+      headers.addCopy(Headers::get().Age, static_cast<uint64_t>(refreshed->age(now).count()));
+
+      if (!end_stream) {
+        // The 304 still has an (empty) body or trailers to come. The stored body is sent in their
+        // place.
+        not_modified_replacement_ = refreshed;
+      } else if (!refreshed->body_.empty()) {
+        Buffer::OwnedImpl body(refreshed->body_);
+        encoder_callbacks_->addEncodedData(body, false);
+      }
+      return FilterHeadersStatus::Continue;
+    }
+
+    // Whatever the upstream returned supersedes the stored response.
+    config_->cache().remove(key_);
+  }
+
+  cacheable_request_ = false;
+  if (response_code != enumToInt(Code::OK) || cache_control.no_store_ || cache_control.private_ ||
+      headers.get(Headers::get().SetCookie)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  std::vector<std::pair<LowerCaseString, std::string>> vary;
+  const HeaderEntry* vary_header = headers.get(Headers::get().Vary);
+  if (vary_header) {
+    for (const std::string& name : splitHeaderTokens(vary_header->value().c_str())) {
+      if (name == "*") {
+        return FilterHeadersStatus::Continue;
+      }
+      const HeaderEntry* entry = request_headers_->get(LowerCaseString(name));
+      vary.emplace_back(LowerCaseString(name),
+                        entry == nullptr ? EMPTY_STRING : std::string(entry->value().c_str()));
+    }
+  }
+
+  // A response without a freshness lifetime is only useful if it can be revalidated.
+  const std::chrono::seconds max_age = cache_control.no_cache_ || !cache_control.max_age_.valid()
+                                           ? std::chrono::seconds(0)
+                                           : cache_control.max_age_.value();
+  if (max_age.count() == 0 && !headers.get(Headers::get().Etag) &&
+      !headers.get(Headers::get().LastModified)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  pending_headers_.reset(new HeaderMapImpl(headers));
+  pending_max_age_ = max_age;
+  request_vary_ = std::move(vary);
+  if (end_stream) {
+    insertPendingResponse();
+  }
+
+  return FilterHeadersStatus::Continue;
+}
+
+FilterDataStatus CacheFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (not_modified_replacement_) {
+    data.drain(data.length());
+    if (end_stream) {
+      data.add(not_modified_replacement_->body_);
+      not_modified_replacement_.reset();
+    }
+    return FilterDataStatus::Continue;
+  }
+
+  if (!pending_headers_) {
+    return FilterDataStatus::Continue;
+  }
+
+  if (pending_body_.size() + data.length() > config_->maxEntryBytes()) {
+    pending_headers_.reset();
+    pending_body_.clear();
+    return FilterDataStatus::Continue;
+  }
+
+  uint64_t num_slices = data.getRawSlices(nullptr, 0);
+  Buffer::RawSlice slices[num_slices];
+  data.getRawSlices(slices, num_slices);
+  for (const Buffer::RawSlice& slice : slices) {
+    pending_body_.append(static_cast<const char*>(slice.mem_), slice.len_);
+  }
+
+  if (end_stream) {
+    insertPendingResponse();
+  }
+
+  return FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus CacheFilter::encodeTrailers(HeaderMap&) {
+  if (not_modified_replacement_) {
+    if (!not_modified_replacement_->body_.empty()) {
+      Buffer::OwnedImpl body(not_modified_replacement_->body_);
+      encoder_callbacks_->addEncodedData(body, false);
+    }
+    not_modified_replacement_.reset();
+    return FilterTrailersStatus::Continue;
+  }
+
+  // Responses with trailers are not cached.
+  pending_headers_.reset();
+  pending_body_.clear();
+  return FilterTrailersStatus::Continue;
+}
+
+void CacheFilter::insertPendingResponse() {
+  config_->cache().insert(key_, std::make_shared<const CachedResponse>(
+                                    *pending_headers_, pending_body_,
+                                    config_->timeSource().currentTime(), pending_max_age_,
+                                    request_vary_));
+  pending_headers_.reset();
+  pending_body_.clear();
+}
+
+} // namespace Http
+} // namespace Envoy
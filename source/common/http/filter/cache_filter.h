@@ -0,0 +1,239 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "envoy/common/optional.h"
+#include "envoy/common/time.h"
+#include "envoy/http/filter.h"
+#include "envoy/json/json_object.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/http/header_map_impl.h"
+#include "common/json/config_schemas.h"
+#include "common/json/json_validator.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All stats for the cache filter. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_CACHE_FILTER_STATS(COUNTER)                                                            \
+  COUNTER(rq_hit)                                                                                  \
+  COUNTER(rq_miss)                                                                                 \
+  COUNTER(rq_validated)                                                                            \
+  COUNTER(insert)                                                                                  \
+  COUNTER(evict)
+// clang-format on
+
+/**
+ * Wrapper struct for cache filter stats. @see stats_macros.h
+ */
+struct CacheFilterStats {
+  ALL_CACHE_FILTER_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * The subset of Cache-Control directives that are relevant to a shared cache.
+ */
+struct CacheControl {
+  /**
+   * Parse a Cache-Control header.
+   * @param header supplies the header entry, which may be nullptr.
+   * @return CacheControl the parsed directives.
+   */
+  static CacheControl parse(const HeaderEntry* header);
+
+  bool no_cache_{};
+  bool no_store_{};
+  bool private_{};
+  // s-maxage if present, otherwise max-age.
+  Optional<std::chrono::seconds> max_age_;
+};
+
+/**
+ * A response stored in the cache. Entries are never mutated once inserted, so a stream that is
+ * serving an entry can keep doing so even if the entry is concurrently evicted or replaced. The Age
+ * header of the response is not stored; it is recomputed whenever the response is served.
+ */
+struct CachedResponse {
+  CachedResponse(const HeaderMap& headers, const std::string& body, MonotonicTime response_time,
+                 std::chrono::seconds max_age,
+                 const std::vector<std::pair<LowerCaseString, std::string>>& vary);
+
+  /**
+   * @return uint64_t the number of bytes accounted against the cache budget for this entry.
+   */
+  uint64_t byteSize() const { return headers_->byteSize() + body_.size(); }
+
+  /**
+   * @return std::chrono::seconds the age of the response at time now: the age it already had when
+   *         it was received plus the time it has been resident in the cache.
+   */
+  std::chrono::seconds age(MonotonicTime now) const {
+    return initial_age_ + std::chrono::duration_cast<std::chrono::seconds>(now - response_time_);
+  }
+
+  /**
+   * @return bool whether the response can be served without revalidation at time now.
+   */
+  bool fresh(MonotonicTime now) const { return age(now) < max_age_; }
+
+  /**
+   * @return bool whether the request headers match the values of all headers the response varies
+   *         on.
+   */
+  bool varyMatches(const HeaderMap& request_headers) const;
+
+  HeaderMapPtr headers_;
+  std::string body_;
+  MonotonicTime response_time_;
+  // The Age header the response was received with, if any.
+  std::chrono::seconds initial_age_{};
+  std::chrono::seconds max_age_;
+  std::vector<std::pair<LowerCaseString, std::string>> vary_;
+};
+
+typedef std::shared_ptr<const CachedResponse> CachedResponseConstSharedPtr;
+
+/**
+ * A byte bounded LRU of cached responses. This is not thread safe; one instance is used per
+ * worker.
+ */
+class ResponseCache {
+public:
+  ResponseCache(uint64_t max_bytes, const CacheFilterStats& stats)
+      : max_bytes_(max_bytes), stats_(stats) {}
+
+  /**
+   * Find a response and mark it as most recently used.
+   * @param key supplies the cache key.
+   * @return CachedResponseConstSharedPtr the response or nullptr if there is none.
+   */
+  CachedResponseConstSharedPtr lookup(const std::string& key);
+
+  /**
+   * Insert or replace a response, evicting least recently used responses until the cache fits in
+   * its byte budget. Responses that are larger than the whole budget are not inserted.
+   */
+  void insert(const std::string& key, CachedResponseConstSharedPtr response);
+
+  /**
+   * Remove a response if present.
+   */
+  void remove(const std::string& key);
+
+  uint64_t bytes() const { return bytes_; }
+  size_t size() const { return entries_.size(); }
+
+private:
+  typedef std::list<std::pair<std::string, CachedResponseConstSharedPtr>> LruList;
+
+  void erase(LruList::iterator it);
+
+  LruList lru_;
+  std::unordered_map<std::string, LruList::iterator> entries_;
+  const uint64_t max_bytes_;
+  uint64_t bytes_{};
+  CacheFilterStats stats_;
+};
+
+/**
+ * Configuration for the cache filter. Each worker owns an independent cache of max_cache_bytes.
+ */
+class CacheFilterConfig : Json::Validator {
+public:
+  CacheFilterConfig(const Json::Object& json_config, const std::string& stats_prefix,
+                    Stats::Scope& scope, ThreadLocal::SlotAllocator& tls,
+                    MonotonicTimeSource& time_source);
+
+  ResponseCache& cache() { return tls_slot_->getTyped<ThreadLocalCache>().cache_; }
+  uint64_t maxEntryBytes() const { return max_entry_bytes_; }
+  CacheFilterStats& stats() { return stats_; }
+  MonotonicTimeSource& timeSource() { return time_source_; }
+
+private:
+  struct ThreadLocalCache : public ThreadLocal::ThreadLocalObject {
+    ThreadLocalCache(uint64_t max_bytes, const CacheFilterStats& stats)
+        : cache_(max_bytes, stats) {}
+
+    ResponseCache cache_;
+  };
+
+  static CacheFilterStats generateStats(const std::string& prefix, Stats::Scope& scope);
+
+  CacheFilterStats stats_;
+  const uint64_t max_cache_bytes_;
+  const uint64_t max_entry_bytes_;
+  MonotonicTimeSource& time_source_;
+  ThreadLocal::SlotPtr tls_slot_;
+};
+
+typedef std::shared_ptr<CacheFilterConfig> CacheFilterConfigSharedPtr;
+
+/**
+ * A filter that serves cacheable GET responses from a per-worker in-memory cache. Caching is
+ * enabled per route by setting the "cache" opaque config key of the route to "true". Stale
+ * responses carrying an ETag or Last-Modified header are revalidated with the upstream via
+ * conditional requests.
+ */
+class CacheFilter : public StreamFilter {
+public:
+  CacheFilter(CacheFilterConfigSharedPtr config);
+
+  static const std::string ROUTE_OPAQUE_CONFIG_KEY;
+
+  // Http::StreamFilterBase
+  void onDestroy() override {}
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance&, bool) override {
+    return FilterDataStatus::Continue;
+  }
+  FilterTrailersStatus decodeTrailers(HeaderMap&) override {
+    return FilterTrailersStatus::Continue;
+  }
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override {
+    decoder_callbacks_ = &callbacks;
+  }
+
+  // Http::StreamEncoderFilter
+  FilterHeadersStatus encodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus encodeTrailers(HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(StreamEncoderFilterCallbacks& callbacks) override {
+    encoder_callbacks_ = &callbacks;
+  }
+
+private:
+  bool cacheableRequest(const HeaderMap& headers, bool end_stream);
+  void serveFromCache(const CachedResponse& response);
+  void insertPendingResponse();
+
+  CacheFilterConfigSharedPtr config_;
+  StreamDecoderFilterCallbacks* decoder_callbacks_{};
+  StreamEncoderFilterCallbacks* encoder_callbacks_{};
+  const HeaderMap* request_headers_{};
+  std::string key_;
+  bool cacheable_request_{};
+  CachedResponseConstSharedPtr validating_response_;
+  // The refreshed response whose body replaces the remaining body of a 304.
+  CachedResponseConstSharedPtr not_modified_replacement_;
+  HeaderMapPtr pending_headers_;
+  std::string pending_body_;
+  std::chrono::seconds pending_max_age_{};
+  std::vector<std::pair<LowerCaseString, std::string>> request_vary_;
+};
+
+} // namespace Http
+} // namespace Envoy
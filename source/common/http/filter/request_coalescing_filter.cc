@@ -0,0 +1,208 @@
+#include "common/http/filter/request_coalescing_filter.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "envoy/router/router.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
+#include "common/common/utility.h"
+#include "common/http/header_map_impl.h"
+#include "common/http/headers.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Http {
+
+const std::string RequestCoalescingFilter::ROUTE_OPAQUE_CONFIG_KEY = "coalesce";
+const std::string RequestCoalescingFilter::ROUTE_OPAQUE_CONFIG_HEADERS_KEY = "coalesce_headers";
+
+RequestCoalescingFilterConfig::RequestCoalescingFilterConfig(const std::string& stats_prefix,
+                                                             Stats::Scope& scope,
+                                                             ThreadLocal::SlotAllocator& tls)
+    : stats_(generateStats(stats_prefix, scope)), tls_slot_(tls.allocateSlot()) {
+  tls_slot_->set([](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<ThreadLocalInFlight>();
+  });
+}
+
+RequestCoalescingFilterStats
+RequestCoalescingFilterConfig::generateStats(const std::string& prefix, Stats::Scope& scope) {
+  std::string final_prefix = prefix + "request_coalescing.";
+  return {ALL_REQUEST_COALESCING_FILTER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
+}
+
+bool RequestCoalescingFilter::buildKey(const HeaderMap& headers, bool end_stream) {
+  Router::RouteConstSharedPtr route = decoder_callbacks_->route();
+  if (!route || !route->routeEntry()) {
+    return false;
+  }
+
+  const auto& opaque_config = route->routeEntry()->opaqueConfig();
+  const auto it = opaque_config.find(ROUTE_OPAQUE_CONFIG_KEY);
+  if (it == opaque_config.end() || it->second != "true") {
+    return false;
+  }
+
+  // Only idempotent requests without a body can share a response.
+  if (!end_stream || !headers.Method() || !headers.Path() || !headers.Host() ||
+      (headers.Method()->value() != Headers::get().MethodValues.Get.c_str() &&
+       headers.Method()->value() != Headers::get().MethodValues.Head.c_str())) {
+    return false;
+  }
+
+  key_ = fmt::format("{}\n{}\n{}", headers.Method()->value().c_str(),
+                     headers.Host()->value().c_str(), headers.Path()->value().c_str());
+  const auto headers_it = opaque_config.find(ROUTE_OPAQUE_CONFIG_HEADERS_KEY);
+  if (headers_it != opaque_config.end()) {
+    for (const std::string& name : StringUtil::split(headers_it->second, ',')) {
+      const HeaderEntry* entry = headers.get(LowerCaseString(name));
+      key_ += fmt::format("\n{}", entry ? entry->value().c_str() : "");
+    }
+  }
+
+  return true;
+}
+
+FilterHeadersStatus RequestCoalescingFilter::decodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (!buildKey(headers, end_stream)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  auto& in_flight = config_->inFlight();
+  auto it = in_flight.find(key_);
+  if (it != in_flight.end()) {
+    ASSERT(!it->second->response_started_);
+    leader_filter_ = it->second;
+    leader_filter_->followers_.push_back(this);
+    config_->stats().rq_coalesced_.inc();
+    return FilterHeadersStatus::StopIteration;
+  }
+
+  in_flight.emplace(key_, this);
+  leader_ = true;
+  config_->stats().rq_leader_.inc();
+  return FilterHeadersStatus::Continue;
+}
+
+template <class Fn> void RequestCoalescingFilter::forEachFollower(Fn fn) {
+  // Encoding to a follower may synchronously reset and destroy it, which removes it from
+  // followers_. Iterate over a snapshot and skip followers that have gone away.
+  const std::vector<RequestCoalescingFilter*> followers(followers_.begin(), followers_.end());
+  for (RequestCoalescingFilter* follower : followers) {
+    if (std::find(followers_.begin(), followers_.end(), follower) != followers_.end()) {
+      fn(*follower);
+    }
+  }
+}
+
+FilterHeadersStatus RequestCoalescingFilter::encodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (!leader_) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  // Once the response has started, later identical requests can no longer join this one.
+  response_started_ = true;
+  removeFromInFlight();
+  forEachFollower([&headers, end_stream](RequestCoalescingFilter& follower) -> void {
+    follower.decoder_callbacks_->encodeHeaders(HeaderMapPtr{new HeaderMapImpl(headers)},
+                                               end_stream);
+  });
+
+  if (end_stream) {
+    onResponseComplete();
+  }
+  return FilterHeadersStatus::Continue;
+}
+
+FilterDataStatus RequestCoalescingFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (!leader_) {
+    return FilterDataStatus::Continue;
+  }
+
+  forEachFollower([&data, end_stream](RequestCoalescingFilter& follower) -> void {
+    Buffer::OwnedImpl copy(data);
+    follower.decoder_callbacks_->encodeData(copy, end_stream);
+  });
+
+  if (end_stream) {
+    onResponseComplete();
+  }
+  return FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus RequestCoalescingFilter::encodeTrailers(HeaderMap& trailers) {
+  if (!leader_) {
+    return FilterTrailersStatus::Continue;
+  }
+
+  forEachFollower([&trailers](RequestCoalescingFilter& follower) -> void {
+    follower.decoder_callbacks_->encodeTrailers(HeaderMapPtr{new HeaderMapImpl(trailers)});
+  });
+
+  onResponseComplete();
+  return FilterTrailersStatus::Continue;
+}
+
+void RequestCoalescingFilter::onResponseComplete() {
+  for (RequestCoalescingFilter* follower : followers_) {
+    follower->leader_filter_ = nullptr;
+  }
+  followers_.clear();
+}
+
+void RequestCoalescingFilter::removeFromInFlight() {
+  auto& in_flight = config_->inFlight();
+  auto it = in_flight.find(key_);
+  if (it != in_flight.end() && it->second == this) {
+    in_flight.erase(it);
+  }
+}
+
+void RequestCoalescingFilter::onDestroy() {
+  if (leader_filter_) {
+    leader_filter_->followers_.remove(this);
+    leader_filter_ = nullptr;
+  }
+
+  if (!leader_) {
+    return;
+  }
+
+  removeFromInFlight();
+  leader_ = false;
+  if (followers_.empty()) {
+    return;
+  }
+
+  if (response_started_) {
+    // Followers have already received part of a response that will never complete.
+    std::list<RequestCoalescingFilter*> followers;
+    followers.swap(followers_);
+    for (RequestCoalescingFilter* follower : followers) {
+      follower->leader_filter_ = nullptr;
+      config_->stats().rq_reset_.inc();
+      follower->decoder_callbacks_->resetStream();
+    }
+    return;
+  }
+
+  // The leader went away before its response started. Promote the first follower so that the
+  // remaining followers keep waiting on a single upstream request.
+  RequestCoalescingFilter* new_leader = followers_.front();
+  followers_.pop_front();
+  new_leader->leader_filter_ = nullptr;
+  new_leader->leader_ = true;
+  new_leader->followers_.swap(followers_);
+  for (RequestCoalescingFilter* follower : new_leader->followers_) {
+    follower->leader_filter_ = new_leader;
+  }
+  config_->inFlight().emplace(new_leader->key_, new_leader);
+  config_->stats().rq_promoted_.inc();
+  new_leader->decoder_callbacks_->continueDecoding();
+}
+
+} // namespace Http
+} // namespace Envoy
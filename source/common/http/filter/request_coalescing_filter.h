@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "envoy/http/filter.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All stats for the request coalescing filter. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_REQUEST_COALESCING_FILTER_STATS(COUNTER)                                               \
+  COUNTER(rq_leader)                                                                               \
+  COUNTER(rq_coalesced)                                                                            \
+  COUNTER(rq_promoted)                                                                             \
+  COUNTER(rq_reset)
+// clang-format on
+
+/**
+ * Wrapper struct for request coalescing filter stats. @see stats_macros.h
+ */
+struct RequestCoalescingFilterStats {
+  ALL_REQUEST_COALESCING_FILTER_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+class RequestCoalescingFilter;
+
+/**
+ * Configuration for the request coalescing filter. In flight requests are tracked per worker, so
+ * only identical requests that land on the same worker are coalesced.
+ */
+class RequestCoalescingFilterConfig {
+public:
+  RequestCoalescingFilterConfig(const std::string& stats_prefix, Stats::Scope& scope,
+                                ThreadLocal::SlotAllocator& tls);
+
+  /**
+   * @return the in flight leader requests on the current worker, keyed by coalescing key.
+   */
+  std::unordered_map<std::string, RequestCoalescingFilter*>& inFlight() {
+    return tls_slot_->getTyped<ThreadLocalInFlight>().in_flight_;
+  }
+
+  RequestCoalescingFilterStats& stats() { return stats_; }
+
+private:
+  struct ThreadLocalInFlight : public ThreadLocal::ThreadLocalObject {
+    std::unordered_map<std::string, RequestCoalescingFilter*> in_flight_;
+  };
+
+  static RequestCoalescingFilterStats generateStats(const std::string& prefix,
+                                                    Stats::Scope& scope);
+
+  RequestCoalescingFilterStats stats_;
+  ThreadLocal::SlotPtr tls_slot_;
+};
+
+typedef std::shared_ptr<RequestCoalescingFilterConfig> RequestCoalescingFilterConfigSharedPtr;
+
+/**
+ * A filter that coalesces identical in flight GET/HEAD requests. The first request for a key (the
+ * leader) is sent upstream and every identical request that arrives before the leader's response
+ * starts (a follower) waits for, and receives a copy of, the leader's response.
+ *
+ * Coalescing is enabled per route by setting the "coalesce" opaque config key to "true". The key
+ * is built from the method, host and path, plus the values of any request headers listed (comma
+ * separated) in the "coalesce_headers" opaque config key.
+ *
+ * If the leader goes away before its response starts, the first follower is promoted to leader
+ * and sent upstream. If it goes away after its response has started, followers are reset.
+ */
+class RequestCoalescingFilter : public StreamFilter {
+public:
+  RequestCoalescingFilter(RequestCoalescingFilterConfigSharedPtr config) : config_(config) {}
+
+  static const std::string ROUTE_OPAQUE_CONFIG_KEY;
+  static const std::string ROUTE_OPAQUE_CONFIG_HEADERS_KEY;
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance&, bool) override {
+    return FilterDataStatus::Continue;
+  }
+  FilterTrailersStatus decodeTrailers(HeaderMap&) override {
+    return FilterTrailersStatus::Continue;
+  }
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override {
+    decoder_callbacks_ = &callbacks;
+  }
+
+  // Http::StreamEncoderFilter
+  FilterHeadersStatus encodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus encodeTrailers(HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(StreamEncoderFilterCallbacks&) override {}
+
+private:
+  bool buildKey(const HeaderMap& headers, bool end_stream);
+  void removeFromInFlight();
+  void onResponseComplete();
+  template <class Fn> void forEachFollower(Fn fn);
+
+  RequestCoalescingFilterConfigSharedPtr config_;
+  StreamDecoderFilterCallbacks* decoder_callbacks_{};
+  std::string key_;
+  bool leader_{};
+  bool response_started_{};
+  RequestCoalescingFilter* leader_filter_{};
+  std::list<RequestCoalescingFilter*> followers_;
+};
+
+} // namespace Http
+} // namespace Envoy
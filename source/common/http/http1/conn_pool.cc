@@ -70,9 +70,13 @@ void ConnPoolImpl::createNewConnection() {
 ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_decoder,
                                                      ConnectionPool::Callbacks& callbacks) {
   if (!ready_clients_.empty()) {
-    ready_clients_.front()->moveBetweenLists(ready_clients_, busy_clients_);
-    ENVOY_CONN_LOG(debug, "using existing connection", *busy_clients_.front()->codec_client_);
-    attachRequestToClient(*busy_clients_.front(), response_decoder, callbacks);
+    ActiveClient& client = *ready_clients_.front();
+    client.moveBetweenLists(ready_clients_, busy_clients_);
+    if (client.idle_timer_) {
+      client.idle_timer_->disableTimer();
+    }
+    ENVOY_CONN_LOG(debug, "using existing connection", *client.codec_client_);
+    attachRequestToClient(client, response_decoder, callbacks);
     return nullptr;
   }
 
@@ -105,6 +109,9 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
       event == Network::ConnectionEvent::LocalClose) {
     // The client died.
     ENVOY_CONN_LOG(debug, "client disconnected", *client.codec_client_);
+    if (client.idle_timer_) {
+      client.idle_timer_->disableTimer();
+    }
     ActiveClientPtr removed;
     bool check_for_drained = true;
     if (client.stream_wrapper_) {
@@ -188,6 +195,14 @@ void ConnPoolImpl::onPendingRequestCancel(PendingRequest& request) {
   checkForDrained();
 }
 
+void ConnPoolImpl::onPendingRequestTimeout(PendingRequest& request) {
+  ENVOY_LOG(debug, "pending request timeout");
+  PendingRequestPtr removed = request.removeFromList(pending_requests_);
+  host_->cluster().stats().upstream_rq_pending_timeout_.inc();
+  removed->callbacks_.onPoolFailure(ConnectionPool::PoolFailureReason::Timeout, nullptr);
+  checkForDrained();
+}
+
 void ConnPoolImpl::onResponseComplete(ActiveClient& client) {
   ENVOY_CONN_LOG(debug, "response complete", *client.codec_client_);
   if (!client.stream_wrapper_->encode_complete_) {
@@ -211,6 +226,15 @@ void ConnPoolImpl::processIdleClient(ActiveClient& client) {
     // There is nothing to service so just move the connection into the ready list.
     ENVOY_CONN_LOG(debug, "moving to ready", *client.codec_client_);
     client.moveBetweenLists(busy_clients_, ready_clients_);
+
+    const Optional<std::chrono::milliseconds>& idle_timeout = host_->cluster().idleTimeout();
+    if (idle_timeout.valid()) {
+      if (!client.idle_timer_) {
+        client.idle_timer_ =
+            dispatcher_.createTimer([&client]() -> void { client.onIdleTimeout(); });
+      }
+      client.idle_timer_->enableTimer(idle_timeout.value());
+    }
   } else {
     // There is work to do so bind a request to the client and move it to the busy list. Pending
     // requests are pushed onto the front, so pull from the back.
@@ -259,13 +283,26 @@ void ConnPoolImpl::StreamWrapper::onDecodeComplete() {
 
 ConnPoolImpl::PendingRequest::PendingRequest(ConnPoolImpl& parent, StreamDecoder& decoder,
                                              ConnectionPool::Callbacks& callbacks)
-    : parent_(parent), decoder_(decoder), callbacks_(callbacks) {
+    : parent_(parent), decoder_(decoder), callbacks_(callbacks),
+      pending_time_(
+          new Stats::Timespan(parent_.host_->cluster().stats().upstream_rq_pending_ms_)) {
   parent_.host_->cluster().stats().upstream_rq_pending_total_.inc();
   parent_.host_->cluster().stats().upstream_rq_pending_active_.inc();
   parent_.host_->cluster().resourceManager(parent_.priority_).pendingRequests().inc();
+
+  const Optional<std::chrono::milliseconds>& max_pending_time =
+      parent_.host_->cluster().maxPendingTime();
+  if (max_pending_time.valid()) {
+    timeout_timer_ = parent_.dispatcher_.createTimer(
+        [this]() -> void { parent_.onPendingRequestTimeout(*this); });
+    timeout_timer_->enableTimer(max_pending_time.value());
+  }
 }
 
 ConnPoolImpl::PendingRequest::~PendingRequest() {
+  // The time spent waiting is recorded however the request leaves the queue, so that requests
+  // that time out or are cancelled are visible as well.
+  pending_time_->complete();
   parent_.host_->cluster().stats().upstream_rq_pending_active_.dec();
   parent_.host_->cluster().resourceManager(parent_.priority_).pendingRequests().dec();
 }
@@ -314,6 +351,13 @@ void ConnPoolImpl::ActiveClient::onConnectTimeout() {
   codec_client_->close();
 }
 
+void ConnPoolImpl::ActiveClient::onIdleTimeout() {
+  // The client is in the ready list, so closing it just removes it from the pool.
+  ENVOY_CONN_LOG(debug, "idle timeout", *codec_client_);
+  parent_.host_->cluster().stats().upstream_cx_idle_timeout_.inc();
+  codec_client_->close();
+}
+
 CodecClientPtr ConnPoolImplProd::createCodecClient(Upstream::Host::CreateConnectionData& data) {
   CodecClientPtr codec{new CodecClientProd(CodecClient::Type::HTTP1, std::move(data.connection_),
                                            data.host_description_)};
@@ -78,6 +78,7 @@ protected:
     ~ActiveClient();
 
     void onConnectTimeout();
+    void onIdleTimeout();
 
     // Network::ConnectionCallbacks
     void onEvent(Network::ConnectionEvent event) override {
@@ -91,6 +92,9 @@ protected:
     Upstream::HostDescriptionConstSharedPtr real_host_description_;
     StreamWrapperPtr stream_wrapper_;
     Event::TimerPtr connect_timer_;
+    // Only created once the client first becomes idle, and only if the cluster has an idle
+    // timeout.
+    Event::TimerPtr idle_timer_;
     Stats::TimespanPtr conn_length_;
     uint64_t remaining_requests_;
   };
@@ -108,6 +112,9 @@ protected:
     ConnPoolImpl& parent_;
     StreamDecoder& decoder_;
     ConnectionPool::Callbacks& callbacks_;
+    // Only created if the cluster has a maximum pending time.
+    Event::TimerPtr timeout_timer_;
+    Stats::TimespanPtr pending_time_;
   };
 
   typedef std::unique_ptr<PendingRequest> PendingRequestPtr;
@@ -120,12 +127,15 @@ protected:
   void onConnectionEvent(ActiveClient& client, Network::ConnectionEvent event);
   void onDownstreamReset(ActiveClient& client);
   void onPendingRequestCancel(PendingRequest& request);
+  void onPendingRequestTimeout(PendingRequest& request);
   void onResponseComplete(ActiveClient& client);
   void processIdleClient(ActiveClient& client);
 
   Stats::TimespanPtr conn_connect_ms_;
   Event::Dispatcher& dispatcher_;
   Upstream::HostConstSharedPtr host_;
+  // Idle clients are pushed onto and taken from the front, so that the most recently used
+  // connections are reused and the rest age out via the idle timeout.
   std::list<ActiveClientPtr> ready_clients_;
   std::list<ActiveClientPtr> busy_clients_;
   std::list<PendingRequestPtr> pending_requests_;
@@ -92,6 +92,9 @@ ConnectionPool::Cancellable* ConnPoolImpl::newStream(Http::StreamDecoder& respon
     host_->cluster().stats().upstream_rq_pending_overflow_.inc();
   } else {
     ENVOY_CONN_LOG(debug, "creating stream", *primary_client_->client_);
+    if (primary_client_->idle_timer_) {
+      primary_client_->idle_timer_->disableTimer();
+    }
     primary_client_->total_streams_++;
     host_->stats().rq_total_.inc();
     host_->stats().rq_active_.inc();
@@ -108,6 +111,9 @@ ConnectionPool::Cancellable* ConnPoolImpl::newStream(Http::StreamDecoder& respon
 void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEvent event) {
   if (event == Network::ConnectionEvent::RemoteClose ||
       event == Network::ConnectionEvent::LocalClose) {
+    if (client.idle_timer_) {
+      client.idle_timer_->disableTimer();
+    }
 
     if (client.closed_with_active_rq_) {
       host_->cluster().stats().upstream_cx_destroy_with_active_rq_.inc();
@@ -181,6 +187,12 @@ void ConnPoolImpl::onGoAway(ActiveClient& client) {
   }
 }
 
+void ConnPoolImpl::onIdleTimeout(ActiveClient& client) {
+  ENVOY_CONN_LOG(debug, "idle timeout", *client.client_);
+  host_->cluster().stats().upstream_cx_idle_timeout_.inc();
+  client.client_->close();
+}
+
 void ConnPoolImpl::onStreamDestroy(ActiveClient& client) {
   ENVOY_CONN_LOG(debug, "destroying stream: {} remaining", *client.client_,
                  client.client_->numActiveRequests());
@@ -190,6 +202,16 @@ void ConnPoolImpl::onStreamDestroy(ActiveClient& client) {
   if (&client == draining_client_.get() && client.client_->numActiveRequests() == 0) {
     // Close out the draining client if we no long have active requests.
     client.client_->close();
+  } else if (&client == primary_client_.get() && client.client_->numActiveRequests() == 0 &&
+             !client.closed_with_active_rq_) {
+    const Optional<std::chrono::milliseconds>& idle_timeout = host_->cluster().idleTimeout();
+    if (idle_timeout.valid()) {
+      if (!client.idle_timer_) {
+        client.idle_timer_ =
+            dispatcher_.createTimer([&client]() -> void { client.onIdleTimeout(); });
+      }
+      client.idle_timer_->enableTimer(idle_timeout.value());
+    }
   }
 
   // If we are destroying this stream because of a disconnect, do not check for drain here. We will
@@ -43,6 +43,7 @@ protected:
     ~ActiveClient();
 
     void onConnectTimeout() { parent_.onConnectTimeout(*this); }
+    void onIdleTimeout() { parent_.onIdleTimeout(*this); }
 
     // Network::ConnectionCallbacks
     void onEvent(Network::ConnectionEvent event) override {
@@ -65,6 +66,9 @@ protected:
     Upstream::HostDescriptionConstSharedPtr real_host_description_;
     uint64_t total_streams_{};
     Event::TimerPtr connect_timer_;
+    // Only created once the client first has no active requests, and only if the cluster has an
+    // idle timeout.
+    Event::TimerPtr idle_timer_;
     Stats::TimespanPtr conn_length_;
     bool closed_with_active_rq_{};
   };
@@ -78,6 +82,7 @@ protected:
   void onConnectionEvent(ActiveClient& client, Network::ConnectionEvent event);
   void onConnectTimeout(ActiveClient& client);
   void onGoAway(ActiveClient& client);
+  void onIdleTimeout(ActiveClient& client);
   void onStreamDestroy(ActiveClient& client);
   void onStreamReset(ActiveClient& client, Http::StreamResetReason reason);
 
@@ -918,6 +918,19 @@ const std::string Json::Schema::BUFFER_HTTP_FILTER_SCHEMA(R"EOF(
   }
   )EOF");
 
+const std::string Json::Schema::CACHE_HTTP_FILTER_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties" : {
+      "max_cache_bytes" : {"type" : "integer", "minimum" : 0},
+      "max_entry_bytes" : {"type" : "integer", "minimum" : 0}
+    },
+    "required" : ["max_cache_bytes"],
+    "additionalProperties" : false
+  }
+  )EOF");
+
 const std::string Json::Schema::LUA_HTTP_FILTER_SCHEMA(R"EOF(
   {
     "$schema": "http://json-schema.org/schema#",
@@ -1,11 +1,13 @@
 #include "common/router/config_impl.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <regex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -167,6 +169,12 @@ Optional<uint64_t> HashPolicyImpl::generateHash(const std::string& downstream_ad
   return hash;
 }
 
+uint64_t MetadataMatchCriteriaImpl::nextId() {
+  // Route tables are not always built on the main thread, so the counter is atomic.
+  static std::atomic<uint64_t> next_id{1};
+  return next_id++;
+}
+
 std::vector<MetadataMatchCriterionConstSharedPtr>
 MetadataMatchCriteriaImpl::extractMetadataMatchCriteria(const MetadataMatchCriteriaImpl* parent,
                                                         const ProtobufWkt::Struct& matches) {
@@ -218,13 +226,17 @@ const std::string& DecoratorImpl::getOperation() const { return operation_; }
 const uint64_t RouteEntryImplBase::WeightedClusterEntry::MAX_CLUSTER_WEIGHT = 100UL;
 
 RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
-                                       const envoy::api::v2::Route& route, Runtime::Loader& loader)
+                                       const envoy::api::v2::Route& route, Runtime::Loader& loader,
+                                       Upstream::ClusterManager& cm)
     : case_sensitive_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(route.match(), case_sensitive, true)),
       prefix_rewrite_(route.route().prefix_rewrite()), host_rewrite_(route.route().host_rewrite()),
       vhost_(vhost),
       auto_host_rewrite_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(route.route(), auto_host_rewrite, false)),
       use_websocket_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(route.route(), use_websocket, false)),
-      cluster_name_(route.route().cluster()), cluster_header_name_(route.route().cluster_header()),
+      cluster_name_(route.route().cluster()),
+      interned_cluster_name_(cluster_name_.empty() ? nullptr
+                                                   : cm.internClusterName(cluster_name_)),
+      cluster_header_name_(route.route().cluster_header()),
       timeout_(PROTOBUF_GET_MS_OR_DEFAULT(route.route(), timeout, DEFAULT_ROUTE_TIMEOUT_MS)),
       runtime_(loadRuntimeData(route.match())), loader_(loader),
       host_redirect_(route.redirect().host_redirect()),
@@ -271,7 +283,8 @@ RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
 
       std::unique_ptr<WeightedClusterEntry> cluster_entry(
           new WeightedClusterEntry(this, runtime_key_prefix + "." + cluster_name, loader_,
-                                   cluster_name, PROTOBUF_GET_WRAPPED_REQUIRED(cluster, weight),
+                                   cluster_name, cm.internClusterName(cluster_name),
+                                   PROTOBUF_GET_WRAPPED_REQUIRED(cluster, weight),
                                    std::move(cluster_metadata_match_criteria)));
       weighted_clusters_.emplace_back(std::move(cluster_entry));
       total_weight += weighted_clusters_.back()->clusterWeight();
@@ -320,6 +333,21 @@ bool RouteEntryImplBase::matchRoute(const Http::HeaderMap& headers, uint64_t ran
   return matches;
 }
 
+bool RouteEntryImplBase::routeCacheHeaders(std::set<std::string>& headers) const {
+  // Runtime fractions and weighted clusters make the match depend on the random value.
+  if (runtime_.valid() || !weighted_clusters_.empty()) {
+    return false;
+  }
+
+  for (const ConfigUtility::HeaderData& header_data : config_headers_) {
+    headers.insert(header_data.name_.get());
+  }
+  if (cluster_name_.empty() && !isRedirect()) {
+    headers.insert(cluster_header_name_.get());
+  }
+  return true;
+}
+
 const std::string& RouteEntryImplBase::clusterName() const { return cluster_name_; }
 
 void RouteEntryImplBase::finalizeRequestHeaders(Http::HeaderMap& headers,
@@ -446,7 +474,7 @@ RouteConstSharedPtr RouteEntryImplBase::clusterEntry(const Http::HeaderMap& head
       // NOTE: Though we return a shared_ptr here, the current ownership model assumes that
       //       the route table sticks around. See snapped_route_config_ in
       //       ConnectionManagerImpl::ActiveStream.
-      return std::make_shared<DynamicRouteEntry>(this, final_cluster_name);
+      return std::make_shared<DynamicRouteEntry>(this, final_cluster_name, nullptr);
     }
   }
 
@@ -500,8 +528,8 @@ void RouteEntryImplBase::validateClusters(Upstream::ClusterManager& cm) const {
 
 PrefixRouteEntryImpl::PrefixRouteEntryImpl(const VirtualHostImpl& vhost,
                                            const envoy::api::v2::Route& route,
-                                           Runtime::Loader& loader)
-    : RouteEntryImplBase(vhost, route, loader), prefix_(route.match().prefix()) {}
+                                           Runtime::Loader& loader, Upstream::ClusterManager& cm)
+    : RouteEntryImplBase(vhost, route, loader, cm), prefix_(route.match().prefix()) {}
 
 void PrefixRouteEntryImpl::finalizeRequestHeaders(
     Http::HeaderMap& headers, const AccessLog::RequestInfo& request_info) const {
@@ -520,8 +548,9 @@ RouteConstSharedPtr PrefixRouteEntryImpl::matches(const Http::HeaderMap& headers
 }
 
 PathRouteEntryImpl::PathRouteEntryImpl(const VirtualHostImpl& vhost,
-                                       const envoy::api::v2::Route& route, Runtime::Loader& loader)
-    : RouteEntryImplBase(vhost, route, loader), path_(route.match().path()) {}
+                                       const envoy::api::v2::Route& route, Runtime::Loader& loader,
+                                       Upstream::ClusterManager& cm)
+    : RouteEntryImplBase(vhost, route, loader, cm), path_(route.match().path()) {}
 
 void PathRouteEntryImpl::finalizeRequestHeaders(Http::HeaderMap& headers,
                                                 const AccessLog::RequestInfo& request_info) const {
@@ -560,8 +589,8 @@ RouteConstSharedPtr PathRouteEntryImpl::matches(const Http::HeaderMap& headers,
 
 RegexRouteEntryImpl::RegexRouteEntryImpl(const VirtualHostImpl& vhost,
                                          const envoy::api::v2::Route& route,
-                                         Runtime::Loader& loader)
-    : RouteEntryImplBase(vhost, route, loader),
+                                         Runtime::Loader& loader, Upstream::ClusterManager& cm)
+    : RouteEntryImplBase(vhost, route, loader, cm),
       regex_(std::regex{route.match().regex().c_str(), std::regex::optimize}) {}
 
 void RegexRouteEntryImpl::finalizeRequestHeaders(Http::HeaderMap& headers,
@@ -619,13 +648,13 @@ VirtualHostImpl::VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host
     const bool has_regex =
         route.match().path_specifier_case() == envoy::api::v2::RouteMatch::kRegex;
     if (has_prefix) {
-      routes_.emplace_back(new PrefixRouteEntryImpl(*this, route, runtime));
+      routes_.emplace_back(new PrefixRouteEntryImpl(*this, route, runtime, cm));
     } else if (has_path) {
-      routes_.emplace_back(new PathRouteEntryImpl(*this, route, runtime));
+      routes_.emplace_back(new PathRouteEntryImpl(*this, route, runtime, cm));
     } else {
       ASSERT(has_regex);
       UNREFERENCED_PARAMETER(has_regex);
-      routes_.emplace_back(new RegexRouteEntryImpl(*this, route, runtime));
+      routes_.emplace_back(new RegexRouteEntryImpl(*this, route, runtime, cm));
     }
 
     if (validate_clusters) {
@@ -726,6 +755,20 @@ RouteConstSharedPtr VirtualHostImpl::getRouteFromEntries(const Http::HeaderMap&
   return nullptr;
 }
 
+bool VirtualHostImpl::routeCacheHeaders(std::set<std::string>& headers) const {
+  if (ssl_requirements_ != SslRequirements::NONE) {
+    headers.insert(Http::Headers::get().ForwardedProto.get());
+    headers.insert(Http::Headers::get().EnvoyInternalRequest.get());
+  }
+
+  for (const RouteEntryImplBaseConstSharedPtr& route : routes_) {
+    if (!route->routeCacheHeaders(headers)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 const VirtualHostImpl* RouteMatcher::findVirtualHost(const Http::HeaderMap& headers) const {
   // Fast path the case where we only have a default virtual host.
   if (virtual_hosts_.empty() && default_virtual_host_) {
@@ -758,6 +801,24 @@ RouteConstSharedPtr RouteMatcher::route(const Http::HeaderMap& headers,
   }
 }
 
+bool RouteMatcher::routeCacheHeaders(std::set<std::string>& headers) const {
+  // A virtual host that serves several domains is visited once per domain. This only happens at
+  // config load.
+  for (const auto& virtual_host : virtual_hosts_) {
+    if (!virtual_host.second->routeCacheHeaders(headers)) {
+      return false;
+    }
+  }
+  for (const auto& wildcard_map : wildcard_virtual_host_suffixes_) {
+    for (const auto& virtual_host : wildcard_map.second) {
+      if (!virtual_host.second->routeCacheHeaders(headers)) {
+        return false;
+      }
+    }
+  }
+  return !default_virtual_host_ || default_virtual_host_->routeCacheHeaders(headers);
+}
+
 const VirtualHostImpl::CatchAllVirtualCluster VirtualHostImpl::VIRTUAL_CLUSTER_CATCH_ALL;
 const SslRedirector SslRedirectRoute::SSL_REDIRECTOR;
 const std::shared_ptr<const SslRedirectRoute> VirtualHostImpl::SSL_REDIRECT_ROUTE{
@@ -805,6 +866,59 @@ ConfigImpl::ConfigImpl(const envoy::api::v2::RouteConfiguration& config, Runtime
                                        header_value_option.header().value()});
   }
   request_headers_parser_ = RequestHeaderParser::parse(config.request_headers_to_add());
+
+  std::set<std::string> route_cache_headers;
+  route_cacheable_ = route_matcher_->routeCacheHeaders(route_cache_headers);
+  for (const std::string& header : route_cache_headers) {
+    route_cache_headers_.emplace_back(header);
+  }
+}
+
+std::string ConfigImpl::routeCacheKey(const Http::HeaderMap& headers) const {
+  std::string key = fmt::format("{}\n{}", headers.Host()->value().c_str(),
+                                headers.Path()->value().c_str());
+  // Header values cannot contain '\n'. A missing header is distinguished from an empty one.
+  for (const Http::LowerCaseString& name : route_cache_headers_) {
+    key += '\n';
+    const Http::HeaderEntry* entry = headers.get(name);
+    if (entry) {
+      key += '=';
+      key += entry->value().c_str();
+    }
+  }
+  return key;
+}
+
+const uint32_t CachingConfigImpl::DEFAULT_MAX_ENTRIES;
+
+ConfigConstSharedPtr CachingConfigImpl::create(ConfigImplConstSharedPtr config) {
+  if (!config->routeCacheable()) {
+    return config;
+  }
+  return std::make_shared<CachingConfigImpl>(config, DEFAULT_MAX_ENTRIES);
+}
+
+RouteConstSharedPtr CachingConfigImpl::route(const Http::HeaderMap& headers,
+                                             uint64_t random_value) const {
+  if (!headers.Host() || !headers.Path()) {
+    return config_->route(headers, random_value);
+  }
+
+  std::string key = config_->routeCacheKey(headers);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+
+  RouteConstSharedPtr route = config_->route(headers, random_value);
+  if (entries_.size() >= max_entries_) {
+    entries_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  lru_.emplace_front(key, route);
+  entries_.emplace(std::move(key), lru_.begin());
+  return route;
 }
 
 } // namespace Router
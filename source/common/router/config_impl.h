@@ -6,6 +6,7 @@
 #include <map>
 #include <memory>
 #include <regex>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -111,6 +112,14 @@ public:
   const ConfigImpl& globalRouteConfig() const { return global_route_config_; }
   const RequestHeaderParser& requestHeaderParser() const { return *request_headers_parser_; };
 
+  /**
+   * Collect the names of request headers, other than host and path, that route matching in this
+   * virtual host depends on.
+   * @param headers supplies the set to add header names to.
+   * @return bool false if matching also depends on runtime or random values.
+   */
+  bool routeCacheHeaders(std::set<std::string>& headers) const;
+
   // Router::VirtualHost
   const CorsPolicy* corsPolicy() const override { return cors_policy_.get(); }
   const std::string& name() const override { return name_; }
@@ -235,7 +244,8 @@ typedef std::unique_ptr<const MetadataMatchCriteriaImpl> MetadataMatchCriteriaIm
 class MetadataMatchCriteriaImpl : public MetadataMatchCriteria {
 public:
   MetadataMatchCriteriaImpl(const ProtobufWkt::Struct& metadata_matches)
-      : metadata_match_criteria_(extractMetadataMatchCriteria(nullptr, metadata_matches)){};
+      : metadata_match_criteria_(extractMetadataMatchCriteria(nullptr, metadata_matches)),
+        id_(nextId()){};
 
   /**
    * Creates a new MetadataMatchCriteriaImpl, merging existing
@@ -253,16 +263,19 @@ public:
   const std::vector<MetadataMatchCriterionConstSharedPtr>& metadataMatchCriteria() const override {
     return metadata_match_criteria_;
   }
+  uint64_t id() const override { return id_; }
 
 private:
   MetadataMatchCriteriaImpl(const std::vector<MetadataMatchCriterionConstSharedPtr>& criteria)
-      : metadata_match_criteria_(criteria){};
+      : metadata_match_criteria_(criteria), id_(nextId()){};
 
   static std::vector<MetadataMatchCriterionConstSharedPtr>
   extractMetadataMatchCriteria(const MetadataMatchCriteriaImpl* parent,
                                const ProtobufWkt::Struct& metadata_matches);
+  static uint64_t nextId();
 
   const std::vector<MetadataMatchCriterionConstSharedPtr> metadata_match_criteria_;
+  const uint64_t id_;
 };
 
 /**
@@ -292,18 +305,22 @@ class RouteEntryImplBase : public RouteEntry,
                            public std::enable_shared_from_this<RouteEntryImplBase> {
 public:
   RouteEntryImplBase(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                     Runtime::Loader& loader);
+                     Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   bool isRedirect() const { return !host_redirect_.empty() || !path_redirect_.empty(); }
 
   bool matchRoute(const Http::HeaderMap& headers, uint64_t random_value) const;
   void validateClusters(Upstream::ClusterManager& cm) const;
+  bool routeCacheHeaders(std::set<std::string>& headers) const;
   const std::list<std::pair<Http::LowerCaseString, std::string>>& requestHeadersToAdd() const {
     return request_headers_to_add_;
   }
 
   // Router::RouteEntry
   const std::string& clusterName() const override;
+  const Upstream::InternedClusterName* internedClusterName() const override {
+    return interned_cluster_name_.get();
+  }
   const CorsPolicy* corsPolicy() const override { return cors_policy_.get(); }
   void finalizeRequestHeaders(Http::HeaderMap& headers,
                               const AccessLog::RequestInfo& request_info) const override;
@@ -355,11 +372,15 @@ private:
 
   class DynamicRouteEntry : public RouteEntry, public Route {
   public:
-    DynamicRouteEntry(const RouteEntryImplBase* parent, const std::string& name)
-        : parent_(parent), cluster_name_(name) {}
+    DynamicRouteEntry(const RouteEntryImplBase* parent, const std::string& name,
+                      Upstream::InternedClusterNameConstSharedPtr interned_cluster_name)
+        : parent_(parent), cluster_name_(name), interned_cluster_name_(interned_cluster_name) {}
 
     // Router::RouteEntry
     const std::string& clusterName() const override { return cluster_name_; }
+    const Upstream::InternedClusterName* internedClusterName() const override {
+      return interned_cluster_name_.get();
+    }
 
     void finalizeRequestHeaders(Http::HeaderMap& headers,
                                 const AccessLog::RequestInfo& request_info) const override {
@@ -400,6 +421,8 @@ private:
   private:
     const RouteEntryImplBase* parent_;
     const std::string cluster_name_;
+    // nullptr when the cluster name comes from a request header, which is not interned.
+    const Upstream::InternedClusterNameConstSharedPtr interned_cluster_name_;
   };
 
   /**
@@ -411,10 +434,11 @@ private:
   class WeightedClusterEntry : public DynamicRouteEntry {
   public:
     WeightedClusterEntry(const RouteEntryImplBase* parent, const std::string runtime_key,
-                         Runtime::Loader& loader, const std::string& name, uint64_t weight,
+                         Runtime::Loader& loader, const std::string& name,
+                         Upstream::InternedClusterNameConstSharedPtr interned_name, uint64_t weight,
                          MetadataMatchCriteriaImplConstPtr cluster_metadata_match_criteria)
-        : DynamicRouteEntry(parent, name), runtime_key_(runtime_key), loader_(loader),
-          cluster_weight_(weight),
+        : DynamicRouteEntry(parent, name, interned_name), runtime_key_(runtime_key),
+          loader_(loader), cluster_weight_(weight),
           cluster_metadata_match_criteria_(std::move(cluster_metadata_match_criteria)) {}
 
     uint64_t clusterWeight() const {
@@ -455,6 +479,9 @@ private:
   const bool auto_host_rewrite_;
   const bool use_websocket_;
   const std::string cluster_name_;
+  // Resolved once at config load so that requests look up the cluster by index. nullptr for
+  // weighted cluster, cluster_header and redirect routes.
+  const Upstream::InternedClusterNameConstSharedPtr interned_cluster_name_;
   const Http::LowerCaseString cluster_header_name_;
   const std::chrono::milliseconds timeout_;
   const Optional<RuntimeData> runtime_;
@@ -485,7 +512,7 @@ private:
 class PrefixRouteEntryImpl : public RouteEntryImplBase {
 public:
   PrefixRouteEntryImpl(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                       Runtime::Loader& loader);
+                       Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   // Router::RouteEntry
   void finalizeRequestHeaders(Http::HeaderMap& headers,
@@ -504,7 +531,7 @@ private:
 class PathRouteEntryImpl : public RouteEntryImplBase {
 public:
   PathRouteEntryImpl(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                     Runtime::Loader& loader);
+                     Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   // Router::RouteEntry
   void finalizeRequestHeaders(Http::HeaderMap& headers,
@@ -523,7 +550,7 @@ private:
 class RegexRouteEntryImpl : public RouteEntryImplBase {
 public:
   RegexRouteEntryImpl(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                      Runtime::Loader& loader);
+                      Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   // Router::RouteEntry
   void finalizeRequestHeaders(Http::HeaderMap& headers,
@@ -547,6 +574,7 @@ public:
                Upstream::ClusterManager& cm, bool validate_clusters);
 
   RouteConstSharedPtr route(const Http::HeaderMap& headers, uint64_t random_value) const;
+  bool routeCacheHeaders(std::set<std::string>& headers) const;
 
 private:
   const VirtualHostImpl* findVirtualHost(const Http::HeaderMap& headers) const;
@@ -581,6 +609,18 @@ public:
 
   const RequestHeaderParser& requestHeaderParser() const { return *request_headers_parser_; };
 
+  /**
+   * @return bool whether route() results depend only on the request headers covered by
+   *         routeCacheKey(), so can be memoized.
+   */
+  bool routeCacheable() const { return route_cacheable_; }
+
+  /**
+   * @return std::string a key that is equal for any two requests that route() resolves to the
+   *         same route. Only valid if routeCacheable() is true.
+   */
+  std::string routeCacheKey(const Http::HeaderMap& headers) const;
+
   // Router::Config
   RouteConstSharedPtr route(const Http::HeaderMap& headers, uint64_t random_value) const override {
     return route_matcher_->route(headers, random_value);
@@ -606,6 +646,56 @@ private:
   std::list<Http::LowerCaseString> response_headers_to_remove_;
   std::list<std::pair<Http::LowerCaseString, std::string>> request_headers_to_add_;
   RequestHeaderParserPtr request_headers_parser_;
+  bool route_cacheable_{};
+  std::vector<Http::LowerCaseString> route_cache_headers_;
+};
+
+typedef std::shared_ptr<const ConfigImpl> ConfigImplConstSharedPtr;
+
+/**
+ * A per-worker view of a ConfigImpl that memoizes route() results in a small LRU. This is not
+ * thread safe and must only be used for configs that are routeCacheable(). Since a new ConfigImpl
+ * is built on every RDS update, the cache is implicitly invalidated along with the config.
+ */
+class CachingConfigImpl : public Config {
+public:
+  CachingConfigImpl(ConfigImplConstSharedPtr config, uint32_t max_entries)
+      : config_(config), max_entries_(max_entries) {}
+
+  /**
+   * Wrap a config in a CachingConfigImpl if its route results can be memoized.
+   * @param config supplies the config to wrap.
+   * @return ConfigConstSharedPtr the config to use on the calling worker.
+   */
+  static ConfigConstSharedPtr create(ConfigImplConstSharedPtr config);
+
+  size_t size() const { return entries_.size(); }
+
+  // Router::Config
+  RouteConstSharedPtr route(const Http::HeaderMap& headers, uint64_t random_value) const override;
+
+  const std::list<Http::LowerCaseString>& internalOnlyHeaders() const override {
+    return config_->internalOnlyHeaders();
+  }
+
+  const std::list<std::pair<Http::LowerCaseString, std::string>>&
+  responseHeadersToAdd() const override {
+    return config_->responseHeadersToAdd();
+  }
+
+  const std::list<Http::LowerCaseString>& responseHeadersToRemove() const override {
+    return config_->responseHeadersToRemove();
+  }
+
+  static const uint32_t DEFAULT_MAX_ENTRIES = 128;
+
+private:
+  typedef std::list<std::pair<std::string, RouteConstSharedPtr>> LruList;
+
+  const ConfigImplConstSharedPtr config_;
+  const uint32_t max_entries_;
+  mutable LruList lru_;
+  mutable std::unordered_map<std::string, LruList::iterator> entries_;
 };
 
 /**
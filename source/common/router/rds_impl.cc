@@ -19,12 +19,13 @@ namespace Router {
 
 RouteConfigProviderSharedPtr RouteConfigProviderUtil::create(
     const envoy::api::v2::filter::http::HttpConnectionManager& config, Runtime::Loader& runtime,
-    Upstream::ClusterManager& cm, Stats::Scope& scope, const std::string& stat_prefix,
-    Init::Manager& init_manager, RouteConfigProviderManager& route_config_provider_manager) {
+    Upstream::ClusterManager& cm, ThreadLocal::SlotAllocator& tls, Stats::Scope& scope,
+    const std::string& stat_prefix, Init::Manager& init_manager,
+    RouteConfigProviderManager& route_config_provider_manager) {
   switch (config.route_specifier_case()) {
   case envoy::api::v2::filter::http::HttpConnectionManager::kRouteConfig:
     return RouteConfigProviderSharedPtr{
-        new StaticRouteConfigProviderImpl(config.route_config(), runtime, cm)};
+        new StaticRouteConfigProviderImpl(config.route_config(), runtime, cm, tls)};
   case envoy::api::v2::filter::http::HttpConnectionManager::kRds:
     return route_config_provider_manager.getRouteConfigProvider(config.rds(), cm, scope,
                                                                 stat_prefix, init_manager);
@@ -35,8 +36,13 @@ RouteConfigProviderSharedPtr RouteConfigProviderUtil::create(
 
 StaticRouteConfigProviderImpl::StaticRouteConfigProviderImpl(
     const envoy::api::v2::RouteConfiguration& config, Runtime::Loader& runtime,
-    Upstream::ClusterManager& cm)
-    : config_(new ConfigImpl(config, runtime, cm, true)) {}
+    Upstream::ClusterManager& cm, ThreadLocal::SlotAllocator& tls)
+    : tls_(tls.allocateSlot()) {
+  ConfigImplConstSharedPtr shared_config(new ConfigImpl(config, runtime, cm, true));
+  tls_->set([shared_config](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<ThreadLocalRouteConfig>(CachingConfigImpl::create(shared_config));
+  });
+}
 
 // TODO(htuch): If support for multiple clusters is added per #1170 cluster_name_
 // initialization needs to be fixed.
@@ -55,7 +61,7 @@ RdsRouteConfigProviderImpl::RdsRouteConfigProviderImpl(
   ::Envoy::Config::Utility::checkLocalInfo("rds", local_info);
   ConfigConstSharedPtr initial_config(new NullConfigImpl());
   tls_->set([initial_config](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
-    return std::make_shared<ThreadLocalConfig>(initial_config);
+    return std::make_shared<ThreadLocalRouteConfig>(initial_config);
   });
   subscription_ = Envoy::Config::SubscriptionFactory::subscriptionFromConfigSource<
       envoy::api::v2::RouteConfiguration>(
@@ -90,7 +96,7 @@ RdsRouteConfigProviderImpl::~RdsRouteConfigProviderImpl() {
 }
 
 Router::ConfigConstSharedPtr RdsRouteConfigProviderImpl::config() {
-  return tls_->getTyped<ThreadLocalConfig>().config_;
+  return tls_->getTyped<ThreadLocalRouteConfig>().config_;
 }
 
 void RdsRouteConfigProviderImpl::onConfigUpdate(const ResourceVector& resources) {
@@ -111,14 +117,16 @@ void RdsRouteConfigProviderImpl::onConfigUpdate(const ResourceVector& resources)
   }
   const uint64_t new_hash = MessageUtil::hash(route_config);
   if (new_hash != last_config_hash_ || !initialized_) {
-    ConfigConstSharedPtr new_config(new ConfigImpl(route_config, runtime_, cm_, false));
+    ConfigImplConstSharedPtr new_config(new ConfigImpl(route_config, runtime_, cm_, false));
     initialized_ = true;
     last_config_hash_ = new_hash;
     stats_.config_reload_.inc();
     ENVOY_LOG(debug, "rds: loading new configuration: config_name={} hash={}", route_config_name_,
               new_hash);
-    tls_->runOnAllThreads(
-        [this, new_config]() -> void { tls_->getTyped<ThreadLocalConfig>().config_ = new_config; });
+    // Each worker gets a fresh route cache along with the new config.
+    tls_->runOnAllThreads([this, new_config]() -> void {
+      tls_->getTyped<ThreadLocalRouteConfig>().config_ = CachingConfigImpl::create(new_config);
+    });
     route_config_proto_ = route_config;
   }
   runInitializeCallbackIfAny();
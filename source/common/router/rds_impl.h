@@ -35,25 +35,38 @@ public:
    */
   static RouteConfigProviderSharedPtr
   create(const envoy::api::v2::filter::http::HttpConnectionManager& config,
-         Runtime::Loader& runtime, Upstream::ClusterManager& cm, Stats::Scope& scope,
-         const std::string& stat_prefix, Init::Manager& init_manager,
+         Runtime::Loader& runtime, Upstream::ClusterManager& cm, ThreadLocal::SlotAllocator& tls,
+         Stats::Scope& scope, const std::string& stat_prefix, Init::Manager& init_manager,
          RouteConfigProviderManager& route_config_provider_manager);
 };
 
+/**
+ * Per-worker route configuration. Each worker gets its own view of the shared configuration so
+ * that route lookups can be memoized without locking. @see CachingConfigImpl.
+ */
+struct ThreadLocalRouteConfig : public ThreadLocal::ThreadLocalObject {
+  ThreadLocalRouteConfig(ConfigConstSharedPtr config) : config_(config) {}
+
+  ConfigConstSharedPtr config_;
+};
+
 /**
  * Implementation of RouteConfigProvider that holds a static route configuration.
  */
 class StaticRouteConfigProviderImpl : public RouteConfigProvider {
 public:
   StaticRouteConfigProviderImpl(const envoy::api::v2::RouteConfiguration& config,
-                                Runtime::Loader& runtime, Upstream::ClusterManager& cm);
+                                Runtime::Loader& runtime, Upstream::ClusterManager& cm,
+                                ThreadLocal::SlotAllocator& tls);
 
   // Router::RouteConfigProvider
-  Router::ConfigConstSharedPtr config() override { return config_; }
+  Router::ConfigConstSharedPtr config() override {
+    return tls_->getTyped<ThreadLocalRouteConfig>().config_;
+  }
   const std::string versionInfo() const override { CONSTRUCT_ON_FIRST_USE(std::string, "static"); }
 
 private:
-  ConfigConstSharedPtr config_;
+  ThreadLocal::SlotPtr tls_;
 };
 
 /**
@@ -109,12 +122,6 @@ public:
   void onConfigUpdateFailed(const EnvoyException* e) override;
 
 private:
-  struct ThreadLocalConfig : public ThreadLocal::ThreadLocalObject {
-    ThreadLocalConfig(ConfigConstSharedPtr initial_config) : config_(initial_config) {}
-
-    ConfigConstSharedPtr config_;
-  };
-
   RdsRouteConfigProviderImpl(const envoy::api::v2::filter::http::Rds& rds,
                              const std::string& manager_identifier, Runtime::Loader& runtime,
                              Upstream::ClusterManager& cm, Event::Dispatcher& dispatcher,
@@ -148,8 +148,12 @@ RetryStatus RetryStateImpl::shouldRetry(const Http::HeaderMap* response_headers,
     return RetryStatus::No;
   }
 
-  if (!cluster_.resourceManager(priority_).retries().canCreate()) {
+  Upstream::ResourceManager& resource_manager = cluster_.resourceManager(priority_);
+  if (!resource_manager.retries().canCreate()) {
     cluster_.stats().upstream_rq_retry_overflow_.inc();
+    if (resource_manager.retryBudgetActive()) {
+      cluster_.stats().upstream_rq_retry_budget_exhausted_.inc();
+    }
     return RetryStatus::NoOverflow;
   }
 
@@ -159,7 +163,7 @@ RetryStatus RetryStateImpl::shouldRetry(const Http::HeaderMap* response_headers,
 
   ASSERT(!callback_);
   callback_ = callback;
-  cluster_.resourceManager(priority_).retries().inc();
+  resource_manager.retries().inc();
   cluster_.stats().upstream_rq_retry_.inc();
   enableBackoffTimer();
   return RetryStatus::Yes;
@@ -172,8 +176,9 @@ bool RetryStateImpl::wouldRetry(const Http::HeaderMap* response_headers,
     return false;
   }
 
-  // we never retry if the reset reason is overflow.
-  if (reset_reason.valid() && reset_reason.value() == Http::StreamResetReason::Overflow) {
+  // we never retry if the reset reason is overflow, or a pending timeout in a saturated pool.
+  if (reset_reason.valid() && (reset_reason.value() == Http::StreamResetReason::Overflow ||
+                               reset_reason.value() == Http::StreamResetReason::PendingTimeout)) {
     return false;
   }
 
@@ -21,7 +21,6 @@
 #include "common/http/codes.h"
 #include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
-#include "common/http/message_impl.h"
 #include "common/http/utility.h"
 #include "common/router/config_impl.h"
 #include "common/router/retry_state_impl.h"
@@ -102,6 +101,7 @@ Filter::~Filter() {
   // Upstream resources should already have been cleaned.
   ASSERT(!upstream_request_);
   ASSERT(!retry_state_);
+  ASSERT(!adaptive_requests_);
 }
 
 const std::string Filter::upstreamZone(Upstream::HostDescriptionConstSharedPtr upstream_host) {
@@ -219,7 +219,12 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
 
   // A route entry matches for the request.
   route_entry_ = route_->routeEntry();
-  Upstream::ThreadLocalCluster* cluster = config_.cm_.get(route_entry_->clusterName());
+  // Routes with a fixed cluster resolve it by interned name. Only cluster_header routes, whose
+  // cluster is picked per request, fall back to a lookup by name.
+  const Upstream::InternedClusterName* interned_cluster = route_entry_->internedClusterName();
+  Upstream::ThreadLocalCluster* cluster = interned_cluster != nullptr
+                                              ? config_.cm_.get(*interned_cluster)
+                                              : config_.cm_.get(route_entry_->clusterName());
   if (!cluster) {
     config_.stats_.no_cluster_.inc();
     ENVOY_STREAM_LOG(debug, "unknown cluster '{}'", *callbacks_, route_entry_->clusterName());
@@ -252,13 +257,29 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
     return Http::FilterHeadersStatus::StopIteration;
   }
 
-  // Fetch a connection pool for the upstream cluster.
-  Http::ConnectionPool::Instance* conn_pool = getConnPool();
+  // Fetch a connection pool for the upstream cluster. The cluster was already looked up above, so
+  // ask it directly rather than looking it up by name again.
+  Http::ConnectionPool::Instance* conn_pool =
+      cluster->httpConnPool(route_entry_->priority(), this);
   if (!conn_pool) {
     sendNoHealthyUpstreamResponse();
     return Http::FilterHeadersStatus::StopIteration;
   }
 
+  // Reject requests beyond the cluster's adaptive concurrency limit before they are queued in the
+  // connection pool.
+  Upstream::Resource& adaptive_requests =
+      cluster_->resourceManager(route_entry_->priority()).adaptiveRequests();
+  if (!adaptive_requests.canCreate()) {
+    callbacks_->requestInfo().setResponseFlag(AccessLog::ResponseFlag::UpstreamOverflow);
+    chargeUpstreamCode(Http::Code::ServiceUnavailable, nullptr, true);
+    sendLocalReply(Http::Code::ServiceUnavailable, "upstream concurrency limit exceeded", true);
+    cluster_->stats().upstream_rq_concurrency_limited_.inc();
+    return Http::FilterHeadersStatus::StopIteration;
+  }
+  adaptive_requests.inc();
+  adaptive_requests_ = &adaptive_requests;
+
   timeout_ = FilterUtility::finalTimeout(*route_entry_, headers);
 
   // If this header is set with any value, use an alternate response code on timeout
@@ -272,8 +293,6 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
   retry_state_ =
       createRetryState(route_entry_->retryPolicy(), headers, *cluster_, config_.runtime_,
                        config_.random_, callbacks_->dispatcher(), route_entry_->priority());
-  do_shadowing_ = FilterUtility::shouldShadow(route_entry_->shadowPolicy(), config_.runtime_,
-                                              callbacks_->streamId());
 
 #ifndef NVLOG
   headers.iterate(
@@ -296,6 +315,11 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
   grpc_request_ = Grpc::Common::hasGrpcContentType(headers);
   upstream_request_.reset(new UpstreamRequest(*this, *conn_pool));
   upstream_request_->encodeHeaders(end_stream);
+  // Even if we got an immediate reset, we could still shadow, but that is a riskier change and
+  // seems unnecessary right now.
+  if (upstream_request_) {
+    maybeStartShadowing(end_stream);
+  }
   if (end_stream) {
     onRequestComplete();
   }
@@ -315,18 +339,19 @@ void Filter::sendNoHealthyUpstreamResponse() {
 }
 
 Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_stream) {
-  bool buffering = (retry_state_ && retry_state_->enabled()) || do_shadowing_;
+  bool buffering = retry_state_ && retry_state_->enabled();
   if (buffering && buffer_limit_ > 0 &&
       getLength(callbacks_->decodingBuffer()) + data.length() > buffer_limit_) {
-    // The request is larger than we should buffer.  Give up on the retry/shadow
+    // The request is larger than we should buffer.  Give up on the retry.
     cluster_->stats().retry_or_shadow_abandoned_.inc();
     retry_state_.reset();
     buffering = false;
-    do_shadowing_ = false;
   }
 
-  // If we are going to buffer for retries or shadowing, we need to make a copy before encoding
-  // since it's all moves from here on.
+  maybeShadowData(data, end_stream);
+
+  // If we are going to buffer for retries, we need to make a copy before encoding since it's all
+  // moves from here on.
   if (buffering) {
     Buffer::OwnedImpl copy(data);
     upstream_request_->encodeData(copy, end_stream);
@@ -338,7 +363,7 @@ Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_strea
     onRequestComplete();
   }
 
-  // If we are potentially going to retry or shadow this request we need to buffer.
+  // If we are potentially going to retry this request we need to buffer.
   // This will not cause the connection manager to 413 because before we hit the
   // buffer limit we give up on retries and buffering.
   return buffering ? Http::FilterDataStatus::StopIterationAndBuffer
@@ -347,6 +372,10 @@ Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_strea
 
 Http::FilterTrailersStatus Filter::decodeTrailers(Http::HeaderMap& trailers) {
   downstream_trailers_ = &trailers;
+  if (shadow_stream_) {
+    shadow_stream_->sendTrailers(trailers);
+    shadow_stream_ = nullptr;
+  }
   upstream_request_->encodeTrailers(trailers);
   onRequestComplete();
   return Http::FilterTrailersStatus::StopIteration;
@@ -367,25 +396,42 @@ void Filter::cleanup() {
     response_timeout_->disableTimer();
     response_timeout_.reset();
   }
+  if (adaptive_requests_) {
+    adaptive_requests_->dec();
+    adaptive_requests_ = nullptr;
+  }
 }
 
-void Filter::maybeDoShadowing() {
-  if (!do_shadowing_) {
+void Filter::maybeStartShadowing(bool end_stream) {
+  if (!FilterUtility::shouldShadow(route_entry_->shadowPolicy(), config_.runtime_,
+                                   callbacks_->streamId())) {
     return;
   }
 
   ASSERT(!route_entry_->shadowPolicy().cluster().empty());
-  Http::MessagePtr request(new Http::RequestMessageImpl(
-      Http::HeaderMapPtr{new Http::HeaderMapImpl(*downstream_headers_)}));
-  if (callbacks_->decodingBuffer()) {
-    request->body().reset(new Buffer::OwnedImpl(*callbacks_->decodingBuffer()));
+  shadow_stream_ = config_.shadowWriter().shadow(
+      route_entry_->shadowPolicy().cluster(),
+      Http::HeaderMapPtr{new Http::HeaderMapImpl(*downstream_headers_)}, end_stream,
+      timeout_.global_timeout_, buffer_limit_);
+}
+
+void Filter::maybeShadowData(Buffer::Instance& data, bool end_stream) {
+  if (!shadow_stream_) {
+    return;
   }
-  if (downstream_trailers_) {
-    request->trailers(Http::HeaderMapPtr{new Http::HeaderMapImpl(*downstream_trailers_)});
+
+  // The shadow stream holds data only while the shadow upstream is backed up, and cancels itself
+  // if what it holds goes over the buffer limit.
+  Buffer::OwnedImpl copy(data);
+  if (!shadow_stream_->sendData(copy, end_stream)) {
+    cluster_->stats().retry_or_shadow_abandoned_.inc();
+    shadow_stream_ = nullptr;
+    return;
   }
 
-  config_.shadowWriter().shadow(route_entry_->shadowPolicy().cluster(), std::move(request),
-                                timeout_.global_timeout_);
+  if (end_stream) {
+    shadow_stream_ = nullptr;
+  }
 }
 
 void Filter::onRequestComplete() {
@@ -398,10 +444,6 @@ void Filter::onRequestComplete() {
     // Nominally how long it took to send the request.
     upstream_request_->request_info_.requestReceivedDuration(downstream_request_complete_time_);
 
-    // Even if we got an immediate reset, we could still shadow, but that is a riskier change and
-    // seems unnecessary right now.
-    maybeDoShadowing();
-
     upstream_request_->setupPerTryTimeout();
     if (timeout_.global_timeout_.count() > 0) {
       response_timeout_ =
@@ -415,6 +457,10 @@ void Filter::onDestroy() {
   if (upstream_request_) {
     upstream_request_->resetStream();
   }
+  if (shadow_stream_) {
+    shadow_stream_->cancel();
+    shadow_stream_ = nullptr;
+  }
   stream_destroyed_ = true;
   cleanup();
 }
@@ -423,6 +469,14 @@ void Filter::onResponseTimeout() {
   ENVOY_STREAM_LOG(debug, "upstream timeout", *callbacks_);
   cluster_->stats().upstream_rq_timeout_.inc();
 
+  // A timed out request is the strongest sign of queueing upstream, so it feeds the adaptive
+  // concurrency limit with the time it waited.
+  if (!callbacks_->requestInfo().healthCheck()) {
+    cluster_->resourceManager(route_entry_->priority())
+        .recordRequestRtt(
+            std::chrono::duration_cast<std::chrono::microseconds>(timeout_.global_timeout_));
+  }
+
   // It's possible to timeout during a retry backoff delay when we have no upstream request. In
   // this case we fake a reset since onUpstreamReset() doesn't care.
   if (upstream_request_) {
@@ -493,8 +547,10 @@ void Filter::onUpstreamReset(UpstreamResetType type,
       body = "upstream connect error or disconnect/reset before headers";
     }
 
+    // Requests that never left a local connection pool are not charged to the upstream host.
     const bool dropped =
-        reset_reason.valid() && reset_reason.value() == Http::StreamResetReason::Overflow;
+        reset_reason.valid() && (reset_reason.value() == Http::StreamResetReason::Overflow ||
+                                 reset_reason.value() == Http::StreamResetReason::PendingTimeout);
     chargeUpstreamCode(code, upstream_host, dropped);
     // If we had non-5xx but still have been reset by backend or timeout before
     // starting response, we treat this as an error. We only get non-5xx when
@@ -519,6 +575,8 @@ Filter::streamResetReasonToResponseFlag(Http::StreamResetReason reset_reason) {
     return AccessLog::ResponseFlag::LocalReset;
   case Http::StreamResetReason::Overflow:
     return AccessLog::ResponseFlag::UpstreamOverflow;
+  case Http::StreamResetReason::PendingTimeout:
+    return AccessLog::ResponseFlag::UpstreamPendingTimeout;
   case Http::StreamResetReason::RemoteReset:
   case Http::StreamResetReason::RemoteRefusedStreamReset:
     return AccessLog::ResponseFlag::UpstreamRemoteReset;
@@ -641,13 +699,25 @@ void Filter::onUpstreamComplete() {
     upstream_request_->resetStream();
   }
 
+  if (!callbacks_->requestInfo().healthCheck() &&
+      DateUtil::timePointValid(downstream_request_complete_time_)) {
+    // Load balancers, outlier detection and the adaptive concurrency limit use response times
+    // regardless of whether stats are emitted.
+    const MonotonicTime now = std::chrono::steady_clock::now();
+    const std::chrono::microseconds response_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                              downstream_request_complete_time_);
+    upstream_request_->upstream_host_->recordResponseTime(response_time, now);
+    upstream_request_->upstream_host_->outlierDetector().putResponseTime(
+        std::chrono::duration_cast<std::chrono::milliseconds>(response_time));
+    cluster_->resourceManager(route_entry_->priority()).recordRequestRtt(response_time);
+  }
+
   if (config_.emit_dynamic_stats_ && !callbacks_->requestInfo().healthCheck() &&
       DateUtil::timePointValid(downstream_request_complete_time_)) {
     std::chrono::milliseconds response_time = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - downstream_request_complete_time_);
 
-    upstream_request_->upstream_host_->outlierDetector().putResponseTime(response_time);
-
     const Http::HeaderEntry* internal_request_header = downstream_headers_->EnvoyInternalRequest();
     const bool internal_request =
         internal_request_header && internal_request_header->value() == "true";
@@ -884,6 +954,9 @@ void Filter::UpstreamRequest::onPoolFailure(Http::ConnectionPool::PoolFailureRea
   case Http::ConnectionPool::PoolFailureReason::ConnectionFailure:
     reset_reason = Http::StreamResetReason::ConnectionFailure;
     break;
+  case Http::ConnectionPool::PoolFailureReason::Timeout:
+    reset_reason = Http::StreamResetReason::PendingTimeout;
+    break;
   }
 
   // Mimic an upstream reset.
@@ -133,8 +133,7 @@ class Filter : Logger::Loggable<Logger::Id::router>,
                public Upstream::LoadBalancerContext {
 public:
   Filter(FilterConfig& config)
-      : config_(config), downstream_response_started_(false), downstream_end_stream_(false),
-        do_shadowing_(false) {}
+      : config_(config), downstream_response_started_(false), downstream_end_stream_(false) {}
 
   ~Filter();
 
@@ -295,7 +294,8 @@ private:
                                          Event::Dispatcher& dispatcher,
                                          Upstream::ResourcePriority priority) PURE;
   Http::ConnectionPool::Instance* getConnPool();
-  void maybeDoShadowing();
+  void maybeStartShadowing(bool end_stream);
+  void maybeShadowData(Buffer::Instance& data, bool end_stream);
   void onRequestComplete();
   void onResponseTimeout();
   void onUpstreamHeaders(uint64_t response_code, Http::HeaderMapPtr&& headers, bool end_stream);
@@ -329,13 +329,15 @@ private:
   MonotonicTime downstream_request_complete_time_;
   uint32_t buffer_limit_{0};
   bool stream_destroyed_{};
+  ShadowStream* shadow_stream_{};
+  // Held from decodeHeaders() until cleanup() so that retries count against the same slot.
+  Upstream::Resource* adaptive_requests_{};
 
   // list of cookies to add to upstream headers
   std::vector<std::string> downstream_set_cookies_;
 
   bool downstream_response_started_ : 1;
   bool downstream_end_stream_ : 1;
-  bool do_shadowing_ : 1;
 };
 
 class ProdFilter : public Filter {
@@ -4,24 +4,141 @@
 #include <string>
 
 #include "common/common/assert.h"
+#include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
 
 namespace Envoy {
 namespace Router {
 
-void ShadowWriterImpl::shadow(const std::string& cluster, Http::MessagePtr&& request,
-                              std::chrono::milliseconds timeout) {
+void ShadowStreamImpl::start(std::chrono::milliseconds timeout, bool end_stream) {
+  stream_ = client_.start(*this, Optional<std::chrono::milliseconds>(timeout), false);
+  // Set before sending since the stream may complete, and delete this object, inline.
+  local_complete_ = end_stream;
+  stream_->sendHeaders(*headers_, end_stream);
+}
+
+bool ShadowStreamImpl::sendData(Buffer::Instance& data, bool end_stream) {
+  ASSERT(!local_complete_);
+  if (remote_complete_) {
+    // The shadow upstream has already responded or reset so there is nowhere to send the data.
+    if (end_stream) {
+      cancel();
+    }
+    return true;
+  }
+
+  if (above_high_watermark_ || holding_) {
+    // The shadow upstream is not keeping up. Hold the data here until it drains, and give up on
+    // the shadow rather than letting the held data grow past the limit.
+    held_data_.move(data);
+    if (buffer_limit_ > 0 && held_data_.length() > buffer_limit_) {
+      cancel();
+      return false;
+    }
+
+    holding_ = true;
+    held_end_stream_ = end_stream;
+    local_complete_ = end_stream;
+    return true;
+  }
+
+  local_complete_ = end_stream;
+  stream_->sendData(data, end_stream);
+  return true;
+}
+
+void ShadowStreamImpl::sendTrailers(const Http::HeaderMap& trailers) {
+  ASSERT(!local_complete_);
+  if (remote_complete_) {
+    cancel();
+    return;
+  }
+
+  local_complete_ = true;
+  trailers_.reset(new Http::HeaderMapImpl(trailers));
+  if (holding_) {
+    held_trailers_ = true;
+    return;
+  }
+
+  stream_->sendTrailers(*trailers_);
+}
+
+void ShadowStreamImpl::cancel() {
+  ASSERT(!local_complete_);
+  local_complete_ = true;
+  held_data_.drain(held_data_.length());
+  holding_ = false;
+  if (stream_) {
+    // Resetting calls back into onReset() which finishes cleanup.
+    stream_->reset();
+  } else {
+    client_.dispatcher().deferredDelete(Event::DeferredDeletablePtr{this});
+  }
+}
+
+void ShadowStreamImpl::onHeaders(Http::HeaderMapPtr&&, bool end_stream) {
+  if (end_stream) {
+    onRemoteComplete();
+  }
+}
+
+void ShadowStreamImpl::onData(Buffer::Instance&, bool end_stream) {
+  if (end_stream) {
+    onRemoteComplete();
+  }
+}
+
+void ShadowStreamImpl::onTrailers(Http::HeaderMapPtr&&) { onRemoteComplete(); }
+
+void ShadowStreamImpl::onReset() {
+  stream_ = nullptr;
+  onRemoteComplete();
+}
+
+void ShadowStreamImpl::onAboveWriteBufferHighWatermark() { above_high_watermark_ = true; }
+
+void ShadowStreamImpl::onBelowWriteBufferLowWatermark() {
+  above_high_watermark_ = false;
+  if (!holding_) {
+    return;
+  }
+
+  // Clear before sending since the flush may push the upstream back over its high watermark.
+  holding_ = false;
+  stream_->sendData(held_data_, held_end_stream_);
+  // The send may reset the stream inline, which calls onReset().
+  if (held_trailers_ && stream_ != nullptr && !remote_complete_) {
+    stream_->sendTrailers(*trailers_);
+  }
+}
+
+void ShadowStreamImpl::onRemoteComplete() {
+  remote_complete_ = true;
+  // Anything still held can no longer be sent.
+  held_data_.drain(held_data_.length());
+  holding_ = false;
+  if (local_complete_) {
+    client_.dispatcher().deferredDelete(Event::DeferredDeletablePtr{this});
+  }
+}
+
+ShadowStream* ShadowWriterImpl::shadow(const std::string& cluster, Http::HeaderMapPtr&& headers,
+                                       bool end_stream, std::chrono::milliseconds timeout,
+                                       uint32_t buffer_limit) {
   // Switch authority to add a shadow postfix. This allows upstream logging to make a more sense.
   // TODO PERF: Avoid copy.
-  std::string host = request->headers().Host()->value().c_str();
+  std::string host = headers->Host()->value().c_str();
   ASSERT(!host.empty());
   host += "-shadow";
-  request->headers().Host()->value(host);
+  headers->Host()->value(host);
 
   // Configuration should guarantee that cluster exists before calling here. This is basically
-  // fire and forget. We don't handle cancelling.
-  cm_.httpAsyncClientForCluster(cluster).send(std::move(request), *this,
-                                              Optional<std::chrono::milliseconds>(timeout));
+  // fire and forget. The stream cleans itself up once both sides are complete.
+  ShadowStreamImpl* stream = new ShadowStreamImpl(cm_.httpAsyncClientForCluster(cluster),
+                                                  std::move(headers), buffer_limit);
+  stream->start(timeout, end_stream);
+  return end_stream ? nullptr : stream;
 }
 
 } // namespace Router
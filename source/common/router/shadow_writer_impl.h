@@ -1,29 +1,75 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <string>
 
+#include "envoy/event/deferred_deletable.h"
 #include "envoy/router/shadow_writer.h"
 #include "envoy/upstream/cluster_manager.h"
 
+#include "common/buffer/buffer_impl.h"
+
 namespace Envoy {
 namespace Router {
 
+/**
+ * A shadow request streamed over an async client stream. The object owns itself: it is deleted
+ * once the caller has ended or cancelled the request and the shadow upstream has finished
+ * responding (or reset). Request data is held while the shadow upstream is above its write buffer
+ * high watermark and flushed once it drains; only the held data counts against the buffer limit.
+ */
+class ShadowStreamImpl : public ShadowStream,
+                         public Http::AsyncClient::StreamCallbacks,
+                         public Event::DeferredDeletable {
+public:
+  ShadowStreamImpl(Http::AsyncClient& client, Http::HeaderMapPtr&& headers, uint32_t buffer_limit)
+      : client_(client), headers_(std::move(headers)), buffer_limit_(buffer_limit) {}
+
+  void start(std::chrono::milliseconds timeout, bool end_stream);
+
+  // Router::ShadowStream
+  bool sendData(Buffer::Instance& data, bool end_stream) override;
+  void sendTrailers(const Http::HeaderMap& trailers) override;
+  void cancel() override;
+
+  // Http::AsyncClient::StreamCallbacks
+  void onHeaders(Http::HeaderMapPtr&&, bool end_stream) override;
+  void onData(Buffer::Instance&, bool end_stream) override;
+  void onTrailers(Http::HeaderMapPtr&&) override;
+  void onReset() override;
+  void onAboveWriteBufferHighWatermark() override;
+  void onBelowWriteBufferLowWatermark() override;
+
+private:
+  void onRemoteComplete();
+
+  Http::AsyncClient& client_;
+  Http::AsyncClient::Stream* stream_{};
+  Http::HeaderMapPtr headers_;
+  Http::HeaderMapPtr trailers_;
+  const uint32_t buffer_limit_;
+  Buffer::OwnedImpl held_data_;
+  bool local_complete_{};
+  bool remote_complete_{};
+  bool above_high_watermark_{};
+  // Set while data (and possibly the end of the request) is waiting in held_data_.
+  bool holding_{};
+  bool held_end_stream_{};
+  bool held_trailers_{};
+};
+
 /**
  * Implementation of ShadowWriter that takes incoming requests to shadow and implements "fire and
- * forget" behavior using an async client.
+ * forget" behavior using an async client stream.
  */
-class ShadowWriterImpl : public ShadowWriter, public Http::AsyncClient::Callbacks {
+class ShadowWriterImpl : public ShadowWriter {
 public:
   ShadowWriterImpl(Upstream::ClusterManager& cm) : cm_(cm) {}
 
   // Router::ShadowWriter
-  void shadow(const std::string& cluster, Http::MessagePtr&& request,
-              std::chrono::milliseconds timeout) override;
-
-  // Http::AsyncClient::Callbacks
-  void onSuccess(Http::MessagePtr&&) override {}
-  void onFailure(Http::AsyncClient::FailureReason) override {}
+  ShadowStream* shadow(const std::string& cluster, Http::HeaderMapPtr&& headers, bool end_stream,
+                       std::chrono::milliseconds timeout, uint32_t buffer_limit) override;
 
 private:
   Upstream::ClusterManager& cm_;
@@ -147,10 +147,12 @@ std::string RandomGeneratorImpl::uuid() {
   return std::string(uuid, UUID_LENGTH);
 }
 
+std::atomic<uint64_t> SnapshotImpl::next_generation_{};
+
 SnapshotImpl::SnapshotImpl(const std::string& root_path, const std::string& override_path,
                            RuntimeStats& stats, RandomGenerator& generator,
                            Api::OsSysCalls& os_sys_calls)
-    : generator_(generator), os_sys_calls_(os_sys_calls) {
+    : generator_(generator), os_sys_calls_(os_sys_calls), generation_(++next_generation_) {
   try {
     walkDirectory(root_path, "");
     if (Filesystem::directoryExists(override_path)) {
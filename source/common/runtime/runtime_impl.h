@@ -2,6 +2,7 @@
 
 #include <dirent.h>
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -91,6 +92,7 @@ public:
 
   const std::string& get(const std::string& key) const override;
   uint64_t getInteger(const std::string&, uint64_t default_value) const override;
+  uint64_t generation() const override { return generation_; }
 
 private:
   struct Directory {
@@ -116,6 +118,10 @@ private:
   std::unordered_map<std::string, Entry> values_;
   RandomGenerator& generator_;
   Api::OsSysCalls& os_sys_calls_;
+  const uint64_t generation_;
+
+  // Snapshots are created on the main thread, but generations are unique across all loaders.
+  static std::atomic<uint64_t> next_generation_;
 };
 
 /**
@@ -190,6 +196,8 @@ private:
       return default_value;
     }
 
+    uint64_t generation() const override { return 0; }
+
     RandomGenerator& generator_;
   };
 
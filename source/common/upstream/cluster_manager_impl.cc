@@ -25,6 +25,7 @@
 #include "common/router/shadow_writer_impl.h"
 #include "common/upstream/cds_api_impl.h"
 #include "common/upstream/load_balancer_impl.h"
+#include "common/upstream/maglev_lb.h"
 #include "common/upstream/original_dst_cluster.h"
 #include "common/upstream/ring_hash_lb.h"
 #include "common/upstream/subset_lb.h"
@@ -170,7 +171,9 @@ ClusterManagerImpl::ClusterManagerImpl(const envoy::api::v2::Bootstrap& bootstra
                                        AccessLog::AccessLogManager& log_manager,
                                        Event::Dispatcher& primary_dispatcher)
     : factory_(factory), runtime_(runtime), stats_(stats), tls_(tls.allocateSlot()),
-      random_(random), local_info_(local_info), cm_stats_(generateStats(stats)) {
+      random_(random), local_info_(local_info), cm_stats_(generateStats(stats)),
+      lazy_thread_local_clusters_(
+          runtime.snapshot().featureEnabled("upstream.lazy_thread_local_clusters", 0)) {
   const auto& ads_config = bootstrap.dynamic_resources().ads_config();
   if (ads_config.cluster_name().empty()) {
     ENVOY_LOG(debug, "No ADS clusters defined, ADS will not be initialized.");
@@ -293,8 +296,15 @@ bool ClusterManagerImpl::addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster
     ThreadLocalClusterManagerImpl& cluster_manager =
         tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
+    if (lazilyMaterialized(*new_cluster)) {
+      // Drop any state built from the old config. The cluster is created again on first use.
+      cluster_manager.eraseCluster(new_cluster->name());
+      return;
+    }
+
     if (cluster_manager.thread_local_clusters_.count(new_cluster->name()) > 0) {
       ENVOY_LOG(debug, "updating TLS cluster {}", new_cluster->name());
+      cluster_manager.clusters_generation_++;
     } else {
       ENVOY_LOG(debug, "adding TLS cluster {}", new_cluster->name());
     }
@@ -315,6 +325,10 @@ bool ClusterManagerImpl::removePrimaryCluster(const std::string& cluster_name) {
 
   init_helper_.removeCluster(*existing_cluster->second.cluster_);
   primary_clusters_.erase(existing_cluster);
+  if (lazy_thread_local_clusters_) {
+    std::lock_guard<std::mutex> lock(lazy_clusters_lock_);
+    lazy_clusters_.erase(cluster_name);
+  }
   cm_stats_.cluster_removed_.inc();
   cm_stats_.total_clusters_.set(primary_clusters_.size());
   ENVOY_LOG(info, "removing cluster {}", cluster_name);
@@ -322,9 +336,10 @@ bool ClusterManagerImpl::removePrimaryCluster(const std::string& cluster_name) {
     ThreadLocalClusterManagerImpl& cluster_manager =
         tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
-    ASSERT(cluster_manager.thread_local_clusters_.count(cluster_name) == 1);
+    ASSERT(cluster_manager.thread_local_clusters_.count(cluster_name) == 1 ||
+           lazy_thread_local_clusters_);
     ENVOY_LOG(debug, "removing TLS cluster {}", cluster_name);
-    cluster_manager.thread_local_clusters_.erase(cluster_name);
+    cluster_manager.eraseCluster(cluster_name);
   });
 
   return true;
@@ -375,6 +390,12 @@ void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster, boo
       PrimaryClusterData{MessageUtil::hash(cluster), added_via_api, std::move(new_cluster)});
 
   cm_stats_.total_clusters_.set(primary_clusters_.size());
+  if (lazilyMaterialized(*primary_cluster_reference.info())) {
+    std::lock_guard<std::mutex> lock(lazy_clusters_lock_);
+    lazy_clusters_[primary_cluster_reference.info()->name()] = {
+        primary_cluster_reference.info(), std::make_shared<const HostSetSnapshot>(), {}};
+  }
+
   if (num_erased) {
     cm_stats_.cluster_modified_.inc();
   } else {
@@ -382,15 +403,59 @@ void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster, boo
   }
 }
 
+bool ClusterManagerImpl::lazilyMaterialized(const ClusterInfo& info) const {
+  // Static clusters may be held on to by long lived users such as the redis connection pool, and
+  // original destination load balancers need the primary cluster, so those are always created
+  // up front.
+  return lazy_thread_local_clusters_ && info.addedViaApi() &&
+         info.lbType() != LoadBalancerType::OriginalDst;
+}
+
 ThreadLocalCluster* ClusterManagerImpl::get(const std::string& cluster) {
   ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
+  return cluster_manager.getOrCreateCluster(cluster);
+}
 
-  auto entry = cluster_manager.thread_local_clusters_.find(cluster);
-  if (entry != cluster_manager.thread_local_clusters_.end()) {
-    return entry->second.get();
+InternedClusterNameConstSharedPtr
+ClusterManagerImpl::internClusterName(const std::string& cluster) {
+  std::shared_ptr<InternedClusterNames> names = interned_cluster_names_;
+  std::lock_guard<std::mutex> lock(names->lock_);
+  std::weak_ptr<const InternedClusterName>& existing = names->names_[cluster];
+  InternedClusterNameConstSharedPtr interned = existing.lock();
+  if (interned) {
+    return interned;
+  }
+
+  // Reuse released indexes so that the per worker lookup tables stay as small as the number of
+  // names in use.
+  uint32_t index;
+  if (names->free_indexes_.empty()) {
+    index = names->next_index_++;
   } else {
-    return nullptr;
-  }
+    index = names->free_indexes_.back();
+    names->free_indexes_.pop_back();
+  }
+
+  interned.reset(new InternedClusterName(cluster, index, names->next_id_++),
+                 [names](const InternedClusterName* name) -> void {
+                   {
+                     std::lock_guard<std::mutex> lock(names->lock_);
+                     auto entry = names->names_.find(name->name_);
+                     // The name may already have been interned again.
+                     if (entry != names->names_.end() && entry->second.expired()) {
+                       names->names_.erase(entry);
+                     }
+                     names->free_indexes_.push_back(name->index_);
+                   }
+                   delete name;
+                 });
+  existing = interned;
+  return interned;
+}
+
+ThreadLocalCluster* ClusterManagerImpl::get(const InternedClusterName& cluster) {
+  ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
+  return cluster_manager.getOrCreateCluster(cluster);
 }
 
 Http::ConnectionPool::Instance*
@@ -398,13 +463,13 @@ ClusterManagerImpl::httpConnPoolForCluster(const std::string& cluster, ResourceP
                                            LoadBalancerContext* context) {
   ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
-  auto entry = cluster_manager.thread_local_clusters_.find(cluster);
-  if (entry == cluster_manager.thread_local_clusters_.end()) {
+  ThreadLocalClusterManagerImpl::ClusterEntry* entry = cluster_manager.getOrCreateCluster(cluster);
+  if (entry == nullptr) {
     return nullptr;
   }
 
   // Select a host and create a connection pool for it if it does not already exist.
-  return entry->second->connPool(priority, context);
+  return entry->httpConnPool(priority, context);
 }
 
 void ClusterManagerImpl::postThreadLocalClusterUpdate(
@@ -416,26 +481,65 @@ void ClusterManagerImpl::postThreadLocalClusterUpdate(
     return;
   }
 
-  HostVectorConstSharedPtr hosts_copy(new std::vector<HostSharedPtr>(primary_cluster.hosts()));
-  HostVectorConstSharedPtr healthy_hosts_copy(
-      new std::vector<HostSharedPtr>(primary_cluster.healthyHosts()));
-  HostListsConstSharedPtr hosts_per_locality_copy(
-      new std::vector<std::vector<HostSharedPtr>>(primary_cluster.hostsPerLocality()));
-  HostListsConstSharedPtr healthy_hosts_per_locality_copy(
-      new std::vector<std::vector<HostSharedPtr>>(primary_cluster.healthyHostsPerLocality()));
+  // The primary cluster's snapshot is shared by every worker, which only swaps a pointer.
+  const HostSetSnapshotConstSharedPtr snapshot = hostSetSnapshot(primary_cluster);
+
+  // Consistent hashing rings and tables are expensive to build, so they are built once here and
+  // shared by every worker rather than being rebuilt by each worker's load balancer.
+  ThreadLocalClusterManagerImpl::SharedLbState shared_lb_state;
+  if (!primary_cluster.info()->lbSubsetInfo().isEnabled()) {
+    switch (primary_cluster.info()->lbType()) {
+    case LoadBalancerType::RingHash:
+      shared_lb_state.ring_hash_rings_ = std::make_shared<const RingHashLoadBalancer::Rings>(
+          runtime_, snapshot->hosts(), snapshot->healthyHosts());
+      break;
+    case LoadBalancerType::Maglev:
+      shared_lb_state.maglev_tables_ = std::make_shared<const MaglevLoadBalancer::Tables>(
+          snapshot->hosts(), snapshot->healthyHosts());
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (lazilyMaterialized(*primary_cluster.info())) {
+    // Workers that create the cluster after this point start from this update. Workers that
+    // already have it apply the update posted below.
+    std::lock_guard<std::mutex> lock(lazy_clusters_lock_);
+    auto data = lazy_clusters_.find(primary_cluster.info()->name());
+    if (data != lazy_clusters_.end()) {
+      data->second.snapshot_ = snapshot;
+      data->second.shared_lb_state_ = shared_lb_state;
+    }
+  }
 
   tls_->runOnAllThreads([
-    this, name = primary_cluster.info()->name(), hosts_copy, healthy_hosts_copy,
-    hosts_per_locality_copy, healthy_hosts_per_locality_copy, hosts_added, hosts_removed
+    this, name = primary_cluster.info()->name(), snapshot, shared_lb_state, hosts_added,
+    hosts_removed
   ]()
                             ->void {
                               ThreadLocalClusterManagerImpl::updateClusterMembership(
-                                  name, hosts_copy, healthy_hosts_copy, hosts_per_locality_copy,
-                                  healthy_hosts_per_locality_copy, hosts_added, hosts_removed,
+                                  name, snapshot, shared_lb_state, hosts_added, hosts_removed,
                                   *tls_);
                             });
 }
 
+HostSetSnapshotConstSharedPtr ClusterManagerImpl::hostSetSnapshot(const Cluster& cluster) {
+  // Clusters derived from ClusterImplBase already keep their membership in an immutable snapshot.
+  const HostSetImpl* host_set = dynamic_cast<const HostSetImpl*>(&cluster);
+  if (host_set != nullptr) {
+    return host_set->snapshot();
+  }
+
+  return std::make_shared<const HostSetSnapshot>(
+      std::make_shared<const std::vector<HostSharedPtr>>(cluster.hosts()),
+      std::make_shared<const std::vector<HostSharedPtr>>(cluster.healthyHosts()),
+      std::make_shared<const std::vector<std::vector<HostSharedPtr>>>(cluster.hostsPerLocality()),
+      std::make_shared<const std::vector<std::vector<HostSharedPtr>>>(
+          cluster.healthyHostsPerLocality()),
+      std::make_shared<const std::vector<uint32_t>>(cluster.localityWeights()));
+}
+
 void ClusterManagerImpl::postThreadLocalHealthFailure(const HostSharedPtr& host) {
   tls_->runOnAllThreads(
       [this, host] { ThreadLocalClusterManagerImpl::onHostHealthFailure(host, *tls_); });
@@ -445,25 +549,27 @@ Host::CreateConnectionData ClusterManagerImpl::tcpConnForCluster(const std::stri
                                                                  LoadBalancerContext* context) {
   ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
-  auto entry = cluster_manager.thread_local_clusters_.find(cluster);
-  if (entry == cluster_manager.thread_local_clusters_.end()) {
+  ThreadLocalClusterManagerImpl::ClusterEntry* entry = cluster_manager.getOrCreateCluster(cluster);
+  if (entry == nullptr) {
     throw EnvoyException(fmt::format("unknown cluster '{}'", cluster));
   }
 
-  HostConstSharedPtr logical_host = entry->second->lb_->chooseHost(context);
+  HostConstSharedPtr logical_host = entry->lb_->chooseHost(context);
   if (logical_host) {
     return logical_host->createConnection(cluster_manager.thread_local_dispatcher_);
   } else {
-    entry->second->cluster_info_->stats().upstream_cx_none_healthy_.inc();
+    entry->cluster_info_->stats().upstream_cx_none_healthy_.inc();
     return {nullptr, nullptr};
   }
 }
 
 Http::AsyncClient& ClusterManagerImpl::httpAsyncClientForCluster(const std::string& cluster) {
   ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
-  auto entry = cluster_manager.thread_local_clusters_.find(cluster);
-  if (entry != cluster_manager.thread_local_clusters_.end()) {
-    return entry->second->http_async_client_;
+  ThreadLocalClusterManagerImpl::ClusterEntry* entry = cluster_manager.getOrCreateCluster(cluster);
+  if (entry != nullptr) {
+    // Async clients are typically held on to by their users, so the cluster must stay around.
+    entry->evictable_ = false;
+    return entry->http_async_client_;
   } else {
     throw EnvoyException(fmt::format("unknown cluster '{}'", cluster));
   }
@@ -491,11 +597,21 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ThreadLocalClusterManagerImpl
       continue;
     }
 
+    if (parent.lazilyMaterialized(*cluster.second.cluster_->info())) {
+      continue;
+    }
+
     ENVOY_LOG(debug, "adding TLS initial cluster {}", cluster.first);
     ASSERT(thread_local_clusters_.count(cluster.first) == 0);
     thread_local_clusters_[cluster.first].reset(
         new ClusterEntry(*this, cluster.second.cluster_->info()));
   }
+
+  if (parent.lazy_thread_local_clusters_) {
+    idle_timer_ = dispatcher.createTimer([this]() -> void { evictIdleClusters(); });
+    idle_timer_->enableTimer(std::chrono::milliseconds(parent.runtime_.snapshot().getInteger(
+        "upstream.thread_local_cluster_idle_timeout_ms", 300000)));
+  }
 }
 
 ClusterManagerImpl::ThreadLocalClusterManagerImpl::~ThreadLocalClusterManagerImpl() {
@@ -507,6 +623,7 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::~ThreadLocalClusterManagerImp
   //                     redis/conn_pool_impl.cc. Will fix at the same time.
   ENVOY_LOG(debug, "shutting down thread local cluster manager");
   host_http_conn_pool_map_.clear();
+  interned_clusters_.clear();
   for (auto& cluster : thread_local_clusters_) {
     if (&cluster.second->host_set_ != local_host_set_) {
       cluster.second.reset();
@@ -515,10 +632,93 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::~ThreadLocalClusterManagerImp
   thread_local_clusters_.clear();
 }
 
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry*
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::getOrCreateCluster(const std::string& name) {
+  auto entry = thread_local_clusters_.find(name);
+  if (entry != thread_local_clusters_.end()) {
+    entry->second->used_ = true;
+    return entry->second.get();
+  }
+
+  if (!parent_.lazy_thread_local_clusters_) {
+    return nullptr;
+  }
+
+  LazyClusterData data;
+  {
+    std::lock_guard<std::mutex> lock(parent_.lazy_clusters_lock_);
+    auto lazy_cluster = parent_.lazy_clusters_.find(name);
+    if (lazy_cluster == parent_.lazy_clusters_.end()) {
+      return nullptr;
+    }
+    data = lazy_cluster->second;
+  }
+
+  // An update that was posted before the data above was copied may still be queued on this
+  // thread. It is applied on top, and the membership converges once the latest update arrives.
+  ENVOY_LOG(debug, "creating TLS cluster {} on demand", name);
+  ClusterEntryPtr new_entry(new ClusterEntry(*this, data.info_));
+  new_entry->used_ = true;
+  new_entry->evictable_ = true;
+  new_entry->shared_lb_state_ = data.shared_lb_state_;
+  const std::vector<HostSharedPtr>& hosts = data.snapshot_->hosts();
+  new_entry->host_set_.updateHosts(std::move(data.snapshot_), hosts, {});
+
+  ClusterEntry* raw_entry = new_entry.get();
+  thread_local_clusters_.emplace(name, std::move(new_entry));
+  return raw_entry;
+}
+
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry*
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::getOrCreateCluster(
+    const InternedClusterName& name) {
+  if (name.index_ < interned_clusters_.size()) {
+    const InternedClusterEntry& interned = interned_clusters_[name.index_];
+    if (interned.id_ == name.id_ && interned.generation_ == clusters_generation_) {
+      interned.entry_->used_ = true;
+      return interned.entry_;
+    }
+  }
+
+  // Clusters that do not exist are not cached, so that a cluster that is added later is found.
+  ClusterEntry* entry = getOrCreateCluster(name.name_);
+  if (entry != nullptr) {
+    if (name.index_ >= interned_clusters_.size()) {
+      interned_clusters_.resize(name.index_ + 1);
+    }
+    interned_clusters_[name.index_] = {entry, name.id_, clusters_generation_};
+  }
+
+  return entry;
+}
+
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::eraseCluster(const std::string& name) {
+  if (thread_local_clusters_.erase(name) > 0) {
+    clusters_generation_++;
+  }
+}
+
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::evictIdleClusters() {
+  for (auto entry = thread_local_clusters_.begin(); entry != thread_local_clusters_.end();) {
+    if (entry->second->evictable_ && !entry->second->used_) {
+      // Destroying the entry drains its connection pools.
+      ENVOY_LOG(debug, "evicting idle TLS cluster {}", entry->first);
+      entry = thread_local_clusters_.erase(entry);
+      clusters_generation_++;
+    } else {
+      entry->second->used_ = false;
+      ++entry;
+    }
+  }
+
+  idle_timer_->enableTimer(std::chrono::milliseconds(parent_.runtime_.snapshot().getInteger(
+      "upstream.thread_local_cluster_idle_timeout_ms", 300000)));
+}
+
 void ClusterManagerImpl::ThreadLocalClusterManagerImpl::drainConnPools(
     const std::vector<HostSharedPtr>& hosts) {
   for (const HostSharedPtr& host : hosts) {
-    auto container = host_http_conn_pool_map_.find(host);
+    auto container = host_http_conn_pool_map_.find(host.get());
     if (container != host_http_conn_pool_map_.end()) {
       drainConnPools(host, container->second);
     }
@@ -539,38 +739,44 @@ void ClusterManagerImpl::ThreadLocalClusterManagerImpl::drainConnPools(
     }
 
     pool->addDrainedCallback([this, old_host]() -> void {
-      ConnPoolsContainer& container = host_http_conn_pool_map_[old_host];
+      ConnPoolsContainer& container = host_http_conn_pool_map_[old_host.get()];
       ASSERT(container.drains_remaining_ > 0);
       container.drains_remaining_--;
       if (container.drains_remaining_ == 0) {
         for (Http::ConnectionPool::InstancePtr& pool : container.pools_) {
           thread_local_dispatcher_.deferredDelete(std::move(pool));
         }
-        host_http_conn_pool_map_.erase(old_host);
+        host_http_conn_pool_map_.erase(old_host.get());
       }
     });
 
     // The above addDrainedCallback() drain completion callback might execute immediately. This can
     // then effectively nuke 'container', which means we can't continue to loop on its contents
     // (we're done here).
-    if (host_http_conn_pool_map_.count(old_host) == 0) {
+    if (host_http_conn_pool_map_.count(old_host.get()) == 0) {
       break;
     }
   }
 }
 
 void ClusterManagerImpl::ThreadLocalClusterManagerImpl::updateClusterMembership(
-    const std::string& name, HostVectorConstSharedPtr hosts, HostVectorConstSharedPtr healthy_hosts,
-    HostListsConstSharedPtr hosts_per_locality, HostListsConstSharedPtr healthy_hosts_per_locality,
-    const std::vector<HostSharedPtr>& hosts_added, const std::vector<HostSharedPtr>& hosts_removed,
-    ThreadLocal::Slot& tls) {
+    const std::string& name, HostSetSnapshotConstSharedPtr snapshot,
+    const SharedLbState& shared_lb_state, const std::vector<HostSharedPtr>& hosts_added,
+    const std::vector<HostSharedPtr>& hosts_removed, ThreadLocal::Slot& tls) {
 
   ThreadLocalClusterManagerImpl& config = tls.getTyped<ThreadLocalClusterManagerImpl>();
 
-  ASSERT(config.thread_local_clusters_.find(name) != config.thread_local_clusters_.end());
-  config.thread_local_clusters_[name]->host_set_.updateHosts(
-      std::move(hosts), std::move(healthy_hosts), std::move(hosts_per_locality),
-      std::move(healthy_hosts_per_locality), hosts_added, hosts_removed);
+  auto entry = config.thread_local_clusters_.find(name);
+  if (entry == config.thread_local_clusters_.end()) {
+    // Clusters that are created on demand are only updated on workers that have used them.
+    ASSERT(config.parent_.lazy_thread_local_clusters_);
+    return;
+  }
+
+  // Swap in the shared load balancer state before the host update so that it is in place by the
+  // time member update callbacks run.
+  entry->second->shared_lb_state_ = shared_lb_state;
+  entry->second->host_set_.updateHosts(std::move(snapshot), hosts_added, hosts_removed);
 }
 
 void ClusterManagerImpl::ThreadLocalClusterManagerImpl::onHostHealthFailure(
@@ -583,7 +789,7 @@ void ClusterManagerImpl::ThreadLocalClusterManagerImpl::onHostHealthFailure(
   // more granular host set changes, we should be able to capture single host changes and make them
   // more targeted.
   ThreadLocalClusterManagerImpl& config = tls.getTyped<ThreadLocalClusterManagerImpl>();
-  const auto& container = config.host_http_conn_pool_map_.find(host);
+  const auto& container = config.host_http_conn_pool_map_.find(host.get());
   if (container != config.host_http_conn_pool_map_.end()) {
     for (const Http::ConnectionPool::InstancePtr& pool : container->second.pools_) {
       if (pool == nullptr) {
@@ -625,7 +831,13 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
     }
     case LoadBalancerType::RingHash: {
       lb_.reset(new RingHashLoadBalancer(host_set_, cluster->stats(), parent.parent_.runtime_,
-                                         parent.parent_.random_));
+                                         parent.parent_.random_,
+                                         shared_lb_state_.ring_hash_rings_));
+      break;
+    }
+    case LoadBalancerType::Maglev: {
+      lb_.reset(new MaglevLoadBalancer(host_set_, cluster->stats(), parent.parent_.runtime_,
+                                       parent.parent_.random_, shared_lb_state_.maglev_tables_));
       break;
     }
     case LoadBalancerType::OriginalDst: {
@@ -656,7 +868,7 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::~ClusterEntry()
 }
 
 Http::ConnectionPool::Instance*
-ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::httpConnPool(
     ResourcePriority priority, LoadBalancerContext* context) {
   HostConstSharedPtr host = lb_->chooseHost(context);
   if (!host) {
@@ -665,7 +877,7 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
     return nullptr;
   }
 
-  ConnPoolsContainer& container = parent_.host_http_conn_pool_map_[host];
+  ConnPoolsContainer& container = parent_.host_http_conn_pool_map_[host.get()];
   ASSERT(enumToInt(priority) < container.pools_.size());
   if (!container.pools_[enumToInt(priority)]) {
     container.pools_[enumToInt(priority)] =
@@ -5,10 +5,12 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "envoy/event/timer.h"
 #include "envoy/http/codes.h"
 #include "envoy/local_info/local_info.h"
 #include "envoy/runtime/runtime.h"
@@ -19,6 +21,8 @@
 #include "common/config/grpc_mux_impl.h"
 #include "common/http/async_client_impl.h"
 #include "common/upstream/load_stats_reporter.h"
+#include "common/upstream/maglev_lb.h"
+#include "common/upstream/ring_hash_lb.h"
 #include "common/upstream/upstream_impl.h"
 
 #include "api/bootstrap.pb.h"
@@ -156,6 +160,8 @@ public:
     return clusters_map;
   }
   ThreadLocalCluster* get(const std::string& cluster) override;
+  InternedClusterNameConstSharedPtr internClusterName(const std::string& cluster) override;
+  ThreadLocalCluster* get(const InternedClusterName& cluster) override;
   Http::ConnectionPool::Instance* httpConnPoolForCluster(const std::string& cluster,
                                                          ResourcePriority priority,
                                                          LoadBalancerContext* context) override;
@@ -174,6 +180,10 @@ public:
 
   Config::GrpcMux& adsMux() override { return *ads_mux_; }
 
+  SharedHealthCheckSessionMap& sharedHealthCheckSessions() override {
+    return shared_health_check_sessions_;
+  }
+
 private:
   /**
    * Thread local cached cluster data. Each thread local cluster gets updates from the parent
@@ -188,36 +198,64 @@ private:
       uint64_t drains_remaining_{};
     };
 
+    /**
+     * Load balancer state that is expensive to build, so it is built once on the main thread for
+     * each membership update and shared by all workers.
+     */
+    struct SharedLbState {
+      RingHashLoadBalancer::RingsConstSharedPtr ring_hash_rings_;
+      MaglevLoadBalancer::TablesConstSharedPtr maglev_tables_;
+    };
+
     struct ClusterEntry : public ThreadLocalCluster {
       ClusterEntry(ThreadLocalClusterManagerImpl& parent, ClusterInfoConstSharedPtr cluster);
       ~ClusterEntry();
 
-      Http::ConnectionPool::Instance* connPool(ResourcePriority priority,
-                                               LoadBalancerContext* context);
-
       // Upstream::ThreadLocalCluster
       const HostSet& hostSet() override { return host_set_; }
       ClusterInfoConstSharedPtr info() override { return cluster_info_; }
       LoadBalancer& loadBalancer() override { return *lb_; }
+      Http::ConnectionPool::Instance* httpConnPool(ResourcePriority priority,
+                                                   LoadBalancerContext* context) override;
 
       ThreadLocalClusterManagerImpl& parent_;
       HostSetImpl host_set_;
+      // Must outlive lb_.
+      SharedLbState shared_lb_state_;
       LoadBalancerPtr lb_;
       ClusterInfoConstSharedPtr cluster_info_;
       Http::AsyncClientImpl http_async_client_;
+      // Set on every lookup and cleared by each idle sweep.
+      bool used_{};
+      // Only entries that were created on demand, and whose async client has not been handed out,
+      // may be evicted when idle.
+      bool evictable_{};
     };
 
     typedef std::unique_ptr<ClusterEntry> ClusterEntryPtr;
 
+    /**
+     * A cached lookup of an interned cluster name. It is only valid for the name with id_, since
+     * indexes are reused, and while generation_ matches clusters_generation_.
+     */
+    struct InternedClusterEntry {
+      ClusterEntry* entry_{};
+      uint64_t id_{};
+      uint64_t generation_{};
+    };
+
     ThreadLocalClusterManagerImpl(ClusterManagerImpl& parent, Event::Dispatcher& dispatcher,
                                   const Optional<std::string>& local_cluster_name);
     ~ThreadLocalClusterManagerImpl();
+    ClusterEntry* getOrCreateCluster(const std::string& name);
+    ClusterEntry* getOrCreateCluster(const InternedClusterName& name);
+    void eraseCluster(const std::string& name);
+    void evictIdleClusters();
     void drainConnPools(const std::vector<HostSharedPtr>& hosts);
     void drainConnPools(HostSharedPtr old_host, ConnPoolsContainer& container);
-    static void updateClusterMembership(const std::string& name, HostVectorConstSharedPtr hosts,
-                                        HostVectorConstSharedPtr healthy_hosts,
-                                        HostListsConstSharedPtr hosts_per_locality,
-                                        HostListsConstSharedPtr healthy_hosts_per_locality,
+    static void updateClusterMembership(const std::string& name,
+                                        HostSetSnapshotConstSharedPtr snapshot,
+                                        const SharedLbState& shared_lb_state,
                                         const std::vector<HostSharedPtr>& hosts_added,
                                         const std::vector<HostSharedPtr>& hosts_removed,
                                         ThreadLocal::Slot& tls);
@@ -226,8 +264,27 @@ private:
     ClusterManagerImpl& parent_;
     Event::Dispatcher& thread_local_dispatcher_;
     std::unordered_map<std::string, ClusterEntryPtr> thread_local_clusters_;
-    std::unordered_map<HostConstSharedPtr, ConnPoolsContainer> host_http_conn_pool_map_;
+    // Indexed by InternedClusterName::index_.
+    std::vector<InternedClusterEntry> interned_clusters_;
+    // Bumped whenever an entry is removed from or replaced in thread_local_clusters_, which
+    // invalidates all of interned_clusters_. Clusters are rarely removed, so this is cheaper than
+    // finding the affected entries.
+    uint64_t clusters_generation_{1};
+    // Keyed by raw pointer so that lookups on the request path do not touch the host's reference
+    // count. A container's pools own its host, so the host outlives the entry.
+    std::unordered_map<const Host*, ConnPoolsContainer> host_http_conn_pool_map_;
     const HostSet* local_host_set_{};
+    Event::TimerPtr idle_timer_;
+  };
+
+  /**
+   * Everything a worker needs to create a thread local cluster on demand. Kept up to date by the
+   * main thread before it posts the matching update to the workers.
+   */
+  struct LazyClusterData {
+    ClusterInfoConstSharedPtr info_;
+    HostSetSnapshotConstSharedPtr snapshot_;
+    ThreadLocalClusterManagerImpl::SharedLbState shared_lb_state_;
   };
 
   struct PrimaryClusterData {
@@ -240,25 +297,54 @@ private:
   };
 
   static ClusterManagerStats generateStats(Stats::Scope& scope);
+  /**
+   * @return the snapshot of the cluster's current membership to publish to the workers. This is
+   *         the cluster's own snapshot when it keeps one, so that nothing is copied.
+   */
+  static HostSetSnapshotConstSharedPtr hostSetSnapshot(const Cluster& cluster);
   void loadCluster(const envoy::api::v2::Cluster& cluster, bool added_via_api);
   void postInitializeCluster(Cluster& cluster);
   void postThreadLocalClusterUpdate(const Cluster& primary_cluster,
                                     const std::vector<HostSharedPtr>& hosts_added,
                                     const std::vector<HostSharedPtr>& hosts_removed);
   void postThreadLocalHealthFailure(const HostSharedPtr& host);
+  bool lazilyMaterialized(const ClusterInfo& info) const;
 
   ClusterManagerFactory& factory_;
   Runtime::Loader& runtime_;
   Stats::Store& stats_;
   ThreadLocal::SlotPtr tls_;
   Runtime::RandomGenerator& random_;
+  // Shared sessions are owned by the clusters' health checkers and remove themselves when they are
+  // destroyed, so this must outlive primary_clusters_.
+  SharedHealthCheckSessionMap shared_health_check_sessions_;
   std::unordered_map<std::string, PrimaryClusterData> primary_clusters_;
+  /**
+   * Names are interned on the main thread, but the last reference to a name, held by a route
+   * table, may go away on a worker. The names share this with the cluster manager so that they can
+   * release their index from any thread.
+   */
+  struct InternedClusterNames {
+    std::mutex lock_;
+    std::unordered_map<std::string, std::weak_ptr<const InternedClusterName>> names_;
+    std::vector<uint32_t> free_indexes_;
+    uint32_t next_index_{};
+    uint64_t next_id_{1};
+  };
+
+  std::shared_ptr<InternedClusterNames> interned_cluster_names_{
+      std::make_shared<InternedClusterNames>()};
   Optional<envoy::api::v2::ConfigSource> eds_config_;
   Network::Address::InstanceConstSharedPtr source_address_;
   Outlier::EventLoggerSharedPtr outlier_event_logger_;
   const LocalInfo::LocalInfo& local_info_;
   CdsApiPtr cds_api_;
   ClusterManagerStats cm_stats_;
+  // When set, workers only create thread local state for API added clusters the first time they
+  // are used, and drop it again once it has been idle for a while.
+  const bool lazy_thread_local_clusters_;
+  std::mutex lazy_clusters_lock_;
+  std::unordered_map<std::string, LazyClusterData> lazy_clusters_;
   ClusterManagerInitHelper init_helper_;
   Config::GrpcMuxPtr ads_mux_;
   LoadStatsReporterPtr load_stats_reporter_;
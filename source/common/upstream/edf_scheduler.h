@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Earliest Deadline First (EDF) scheduler, used for weighted round robin. Each entry is given a
+ * deadline of the current virtual time plus 1 / weight. Picking returns the entry with the earliest
+ * deadline and advances the virtual time to that deadline, so over time every entry is picked in
+ * proportion to its weight, with picks of different entries interleaved as evenly as possible.
+ * Entries with equal deadlines are picked in the order they were added.
+ *
+ * Adding and picking are O(log n). This is not thread safe.
+ */
+template <class C> class EdfScheduler {
+public:
+  /**
+   * Pick the entry with the earliest deadline and remove it from the scheduler. Callers will
+   * typically add() the entry back, with its current weight, right away.
+   * @return std::shared_ptr<C> the picked entry, or nullptr if the scheduler is empty.
+   */
+  std::shared_ptr<C> pick() {
+    if (heap_.empty()) {
+      return nullptr;
+    }
+
+    std::pop_heap(heap_.begin(), heap_.end());
+    EdfEntry& edf_entry = heap_.back();
+    current_time_ = edf_entry.deadline_;
+    std::shared_ptr<C> entry = std::move(edf_entry.entry_);
+    heap_.pop_back();
+    return entry;
+  }
+
+  /**
+   * Pick the entry with the earliest deadline and add it back with a new weight. Unlike pick()
+   * followed by add(), the entry is moved in place and only copied once, for the return value.
+   * @param calculate_weight supplies the picked entry's new weight, which must be positive.
+   * @return std::shared_ptr<C> the picked entry, or nullptr if the scheduler is empty.
+   */
+  std::shared_ptr<C> pickAndAdd(const std::function<double(const C&)>& calculate_weight) {
+    if (heap_.empty()) {
+      return nullptr;
+    }
+
+    std::pop_heap(heap_.begin(), heap_.end());
+    EdfEntry& edf_entry = heap_.back();
+    current_time_ = edf_entry.deadline_;
+    const double weight = calculate_weight(*edf_entry.entry_);
+    ASSERT(weight > 0);
+    edf_entry.deadline_ = current_time_ + 1.0 / weight;
+    edf_entry.order_offset_ = order_offset_++;
+    std::shared_ptr<C> entry = edf_entry.entry_;
+    std::push_heap(heap_.begin(), heap_.end());
+    return entry;
+  }
+
+  /**
+   * Add an entry to the scheduler.
+   * @param weight supplies the entry's weight, which must be positive.
+   * @param entry supplies the entry.
+   */
+  void add(double weight, std::shared_ptr<C> entry) {
+    ASSERT(weight > 0);
+    heap_.push_back({current_time_ + 1.0 / weight, order_offset_++, std::move(entry)});
+    std::push_heap(heap_.begin(), heap_.end());
+  }
+
+  bool empty() const { return heap_.empty(); }
+  size_t size() const { return heap_.size(); }
+
+private:
+  struct EdfEntry {
+    double deadline_;
+    // Tie breaker for entries with equal deadlines.
+    uint64_t order_offset_;
+    std::shared_ptr<C> entry_;
+
+    // The standard heap algorithms build a max heap, so order entries with later deadlines first.
+    bool operator<(const EdfEntry& other) const {
+      return deadline_ == other.deadline_ ? order_offset_ > other.order_offset_
+                                          : deadline_ > other.deadline_;
+    }
+  };
+
+  double current_time_{};
+  uint64_t order_offset_{};
+  std::vector<EdfEntry> heap_;
+};
+
+} // namespace Upstream
+} // namespace Envoy
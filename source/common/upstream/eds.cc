@@ -58,7 +58,12 @@ void EdsClusterImpl::onConfigUpdate(const ResourceVector& resources) {
     throw EnvoyException(fmt::format("Unexpected EDS cluster (expecting {}): {}", cluster_name_,
                                      cluster_load_assignment.cluster_name()));
   }
+  std::map<Locality, uint32_t> locality_weights_map;
   for (const auto& locality_lb_endpoint : cluster_load_assignment.endpoints()) {
+    if (locality_lb_endpoint.has_load_balancing_weight()) {
+      locality_weights_map[Locality(locality_lb_endpoint.locality())] =
+          locality_lb_endpoint.load_balancing_weight().value();
+    }
     for (const auto& lb_endpoint : locality_lb_endpoint.lb_endpoints()) {
       new_hosts.emplace_back(new HostImpl(
           info_, "", Network::Address::resolveProtoAddress(lb_endpoint.endpoint().address()),
@@ -70,36 +75,60 @@ void EdsClusterImpl::onConfigUpdate(const ResourceVector& resources) {
   HostVectorSharedPtr current_hosts_copy(new std::vector<HostSharedPtr>(hosts()));
   std::vector<HostSharedPtr> hosts_added;
   std::vector<HostSharedPtr> hosts_removed;
-  if (updateDynamicHostList(new_hosts, *current_hosts_copy, hosts_added, hosts_removed,
-                            health_checker_ != nullptr)) {
-    ENVOY_LOG(debug, "EDS hosts changed for cluster: {} ({})", info_->name(), hosts().size());
+  const bool hosts_changed = updateDynamicHostList(new_hosts, *current_hosts_copy, hosts_added,
+                                                   hosts_removed, health_checker_ != nullptr);
+  // Locality weights may change without any host changing, so weighted clusters always recompute
+  // them below and only skip the update if nothing changed.
+  if (hosts_changed || !locality_weights_map.empty() || !localityWeights().empty()) {
     HostListsSharedPtr per_locality(new std::vector<std::vector<HostSharedPtr>>());
+    std::shared_ptr<std::vector<uint32_t>> locality_weights;
 
-    // If local locality is not defined then skip populating per locality hosts.
+    // If local locality is not defined and localities are not weighted then skip populating per
+    // locality hosts.
     const Locality local_locality(local_info_.node().locality());
     ENVOY_LOG(trace, "Local locality: {}", local_info_.node().locality().DebugString());
-    if (!local_locality.empty()) {
+    if (!local_locality.empty() || !locality_weights_map.empty()) {
       std::map<Locality, std::vector<HostSharedPtr>> hosts_per_locality;
 
       for (const HostSharedPtr& host : *current_hosts_copy) {
         hosts_per_locality[Locality(host->locality())].push_back(host);
       }
 
-      // Populate per_locality hosts only if upstream cluster has hosts in the same locality.
-      if (hosts_per_locality.find(local_locality) != hosts_per_locality.end()) {
-        per_locality->push_back(hosts_per_locality[local_locality]);
+      // Populate per_locality hosts only if upstream cluster has hosts in the same locality. When
+      // localities are weighted they are always populated, and the local locality slot is left
+      // empty if there are no upstream hosts in it.
+      if (hosts_per_locality.find(local_locality) != hosts_per_locality.end() ||
+          !locality_weights_map.empty()) {
+        if (!locality_weights_map.empty()) {
+          locality_weights = std::make_shared<std::vector<uint32_t>>();
+        }
+        const auto add_locality = [&](const Locality& locality,
+                                      std::vector<HostSharedPtr> locality_hosts) {
+          per_locality->push_back(std::move(locality_hosts));
+          if (locality_weights) {
+            const auto weight = locality_weights_map.find(locality);
+            locality_weights->push_back(weight != locality_weights_map.end() ? weight->second : 0);
+          }
+        };
 
+        add_locality(local_locality, hosts_per_locality[local_locality]);
         for (auto& entry : hosts_per_locality) {
           if (local_locality != entry.first) {
-            per_locality->push_back(entry.second);
+            add_locality(entry.first, entry.second);
           }
         }
       }
     }
 
-    updateHosts(current_hosts_copy, createHealthyHostList(*current_hosts_copy), per_locality,
-                createHealthyHostLists(*per_locality), hosts_added, hosts_removed);
-    onPreInitComplete();
+    const bool locality_weights_changed =
+        locality_weights ? *locality_weights != localityWeights() : !localityWeights().empty();
+    if (hosts_changed || locality_weights_changed) {
+      ENVOY_LOG(debug, "EDS hosts changed for cluster: {} ({})", info_->name(), hosts().size());
+      updateHosts(std::make_shared<const HostSetSnapshot>(current_hosts_copy, per_locality,
+                                                          locality_weights),
+                  hosts_added, hosts_removed);
+      onPreInitComplete();
+    }
   }
 
   // If we didn't setup to initialize when our first round of health checking is complete, just
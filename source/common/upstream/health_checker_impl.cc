@@ -1,5 +1,6 @@
 #include "common/upstream/health_checker_impl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <string>
@@ -24,6 +25,8 @@
 #include "common/redis/conn_pool_impl.h"
 #include "common/upstream/host_utility.h"
 
+#include "fmt/format.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -31,15 +34,18 @@ HealthCheckerSharedPtr HealthCheckerFactory::create(const envoy::api::v2::Health
                                                     Upstream::Cluster& cluster,
                                                     Runtime::Loader& runtime,
                                                     Runtime::RandomGenerator& random,
-                                                    Event::Dispatcher& dispatcher) {
+                                                    Event::Dispatcher& dispatcher,
+                                                    SharedHealthCheckSessionMap& shared_sessions) {
   switch (hc_config.health_checker_case()) {
   case envoy::api::v2::HealthCheck::HealthCheckerCase::kHttpHealthCheck:
     return std::make_shared<ProdHttpHealthCheckerImpl>(cluster, hc_config, dispatcher, runtime,
-                                                       random);
+                                                       random, shared_sessions);
   case envoy::api::v2::HealthCheck::HealthCheckerCase::kTcpHealthCheck:
-    return std::make_shared<TcpHealthCheckerImpl>(cluster, hc_config, dispatcher, runtime, random);
+    return std::make_shared<TcpHealthCheckerImpl>(cluster, hc_config, dispatcher, runtime, random,
+                                                  shared_sessions);
   case envoy::api::v2::HealthCheck::HealthCheckerCase::kRedisHealthCheck:
     return std::make_shared<RedisHealthCheckerImpl>(cluster, hc_config, dispatcher, runtime, random,
+                                                    shared_sessions,
                                                     Redis::ConnPool::ClientFactoryImpl::instance_);
   default:
     // TODO(htuch): This should be subsumed eventually by the constraint checking in #1308.
@@ -53,14 +59,16 @@ HealthCheckerImplBase::HealthCheckerImplBase(const Cluster& cluster,
                                              const envoy::api::v2::HealthCheck& config,
                                              Event::Dispatcher& dispatcher,
                                              Runtime::Loader& runtime,
-                                             Runtime::RandomGenerator& random)
-    : cluster_(cluster), dispatcher_(dispatcher),
+                                             Runtime::RandomGenerator& random,
+                                             SharedHealthCheckSessionMap& shared_sessions)
+    : cluster_(cluster), dispatcher_(dispatcher), config_hash_(MessageUtil::hash(config)),
       timeout_(PROTOBUF_GET_MS_REQUIRED(config, timeout)),
       unhealthy_threshold_(PROTOBUF_GET_WRAPPED_REQUIRED(config, unhealthy_threshold)),
       healthy_threshold_(PROTOBUF_GET_WRAPPED_REQUIRED(config, healthy_threshold)),
       stats_(generateStats(cluster.info()->statsScope())), runtime_(runtime), random_(random),
       interval_(PROTOBUF_GET_MS_REQUIRED(config, interval)),
-      interval_jitter_(PROTOBUF_GET_MS_OR_DEFAULT(config, interval_jitter, 0)) {
+      interval_jitter_(PROTOBUF_GET_MS_OR_DEFAULT(config, interval_jitter, 0)),
+      shared_sessions_(shared_sessions) {
   cluster_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>& hosts_added,
                                     const std::vector<HostSharedPtr>& hosts_removed) -> void {
     onClusterMemberUpdate(hosts_added, hosts_removed);
@@ -111,11 +119,63 @@ std::chrono::milliseconds HealthCheckerImplBase::interval() const {
 
 void HealthCheckerImplBase::addHosts(const std::vector<HostSharedPtr>& hosts) {
   for (const HostSharedPtr& host : hosts) {
-    active_sessions_[host] = makeSession(host);
     host->setHealthChecker(
         HealthCheckHostMonitorPtr{new HealthCheckHostMonitorImpl(shared_from_this(), host)});
-    active_sessions_[host]->start();
+    addSession(host);
+  }
+}
+
+void HealthCheckerImplBase::addSession(const HostSharedPtr& host) {
+  // Clusters that would send identical checks to the same endpoint can share a single session
+  // per endpoint.
+  std::string shared_key;
+  if (runtime_.snapshot().featureEnabled("health_check.shared_sessions", 0)) {
+    shared_key = fmt::format("{}_{}", sharedSessionKey(), host->address()->asString());
+    auto leader = shared_sessions_.find(shared_key);
+    if (leader != shared_sessions_.end()) {
+      // Only ActiveHealthCheckSessions are added to the shared sessions.
+      ActiveHealthCheckSession& leader_session =
+          static_cast<ActiveHealthCheckSession&>(*leader->second);
+      if (&leader_session.parent_ != this) {
+        ActiveHealthCheckSessionPtr follower(new SharedFollowerSession(*this, host));
+        follower->follow(leader_session);
+        active_sessions_[host] = std::move(follower);
+        return;
+      }
+
+      // Duplicate hosts within a cluster are checked independently.
+      shared_key.clear();
+    }
+  }
+
+  ActiveHealthCheckSessionPtr& session = active_sessions_[host];
+  session = makeSession(host);
+  if (!shared_key.empty()) {
+    session->shared_key_ = shared_key;
+    shared_sessions_[shared_key] = session.get();
+  }
+  session->start();
+}
+
+HealthCheckerImplBase::ActiveHealthCheckSession&
+HealthCheckerImplBase::takeOverSession(HostSharedPtr host, const std::string& shared_key) {
+  // This replaces, and so destroys, the host's follower session.
+  ActiveHealthCheckSessionPtr& session = active_sessions_[host];
+  session = makeSession(host);
+  if (!shared_key.empty()) {
+    session->shared_key_ = shared_key;
+    shared_sessions_[shared_key] = session.get();
   }
+
+  // The host was checked recently, so continue on the regular schedule.
+  session->interval_timer_->enableTimer(interval());
+  return *session;
+}
+
+std::string HealthCheckerImplBase::sharedSessionKey() const {
+  // Each cluster has its own TLS context object, but clusters with the same TLS config make
+  // identical connections, so they can share.
+  return fmt::format("{}_{}", config_hash_, cluster_.info()->tlsContextHash());
 }
 
 void HealthCheckerImplBase::onClusterMemberUpdate(const std::vector<HostSharedPtr>& hosts_added,
@@ -192,12 +252,67 @@ HealthCheckerImplBase::ActiveHealthCheckSession::ActiveHealthCheckSession(
 }
 
 HealthCheckerImplBase::ActiveHealthCheckSession::~ActiveHealthCheckSession() {
+  if (leader_ != nullptr) {
+    leader_->followers_.remove(this);
+  }
+
+  if (!shared_key_.empty()) {
+    // Hand the checks over to the first follower, which leads the remaining followers from now on.
+    // A follower of the same health checker as the new leader gets a session of its own instead.
+    parent_.shared_sessions_.erase(shared_key_);
+    const std::list<ActiveHealthCheckSession*> followers = std::move(followers_);
+    for (ActiveHealthCheckSession* follower : followers) {
+      follower->leader_ = nullptr;
+    }
+
+    ActiveHealthCheckSession* new_leader = nullptr;
+    for (ActiveHealthCheckSession* follower : followers) {
+      if (new_leader == nullptr) {
+        new_leader = &follower->parent_.takeOverSession(follower->host_, shared_key_);
+      } else if (&follower->parent_ == &new_leader->parent_) {
+        follower->parent_.takeOverSession(follower->host_, EMPTY_STRING);
+      } else {
+        follower->follow(*new_leader);
+      }
+    }
+  }
+
   if (!host_->healthFlagGet(Host::HealthFlag::FAILED_ACTIVE_HC)) {
     parent_.decHealthy();
   }
 }
 
+void HealthCheckerImplBase::ActiveHealthCheckSession::start() {
+  // The first check can be delayed by a random part of the interval, so that hosts that are added
+  // together, for example at startup, are not all checked at once.
+  const uint64_t jitter_percent = std::min<uint64_t>(
+      100, parent_.runtime_.snapshot().getInteger("health_check.initial_jitter_percent", 0));
+  const uint64_t max_delay_ms =
+      jitter_percent > 0 ? parent_.interval().count() * jitter_percent / 100 : 0;
+  if (max_delay_ms == 0) {
+    onIntervalBase();
+    return;
+  }
+
+  interval_timer_->enableTimer(std::chrono::milliseconds(parent_.random_.random() % max_delay_ms));
+}
+
+void HealthCheckerImplBase::ActiveHealthCheckSession::follow(ActiveHealthCheckSession& leader) {
+  leader_ = &leader;
+  leader.followers_.push_back(this);
+}
+
 void HealthCheckerImplBase::ActiveHealthCheckSession::handleSuccess() {
+  recordSuccess();
+  for (ActiveHealthCheckSession* follower : followers_) {
+    follower->recordSuccess();
+  }
+
+  timeout_timer_->disableTimer();
+  interval_timer_->enableTimer(parent_.interval());
+}
+
+void HealthCheckerImplBase::ActiveHealthCheckSession::recordSuccess() {
   // If we are healthy, reset the # of unhealthy to zero.
   num_unhealthy_ = 0;
 
@@ -216,9 +331,6 @@ void HealthCheckerImplBase::ActiveHealthCheckSession::handleSuccess() {
   parent_.stats_.success_.inc();
   first_check_ = false;
   parent_.runCallbacks(host_, changed_state);
-
-  timeout_timer_->disableTimer();
-  interval_timer_->enableTimer(parent_.interval());
 }
 
 void HealthCheckerImplBase::ActiveHealthCheckSession::setUnhealthy(FailureType type) {
@@ -247,6 +359,10 @@ void HealthCheckerImplBase::ActiveHealthCheckSession::setUnhealthy(FailureType t
 
 void HealthCheckerImplBase::ActiveHealthCheckSession::handleFailure(FailureType type) {
   setUnhealthy(type);
+  for (ActiveHealthCheckSession* follower : followers_) {
+    follower->setUnhealthy(type);
+  }
+
   timeout_timer_->disableTimer();
   interval_timer_->enableTimer(parent_.interval());
 }
@@ -266,14 +382,25 @@ HttpHealthCheckerImpl::HttpHealthCheckerImpl(const Cluster& cluster,
                                              const envoy::api::v2::HealthCheck& config,
                                              Event::Dispatcher& dispatcher,
                                              Runtime::Loader& runtime,
-                                             Runtime::RandomGenerator& random)
-    : HealthCheckerImplBase(cluster, config, dispatcher, runtime, random),
-      path_(config.http_health_check().path()) {
+                                             Runtime::RandomGenerator& random,
+                                             SharedHealthCheckSessionMap& shared_sessions)
+    : HealthCheckerImplBase(cluster, config, dispatcher, runtime, random, shared_sessions),
+      path_(config.http_health_check().path()),
+      codec_client_type_((cluster.info()->features() & ClusterInfo::Features::HTTP2) &&
+                                 runtime.snapshot().featureEnabled("health_check.http2", 0)
+                             ? Http::CodecClient::Type::HTTP2
+                             : Http::CodecClient::Type::HTTP1) {
   if (!config.http_health_check().service_name().empty()) {
     service_name_.value(config.http_health_check().service_name());
   }
 }
 
+std::string HttpHealthCheckerImpl::sharedSessionKey() const {
+  // Checks send the cluster name as the host header, which the endpoint may route or verify on.
+  return fmt::format("{}_{}_{}", HealthCheckerImplBase::sharedSessionKey(),
+                     enumToInt(codec_client_type_), cluster_.info()->name());
+}
+
 HttpHealthCheckerImpl::HttpActiveHealthCheckSession::HttpActiveHealthCheckSession(
     HttpHealthCheckerImpl& parent, HostSharedPtr host)
     : ActiveHealthCheckSession(parent, host), parent_(parent) {}
@@ -321,6 +448,12 @@ void HttpHealthCheckerImpl::HttpActiveHealthCheckSession::onInterval() {
       {Http::Headers::get().Host, parent_.cluster_.info()->name()},
       {Http::Headers::get().Path, parent_.path_},
       {Http::Headers::get().UserAgent, Http::Headers::get().UserAgentValues.EnvoyHealthChecker}};
+  if (parent_.codecClientType() == Http::CodecClient::Type::HTTP2) {
+    // HTTP/2 servers reject requests without a :scheme.
+    request_headers.insertScheme().value().setReference(
+        parent_.cluster_.info()->sslContext() ? Http::Headers::get().SchemeValues.Https
+                                              : Http::Headers::get().SchemeValues.Http);
+  }
 
   request_encoder_->encodeHeaders(request_headers, true);
   request_encoder_ = nullptr;
@@ -387,7 +520,7 @@ void HttpHealthCheckerImpl::HttpActiveHealthCheckSession::onTimeout() {
 
 Http::CodecClient*
 ProdHttpHealthCheckerImpl::createCodecClient(Upstream::Host::CreateConnectionData& data) {
-  return new Http::CodecClientProd(Http::CodecClient::Type::HTTP1, std::move(data.connection_),
+  return new Http::CodecClientProd(codecClientType(), std::move(data.connection_),
                                    data.host_description_);
 }
 
@@ -420,8 +553,10 @@ bool TcpHealthCheckMatcher::match(const MatchSegments& expected, const Buffer::I
 TcpHealthCheckerImpl::TcpHealthCheckerImpl(const Cluster& cluster,
                                            const envoy::api::v2::HealthCheck& config,
                                            Event::Dispatcher& dispatcher, Runtime::Loader& runtime,
-                                           Runtime::RandomGenerator& random)
-    : HealthCheckerImplBase(cluster, config, dispatcher, runtime, random), send_bytes_([&config] {
+                                           Runtime::RandomGenerator& random,
+                                           SharedHealthCheckSessionMap& shared_sessions)
+    : HealthCheckerImplBase(cluster, config, dispatcher, runtime, random, shared_sessions),
+      send_bytes_([&config] {
         Protobuf::RepeatedPtrField<envoy::api::v2::HealthCheck::Payload> send_repeated;
         if (!config.tcp_health_check().send().text().empty()) {
           send_repeated.Add()->CopyFrom(config.tcp_health_check().send());
@@ -504,8 +639,9 @@ RedisHealthCheckerImpl::RedisHealthCheckerImpl(const Cluster& cluster,
                                                Event::Dispatcher& dispatcher,
                                                Runtime::Loader& runtime,
                                                Runtime::RandomGenerator& random,
+                                               SharedHealthCheckSessionMap& shared_sessions,
                                                Redis::ConnPool::ClientFactory& client_factory)
-    : HealthCheckerImplBase(cluster, config, dispatcher, runtime, random),
+    : HealthCheckerImplBase(cluster, config, dispatcher, runtime, random, shared_sessions),
       client_factory_(client_factory) {}
 
 RedisHealthCheckerImpl::RedisActiveHealthCheckSession::RedisActiveHealthCheckSession(
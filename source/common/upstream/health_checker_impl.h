@@ -38,12 +38,14 @@ public:
    * @param runtime supplies the runtime loader.
    * @param random supplies the random generator.
    * @param dispatcher supplies the dispatcher.
+   * @param shared_sessions supplies the health check sessions shared between clusters.
    * @return a health checker.
    */
   static HealthCheckerSharedPtr create(const envoy::api::v2::HealthCheck& hc_config,
                                        Upstream::Cluster& cluster, Runtime::Loader& runtime,
                                        Runtime::RandomGenerator& random,
-                                       Event::Dispatcher& dispatcher);
+                                       Event::Dispatcher& dispatcher,
+                                       SharedHealthCheckSessionMap& shared_sessions);
 };
 
 /**
@@ -79,13 +81,13 @@ public:
   void start() override;
 
 protected:
-  class ActiveHealthCheckSession {
+  class ActiveHealthCheckSession : public SharedHealthCheckSession {
   public:
     enum class FailureType { Active, Passive, Network };
 
     virtual ~ActiveHealthCheckSession();
     void setUnhealthy(FailureType type);
-    void start() { onIntervalBase(); }
+    void start();
 
   protected:
     ActiveHealthCheckSession(HealthCheckerImplBase& parent, HostSharedPtr host);
@@ -96,10 +98,14 @@ protected:
     HostSharedPtr host_;
 
   private:
+    friend class HealthCheckerImplBase;
+
+    void follow(ActiveHealthCheckSession& leader);
     virtual void onInterval() PURE;
     void onIntervalBase();
     virtual void onTimeout() PURE;
     void onTimeoutBase();
+    void recordSuccess();
 
     HealthCheckerImplBase& parent_;
     Event::TimerPtr interval_timer_;
@@ -107,18 +113,34 @@ protected:
     uint32_t num_unhealthy_{};
     uint32_t num_healthy_{};
     bool first_check_{true};
+    // When sessions are shared, a leader runs the checks and replays each result on its followers.
+    // Followers belong to other health checkers with the same shared session key, for hosts with
+    // the same address. Only leaders have a shared key.
+    std::string shared_key_;
+    ActiveHealthCheckSession* leader_{};
+    std::list<ActiveHealthCheckSession*> followers_;
   };
 
   typedef std::unique_ptr<ActiveHealthCheckSession> ActiveHealthCheckSessionPtr;
 
   HealthCheckerImplBase(const Cluster& cluster, const envoy::api::v2::HealthCheck& config,
                         Event::Dispatcher& dispatcher, Runtime::Loader& runtime,
-                        Runtime::RandomGenerator& random);
+                        Runtime::RandomGenerator& random,
+                        SharedHealthCheckSessionMap& shared_sessions);
 
   virtual ActiveHealthCheckSessionPtr makeSession(HostSharedPtr host) PURE;
 
+  /**
+   * @return std::string the part of the shared session key that does not depend on the host.
+   *         Sessions are only shared between health checkers that would send identical checks
+   *         to an endpoint, so this includes the health check config and the TLS settings.
+   *         Implementations must add anything else that their checks depend on.
+   */
+  virtual std::string sharedSessionKey() const;
+
   const Cluster& cluster_;
   Event::Dispatcher& dispatcher_;
+  const uint64_t config_hash_;
   const std::chrono::milliseconds timeout_;
   const uint32_t unhealthy_threshold_;
   const uint32_t healthy_threshold_;
@@ -139,7 +161,20 @@ private:
     std::weak_ptr<Host> host_;
   };
 
+  /**
+   * Session for a host whose checks are run by a leader session of another health checker.
+   */
+  struct SharedFollowerSession : public ActiveHealthCheckSession {
+    SharedFollowerSession(HealthCheckerImplBase& parent, HostSharedPtr host)
+        : ActiveHealthCheckSession(parent, host) {}
+
+    // ActiveHealthCheckSession
+    void onInterval() override {}
+    void onTimeout() override {}
+  };
+
   void addHosts(const std::vector<HostSharedPtr>& hosts);
+  void addSession(const HostSharedPtr& host);
   void decHealthy();
   HealthCheckerStats generateStats(Stats::Scope& scope);
   void incHealthy();
@@ -149,6 +184,7 @@ private:
   void refreshHealthyStat();
   void runCallbacks(HostSharedPtr host, bool changed_state);
   void setUnhealthyCrossThread(const HostSharedPtr& host);
+  ActiveHealthCheckSession& takeOverSession(HostSharedPtr host, const std::string& shared_key);
 
   static const std::chrono::milliseconds NO_TRAFFIC_INTERVAL;
 
@@ -156,17 +192,26 @@ private:
   const std::chrono::milliseconds interval_;
   const std::chrono::milliseconds interval_jitter_;
   std::unordered_map<HostSharedPtr, ActiveHealthCheckSessionPtr> active_sessions_;
+  // Leader sessions by shared key. These are all ActiveHealthCheckSessions.
+  SharedHealthCheckSessionMap& shared_sessions_;
   uint64_t local_process_healthy_{};
 };
 
 /**
- * HTTP health checker implementation. Connection keep alive is used where possible.
+ * HTTP health checker implementation. Connection keep alive is used where possible. For HTTP/2
+ * clusters, checks can run as streams on a single persistent HTTP/2 connection per host.
  */
 class HttpHealthCheckerImpl : public HealthCheckerImplBase {
 public:
   HttpHealthCheckerImpl(const Cluster& cluster, const envoy::api::v2::HealthCheck& config,
                         Event::Dispatcher& dispatcher, Runtime::Loader& runtime,
-                        Runtime::RandomGenerator& random);
+                        Runtime::RandomGenerator& random,
+                        SharedHealthCheckSessionMap& shared_sessions);
+
+  /**
+   * @return Http::CodecClient::Type the codec that health check connections use.
+   */
+  Http::CodecClient::Type codecClientType() const { return codec_client_type_; }
 
 private:
   struct HttpActiveHealthCheckSession : public ActiveHealthCheckSession,
@@ -226,9 +271,11 @@ private:
   ActiveHealthCheckSessionPtr makeSession(HostSharedPtr host) override {
     return ActiveHealthCheckSessionPtr{new HttpActiveHealthCheckSession(*this, host)};
   }
+  std::string sharedSessionKey() const override;
 
   const std::string path_;
   Optional<std::string> service_name_;
+  const Http::CodecClient::Type codec_client_type_;
 };
 
 /**
@@ -301,7 +348,8 @@ class TcpHealthCheckerImpl : public HealthCheckerImplBase {
 public:
   TcpHealthCheckerImpl(const Cluster& cluster, const envoy::api::v2::HealthCheck& config,
                        Event::Dispatcher& dispatcher, Runtime::Loader& runtime,
-                       Runtime::RandomGenerator& random);
+                       Runtime::RandomGenerator& random,
+                       SharedHealthCheckSessionMap& shared_sessions);
 
 private:
   struct TcpActiveHealthCheckSession;
@@ -360,6 +408,7 @@ public:
   RedisHealthCheckerImpl(const Cluster& cluster, const envoy::api::v2::HealthCheck& config,
                          Event::Dispatcher& dispatcher, Runtime::Loader& runtime,
                          Runtime::RandomGenerator& random,
+                         SharedHealthCheckSessionMap& shared_sessions,
                          Redis::ConnPool::ClientFactory& client_factory);
 
   static const Redis::RespValue& healthCheckRequest() {
@@ -1,5 +1,9 @@
 #include "common/upstream/host_utility.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <string>
 
 namespace Envoy {
@@ -22,5 +26,42 @@ std::string HostUtility::healthFlagsToString(const Host& host) {
   return ret;
 }
 
+const std::chrono::seconds ResponseTimeAverage::DecayHalfLife{10};
+const uint64_t ResponseTimeAverage::FractionBits;
+
+double ResponseTimeAverage::decay(MonotonicTime last_update, MonotonicTime now) {
+  const std::chrono::duration<double> idle = now - last_update;
+  if (idle.count() <= 0) {
+    return 1.0;
+  }
+
+  return std::exp2(-idle.count() / std::chrono::duration<double>(DecayHalfLife).count());
+}
+
+void ResponseTimeAverage::record(std::chrono::microseconds response_time, MonotonicTime now) {
+  const double sample = static_cast<double>(
+      static_cast<uint64_t>(std::max<int64_t>(response_time.count(), 1)) << FractionBits);
+  const MonotonicTime last_update(MonotonicTime::duration(
+      last_update_.exchange(now.time_since_epoch().count(), std::memory_order_relaxed)));
+  const double weight = 0.875 * decay(last_update, now);
+
+  uint64_t average = average_.load(std::memory_order_relaxed);
+  uint64_t updated;
+  do {
+    // Seed the average with the first sample rather than decaying up from 0.
+    updated = static_cast<uint64_t>(average == 0 ? sample
+                                                 : average * weight + sample * (1.0 - weight));
+  } while (!average_.compare_exchange_weak(average, updated, std::memory_order_relaxed));
+}
+
+uint64_t ResponseTimeAverage::value(MonotonicTime now) const {
+  const MonotonicTime last_update(
+      MonotonicTime::duration(last_update_.load(std::memory_order_relaxed)));
+  const uint64_t average = static_cast<uint64_t>(average_.load(std::memory_order_relaxed) *
+                                                 decay(last_update, now));
+  // Round to the nearest microsecond so that responses of about a microsecond do not read as 0.
+  return (average + (1ULL << (FractionBits - 1))) >> FractionBits;
+}
+
 } // namespace Upstream
 } // namespace Envoy
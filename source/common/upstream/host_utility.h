@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
 
+#include "envoy/common/time.h"
 #include "envoy/upstream/upstream.h"
 
 namespace Envoy {
@@ -18,5 +22,42 @@ public:
   static std::string healthFlagsToString(const Host& host);
 };
 
+/**
+ * A moving average of a host's response times that any thread can update without locking. Each
+ * response normally has a weight of 1/8. The previous average's weight halves for every
+ * DecayHalfLife since it was last updated, so the first response after an idle period mostly
+ * replaces it. Reads decay towards 0 at the same rate. A host that was slow and is then avoided by
+ * latency aware load balancing therefore soon looks fast enough to be tried again; it is not
+ * starved on the strength of an old sample.
+ */
+class ResponseTimeAverage {
+public:
+  static const std::chrono::seconds DecayHalfLife;
+
+  /**
+   * Fold in a response time.
+   * @param response_time supplies the response time. Times under a microsecond count as one.
+   * @param now supplies the time the response completed.
+   */
+  void record(std::chrono::microseconds response_time, MonotonicTime now);
+
+  /**
+   * @param now supplies the current time.
+   * @return the average in microseconds decayed for the time since the last response, or 0 if no
+   *         response has been recorded.
+   */
+  uint64_t value(MonotonicTime now) const;
+
+private:
+  // The average is kept in fixed point so that it keeps moving when responses take only a few
+  // microseconds.
+  static const uint64_t FractionBits = 8;
+
+  static double decay(MonotonicTime last_update, MonotonicTime now);
+
+  std::atomic<uint64_t> average_{};
+  std::atomic<MonotonicTime::rep> last_update_{};
+};
+
 } // namespace Upstream
 } // namespace Envoy
@@ -1,9 +1,11 @@
 #include "common/upstream/load_balancer_impl.h"
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/stats/stats.h"
 #include "envoy/upstream/upstream.h"
@@ -16,12 +18,26 @@ namespace Upstream {
 static const std::string RuntimeZoneEnabled = "upstream.zone_routing.enabled";
 static const std::string RuntimeMinClusterSize = "upstream.zone_routing.min_cluster_size";
 static const std::string RuntimePanicThreshold = "upstream.healthy_panic_threshold";
+static const std::string RuntimeWeightEnabled = "upstream.weight_enabled";
+static const std::string RuntimeWeightedP2cEnabled = "upstream.least_request.weighted_p2c";
+static const std::string RuntimeLatencyAware = "upstream.least_request.latency_aware";
+
+// Locality weights are only scaled down once fewer than 1 / 1.4 (~71%) of a locality's hosts are
+// healthy, which leaves some headroom for hosts to fail without shifting traffic.
+static const double LocalityOverprovisioningFactor = 1.4;
 
 LoadBalancerBase::LoadBalancerBase(const HostSet& host_set, const HostSet* local_host_set,
                                    ClusterStats& stats, Runtime::Loader& runtime,
                                    Runtime::RandomGenerator& random)
     : stats_(stats), runtime_(runtime), random_(random), host_set_(host_set),
       local_host_set_(local_host_set) {
+  host_set_.addMemberUpdateCb(
+      [this](const std::vector<HostSharedPtr>&, const std::vector<HostSharedPtr>&) -> void {
+        runtime_stale_ = true;
+        regenerateLocalityWeightStructures();
+      });
+  regenerateLocalityWeightStructures();
+
   if (local_host_set_) {
     host_set_.addMemberUpdateCb(
         [this](const std::vector<HostSharedPtr>&, const std::vector<HostSharedPtr>&) -> void {
@@ -133,18 +149,27 @@ bool LoadBalancerBase::earlyExitNonLocalityRouting() {
 }
 
 bool LoadBalancerUtility::isGlobalPanic(const HostSet& host_set, Runtime::Loader& runtime) {
-  uint64_t global_panic_threshold =
-      std::min<uint64_t>(100, runtime.snapshot().getInteger(RuntimePanicThreshold, 50));
-  double healthy_percent = host_set.hosts().size() == 0
-                               ? 0
-                               : 100.0 * host_set.healthyHosts().size() / host_set.hosts().size();
+  return isGlobalPanic(host_set, panicThreshold(runtime.snapshot()));
+}
 
-  // If the % of healthy hosts in the cluster is less than our panic threshold, we use all hosts.
-  if (healthy_percent < global_panic_threshold) {
-    return true;
+uint64_t LoadBalancerUtility::panicThreshold(const Runtime::Snapshot& snapshot) {
+  return snapshot.getInteger(RuntimePanicThreshold, 50);
+}
+
+bool LoadBalancerUtility::isGlobalPanic(const HostSet& host_set, uint64_t panic_threshold) {
+  panic_threshold = std::min<uint64_t>(100, panic_threshold);
+  if (host_set.hosts().empty()) {
+    return panic_threshold > 0;
   }
 
-  return false;
+  // If the % of healthy hosts in the cluster is less than our panic threshold, we use all hosts.
+  // The percentage is compared cross multiplied to avoid a division.
+  return 100 * host_set.healthyHosts().size() < panic_threshold * host_set.hosts().size();
+}
+
+void LoadBalancerBase::onRuntimeUpdate(const Runtime::Snapshot& snapshot) {
+  panic_threshold_ = LoadBalancerUtility::panicThreshold(snapshot);
+  zone_routing_percent_ = std::min<uint64_t>(100, snapshot.getInteger(RuntimeZoneEnabled, 100));
 }
 
 void LoadBalancerBase::calculateLocalityPercentage(
@@ -209,23 +234,71 @@ const std::vector<HostSharedPtr>& LoadBalancerBase::tryChooseLocalLocalityHosts(
   return host_set_.healthyHostsPerLocality()[i];
 }
 
+void LoadBalancerBase::regenerateLocalityWeightStructures() {
+  locality_scheduler_.reset();
+  const std::vector<uint32_t>& locality_weights = host_set_.localityWeights();
+  if (locality_weights.empty()) {
+    return;
+  }
+
+  const auto& hosts_per_locality = host_set_.hostsPerLocality();
+  const auto& healthy_hosts_per_locality = host_set_.healthyHostsPerLocality();
+  ASSERT(locality_weights.size() == hosts_per_locality.size());
+  ASSERT(healthy_hosts_per_locality.size() == hosts_per_locality.size());
+
+  std::unique_ptr<EdfScheduler<LocalityEntry>> scheduler(new EdfScheduler<LocalityEntry>());
+  for (uint32_t i = 0; i < locality_weights.size(); ++i) {
+    if (locality_weights[i] == 0 || healthy_hosts_per_locality[i].empty()) {
+      continue;
+    }
+
+    // A locality keeps its full weight until less than 1 / LocalityOverprovisioningFactor of its
+    // hosts are healthy, and then loses weight in proportion to its healthy hosts.
+    const double healthy_fraction =
+        static_cast<double>(healthy_hosts_per_locality[i].size()) / hosts_per_locality[i].size();
+    const double effective_weight =
+        locality_weights[i] * std::min(1.0, LocalityOverprovisioningFactor * healthy_fraction);
+    scheduler->add(effective_weight, std::make_shared<LocalityEntry>(
+                                         LocalityEntry{i, effective_weight}));
+  }
+
+  if (!scheduler->empty()) {
+    locality_scheduler_ = std::move(scheduler);
+  }
+}
+
+const std::vector<HostSharedPtr>& LoadBalancerBase::chooseWeightedLocalityHosts() {
+  ASSERT(locality_scheduler_ != nullptr);
+  const std::shared_ptr<LocalityEntry> locality = locality_scheduler_->pickAndAdd(
+      [](const LocalityEntry& locality) { return locality.effective_weight_; });
+  return host_set_.healthyHostsPerLocality()[locality->index_];
+}
+
 const std::vector<HostSharedPtr>& LoadBalancerBase::hostsToUse() {
   ASSERT(host_set_.healthyHosts().size() <= host_set_.hosts().size());
+  refreshRuntimeIfStale();
 
-  if (LoadBalancerUtility::isGlobalPanic(host_set_, runtime_)) {
+  if (LoadBalancerUtility::isGlobalPanic(host_set_, panic_threshold_)) {
     stats_.lb_healthy_panic_.inc();
     return host_set_.hosts();
   }
 
+  // Explicit locality weights take precedence over zone aware routing.
+  if (locality_scheduler_) {
+    return chooseWeightedLocalityHosts();
+  }
+
   if (locality_routing_state_ == LocalityRoutingState::NoLocalityRouting) {
     return host_set_.healthyHosts();
   }
 
-  if (!runtime_.snapshot().featureEnabled(RuntimeZoneEnabled, 100)) {
+  // Same sampling as Snapshot::featureEnabled(), without the runtime lookup on every pick.
+  if (zone_routing_percent_ == 0 ||
+      (zone_routing_percent_ < 100 && random_.random() % 100 >= zone_routing_percent_)) {
     return host_set_.healthyHosts();
   }
 
-  if (LoadBalancerUtility::isGlobalPanic(*local_host_set_, runtime_)) {
+  if (LoadBalancerUtility::isGlobalPanic(*local_host_set_, panic_threshold_)) {
     stats_.lb_local_cluster_not_ok_.inc();
     return host_set_.healthyHosts();
   }
@@ -233,47 +306,59 @@ const std::vector<HostSharedPtr>& LoadBalancerBase::hostsToUse() {
   return tryChooseLocalLocalityHosts();
 }
 
-HostConstSharedPtr RoundRobinLoadBalancer::chooseHost(LoadBalancerContext*) {
-  const std::vector<HostSharedPtr>& hosts_to_use = hostsToUse();
-  if (hosts_to_use.empty()) {
-    return nullptr;
+EdfLoadBalancerBase::EdfLoadBalancerBase(const HostSet& host_set, const HostSet* local_host_set,
+                                         ClusterStats& stats, Runtime::Loader& runtime,
+                                         Runtime::RandomGenerator& random)
+    : LoadBalancerBase(host_set, local_host_set, stats, runtime, random) {
+  host_set.addMemberUpdateCb(
+      [this](const std::vector<HostSharedPtr>&, const std::vector<HostSharedPtr>&) -> void {
+        refresh();
+      });
+
+  refresh();
+}
+
+void EdfLoadBalancerBase::refresh() {
+  schedulers_.clear();
+  addScheduler(host_set_.hosts());
+  addScheduler(host_set_.healthyHosts());
+  for (const auto& locality_hosts : host_set_.healthyHostsPerLocality()) {
+    addScheduler(locality_hosts);
   }
+}
 
-  return hosts_to_use[rr_index_++ % hosts_to_use.size()];
+void EdfLoadBalancerBase::onRuntimeUpdate(const Runtime::Snapshot& snapshot) {
+  LoadBalancerBase::onRuntimeUpdate(snapshot);
+  weight_enabled_ = snapshot.getInteger(RuntimeWeightEnabled, 1) != 0;
 }
 
-LeastRequestLoadBalancer::LeastRequestLoadBalancer(const HostSet& host_set,
-                                                   const HostSet* local_host_set,
-                                                   ClusterStats& stats, Runtime::Loader& runtime,
-                                                   Runtime::RandomGenerator& random)
-    : LoadBalancerBase(host_set, local_host_set, stats, runtime, random) {
-  host_set.addMemberUpdateCb([this](const std::vector<HostSharedPtr>&,
-                                    const std::vector<HostSharedPtr>& hosts_removed) -> void {
-    if (last_host_) {
-      for (const HostSharedPtr& host : hosts_removed) {
-        if (host == last_host_) {
-          hits_left_ = 0;
-          last_host_.reset();
-
-          break;
-        }
-      }
-    }
-  });
+void EdfLoadBalancerBase::addScheduler(const std::vector<HostSharedPtr>& hosts) {
+  EdfScheduler<Host>& scheduler = schedulers_[&hosts];
+  for (const HostSharedPtr& host : hosts) {
+    scheduler.add(host->weight(), host);
+  }
 }
 
-HostConstSharedPtr LeastRequestLoadBalancer::chooseHost(LoadBalancerContext*) {
-  bool is_weight_imbalanced = stats_.max_host_weight_.value() != 1;
-  bool is_weight_enabled = runtime_.snapshot().getInteger("upstream.weight_enabled", 1UL) != 0;
+HostConstSharedPtr EdfLoadBalancerBase::chooseHost(LoadBalancerContext*) {
+  const std::vector<HostSharedPtr>& hosts_to_use = hostsToUse();
+  if (hosts_to_use.empty()) {
+    return nullptr;
+  }
 
-  if (is_weight_imbalanced && hits_left_ > 0 && is_weight_enabled) {
-    --hits_left_;
+  if (weight_enabled_ && stats_.max_host_weight_.value() > 1) {
+    auto it = schedulers_.find(&hosts_to_use);
+    if (it != schedulers_.end() && !it->second.empty()) {
+      return it->second.pickAndAdd([](const Host& host) { return host.weight(); });
+    }
+  }
 
-    return last_host_;
-  } else {
-    // To avoid hit stale last_host_ when all hosts become weight balanced.
-    hits_left_ = 0;
-    last_host_.reset();
+  return unweightedHostPick(hosts_to_use);
+}
+
+HostConstSharedPtr LeastRequestLoadBalancer::chooseHost(LoadBalancerContext* context) {
+  refreshRuntimeIfStale();
+  if (!weighted_p2c_) {
+    return EdfLoadBalancerBase::chooseHost(context);
   }
 
   const std::vector<HostSharedPtr>& hosts_to_use = hostsToUse();
@@ -281,21 +366,55 @@ HostConstSharedPtr LeastRequestLoadBalancer::chooseHost(LoadBalancerContext*) {
     return nullptr;
   }
 
-  // Make weighed random if we have hosts with non 1 weights.
-  if (is_weight_imbalanced & is_weight_enabled) {
-    last_host_ = hosts_to_use[random_.random() % hosts_to_use.size()];
-    hits_left_ = last_host_->weight() - 1;
+  return weightedHostPick(hosts_to_use);
+}
 
-    return last_host_;
-  } else {
-    HostSharedPtr host1 = hosts_to_use[random_.random() % hosts_to_use.size()];
-    HostSharedPtr host2 = hosts_to_use[random_.random() % hosts_to_use.size()];
-    if (host1->stats().rq_active_.value() < host2->stats().rq_active_.value()) {
-      return host1;
-    } else {
-      return host2;
+void LeastRequestLoadBalancer::onRuntimeUpdate(const Runtime::Snapshot& snapshot) {
+  EdfLoadBalancerBase::onRuntimeUpdate(snapshot);
+  weighted_p2c_ = snapshot.getInteger(RuntimeWeightedP2cEnabled, 0) != 0;
+  latency_aware_ = snapshot.getInteger(RuntimeLatencyAware, 0) != 0;
+}
+
+HostConstSharedPtr
+LeastRequestLoadBalancer::weightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) {
+  const HostSharedPtr& host1 = hosts_to_use[random_.random() % hosts_to_use.size()];
+  const HostSharedPtr& host2 = hosts_to_use[random_.random() % hosts_to_use.size()];
+
+  // Count the request about to be sent so that idle hosts are still compared by weight. Scores
+  // are (active + 1) / weight, compared cross multiplied by the other host's weight to avoid a
+  // division.
+  uint64_t score1 = (host1->stats().rq_active_.value() + 1) * host2->weight();
+  uint64_t score2 = (host2->stats().rq_active_.value() + 1) * host1->weight();
+
+  // Latency is only blended in when both hosts have an average, so that a host without one is
+  // neither flooded nor starved. Averages decay while a host gets no responses, so a host that
+  // was slow is eventually compared by load alone and gets a chance to show it has recovered.
+  if (latency_aware_) {
+    const MonotonicTime now = std::chrono::steady_clock::now();
+    const uint64_t latency1 = host1->responseTimeAverage(now);
+    const uint64_t latency2 = host2->responseTimeAverage(now);
+    if (latency1 > 0 && latency2 > 0) {
+      score1 *= latency1;
+      score2 *= latency2;
     }
   }
+
+  if (score1 < score2) {
+    return host1;
+  } else {
+    return host2;
+  }
+}
+
+HostConstSharedPtr
+LeastRequestLoadBalancer::unweightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) {
+  const HostSharedPtr& host1 = hosts_to_use[random_.random() % hosts_to_use.size()];
+  const HostSharedPtr& host2 = hosts_to_use[random_.random() % hosts_to_use.size()];
+  if (host1->stats().rq_active_.value() < host2->stats().rq_active_.value()) {
+    return host1;
+  } else {
+    return host2;
+  }
 }
 
 HostConstSharedPtr RandomLoadBalancer::chooseHost(LoadBalancerContext*) {
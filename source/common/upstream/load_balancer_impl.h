@@ -1,13 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "envoy/runtime/runtime.h"
 #include "envoy/upstream/load_balancer.h"
 #include "envoy/upstream/upstream.h"
 
+#include "common/upstream/edf_scheduler.h"
+
 #include "api/cds.pb.h"
 
 namespace Envoy {
@@ -24,6 +28,17 @@ public:
    * requests to hosts regardless of whether they are healthy or not.
    */
   static bool isGlobalPanic(const HostSet& host_set, Runtime::Loader& runtime);
+
+  /**
+   * Same as above, with a panic threshold (the minimum percentage of healthy hosts) that has
+   * already been read from runtime.
+   */
+  static bool isGlobalPanic(const HostSet& host_set, uint64_t panic_threshold);
+
+  /**
+   * @return uint64_t the panic threshold configured in the given runtime snapshot.
+   */
+  static uint64_t panicThreshold(const Runtime::Snapshot& snapshot);
 };
 
 /**
@@ -33,16 +48,39 @@ class LoadBalancerBase {
 protected:
   LoadBalancerBase(const HostSet& host_set, const HostSet* local_host_set, ClusterStats& stats,
                    Runtime::Loader& runtime, Runtime::RandomGenerator& random);
-  ~LoadBalancerBase();
+  virtual ~LoadBalancerBase();
 
   /**
    * Pick the host list to use (healthy or all depending on how many in the set are not healthy).
+   * If localities are weighted, a locality is picked first and its healthy hosts are used.
    */
   const std::vector<HostSharedPtr>& hostsToUse();
 
+  /**
+   * Re-read the runtime values cached by the load balancer if a new runtime snapshot has been
+   * loaded since they were last read. A host set update also forces a re-read, so runtime changes
+   * are never picked up later than they would be without the cache. This must be called before
+   * any cached value is used; hostsToUse() does so.
+   */
+  void refreshRuntimeIfStale() {
+    const Runtime::Snapshot& snapshot = runtime_.snapshot();
+    if (runtime_stale_ || snapshot.generation() != runtime_generation_) {
+      runtime_stale_ = false;
+      runtime_generation_ = snapshot.generation();
+      onRuntimeUpdate(snapshot);
+    }
+  }
+
+  /**
+   * Cache the runtime values that are used on every pick, so that picking a host does not need
+   * any runtime lookups. Overrides must call the base class implementation.
+   */
+  virtual void onRuntimeUpdate(const Runtime::Snapshot& snapshot);
+
   ClusterStats& stats_;
   Runtime::Loader& runtime_;
   Runtime::RandomGenerator& random_;
+  const HostSet& host_set_;
 
 private:
   enum class LocalityRoutingState { NoLocalityRouting, LocalityDirect, LocalityResidual };
@@ -72,28 +110,90 @@ private:
    */
   void regenerateLocalityRoutingStructures();
 
-  const HostSet& host_set_;
+  /**
+   * Regenerate the scheduler used to pick localities when they are weighted. Each locality's
+   * weight is scaled down by its healthy fraction, with some overprovisioning, so traffic shifts
+   * away from a locality gradually as it loses healthy hosts.
+   */
+  void regenerateLocalityWeightStructures();
+
+  /**
+   * @return the healthy hosts of a locality picked by weight.
+   */
+  const std::vector<HostSharedPtr>& chooseWeightedLocalityHosts();
+
+  struct LocalityEntry {
+    uint32_t index_;
+    double effective_weight_;
+  };
+
   const HostSet* local_host_set_;
+  // The generation of the snapshot that the cached runtime values were read from.
+  uint64_t runtime_generation_{};
+  bool runtime_stale_{true};
+  uint64_t panic_threshold_{};
+  uint64_t zone_routing_percent_{};
   uint64_t local_percent_to_route_{};
   LocalityRoutingState locality_routing_state_{LocalityRoutingState::NoLocalityRouting};
   std::vector<uint64_t> residual_capacity_;
   Common::CallbackHandle* local_host_set_member_update_cb_handle_{};
+  // Only set while at least one locality has a positive effective weight.
+  std::unique_ptr<EdfScheduler<LocalityEntry>> locality_scheduler_;
+};
+
+/**
+ * Base class for load balancers that honor host weights by picking hosts with an EDF scheduler.
+ * A scheduler is kept for every host list that hostsToUse() can return and is rebuilt when the
+ * host set changes. Picked hosts are added back with their current weight, so weight changes
+ * that do not change membership take effect incrementally.
+ *
+ * When no host has a weight above 1, or weighting is disabled via the "upstream.weight_enabled"
+ * runtime key, hosts are picked with unweightedHostPick() instead.
+ */
+class EdfLoadBalancerBase : public LoadBalancer, protected LoadBalancerBase {
+public:
+  EdfLoadBalancerBase(const HostSet& host_set, const HostSet* local_host_set, ClusterStats& stats,
+                      Runtime::Loader& runtime, Runtime::RandomGenerator& random);
+
+  // Upstream::LoadBalancer
+  HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+
+protected:
+  // LoadBalancerBase
+  void onRuntimeUpdate(const Runtime::Snapshot& snapshot) override;
+
+  /**
+   * Pick a host from a non-empty host list without regard to weights.
+   */
+  virtual HostConstSharedPtr
+  unweightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) PURE;
+
+private:
+  void refresh();
+  void addScheduler(const std::vector<HostSharedPtr>& hosts);
+
+  // Keyed by the host lists owned by host_set_, which stay put until the next member update.
+  std::unordered_map<const std::vector<HostSharedPtr>*, EdfScheduler<Host>> schedulers_;
+  bool weight_enabled_{};
 };
 
 /**
  * Implementation of LoadBalancer that performs RR selection across the hosts in the cluster.
+ * Weighted hosts are picked in proportion to their weight.
  */
-class RoundRobinLoadBalancer : public LoadBalancer, LoadBalancerBase {
+class RoundRobinLoadBalancer : public EdfLoadBalancerBase {
 public:
   RoundRobinLoadBalancer(const HostSet& host_set, const HostSet* local_host_set_,
                          ClusterStats& stats, Runtime::Loader& runtime,
                          Runtime::RandomGenerator& random)
-      : LoadBalancerBase(host_set, local_host_set_, stats, runtime, random) {}
-
-  // Upstream::LoadBalancer
-  HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+      : EdfLoadBalancerBase(host_set, local_host_set_, stats, runtime, random) {}
 
 private:
+  // EdfLoadBalancerBase
+  HostConstSharedPtr unweightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) override {
+    return hosts_to_use[rr_index_++ % hosts_to_use.size()];
+  }
+
   size_t rr_index_{};
 };
 
@@ -104,24 +204,35 @@ private:
  * and compares number of active requests.
  * Technique is based on http://www.eecs.harvard.edu/~michaelm/postscripts/mythesis.pdf
  *
- * When any of the hosts have non 1 weight, apply random weighted balancing.
- * Randomly pickup the host and send 'weight' number of requests to it.
- * This technique is acceptable for load testing but
- * will not work well in situations where requests take a long time.
- * In that case a different algorithm using a full scan will be required.
+ * When any of the hosts have non 1 weight, hosts are picked in proportion to their weight by the
+ * EDF scheduler.
+ *
+ * If the "upstream.least_request.weighted_p2c" runtime key is set, two random hosts are always
+ * compared instead, using their active requests divided by their weight. If
+ * "upstream.least_request.latency_aware" is also set, the score is further multiplied by each
+ * host's response time average (see HostDescription::responseTimeAverage()), so that of two
+ * equally loaded hosts the faster one is picked. This suits latency sensitive services with
+ * heterogeneous backends better than the EDF scheduler, which ignores load.
  */
-class LeastRequestLoadBalancer : public LoadBalancer, LoadBalancerBase {
+class LeastRequestLoadBalancer : public EdfLoadBalancerBase {
 public:
   LeastRequestLoadBalancer(const HostSet& host_set, const HostSet* local_host_set_,
                            ClusterStats& stats, Runtime::Loader& runtime,
-                           Runtime::RandomGenerator& random);
+                           Runtime::RandomGenerator& random)
+      : EdfLoadBalancerBase(host_set, local_host_set_, stats, runtime, random) {}
 
   // Upstream::LoadBalancer
   HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
 
 private:
-  HostSharedPtr last_host_;
-  uint32_t hits_left_{};
+  HostConstSharedPtr weightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use);
+
+  // EdfLoadBalancerBase
+  void onRuntimeUpdate(const Runtime::Snapshot& snapshot) override;
+  HostConstSharedPtr unweightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) override;
+
+  bool weighted_p2c_{};
+  bool latency_aware_{};
 };
 
 /**
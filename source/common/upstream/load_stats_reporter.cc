@@ -50,8 +50,8 @@ void LoadStatsReporter::establishNewStream() {
 
 void LoadStatsReporter::sendLoadStatsRequest() {
   request_.mutable_cluster_stats()->Clear();
+  const auto cluster_info_map = cm_.clusters();
   for (const std::string& cluster_name : clusters_) {
-    auto cluster_info_map = cm_.clusters();
     auto it = cluster_info_map.find(cluster_name);
     if (it == cluster_info_map.end()) {
       ENVOY_LOG(debug, "Cluster {} does not exist", cluster_name);
@@ -61,17 +61,22 @@ void LoadStatsReporter::sendLoadStatsRequest() {
     auto* cluster_stats = request_.add_cluster_stats();
     cluster_stats->set_cluster_name(cluster_name);
     for (auto& hosts : cluster.hostsPerLocality()) {
-      auto* locality_stats = cluster_stats->add_upstream_locality_stats();
       ASSERT(hosts.size() > 0);
-      locality_stats->mutable_locality()->MergeFrom(hosts[0]->locality());
       uint64_t rq_success = 0;
       uint64_t rq_error = 0;
       uint64_t rq_active = 0;
-      for (auto host : hosts) {
+      for (const auto& host : hosts) {
         rq_success += host->stats().rq_success_.latch();
         rq_error += host->stats().rq_error_.latch();
         rq_active += host->stats().rq_active_.value();
       }
+      // Counts are deltas since the last report, so localities that saw no traffic are left out
+      // rather than reported as zeroes. This keeps the report proportional to active localities.
+      if (rq_success + rq_error + rq_active == 0) {
+        continue;
+      }
+      auto* locality_stats = cluster_stats->add_upstream_locality_stats();
+      locality_stats->mutable_locality()->MergeFrom(hosts[0]->locality());
       locality_stats->set_total_successful_requests(rq_success);
       locality_stats->set_total_error_requests(rq_error);
       locality_stats->set_total_requests_in_progress(rq_active);
@@ -105,15 +110,15 @@ void LoadStatsReporter::onReceiveMessage(
   ENVOY_LOG(debug, "New load report epoch: {}", message->DebugString());
   clusters_.clear();
   // Reset stats for all hosts in clusters we are tracking.
+  const auto cluster_info_map = cm_.clusters();
   for (const std::string& cluster_name : message->clusters()) {
     clusters_.emplace_back(cluster_name);
-    auto cluster_info_map = cm_.clusters();
     auto it = cluster_info_map.find(cluster_name);
     if (it == cluster_info_map.end()) {
       continue;
     }
     auto& cluster = it->second.get();
-    for (auto host : cluster.hosts()) {
+    for (const auto& host : cluster.hosts()) {
       host->stats().rq_success_.latch();
       host->stats().rq_error_.latch();
     }
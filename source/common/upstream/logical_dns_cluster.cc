@@ -110,8 +110,9 @@ void LogicalDnsCluster::startResolve() {
             }
             HostVectorSharedPtr new_hosts(new std::vector<HostSharedPtr>());
             new_hosts->emplace_back(logical_host_);
-            updateHosts(new_hosts, createHealthyHostList(*new_hosts), empty_host_lists_,
-                        empty_host_lists_, *new_hosts, {});
+            updateHosts(std::make_shared<const HostSetSnapshot>(new_hosts, empty_host_lists_,
+                                                                 nullptr),
+                        *new_hosts, {});
           }
         }
 
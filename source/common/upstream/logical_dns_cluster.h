@@ -70,6 +70,13 @@ private:
       return logical_host_->outlierDetector();
     }
     const HostStats& stats() const override { return logical_host_->stats(); }
+    void recordResponseTime(std::chrono::microseconds response_time,
+                            MonotonicTime now) const override {
+      logical_host_->recordResponseTime(response_time, now);
+    }
+    uint64_t responseTimeAverage(MonotonicTime now) const override {
+      return logical_host_->responseTimeAverage(now);
+    }
     const std::string& hostname() const override { return logical_host_->hostname(); }
     Network::Address::InstanceConstSharedPtr address() const override { return address_; }
     const envoy::api::v2::Locality& locality() const override {
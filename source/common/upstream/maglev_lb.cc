@@ -0,0 +1,116 @@
+#include "common/upstream/maglev_lb.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/common/hash.h"
+#include "common/upstream/load_balancer_impl.h"
+
+namespace Envoy {
+namespace Upstream {
+
+const uint64_t MaglevTable::DefaultTableSize;
+
+// Marks a slot that no host has claimed yet while the table is being built.
+static const uint32_t EmptySlot = std::numeric_limits<uint32_t>::max();
+
+MaglevTable::MaglevTable(const std::vector<HostSharedPtr>& hosts, uint64_t table_size)
+    : num_hosts_(hosts.size()) {
+  ENVOY_LOG(trace, "maglev: building table size={} hosts={}", table_size, hosts.size());
+  if (hosts.empty()) {
+    return;
+  }
+
+  ASSERT(table_size > 1);
+  ASSERT(hosts.size() < EmptySlot);
+
+  // Each host's permutation of the table is (offset + j * skip) % table_size for j = 0, 1, ...
+  // Since table_size is prime and skip is in [1, table_size), this visits every slot.
+  struct Permutation {
+    uint64_t next_;
+    uint64_t skip_;
+  };
+
+  std::vector<Permutation> permutations;
+  permutations.reserve(hosts.size());
+  for (const auto& host : hosts) {
+    const std::string& address = host->address()->asString();
+    permutations.push_back({HashUtil::xxHash64(address) % table_size,
+                            HashUtil::xxHash64(address, 1) % (table_size - 1) + 1});
+  }
+
+  // Hosts take turns claiming the next free slot in their permutation until the table is full.
+  table_.resize(table_size, EmptySlot);
+  uint64_t filled = 0;
+  while (filled < table_size) {
+    for (uint32_t i = 0; i < hosts.size() && filled < table_size; i++) {
+      Permutation& permutation = permutations[i];
+      while (table_[permutation.next_] != EmptySlot) {
+        permutation.next_ = (permutation.next_ + permutation.skip_) % table_size;
+      }
+
+      table_[permutation.next_] = i;
+      permutation.next_ = (permutation.next_ + permutation.skip_) % table_size;
+      filled++;
+    }
+  }
+}
+
+MaglevLoadBalancer::MaglevLoadBalancer(HostSet& host_set, ClusterStats& stats,
+                                       Runtime::Loader& runtime, Runtime::RandomGenerator& random)
+    : host_set_(host_set), stats_(stats), runtime_(runtime), random_(random),
+      tables_(owned_tables_) {
+  host_set_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>&,
+                                     const std::vector<HostSharedPtr>&) -> void { refresh(); });
+
+  refresh();
+}
+
+MaglevLoadBalancer::MaglevLoadBalancer(HostSet& host_set, ClusterStats& stats,
+                                       Runtime::Loader& runtime, Runtime::RandomGenerator& random,
+                                       const TablesConstSharedPtr& shared_tables)
+    : host_set_(host_set), stats_(stats), runtime_(runtime), random_(random),
+      tables_(shared_tables) {}
+
+HostConstSharedPtr MaglevLoadBalancer::chooseHost(LoadBalancerContext* context) {
+  // Tables are only swapped on this thread, so there is no need to take a reference.
+  const Tables* tables = tables_.get();
+  if (!tables) {
+    return nullptr;
+  }
+
+  // If there is no hash in the context, just choose a random value (this effectively becomes
+  // the random LB but it won't crash if someone configures it this way).
+  // computeHashKey() may be computed on demand, so get it only once.
+  Optional<uint64_t> hash;
+  if (context) {
+    hash = context->computeHashKey();
+  }
+  const uint64_t h = hash.valid() ? hash.value() : random_.random();
+
+  if (LoadBalancerUtility::isGlobalPanic(host_set_, panicThreshold())) {
+    stats_.lb_healthy_panic_.inc();
+    return tables->all_hosts_table_.chooseHost(host_set_.hosts(), h);
+  } else {
+    return tables->healthy_hosts_table_.chooseHost(host_set_.healthyHosts(), h);
+  }
+}
+
+uint64_t MaglevLoadBalancer::panicThreshold() {
+  const Runtime::Snapshot& snapshot = runtime_.snapshot();
+  if (!panic_threshold_.valid() || snapshot.generation() != runtime_generation_) {
+    panic_threshold_ = LoadBalancerUtility::panicThreshold(snapshot);
+    runtime_generation_ = snapshot.generation();
+  }
+  return panic_threshold_.value();
+}
+
+void MaglevLoadBalancer::refresh() {
+  owned_tables_ = std::make_shared<const Tables>(host_set_.hosts(), host_set_.healthyHosts());
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "envoy/common/optional.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/upstream/load_balancer.h"
+
+#include "common/common/assert.h"
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * A Maglev lookup table (see "Maglev: A Fast and Reliable Software Network Load Balancer",
+ * Eisenbud et al., NSDI 2016). Each host fills table slots in the order of its own permutation
+ * of the table until every slot is taken, which gives every host an almost equal share of the
+ * table and moves few slots when hosts are added or removed. Lookup is a single modulo.
+ */
+class MaglevTable : Logger::Loggable<Logger::Id::upstream> {
+public:
+  /**
+   * @param hosts supplies the hosts to populate the table with.
+   * @param table_size supplies the number of slots. This must be prime, and should be much larger
+   *        than the number of hosts for the shares to be even.
+   */
+  MaglevTable(const std::vector<HostSharedPtr>& hosts, uint64_t table_size = DefaultTableSize);
+
+  /**
+   * @param hosts supplies the hosts that the table was built from.
+   * @param hash supplies the hash key to look up.
+   * @return HostConstSharedPtr the host owning the slot for hash, or nullptr if there are no hosts.
+   */
+  HostConstSharedPtr chooseHost(const std::vector<HostSharedPtr>& hosts, uint64_t hash) const {
+    if (table_.empty()) {
+      return nullptr;
+    }
+    ASSERT(hosts.size() == num_hosts_);
+    return hosts[table_[hash % table_.size()]];
+  }
+
+  static const uint64_t DefaultTableSize = 65537;
+
+private:
+  // Slots hold indices into the hosts the table was built from rather than references to the
+  // hosts, which keeps the table small and avoids reference counting on every slot.
+  std::vector<uint32_t> table_;
+  uint32_t num_hosts_{};
+};
+
+/**
+ * A consistent hashing load balancer backed by Maglev tables. Like RingHashLoadBalancer, a table
+ * is kept for all hosts as well as for healthy hosts, and the healthy host table is used unless
+ * we are in panic mode. Hash keys come from LoadBalancerContext::computeHashKey(); when there is
+ * no hash key a random host is chosen.
+ *
+ * The load balancer can either build its own tables whenever the host set changes, or use tables
+ * that are built once on the main thread and shared by every worker (see Tables).
+ */
+class MaglevLoadBalancer : public LoadBalancer {
+public:
+  /**
+   * The tables for a single host set snapshot. Tables can be built on any thread and then shared
+   * by load balancers on all threads, but can only be used with the host lists of that snapshot.
+   */
+  struct Tables {
+    Tables(const std::vector<HostSharedPtr>& hosts,
+           const std::vector<HostSharedPtr>& healthy_hosts)
+        : all_hosts_table_(hosts), healthy_hosts_table_(healthy_hosts) {}
+
+    const MaglevTable all_hosts_table_;
+    const MaglevTable healthy_hosts_table_;
+  };
+
+  typedef std::shared_ptr<const Tables> TablesConstSharedPtr;
+
+  /**
+   * Create a load balancer that rebuilds its own tables whenever host_set changes.
+   */
+  MaglevLoadBalancer(HostSet& host_set, ClusterStats& stats, Runtime::Loader& runtime,
+                     Runtime::RandomGenerator& random);
+
+  /**
+   * Create a load balancer that uses externally built tables. shared_tables must outlive the load
+   * balancer and is read on every pick, so the owner can swap in new tables whenever host_set
+   * changes. No host will be chosen while it is nullptr.
+   */
+  MaglevLoadBalancer(HostSet& host_set, ClusterStats& stats, Runtime::Loader& runtime,
+                     Runtime::RandomGenerator& random, const TablesConstSharedPtr& shared_tables);
+
+  // Upstream::LoadBalancer
+  HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+
+private:
+  void refresh();
+  uint64_t panicThreshold();
+
+  HostSet& host_set_;
+  ClusterStats& stats_;
+  Runtime::Loader& runtime_;
+  Runtime::RandomGenerator& random_;
+  // The panic threshold read from the runtime snapshot with generation runtime_generation_.
+  Optional<uint64_t> panic_threshold_;
+  uint64_t runtime_generation_{};
+  TablesConstSharedPtr owned_tables_;
+  const TablesConstSharedPtr& tables_;
+};
+
+} // namespace Upstream
+} // namespace Envoy
@@ -107,7 +107,7 @@ OriginalDstCluster::OriginalDstCluster(const envoy::api::v2::Cluster& config,
 void OriginalDstCluster::addHost(HostSharedPtr& host) {
   HostVectorSharedPtr new_hosts(new std::vector<HostSharedPtr>(hosts()));
   new_hosts->emplace_back(host);
-  updateHosts(new_hosts, createHealthyHostList(*new_hosts), empty_host_lists_, empty_host_lists_,
+  updateHosts(std::make_shared<const HostSetSnapshot>(new_hosts, empty_host_lists_, nullptr),
               {std::move(host)}, {});
 }
 
@@ -129,8 +129,8 @@ void OriginalDstCluster::cleanup() {
   }
 
   if (to_be_removed.size() > 0) {
-    updateHosts(new_hosts, createHealthyHostList(*new_hosts), empty_host_lists_, empty_host_lists_,
-                {}, to_be_removed);
+    updateHosts(std::make_shared<const HostSetSnapshot>(new_hosts, empty_host_lists_, nullptr), {},
+                to_be_removed);
   }
 
   cleanup_timer_->enableTimer(cleanup_interval_ms_);
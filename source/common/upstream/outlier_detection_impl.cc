@@ -1,5 +1,6 @@
 #include "common/upstream/outlier_detection_impl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <memory>
@@ -41,13 +42,17 @@ void DetectorHostMonitorImpl::uneject(MonotonicTime unejection_time) {
   last_unejection_time_.value(unejection_time);
 }
 
-void DetectorHostMonitorImpl::updateCurrentSuccessRateBucket() {
-  success_rate_accumulator_bucket_.store(success_rate_accumulator_.updateCurrentWriter());
+void DetectorHostMonitorImpl::updateCurrentWriters() {
+  success_rate_accumulator_.updateCurrentWriter();
+  if (latency_accumulator_) {
+    latency_accumulator_->updateCurrentWriter();
+  }
 }
 
 void DetectorHostMonitorImpl::putHttpResponseCode(uint64_t response_code) {
-  success_rate_accumulator_bucket_.load()->total_request_counter_++;
-  if (Http::CodeUtility::is5xx(response_code)) {
+  const bool is_5xx = Http::CodeUtility::is5xx(response_code);
+  success_rate_accumulator_.putResult(!is_5xx);
+  if (is_5xx) {
     std::shared_ptr<DetectorImpl> detector = detector_.lock();
     if (!detector) {
       // It's possible for the cluster/detector to go away while we still have a host in use.
@@ -59,12 +64,19 @@ void DetectorHostMonitorImpl::putHttpResponseCode(uint64_t response_code) {
                                                   detector->config().consecutive5xx())) {
       detector->onConsecutive5xx(host_.lock());
     }
-  } else {
-    success_rate_accumulator_bucket_.load()->success_request_counter_++;
+  } else if (consecutive_5xx_.load(std::memory_order_relaxed) != 0) {
+    // Only write when there is something to reset, so that hosts that are doing well do not keep
+    // taking the cache line away from other workers.
     consecutive_5xx_ = 0;
   }
 }
 
+void DetectorHostMonitorImpl::putResponseTime(std::chrono::milliseconds time) {
+  if (latency_accumulator_) {
+    latency_accumulator_->putResponseTime(time);
+  }
+}
+
 DetectorConfig::DetectorConfig(const envoy::api::v2::Cluster::OutlierDetection& config)
     : interval_ms_(static_cast<uint64_t>(PROTOBUF_GET_MS_OR_DEFAULT(config, interval, 10000))),
       base_ejection_time_ms_(
@@ -90,6 +102,7 @@ DetectorImpl::DetectorImpl(const Cluster& cluster,
                            MonotonicTimeSource& time_source, EventLoggerSharedPtr event_logger)
     : config_(config), dispatcher_(dispatcher), runtime_(runtime), time_source_(time_source),
       stats_(generateStats(cluster.info()->statsScope())),
+      latency_ejection_(runtime.snapshot().featureEnabled("outlier_detection.latency_ejection", 0)),
       interval_timer_(dispatcher.createTimer([this]() -> void { onIntervalTimer(); })),
       event_logger_(event_logger), success_rate_average_(-1), success_rate_ejection_threshold_(-1) {
 }
@@ -141,7 +154,8 @@ void DetectorImpl::initialize(const Cluster& cluster) {
 
 void DetectorImpl::addHostMonitor(HostSharedPtr host) {
   ASSERT(host_monitors_.count(host) == 0);
-  DetectorHostMonitorImpl* monitor = new DetectorHostMonitorImpl(shared_from_this(), host);
+  DetectorHostMonitorImpl* monitor =
+      new DetectorHostMonitorImpl(shared_from_this(), host, latency_ejection_);
   host_monitors_[host] = monitor;
   host->setOutlierDetector(DetectorHostMonitorPtr{monitor});
 }
@@ -181,6 +195,8 @@ bool DetectorImpl::enforceEjection(EjectionType type) {
   case EjectionType::SuccessRate:
     return runtime_.snapshot().featureEnabled("outlier_detection.enforcing_success_rate",
                                               config_.enforcingSuccessRate());
+  case EjectionType::Latency:
+    return runtime_.snapshot().featureEnabled("outlier_detection.enforcing_latency", 100);
   }
 
   NOT_REACHED;
@@ -341,20 +357,72 @@ void DetectorImpl::processSuccessRateEjections() {
   }
 }
 
+void DetectorImpl::processLatencyEjections() {
+  if (!latency_ejection_) {
+    return;
+  }
+
+  const uint64_t minimum_hosts = runtime_.snapshot().getInteger(
+      "outlier_detection.latency_minimum_hosts", config_.successRateMinimumHosts());
+  const uint64_t request_volume = runtime_.snapshot().getInteger(
+      "outlier_detection.latency_request_volume", config_.successRateRequestVolume());
+  if (host_monitors_.size() < minimum_hosts) {
+    return;
+  }
+
+  std::vector<std::pair<HostSharedPtr, uint64_t>> valid_latency_hosts;
+  valid_latency_hosts.reserve(host_monitors_.size());
+  for (const auto& host : host_monitors_) {
+    if (!host.first->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK)) {
+      Optional<uint64_t> p99 = host.second->latencyAccumulator()->getP99(request_volume);
+      if (p99.valid()) {
+        valid_latency_hosts.emplace_back(host.first, p99.value());
+      }
+    }
+  }
+
+  if (valid_latency_hosts.empty() || valid_latency_hosts.size() < minimum_hosts) {
+    return;
+  }
+
+  // A host is an outlier if its p99 response time is both a multiple of and a minimum distance
+  // above the median p99 of the cluster. The minimum distance keeps hosts of clusters with very
+  // fast responses from being ejected over a few milliseconds.
+  std::vector<uint64_t> p99s;
+  p99s.reserve(valid_latency_hosts.size());
+  for (const auto& host_p99 : valid_latency_hosts) {
+    p99s.push_back(host_p99.second);
+  }
+  std::nth_element(p99s.begin(), p99s.begin() + p99s.size() / 2, p99s.end());
+  const uint64_t median = p99s[p99s.size() / 2];
+  const uint64_t threshold = std::max(
+      median * runtime_.snapshot().getInteger("outlier_detection.latency_factor", 300) / 100,
+      median + runtime_.snapshot().getInteger("outlier_detection.latency_minimum_deviation_ms",
+                                              10));
+
+  for (const auto& host_p99 : valid_latency_hosts) {
+    if (host_p99.second > threshold) {
+      stats_.ejections_latency_.inc();
+      ejectHost(host_p99.first, EjectionType::Latency);
+    }
+  }
+}
+
 void DetectorImpl::onIntervalTimer() {
   MonotonicTime now = time_source_.currentTime();
 
   for (auto host : host_monitors_) {
     checkHostForUneject(host.first, host.second, now);
 
-    // Need to update the writer bucket to keep the data valid.
-    host.second->updateCurrentSuccessRateBucket();
+    // Need to start a new window to keep the data valid.
+    host.second->updateCurrentWriters();
     // Refresh host success rate stat for the /clusters endpoint. If there is a new valid value, it
     // will get updated in processSuccessRateEjections().
     host.second->successRate(-1);
   }
 
   processSuccessRateEjections();
+  processLatencyEjections();
 
   armIntervalTimer();
 }
@@ -401,6 +469,7 @@ void EventLoggerImpl::logEject(HostDescriptionConstSharedPtr host, Detector& det
 
   switch (type) {
   case EjectionType::Consecutive5xx:
+  case EjectionType::Latency:
     file_->write(fmt::format(
         json_5xx, AccessLogDateTimeFormatter::fromTime(now),
         secsSinceLastAction(host->outlierDetector().lastUnejectionTime(), monotonic_now),
@@ -445,6 +514,8 @@ std::string EventLoggerImpl::typeToString(EjectionType type) {
     return "5xx";
   case EjectionType::SuccessRate:
     return "SuccessRate";
+  case EjectionType::Latency:
+    return "Latency";
   }
 
   NOT_REACHED;
@@ -458,23 +529,104 @@ int EventLoggerImpl::secsSinceLastAction(const Optional<MonotonicTime>& lastActi
   return -1;
 }
 
-SuccessRateAccumulatorBucket* SuccessRateAccumulator::updateCurrentWriter() {
-  // Right now current is being written to and backup is not. Flush the backup and swap.
-  backup_success_rate_bucket_->success_request_counter_ = 0;
-  backup_success_rate_bucket_->total_request_counter_ = 0;
+namespace {
+
+// Threads are spread over the shards in the order in which they first count a request, so that
+// workers use different shards as long as there are no more workers than shards.
+size_t threadShard(size_t num_shards) {
+  static std::atomic<size_t> next_shard{0};
+  static thread_local const size_t shard = next_shard++;
+  return shard % num_shards;
+}
+
+} // namespace
 
-  current_success_rate_bucket_.swap(backup_success_rate_bucket_);
+const size_t SuccessRateAccumulator::NumShards;
 
-  return current_success_rate_bucket_.get();
+void SuccessRateAccumulator::putResult(bool success) {
+  shards_[threadShard(NumShards)].counts_.fetch_add(success ? (1ULL << 32) + 1 : 1,
+                                                    std::memory_order_relaxed);
+}
+
+void SuccessRateAccumulator::updateCurrentWriter() {
+  backup_success_rate_bucket_.success_request_counter_ = 0;
+  backup_success_rate_bucket_.total_request_counter_ = 0;
+  for (Shard& shard : shards_) {
+    const uint64_t counts = shard.counts_.exchange(0, std::memory_order_relaxed);
+    backup_success_rate_bucket_.success_request_counter_ += counts >> 32;
+    backup_success_rate_bucket_.total_request_counter_ += counts & 0xFFFFFFFF;
+  }
 }
 
 Optional<double> SuccessRateAccumulator::getSuccessRate(uint64_t success_rate_request_volume) {
-  if (backup_success_rate_bucket_->total_request_counter_ < success_rate_request_volume) {
+  if (backup_success_rate_bucket_.total_request_counter_ < success_rate_request_volume) {
     return Optional<double>();
   }
 
-  return Optional<double>(backup_success_rate_bucket_->success_request_counter_ * 100.0 /
-                          backup_success_rate_bucket_->total_request_counter_);
+  return Optional<double>(backup_success_rate_bucket_.success_request_counter_ * 100.0 /
+                          backup_success_rate_bucket_.total_request_counter_);
+}
+
+const size_t LatencyAccumulator::NumBuckets;
+const size_t LatencyAccumulator::NumShards;
+
+size_t LatencyAccumulator::bucketIndex(uint64_t time_ms) {
+  if (time_ms <= 1) {
+    return time_ms;
+  }
+
+  // For n > 0, bucket 2 * n starts at 2^n and bucket 2 * n + 1 starts half way to 2^(n + 1).
+  uint64_t msb = 0;
+  while (time_ms >> (msb + 1)) {
+    msb++;
+  }
+  const uint64_t half = (time_ms >> (msb - 1)) & 1;
+  return std::min<uint64_t>(2 * msb + half, NumBuckets - 1);
+}
+
+uint64_t LatencyAccumulator::bucketLowerBound(size_t index) {
+  if (index <= 1) {
+    return index;
+  }
+
+  const uint64_t msb = index / 2;
+  return (1ULL << msb) + (index % 2) * (1ULL << (msb - 1));
+}
+
+void LatencyAccumulator::putResponseTime(std::chrono::milliseconds time) {
+  shards_[threadShard(NumShards)]
+      .buckets_[bucketIndex(std::max<int64_t>(0, time.count()))]
+      .fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyAccumulator::updateCurrentWriter() {
+  backup_buckets_.fill(0);
+  backup_total_ = 0;
+  for (Shard& shard : shards_) {
+    for (size_t i = 0; i < NumBuckets; i++) {
+      const uint32_t count = shard.buckets_[i].exchange(0, std::memory_order_relaxed);
+      backup_buckets_[i] += count;
+      backup_total_ += count;
+    }
+  }
+}
+
+Optional<uint64_t> LatencyAccumulator::getP99(uint64_t request_volume) const {
+  if (backup_total_ == 0 || backup_total_ < request_volume) {
+    return Optional<uint64_t>();
+  }
+
+  // The rank of the 99th percentile, rounded up.
+  const uint64_t rank = (backup_total_ * 99 + 99) / 100;
+  uint64_t count = 0;
+  for (size_t i = 0; i < NumBuckets; i++) {
+    count += backup_buckets_[i];
+    if (count >= rank) {
+      return Optional<uint64_t>(bucketLowerBound(i));
+    }
+  }
+
+  NOT_REACHED;
 }
 
 } // namespace Outlier
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
@@ -60,26 +61,28 @@ struct HostSuccessRatePair {
 };
 
 struct SuccessRateAccumulatorBucket {
-  std::atomic<uint64_t> success_request_counter_;
-  std::atomic<uint64_t> total_request_counter_;
+  uint64_t success_request_counter_{};
+  uint64_t total_request_counter_{};
 };
 
 /**
- * The SuccessRateAccumulator uses the SuccessRateAccumulatorBucket to get per host success rate
- * stats. This implementation has a fixed window size of time, and thus only needs a
- * bucket to write to, and a bucket to accumulate/run stats over.
+ * The SuccessRateAccumulator gets per host success rate stats over a fixed window of time.
+ * Workers count requests into one of a few shards, picked per thread and each on its own cache
+ * line, so that workers sending to the same host mostly do not write to the same line. At the
+ * end of each window the shards are drained into a bucket that stats are run over.
  */
 class SuccessRateAccumulator {
 public:
-  SuccessRateAccumulator()
-      : current_success_rate_bucket_(new SuccessRateAccumulatorBucket()),
-        backup_success_rate_bucket_(new SuccessRateAccumulatorBucket()) {}
-
   /**
-   * This function updates the bucket to write data to.
-   * @return a pointer to the SuccessRateAccumulatorBucket.
+   * Count a request. This can be called from any thread.
+   * @param success supplies whether the request succeeded.
+   */
+  void putResult(bool success);
+  /**
+   * Start a new window. The requests counted during the window that just ended are kept for
+   * getSuccessRate().
    */
-  SuccessRateAccumulatorBucket* updateCurrentWriter();
+  void updateCurrentWriter();
   /**
    * This function returns the success rate of a host over a window of time if the request volume is
    * high enough. The underlying window of time could be dynamically adjusted. In the current
@@ -92,8 +95,63 @@ public:
   Optional<double> getSuccessRate(uint64_t success_rate_request_volume);
 
 private:
-  std::unique_ptr<SuccessRateAccumulatorBucket> current_success_rate_bucket_;
-  std::unique_ptr<SuccessRateAccumulatorBucket> backup_success_rate_bucket_;
+  static const size_t NumShards = 4;
+
+  // The total count is kept in the low 32 bits and the success count in the high 32 bits, so that
+  // a request is a single atomic add.
+  struct Shard {
+    std::atomic<uint64_t> counts_{};
+    char padding_[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  std::array<Shard, NumShards> shards_;
+  SuccessRateAccumulatorBucket backup_success_rate_bucket_;
+};
+
+/**
+ * The LatencyAccumulator tracks a host's response time distribution over a fixed window of time,
+ * in buckets that are spaced logarithmically with two buckets per power of two milliseconds.
+ * Like SuccessRateAccumulator, workers record into per thread shards that are merged at the end
+ * of each window.
+ */
+class LatencyAccumulator {
+public:
+  static const size_t NumBuckets = 48;
+
+  /**
+   * Add a response time. This can be called from any thread.
+   */
+  void putResponseTime(std::chrono::milliseconds time);
+  /**
+   * Start a new window. The response times added during the window that just ended are kept for
+   * getP99().
+   */
+  void updateCurrentWriter();
+  /**
+   * @param request_volume the number of response times the previous window must have for the
+   *                       result to be significant.
+   * @return a valid Optional<uint64_t> with the lower bound, in milliseconds, of the bucket that
+   *         the 99th percentile response time of the previous window falls in. If there were not
+   *         enough response times, an invalid Optional<uint64_t> is returned.
+   */
+  Optional<uint64_t> getP99(uint64_t request_volume) const;
+
+  static size_t bucketIndex(uint64_t time_ms);
+  static uint64_t bucketLowerBound(size_t index);
+
+private:
+  static const size_t NumShards = 4;
+
+  // The padding keeps the busy low buckets of one shard off the cache line holding the end of the
+  // previous shard.
+  struct Shard {
+    std::array<std::atomic<uint32_t>, NumBuckets> buckets_{};
+    char padding_[64];
+  };
+
+  std::array<Shard, NumShards> shards_;
+  std::array<uint64_t, NumBuckets> backup_buckets_{};
+  uint64_t backup_total_{};
 };
 
 class DetectorImpl;
@@ -103,23 +161,24 @@ class DetectorImpl;
  */
 class DetectorHostMonitorImpl : public DetectorHostMonitor {
 public:
-  DetectorHostMonitorImpl(std::shared_ptr<DetectorImpl> detector, HostSharedPtr host)
-      : detector_(detector), host_(host), success_rate_(-1) {
-    // Point the success_rate_accumulator_bucket_ pointer to a bucket.
-    updateCurrentSuccessRateBucket();
-  }
+  DetectorHostMonitorImpl(std::shared_ptr<DetectorImpl> detector, HostSharedPtr host,
+                          bool track_latency)
+      : detector_(detector), host_(host),
+        latency_accumulator_(track_latency ? new LatencyAccumulator() : nullptr),
+        success_rate_(-1) {}
 
   void eject(MonotonicTime ejection_time);
   void uneject(MonotonicTime ejection_time);
-  void updateCurrentSuccessRateBucket();
+  void updateCurrentWriters();
   SuccessRateAccumulator& successRateAccumulator() { return success_rate_accumulator_; }
+  const LatencyAccumulator* latencyAccumulator() const { return latency_accumulator_.get(); }
   void successRate(double new_success_rate) { success_rate_ = new_success_rate; }
   void resetConsecutive5xx() { consecutive_5xx_ = 0; }
 
   // Upstream::Outlier::DetectorHostMonitor
   uint32_t numEjections() override { return num_ejections_; }
   void putHttpResponseCode(uint64_t response_code) override;
-  void putResponseTime(std::chrono::milliseconds) override {}
+  void putResponseTime(std::chrono::milliseconds time) override;
   const Optional<MonotonicTime>& lastEjectionTime() override { return last_ejection_time_; }
   const Optional<MonotonicTime>& lastUnejectionTime() override { return last_unejection_time_; }
   double successRate() const override { return success_rate_; }
@@ -132,7 +191,8 @@ private:
   Optional<MonotonicTime> last_unejection_time_;
   uint32_t num_ejections_{};
   SuccessRateAccumulator success_rate_accumulator_;
-  std::atomic<SuccessRateAccumulatorBucket*> success_rate_accumulator_bucket_;
+  // Only set when latency based ejection is enabled.
+  std::unique_ptr<LatencyAccumulator> latency_accumulator_;
   double success_rate_;
 };
 
@@ -145,7 +205,8 @@ private:
   GAUGE  (ejections_active)                                                                        \
   COUNTER(ejections_overflow)                                                                      \
   COUNTER(ejections_consecutive_5xx)                                                               \
-  COUNTER(ejections_success_rate)
+  COUNTER(ejections_success_rate)                                                                  \
+  COUNTER(ejections_latency)
 // clang-format on
 
 /**
@@ -221,6 +282,7 @@ private:
   void onIntervalTimer();
   void runCallbacks(HostSharedPtr host);
   bool enforceEjection(EjectionType type);
+  void processLatencyEjections();
   void processSuccessRateEjections();
 
   DetectorConfig config_;
@@ -228,6 +290,8 @@ private:
   Runtime::Loader& runtime_;
   MonotonicTimeSource& time_source_;
   DetectionStats stats_;
+  // Latency based ejection is configured through runtime, since the v2 API has no field for it.
+  const bool latency_ejection_;
   Event::TimerPtr interval_timer_;
   std::list<ChangeStateCb> callbacks_;
   std::unordered_map<HostSharedPtr, DetectorHostMonitorImpl*> host_monitors_;
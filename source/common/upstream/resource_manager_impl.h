@@ -1,11 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/upstream/resource_manager.h"
 
 #include "common/common/assert.h"
@@ -13,6 +19,23 @@
 namespace Envoy {
 namespace Upstream {
 
+/**
+ * All adaptive concurrency stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_ADAPTIVE_CONCURRENCY_STATS(GAUGE)                                                      \
+  GAUGE(limit)                                                                                     \
+  GAUGE(min_rtt_us)                                                                                \
+  GAUGE(sample_rtt_us)
+// clang-format on
+
+/**
+ * Struct definition for all adaptive concurrency stats. @see stats_macros.h
+ */
+struct AdaptiveConcurrencyStats {
+  ALL_ADAPTIVE_CONCURRENCY_STATS(GENERATE_GAUGE_STRUCT)
+};
+
 /**
  * Implementation of ResourceManager.
  * NOTE: This implementation makes some assumptions which favor simplicity over correctness.
@@ -21,22 +44,45 @@ namespace Upstream {
  *    occur during high contention.
  * 2) Though atomics are used, it is possible for resources to temporarily go above the supplied
  *    maximums. This should not effect overall behavior.
+ *
+ * Retries can optionally be limited by a retry budget instead of the static max_retries threshold.
+ * The budget is configured via the runtime keys <runtime_key>retry_budget.budget_percent and
+ * <runtime_key>retry_budget.min_retry_concurrency. When budget_percent is non-zero, the number of
+ * active retries is capped at budget_percent of the currently outstanding (active + pending)
+ * requests, with a floor of min_retry_concurrency so that low volume clusters can still retry.
+ *
+ * Outstanding requests can optionally be limited by an adaptive concurrency limit, enabled via the
+ * runtime key <runtime_key>adaptive_concurrency.enabled. See AdaptiveRequestsResourceImpl.
  */
 class ResourceManagerImpl : public ResourceManager {
 public:
   ResourceManagerImpl(Runtime::Loader& runtime, const std::string& runtime_key,
+                      Stats::Scope& scope, const std::string& stats_prefix,
                       uint64_t max_connections, uint64_t max_pending_requests,
                       uint64_t max_requests, uint64_t max_retries)
       : connections_(max_connections, runtime, runtime_key + "max_connections"),
         pending_requests_(max_pending_requests, runtime, runtime_key + "max_pending_requests"),
         requests_(max_requests, runtime, runtime_key + "max_requests"),
-        retries_(max_retries, runtime, runtime_key + "max_retries") {}
+        retries_(max_retries, runtime, runtime_key, requests_, pending_requests_),
+        adaptive_requests_(max_requests, runtime, runtime_key,
+                           generateAdaptiveConcurrencyStats(scope, stats_prefix)) {}
+
+  static AdaptiveConcurrencyStats generateAdaptiveConcurrencyStats(Stats::Scope& scope,
+                                                                   const std::string& prefix) {
+    const std::string final_prefix = prefix + "adaptive_concurrency.";
+    return {ALL_ADAPTIVE_CONCURRENCY_STATS(POOL_GAUGE_PREFIX(scope, final_prefix))};
+  }
 
   // Upstream::ResourceManager
   Resource& connections() override { return connections_; }
   Resource& pendingRequests() override { return pending_requests_; }
   Resource& requests() override { return requests_; }
   Resource& retries() override { return retries_; }
+  bool retryBudgetActive() override { return retries_.budgetPercent() > 0; }
+  Resource& adaptiveRequests() override { return adaptive_requests_; }
+  void recordRequestRtt(std::chrono::microseconds rtt) override {
+    adaptive_requests_.recordRtt(rtt);
+  }
 
 private:
   struct ResourceImpl : public Resource {
@@ -59,10 +105,162 @@ private:
     const std::string runtime_key_;
   };
 
+  /**
+   * Retry resource which, when a retry budget is configured via runtime, derives its maximum from
+   * the number of outstanding requests instead of the static max_retries threshold.
+   */
+  struct RetryResourceImpl : public ResourceImpl {
+    RetryResourceImpl(uint64_t max, Runtime::Loader& runtime, const std::string& runtime_key,
+                      const ResourceImpl& requests, const ResourceImpl& pending_requests)
+        : ResourceImpl(max, runtime, runtime_key + "max_retries"), requests_(requests),
+          pending_requests_(pending_requests),
+          budget_percent_key_(runtime_key + "retry_budget.budget_percent"),
+          min_retry_concurrency_key_(runtime_key + "retry_budget.min_retry_concurrency") {}
+
+    uint64_t budgetPercent() {
+      return std::min<uint64_t>(100, runtime_.snapshot().getInteger(budget_percent_key_, 0));
+    }
+
+    // Upstream::Resource
+    uint64_t max() override {
+      const uint64_t budget_percent = budgetPercent();
+      if (budget_percent == 0) {
+        return ResourceImpl::max();
+      }
+
+      const uint64_t outstanding = requests_.current_ + pending_requests_.current_;
+      return std::max<uint64_t>(runtime_.snapshot().getInteger(min_retry_concurrency_key_, 3),
+                                outstanding * budget_percent / 100);
+    }
+
+    const ResourceImpl& requests_;
+    const ResourceImpl& pending_requests_;
+    const std::string budget_percent_key_;
+    const std::string min_retry_concurrency_key_;
+  };
+
+  /**
+   * Outstanding request resource whose maximum follows a gradient concurrency limit, in the spirit
+   * of TCP Vegas: the limit grows while request round trip times stay near the lowest one seen and
+   * shrinks once they rise, as that means requests are queueing upstream.
+   *
+   * Round trip times are averaged over windows of <runtime_key>adaptive_concurrency.window_samples
+   * requests (at most 10000). At the end of each window the limit becomes
+   *   limit * gradient + sqrt(limit), where gradient = min_rtt * (1 + tolerance) / sample_rtt
+   * clamped to [0.5, 1], bounded by <runtime_key>adaptive_concurrency.min_limit and
+   * <runtime_key>adaptive_concurrency.max_limit (the static max_requests threshold by default).
+   * The limit does not grow while fewer than half of it is in use. The minimum round trip time is
+   * re-measured every <runtime_key>adaptive_concurrency.min_rtt_windows windows so that it can
+   * follow upstreams that become slower for good, and the limit is left as is for that window.
+   *
+   * The limit starts at max_limit, so enabling it never admits fewer requests than the static
+   * threshold until latency rises. While disabled the maximum is unbounded.
+   */
+  struct AdaptiveRequestsResourceImpl : public ResourceImpl {
+    AdaptiveRequestsResourceImpl(uint64_t max, Runtime::Loader& runtime,
+                                 const std::string& runtime_key, AdaptiveConcurrencyStats stats)
+        : ResourceImpl(max, runtime, runtime_key + "adaptive_concurrency.max_limit"),
+          stats_(stats), enabled_key_(runtime_key + "adaptive_concurrency.enabled"),
+          min_limit_key_(runtime_key + "adaptive_concurrency.min_limit"),
+          window_samples_key_(runtime_key + "adaptive_concurrency.window_samples"),
+          min_rtt_windows_key_(runtime_key + "adaptive_concurrency.min_rtt_windows"),
+          tolerance_percent_key_(runtime_key + "adaptive_concurrency.rtt_tolerance_percent") {}
+
+    bool enabled() { return runtime_.snapshot().getInteger(enabled_key_, 0) != 0; }
+
+    void recordRtt(std::chrono::microseconds rtt) {
+      if (!enabled()) {
+        return;
+      }
+
+      // Samples arrive from every worker, so they are only added to the window. Whichever thread
+      // sees the window fill up closes it; the lock is only tried so that no worker ever waits,
+      // and only the thread that closes a window reads the rest of the configuration. The window
+      // size is capped well below what the count bits of window_ hold, so samples added while a
+      // window is being closed cannot overflow into the sum.
+      const uint64_t window_size = std::max<uint64_t>(
+          1, std::min<uint64_t>(10000, runtime_.snapshot().getInteger(window_samples_key_, 100)));
+      const uint64_t window =
+          window_.fetch_add((static_cast<uint64_t>(rtt.count()) << WindowCountBits) + 1,
+                            std::memory_order_relaxed) +
+          1;
+      if ((window & WindowCountMask) < window_size) {
+        return;
+      }
+
+      std::unique_lock<std::mutex> lock(lock_, std::try_to_lock);
+      if (!lock.owns_lock() ||
+          (window_.load(std::memory_order_relaxed) & WindowCountMask) < window_size) {
+        // Another thread is closing, or has just closed, this window.
+        return;
+      }
+
+      const uint64_t closed_window = window_.exchange(0, std::memory_order_relaxed);
+      const uint64_t sample_rtt_us = std::max<uint64_t>(
+          1, (closed_window >> WindowCountBits) / (closed_window & WindowCountMask));
+      stats_.sample_rtt_us_.set(sample_rtt_us);
+
+      const uint64_t max_limit = ResourceImpl::max();
+      const uint64_t min_limit =
+          std::min(max_limit, runtime_.snapshot().getInteger(min_limit_key_, 3));
+      uint64_t limit = limit_ == 0 ? max_limit : limit_.load();
+
+      if (min_rtt_us_ == 0 ||
+          ++windows_since_min_rtt_ >= runtime_.snapshot().getInteger(min_rtt_windows_key_, 100)) {
+        min_rtt_us_ = sample_rtt_us;
+        windows_since_min_rtt_ = 0;
+      } else {
+        min_rtt_us_ = std::min(min_rtt_us_, sample_rtt_us);
+        const double tolerance =
+            1.0 + runtime_.snapshot().getInteger(tolerance_percent_key_, 10) / 100.0;
+        const double gradient = std::max(
+            0.5, std::min(1.0, tolerance * min_rtt_us_ / static_cast<double>(sample_rtt_us)));
+        const uint64_t new_limit =
+            static_cast<uint64_t>(limit * gradient + std::sqrt(static_cast<double>(limit)));
+        if (new_limit < limit || current_ * 2 >= limit) {
+          limit = new_limit;
+        }
+      }
+
+      limit = std::max(min_limit, std::min(max_limit, limit));
+      limit_ = limit;
+      stats_.min_rtt_us_.set(min_rtt_us_);
+      stats_.limit_.set(limit);
+    }
+
+    // Upstream::Resource
+    uint64_t max() override {
+      if (!enabled()) {
+        return std::numeric_limits<uint64_t>::max();
+      }
+
+      return limit_ == 0 ? ResourceImpl::max() : limit_.load();
+    }
+
+    AdaptiveConcurrencyStats stats_;
+    const std::string enabled_key_;
+    const std::string min_limit_key_;
+    const std::string window_samples_key_;
+    const std::string min_rtt_windows_key_;
+    const std::string tolerance_percent_key_;
+    // The current limit, or 0 before the first window has completed.
+    std::atomic<uint64_t> limit_{};
+    // The current window's sample count is kept in the low WindowCountBits bits and the sum of its
+    // round trip times, in microseconds, in the rest, so that a sample is a single atomic add.
+    static const uint64_t WindowCountBits = 16;
+    static const uint64_t WindowCountMask = (1ULL << WindowCountBits) - 1;
+    std::atomic<uint64_t> window_{};
+    // Held by the thread closing a window; guards the fields below.
+    std::mutex lock_;
+    uint64_t min_rtt_us_{};
+    uint64_t windows_since_min_rtt_{};
+  };
+
   ResourceImpl connections_;
   ResourceImpl pending_requests_;
   ResourceImpl requests_;
-  ResourceImpl retries_;
+  RetryResourceImpl retries_;
+  AdaptiveRequestsResourceImpl adaptive_requests_;
 };
 
 typedef std::unique_ptr<ResourceManagerImpl> ResourceManagerImplPtr;
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "common/common/assert.h"
+#include "common/common/hash.h"
 #include "common/upstream/load_balancer_impl.h"
 
 namespace Envoy {
@@ -13,24 +14,38 @@ namespace Upstream {
 RingHashLoadBalancer::RingHashLoadBalancer(HostSet& host_set, ClusterStats& stats,
                                            Runtime::Loader& runtime,
                                            Runtime::RandomGenerator& random)
-    : host_set_(host_set), stats_(stats), runtime_(runtime), random_(random) {
+    : host_set_(host_set), stats_(stats), runtime_(runtime), random_(random),
+      rings_(owned_rings_) {
   host_set_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>&,
                                      const std::vector<HostSharedPtr>&) -> void { refresh(); });
 
   refresh();
 }
 
+RingHashLoadBalancer::RingHashLoadBalancer(HostSet& host_set, ClusterStats& stats,
+                                           Runtime::Loader& runtime,
+                                           Runtime::RandomGenerator& random,
+                                           const RingsConstSharedPtr& shared_rings)
+    : host_set_(host_set), stats_(stats), runtime_(runtime), random_(random),
+      rings_(shared_rings) {}
+
 HostConstSharedPtr RingHashLoadBalancer::chooseHost(LoadBalancerContext* context) {
-  if (LoadBalancerUtility::isGlobalPanic(host_set_, runtime_)) {
+  // Rings are only swapped on this thread, so there is no need to take a reference.
+  const Rings* rings = rings_.get();
+  if (!rings) {
+    return nullptr;
+  }
+
+  if (LoadBalancerUtility::isGlobalPanic(host_set_, panicThreshold())) {
     stats_.lb_healthy_panic_.inc();
-    return all_hosts_ring_.chooseHost(context, random_);
+    return rings->all_hosts_ring_.chooseHost(context, random_);
   } else {
-    return healthy_hosts_ring_.chooseHost(context, random_);
+    return rings->healthy_hosts_ring_.chooseHost(context, random_);
   }
 }
 
 HostConstSharedPtr RingHashLoadBalancer::Ring::chooseHost(LoadBalancerContext* context,
-                                                          Runtime::RandomGenerator& random) {
+                                                          Runtime::RandomGenerator& random) const {
   if (ring_.empty()) {
     return nullptr;
   }
@@ -76,10 +91,9 @@ HostConstSharedPtr RingHashLoadBalancer::Ring::chooseHost(LoadBalancerContext* c
   }
 }
 
-void RingHashLoadBalancer::Ring::create(Runtime::Loader& runtime,
-                                        const std::vector<HostSharedPtr>& hosts) {
+RingHashLoadBalancer::Ring::Ring(Runtime::Loader& runtime,
+                                 const std::vector<HostSharedPtr>& hosts) {
   ENVOY_LOG(trace, "ring hash: building ring");
-  ring_.clear();
   if (hosts.empty()) {
     return;
   }
@@ -87,11 +101,6 @@ void RingHashLoadBalancer::Ring::create(Runtime::Loader& runtime,
   // Currently we specify the minimum size of the ring, and determine the replication factor
   // based on the number of hosts. It's possible we might want to support more sophisticated
   // configuration in the future.
-  // NOTE: Currently we keep a ring for healthy hosts and unhealthy hosts, and this is done per
-  //       thread. This is the simplest implementation, but it's expensive from a memory
-  //       standpoint and duplicates the regeneration computation. In the future we might want
-  //       to generate the rings centrally and then just RCU them out to each thread. This is
-  //       sufficient for getting started.
   uint64_t min_ring_size = runtime.snapshot().getInteger("upstream.ring_hash.min_ring_size", 1024);
 
   uint64_t hashes_per_host = 1;
@@ -108,8 +117,7 @@ void RingHashLoadBalancer::Ring::create(Runtime::Loader& runtime,
   for (const auto& host : hosts) {
     for (uint64_t i = 0; i < hashes_per_host; i++) {
       std::string hash_key(host->address()->asString() + "_" + std::to_string(i));
-      // TODO(danielhochman): convert to HashUtil::xxHash64 when we have a migration strategy.
-      uint64_t hash = std::hash<std::string>()(hash_key);
+      const uint64_t hash = HashUtil::xxHash64(hash_key);
       ENVOY_LOG(trace, "ring hash: hash_key={} hash={}", hash_key, hash);
       ring_.push_back({hash, host});
     }
@@ -125,9 +133,18 @@ void RingHashLoadBalancer::Ring::create(Runtime::Loader& runtime,
 #endif
 }
 
+uint64_t RingHashLoadBalancer::panicThreshold() {
+  const Runtime::Snapshot& snapshot = runtime_.snapshot();
+  if (!panic_threshold_.valid() || snapshot.generation() != runtime_generation_) {
+    panic_threshold_ = LoadBalancerUtility::panicThreshold(snapshot);
+    runtime_generation_ = snapshot.generation();
+  }
+  return panic_threshold_.value();
+}
+
 void RingHashLoadBalancer::refresh() {
-  all_hosts_ring_.create(runtime_, host_set_.hosts());
-  healthy_hosts_ring_.create(runtime_, host_set_.healthyHosts());
+  owned_rings_ = std::make_shared<const Rings>(runtime_, host_set_.hosts(),
+                                               host_set_.healthyHosts());
 }
 
 } // namespace Upstream
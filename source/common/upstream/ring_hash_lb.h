@@ -1,8 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "envoy/common/optional.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/upstream/load_balancer.h"
 
@@ -15,6 +17,11 @@ namespace Upstream {
  * A load balancer that implements consistent modulo hashing ("ketama"). Currently, zone aware
  * routing is not supported. A ring is kept for all hosts as well as a ring for healthy hosts.
  * Unless we are in panic mode, the healthy host ring is used.
+ *
+ * Rings are immutable once built. The load balancer can either build its own rings whenever the
+ * host set changes, or use rings that are built once on the main thread and shared by every
+ * worker (see Rings).
+ *
  * In the future it would be nice to support:
  * 1) Weighting.
  * 2) Per-zone rings and optional zone aware routing (not all applications will want this).
@@ -22,33 +29,65 @@ namespace Upstream {
  */
 class RingHashLoadBalancer : public LoadBalancer, Logger::Loggable<Logger::Id::upstream> {
 public:
-  RingHashLoadBalancer(HostSet& host_set, ClusterStats& stats, Runtime::Loader& runtime,
-                       Runtime::RandomGenerator& random);
-
-  // Upstream::LoadBalancer
-  HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
-
-private:
   struct RingEntry {
     uint64_t hash_;
     HostConstSharedPtr host_;
   };
 
   struct Ring {
-    HostConstSharedPtr chooseHost(LoadBalancerContext* context, Runtime::RandomGenerator& random);
-    void create(Runtime::Loader& runtime, const std::vector<HostSharedPtr>& hosts);
+    Ring(Runtime::Loader& runtime, const std::vector<HostSharedPtr>& hosts);
+
+    HostConstSharedPtr chooseHost(LoadBalancerContext* context,
+                                  Runtime::RandomGenerator& random) const;
 
     std::vector<RingEntry> ring_;
   };
 
+  /**
+   * The rings for a single host set snapshot. Rings can be built on any thread and then shared by
+   * load balancers on all threads.
+   */
+  struct Rings {
+    Rings(Runtime::Loader& runtime, const std::vector<HostSharedPtr>& hosts,
+          const std::vector<HostSharedPtr>& healthy_hosts)
+        : all_hosts_ring_(runtime, hosts), healthy_hosts_ring_(runtime, healthy_hosts) {}
+
+    const Ring all_hosts_ring_;
+    const Ring healthy_hosts_ring_;
+  };
+
+  typedef std::shared_ptr<const Rings> RingsConstSharedPtr;
+
+  /**
+   * Create a load balancer that rebuilds its own rings whenever host_set changes.
+   */
+  RingHashLoadBalancer(HostSet& host_set, ClusterStats& stats, Runtime::Loader& runtime,
+                       Runtime::RandomGenerator& random);
+
+  /**
+   * Create a load balancer that uses externally built rings. shared_rings must outlive the load
+   * balancer and is read on every pick, so the owner can swap in new rings whenever host_set
+   * changes. No host will be chosen while it is nullptr.
+   */
+  RingHashLoadBalancer(HostSet& host_set, ClusterStats& stats, Runtime::Loader& runtime,
+                       Runtime::RandomGenerator& random, const RingsConstSharedPtr& shared_rings);
+
+  // Upstream::LoadBalancer
+  HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+
+private:
   void refresh();
+  uint64_t panicThreshold();
 
   HostSet& host_set_;
   ClusterStats& stats_;
   Runtime::Loader& runtime_;
   Runtime::RandomGenerator& random_;
-  Ring all_hosts_ring_;
-  Ring healthy_hosts_ring_;
+  // The panic threshold read from the runtime snapshot with generation runtime_generation_.
+  Optional<uint64_t> panic_threshold_;
+  uint64_t runtime_generation_{};
+  RingsConstSharedPtr owned_rings_;
+  const RingsConstSharedPtr& rings_;
 };
 
 } // namespace Upstream
@@ -9,6 +9,7 @@
 #include "common/config/well_known_names.h"
 #include "common/protobuf/utility.h"
 #include "common/upstream/load_balancer_impl.h"
+#include "common/upstream/maglev_lb.h"
 #include "common/upstream/ring_hash_lb.h"
 
 #include "api/cds.pb.h"
@@ -16,6 +17,8 @@
 namespace Envoy {
 namespace Upstream {
 
+const size_t SubsetLoadBalancer::MaxCachedSubsets;
+
 SubsetLoadBalancer::SubsetLoadBalancer(LoadBalancerType lb_type, HostSet& host_set,
                                        const HostSet* local_host_set, ClusterStats& stats,
                                        Runtime::Loader& runtime, Runtime::RandomGenerator& random,
@@ -67,7 +70,7 @@ HostConstSharedPtr SubsetLoadBalancer::tryChooseHostFromContext(LoadBalancerCont
   }
 
   // Route has metadata match criteria defined, see if we have a matching subset.
-  LbSubsetEntryPtr entry = findSubset(match_criteria->metadataMatchCriteria());
+  const LbSubsetEntryPtr& entry = findSubset(*match_criteria);
   if (entry == nullptr || !entry->active()) {
     // No matching subset or subset not active: use fallback policy.
     return nullptr;
@@ -78,6 +81,26 @@ HostConstSharedPtr SubsetLoadBalancer::tryChooseHostFromContext(LoadBalancerCont
   return entry->lb_->chooseHost(context);
 }
 
+// Finds the subset for the given criteria, remembering the result by criteria id. Entries are never
+// removed from subsets_, so a cached entry stays valid until the cache is cleared by update().
+const SubsetLoadBalancer::LbSubsetEntryPtr&
+SubsetLoadBalancer::findSubset(const Router::MetadataMatchCriteria& match_criteria) {
+  const auto it = subset_cache_.find(match_criteria.id());
+  if (it != subset_cache_.end()) {
+    return it->second;
+  }
+
+  // Ids are never reused, so criteria from replaced route tables linger until the next update.
+  // Bound the cache in case routes are reloaded much more often than hosts change.
+  if (subset_cache_.size() >= MaxCachedSubsets) {
+    subset_cache_.clear();
+  }
+
+  return subset_cache_
+      .emplace(match_criteria.id(), findSubset(match_criteria.metadataMatchCriteria()))
+      .first->second;
+}
+
 // Iterates over the given metadata match criteria (which must be lexically sorted by key) and find
 // a matching LbSubsetEnryPtr, if any.
 SubsetLoadBalancer::LbSubsetEntryPtr SubsetLoadBalancer::findSubset(
@@ -184,6 +207,9 @@ void SubsetLoadBalancer::processSubsets(
 // necessary.
 void SubsetLoadBalancer::update(const std::vector<HostSharedPtr>& hosts_added,
                                 const std::vector<HostSharedPtr>& hosts_removed) {
+  // New subsets may be created below, which can change the result of any cached lookup.
+  subset_cache_.clear();
+
   updateFallbackSubset(hosts_added, hosts_removed);
 
   processSubsets(hosts_added, hosts_removed,
@@ -340,6 +366,11 @@ void SubsetLoadBalancer::LbSubsetEntry::initLoadBalancer(const SubsetLoadBalance
                                        subset_lb.random_));
     break;
 
+  case LoadBalancerType::Maglev:
+    lb_.reset(new MaglevLoadBalancer(*host_subset_, subset_lb.stats_, subset_lb.runtime_,
+                                     subset_lb.random_));
+    break;
+
   case LoadBalancerType::OriginalDst:
     NOT_REACHED;
   }
@@ -401,8 +432,11 @@ void SubsetLoadBalancer::HostSubsetImpl::update(const std::vector<HostSharedPtr>
     healthy_hosts_per_locality->emplace_back(curr_locality_healthy_hosts);
   }
 
-  HostSetImpl::updateHosts(hosts, healthy_hosts, hosts_per_locality, healthy_hosts_per_locality,
-                           filtered_added, filtered_removed);
+  // Subsets keep every locality of the original host set, so the locality weights still apply.
+  HostSetImpl::updateHosts(
+      hosts, healthy_hosts, hosts_per_locality, healthy_hosts_per_locality,
+      std::make_shared<const std::vector<uint32_t>>(original_host_set_.localityWeights()),
+      filtered_added, filtered_removed);
 }
 
 } // namespace Upstream
@@ -4,6 +4,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "envoy/common/optional.h"
 #include "envoy/runtime/runtime.h"
@@ -86,6 +87,7 @@ private:
   bool hostMatchesDefaultSubset(const Host& host);
   bool hostMatches(const SubsetMetadata& kvs, const Host& host);
 
+  const LbSubsetEntryPtr& findSubset(const Router::MetadataMatchCriteria& match_criteria);
   LbSubsetEntryPtr
   findSubset(const std::vector<Router::MetadataMatchCriterionConstSharedPtr>& matches);
 
@@ -112,6 +114,11 @@ private:
 
   // Forms a trie-like structure. Requires lexically sorted Host and Route metadata.
   LbSubsetMap subsets_;
+
+  // Results of findSubset(), keyed by Router::MetadataMatchCriteria::id(), so that each route's
+  // criteria are only walked through subsets_ once. Cleared whenever subsets_ changes.
+  std::unordered_map<uint64_t, LbSubsetEntryPtr> subset_cache_;
+  static const size_t MaxCachedSubsets = 1024;
 };
 
 } // namespace Upstream
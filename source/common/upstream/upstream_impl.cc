@@ -5,6 +5,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -48,6 +49,18 @@ getSourceAddress(const envoy::api::v2::Cluster& cluster,
   // If there's no source address in the cluster config, use any default from the bootstrap proto.
   return source_address;
 }
+
+Optional<std::chrono::milliseconds> runtimeTimeout(Runtime::Loader& runtime,
+                                                   const std::string& key,
+                                                   const std::string& cluster_name) {
+  Optional<std::chrono::milliseconds> timeout;
+  const uint64_t timeout_ms = runtime.snapshot().getInteger(
+      fmt::format("{}.{}", key, cluster_name), runtime.snapshot().getInteger(key, 0));
+  if (timeout_ms > 0) {
+    timeout.value(std::chrono::milliseconds(timeout_ms));
+  }
+  return timeout;
+}
 } // namespace
 
 Host::CreateConnectionData HostImpl::createConnection(Event::Dispatcher& dispatcher) const {
@@ -91,14 +104,20 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
       load_report_stats_(generateLoadReportStats(load_report_stats_store_)),
       features_(parseFeatures(config)),
       http2_settings_(Http::Utility::parseHttp2Settings(config.http2_protocol_options())),
-      resource_managers_(config, runtime, name_),
+      resource_managers_(config, runtime, name_, *stats_scope_),
       maintenance_mode_runtime_key_(fmt::format("upstream.maintenance_mode.{}", name_)),
       source_address_(getSourceAddress(config, source_address)), added_via_api_(added_via_api),
       lb_subset_(LoadBalancerSubsetInfoImpl(config.lb_subset_config())) {
+  // The cluster proto has no connection pool timeouts yet, so they are read from runtime, per
+  // cluster with a global default. 0 disables them.
+  idle_timeout_ = runtimeTimeout(runtime, "upstream.idle_timeout_ms", name_);
+  max_pending_time_ = runtimeTimeout(runtime, "upstream.max_pending_time_ms", name_);
+
   ssl_ctx_ = nullptr;
   if (config.has_tls_context()) {
     Ssl::ClientContextConfigImpl context_config(config.tls_context());
     ssl_ctx_ = ssl_context_manager.createSslClientContext(*stats_scope_, context_config);
+    tls_context_hash_ = MessageUtil::hash(config.tls_context());
   }
 
   switch (config.lb_policy()) {
@@ -112,7 +131,11 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
     lb_type_ = LoadBalancerType::Random;
     break;
   case envoy::api::v2::Cluster::RING_HASH:
-    lb_type_ = LoadBalancerType::RingHash;
+    // The v2 API has no Maglev policy, so consistent hashing clusters opt into Maglev via runtime.
+    // This is only read when the cluster is created.
+    lb_type_ = runtime.snapshot().getInteger(fmt::format("upstream.use_maglev.{}", name_), 0) != 0
+                   ? LoadBalancerType::Maglev
+                   : LoadBalancerType::RingHash;
     break;
   case envoy::api::v2::Cluster::ORIGINAL_DST_LB:
     if (config.type() != envoy::api::v2::Cluster::ORIGINAL_DST) {
@@ -126,6 +149,37 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
   }
 }
 
+const LocalityWeightsConstSharedPtr HostSetSnapshot::empty_locality_weights_{
+    new std::vector<uint32_t>()};
+
+HostSetSnapshot::HostSetSnapshot()
+    : HostSetSnapshot(std::make_shared<const std::vector<HostSharedPtr>>(),
+                      std::make_shared<const std::vector<HostSharedPtr>>(),
+                      std::make_shared<const std::vector<std::vector<HostSharedPtr>>>(),
+                      std::make_shared<const std::vector<std::vector<HostSharedPtr>>>(), nullptr) {}
+
+HostSetSnapshot::HostSetSnapshot(HostVectorConstSharedPtr hosts,
+                                 HostListsConstSharedPtr hosts_per_locality,
+                                 LocalityWeightsConstSharedPtr locality_weights)
+    : HostSetSnapshot(hosts, createHealthyHostList(*hosts), hosts_per_locality,
+                      createHealthyHostLists(*hosts_per_locality), std::move(locality_weights)) {}
+
+HostSetSnapshot::HostSetSnapshot(HostVectorConstSharedPtr hosts,
+                                 HostVectorConstSharedPtr healthy_hosts,
+                                 HostListsConstSharedPtr hosts_per_locality,
+                                 HostListsConstSharedPtr healthy_hosts_per_locality,
+                                 LocalityWeightsConstSharedPtr locality_weights)
+    : hosts_(std::move(hosts)), healthy_hosts_(std::move(healthy_hosts)),
+      hosts_per_locality_(std::move(hosts_per_locality)),
+      healthy_hosts_per_locality_(std::move(healthy_hosts_per_locality)),
+      // nullptr means that localities are not weighted.
+      locality_weights_(locality_weights ? std::move(locality_weights) : empty_locality_weights_) {
+}
+
+HostSetSnapshotConstSharedPtr HostSetSnapshot::refreshHealth() const {
+  return std::make_shared<const HostSetSnapshot>(hosts_, hosts_per_locality_, locality_weights_);
+}
+
 const HostListsConstSharedPtr ClusterImplBase::empty_host_lists_{
     new std::vector<std::vector<HostSharedPtr>>()};
 
@@ -200,8 +254,9 @@ ClusterSharedPtr ClusterImplBase::create(const envoy::api::v2::Cluster& cluster,
   if (!cluster.health_checks().empty()) {
     // TODO(htuch): Need to support multiple health checks in v2.
     ASSERT(cluster.health_checks().size() == 1);
-    new_cluster->setHealthChecker(HealthCheckerFactory::create(
-        cluster.health_checks()[0], *new_cluster, runtime, random, dispatcher));
+    new_cluster->setHealthChecker(
+        HealthCheckerFactory::create(cluster.health_checks()[0], *new_cluster, runtime, random,
+                                     dispatcher, cm.sharedHealthCheckSessions()));
   }
 
   new_cluster->setOutlierDetector(Outlier::DetectorImplFactory::createForCluster(
@@ -217,7 +272,7 @@ ClusterImplBase::ClusterImplBase(const envoy::api::v2::Cluster& cluster,
                                                    ssl_context_manager, added_via_api)) {}
 
 HostVectorConstSharedPtr
-ClusterImplBase::createHealthyHostList(const std::vector<HostSharedPtr>& hosts) {
+HostSetSnapshot::createHealthyHostList(const std::vector<HostSharedPtr>& hosts) {
   HostVectorSharedPtr healthy_list(new std::vector<HostSharedPtr>());
   for (const auto& host : hosts) {
     if (host->healthy()) {
@@ -229,7 +284,7 @@ ClusterImplBase::createHealthyHostList(const std::vector<HostSharedPtr>& hosts)
 }
 
 HostListsConstSharedPtr
-ClusterImplBase::createHealthyHostLists(const std::vector<std::vector<HostSharedPtr>>& hosts) {
+HostSetSnapshot::createHealthyHostLists(const std::vector<std::vector<HostSharedPtr>>& hosts) {
   HostListsSharedPtr healthy_list(new std::vector<std::vector<HostSharedPtr>>());
 
   for (const auto& hosts_zone : hosts) {
@@ -353,25 +408,25 @@ void ClusterImplBase::reloadHealthyHosts() {
     return;
   }
 
-  HostVectorConstSharedPtr hosts_copy(new std::vector<HostSharedPtr>(hosts()));
-  HostListsConstSharedPtr hosts_per_locality_copy(
-      new std::vector<std::vector<HostSharedPtr>>(hostsPerLocality()));
-  updateHosts(hosts_copy, createHealthyHostList(hosts()), hosts_per_locality_copy,
-              createHealthyHostLists(hostsPerLocality()), {}, {});
+  // Membership has not changed, so the new snapshot shares the current membership lists and only
+  // rebuilds the healthy ones.
+  updateHosts(snapshot()->refreshHealth(), {}, {});
 }
 
 ClusterInfoImpl::ResourceManagers::ResourceManagers(const envoy::api::v2::Cluster& config,
                                                     Runtime::Loader& runtime,
-                                                    const std::string& cluster_name) {
+                                                    const std::string& cluster_name,
+                                                    Stats::Scope& stats_scope) {
   managers_[enumToInt(ResourcePriority::Default)] =
-      load(config, runtime, cluster_name, envoy::api::v2::RoutingPriority::DEFAULT);
+      load(config, runtime, cluster_name, stats_scope, envoy::api::v2::RoutingPriority::DEFAULT);
   managers_[enumToInt(ResourcePriority::High)] =
-      load(config, runtime, cluster_name, envoy::api::v2::RoutingPriority::HIGH);
+      load(config, runtime, cluster_name, stats_scope, envoy::api::v2::RoutingPriority::HIGH);
 }
 
 ResourceManagerImplPtr
 ClusterInfoImpl::ResourceManagers::load(const envoy::api::v2::Cluster& config,
                                         Runtime::Loader& runtime, const std::string& cluster_name,
+                                        Stats::Scope& stats_scope,
                                         const envoy::api::v2::RoutingPriority& priority) {
   uint64_t max_connections = 1024;
   uint64_t max_pending_requests = 1024;
@@ -407,7 +462,8 @@ ClusterInfoImpl::ResourceManagers::load(const envoy::api::v2::Cluster& config,
     max_retries = PROTOBUF_GET_WRAPPED_OR_DEFAULT(*it, max_retries, max_retries);
   }
   return ResourceManagerImplPtr{new ResourceManagerImpl(
-      runtime, runtime_prefix, max_connections, max_pending_requests, max_requests, max_retries)};
+      runtime, runtime_prefix, stats_scope, fmt::format("circuit_breakers.{}.", priority_name),
+      max_connections, max_pending_requests, max_requests, max_retries)};
 }
 
 StaticClusterImpl::StaticClusterImpl(const envoy::api::v2::Cluster& cluster,
@@ -435,8 +491,8 @@ void StaticClusterImpl::startPreInit() {
     }
   }
 
-  updateHosts(initial_hosts_, createHealthyHostList(*initial_hosts_), empty_host_lists_,
-              empty_host_lists_, *initial_hosts_, {});
+  updateHosts(std::make_shared<const HostSetSnapshot>(initial_hosts_, empty_host_lists_, nullptr),
+              *initial_hosts_, {});
   initial_hosts_ = nullptr;
 
   onPreInitComplete();
@@ -450,50 +506,62 @@ bool BaseDynamicClusterImpl::updateDynamicHostList(const std::vector<HostSharedP
   uint64_t max_host_weight = 1;
 
   // Go through and see if the list we have is different from what we just got. If it is, we
-  // make a new host list and raise a change notification. This uses an N^2 search given that
-  // this does not happen very often and the list sizes should be small. We also check for
-  // duplicates here. It's possible for DNS to return the same address multiple times, and a bad
-  // SDS implementation could do the same thing.
+  // make a new host list and raise a change notification. Current hosts are indexed by address so
+  // that the comparison is linear in the size of the lists, which matters for large clusters that
+  // are updated often. We also check for duplicates here. It's possible for DNS to return the same
+  // address multiple times, and a bad SDS implementation could do the same thing.
+  std::unordered_map<std::string, size_t> current_host_index;
+  current_host_index.reserve(current_hosts.size());
+  for (size_t i = 0; i < current_hosts.size(); i++) {
+    current_host_index.emplace(current_hosts[i]->address()->asString(), i);
+  }
+
   std::unordered_set<std::string> host_addresses;
+  host_addresses.reserve(new_hosts.size());
+  std::vector<bool> kept(current_hosts.size(), false);
   std::vector<HostSharedPtr> final_hosts;
+  final_hosts.reserve(new_hosts.size());
   for (const HostSharedPtr& host : new_hosts) {
-    if (host_addresses.count(host->address()->asString())) {
+    const std::string& address = host->address()->asString();
+    if (!host_addresses.emplace(address).second) {
       continue;
     }
-    host_addresses.emplace(host->address()->asString());
 
-    bool found = false;
-    for (auto i = current_hosts.begin(); i != current_hosts.end();) {
-      // If we find a host matched based on address, we keep it. However we do change weight inline
-      // so do that here.
-      if (*(*i)->address() == *host->address()) {
-        if (host->weight() > max_host_weight) {
-          max_host_weight = host->weight();
-        }
+    if (host->weight() > max_host_weight) {
+      max_host_weight = host->weight();
+    }
 
-        (*i)->weight(host->weight());
-        final_hosts.push_back(*i);
-        i = current_hosts.erase(i);
-        found = true;
-      } else {
-        i++;
-      }
+    // If we find a host matched based on address, we keep it. However we do change weight inline
+    // so do that here.
+    const auto existing = current_host_index.find(address);
+    if (existing != current_host_index.end()) {
+      const HostSharedPtr& current_host = current_hosts[existing->second];
+      current_host->weight(host->weight());
+      final_hosts.push_back(current_host);
+      kept[existing->second] = true;
+      continue;
     }
 
-    if (!found) {
-      if (host->weight() > max_host_weight) {
-        max_host_weight = host->weight();
-      }
+    final_hosts.push_back(host);
+    hosts_added.push_back(host);
 
-      final_hosts.push_back(host);
-      hosts_added.push_back(host);
+    // If we are depending on a health checker, we initialize to unhealthy.
+    if (depend_on_hc) {
+      hosts_added.back()->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+    }
+  }
 
-      // If we are depending on a health checker, we initialize to unhealthy.
-      if (depend_on_hc) {
-        hosts_added.back()->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+  // Leave only the hosts that were not kept in current_hosts, preserving their order.
+  size_t remaining = 0;
+  for (size_t i = 0; i < current_hosts.size(); i++) {
+    if (!kept[i]) {
+      if (remaining != i) {
+        current_hosts[remaining] = std::move(current_hosts[i]);
       }
+      remaining++;
     }
   }
+  current_hosts.resize(remaining);
 
   // If there are removed hosts, check to see if we should only delete if unhealthy.
   if (!current_hosts.empty() && depend_on_hc) {
@@ -574,7 +642,7 @@ void StrictDnsClusterImpl::updateAllHosts(const std::vector<HostSharedPtr>& host
     }
   }
 
-  updateHosts(new_hosts, createHealthyHostList(*new_hosts), empty_host_lists_, empty_host_lists_,
+  updateHosts(std::make_shared<const HostSetSnapshot>(new_hosts, empty_host_lists_, nullptr),
               hosts_added, hosts_removed);
 }
 
@@ -28,6 +28,7 @@
 #include "common/config/metadata.h"
 #include "common/config/well_known_names.h"
 #include "common/stats/stats_impl.h"
+#include "common/upstream/host_utility.h"
 #include "common/upstream/load_balancer_impl.h"
 #include "common/upstream/outlier_detection_impl.h"
 #include "common/upstream/resource_manager_impl.h"
@@ -101,6 +102,14 @@ public:
     }
   }
   const HostStats& stats() const override { return stats_; }
+  void recordResponseTime(std::chrono::microseconds response_time,
+                          MonotonicTime now) const override {
+    response_time_average_.record(response_time, now);
+    stats_.rq_time_ewma_.set(response_time_average_.value(now));
+  }
+  uint64_t responseTimeAverage(MonotonicTime now) const override {
+    return response_time_average_.value(now);
+  }
   const std::string& hostname() const override { return hostname_; }
   Network::Address::InstanceConstSharedPtr address() const override { return address_; }
   const envoy::api::v2::Locality& locality() const override { return locality_; }
@@ -114,6 +123,7 @@ protected:
   const envoy::api::v2::Locality locality_;
   Stats::IsolatedStoreImpl stats_store_;
   HostStats stats_;
+  mutable ResponseTimeAverage response_time_average_;
   Outlier::DetectorHostMonitorPtr outlier_detector_;
   HealthCheckHostMonitorPtr health_checker_;
 };
@@ -167,37 +177,115 @@ typedef std::shared_ptr<std::vector<HostSharedPtr>> HostVectorSharedPtr;
 typedef std::shared_ptr<const std::vector<HostSharedPtr>> HostVectorConstSharedPtr;
 typedef std::shared_ptr<std::vector<std::vector<HostSharedPtr>>> HostListsSharedPtr;
 typedef std::shared_ptr<const std::vector<std::vector<HostSharedPtr>>> HostListsConstSharedPtr;
+typedef std::shared_ptr<const std::vector<uint32_t>> LocalityWeightsConstSharedPtr;
+
+/**
+ * An immutable snapshot of a host set's membership, along with the data derived from it such as
+ * the healthy host lists. A snapshot is built once per membership or health change and can then
+ * be shared by any number of host sets, on any thread, by swapping a single pointer. Nothing in a
+ * snapshot changes after construction, so readers need no synchronization.
+ */
+class HostSetSnapshot {
+public:
+  /**
+   * Build an empty snapshot.
+   */
+  HostSetSnapshot();
+
+  /**
+   * Build a snapshot, deriving the healthy host lists from the hosts' current health.
+   * @param locality_weights supplies the locality weights, or nullptr if localities are not
+   *        weighted.
+   */
+  HostSetSnapshot(HostVectorConstSharedPtr hosts, HostListsConstSharedPtr hosts_per_locality,
+                  LocalityWeightsConstSharedPtr locality_weights);
+
+  /**
+   * Build a snapshot from already computed healthy host lists.
+   */
+  HostSetSnapshot(HostVectorConstSharedPtr hosts, HostVectorConstSharedPtr healthy_hosts,
+                  HostListsConstSharedPtr hosts_per_locality,
+                  HostListsConstSharedPtr healthy_hosts_per_locality,
+                  LocalityWeightsConstSharedPtr locality_weights);
+
+  /**
+   * @return a snapshot with the same membership whose healthy host lists are derived again from
+   *         the hosts' current health. The membership lists are shared, not copied.
+   */
+  std::shared_ptr<const HostSetSnapshot> refreshHealth() const;
+
+  const std::vector<HostSharedPtr>& hosts() const { return *hosts_; }
+  const std::vector<HostSharedPtr>& healthyHosts() const { return *healthy_hosts_; }
+  const std::vector<std::vector<HostSharedPtr>>& hostsPerLocality() const {
+    return *hosts_per_locality_;
+  }
+  const std::vector<std::vector<HostSharedPtr>>& healthyHostsPerLocality() const {
+    return *healthy_hosts_per_locality_;
+  }
+  const std::vector<uint32_t>& localityWeights() const { return *locality_weights_; }
+
+private:
+  static HostVectorConstSharedPtr createHealthyHostList(const std::vector<HostSharedPtr>& hosts);
+  static HostListsConstSharedPtr
+  createHealthyHostLists(const std::vector<std::vector<HostSharedPtr>>& hosts);
+
+  const HostVectorConstSharedPtr hosts_;
+  const HostVectorConstSharedPtr healthy_hosts_;
+  const HostListsConstSharedPtr hosts_per_locality_;
+  const HostListsConstSharedPtr healthy_hosts_per_locality_;
+  const LocalityWeightsConstSharedPtr locality_weights_;
+  static const LocalityWeightsConstSharedPtr empty_locality_weights_;
+};
+
+typedef std::shared_ptr<const HostSetSnapshot> HostSetSnapshotConstSharedPtr;
 
 /**
  * Base class for all clusters as well as thread local host sets.
  */
 class HostSetImpl : public virtual HostSet {
 public:
-  HostSetImpl()
-      : hosts_(new std::vector<HostSharedPtr>()), healthy_hosts_(new std::vector<HostSharedPtr>()),
-        hosts_per_locality_(new std::vector<std::vector<HostSharedPtr>>()),
-        healthy_hosts_per_locality_(new std::vector<std::vector<HostSharedPtr>>()) {}
+  HostSetImpl() : snapshot_(new HostSetSnapshot()) {}
+
+  /**
+   * Swap in a new snapshot and run the member update callbacks.
+   */
+  void updateHosts(HostSetSnapshotConstSharedPtr snapshot,
+                   const std::vector<HostSharedPtr>& hosts_added,
+                   const std::vector<HostSharedPtr>& hosts_removed) {
+    snapshot_ = std::move(snapshot);
+    runUpdateCallbacks(hosts_added, hosts_removed);
+  }
 
   void updateHosts(HostVectorConstSharedPtr hosts, HostVectorConstSharedPtr healthy_hosts,
                    HostListsConstSharedPtr hosts_per_locality,
                    HostListsConstSharedPtr healthy_hosts_per_locality,
+                   LocalityWeightsConstSharedPtr locality_weights,
                    const std::vector<HostSharedPtr>& hosts_added,
                    const std::vector<HostSharedPtr>& hosts_removed) {
-    hosts_ = std::move(hosts);
-    healthy_hosts_ = std::move(healthy_hosts);
-    hosts_per_locality_ = std::move(hosts_per_locality);
-    healthy_hosts_per_locality_ = std::move(healthy_hosts_per_locality);
-    runUpdateCallbacks(hosts_added, hosts_removed);
+    updateHosts(std::make_shared<const HostSetSnapshot>(
+                    std::move(hosts), std::move(healthy_hosts), std::move(hosts_per_locality),
+                    std::move(healthy_hosts_per_locality), std::move(locality_weights)),
+                hosts_added, hosts_removed);
   }
 
+  /**
+   * @return the current snapshot, which stays valid for as long as the caller holds on to it.
+   */
+  const HostSetSnapshotConstSharedPtr& snapshot() const { return snapshot_; }
+
   // Upstream::HostSet
-  const std::vector<HostSharedPtr>& hosts() const override { return *hosts_; }
-  const std::vector<HostSharedPtr>& healthyHosts() const override { return *healthy_hosts_; }
+  const std::vector<HostSharedPtr>& hosts() const override { return snapshot_->hosts(); }
+  const std::vector<HostSharedPtr>& healthyHosts() const override {
+    return snapshot_->healthyHosts();
+  }
   const std::vector<std::vector<HostSharedPtr>>& hostsPerLocality() const override {
-    return *hosts_per_locality_;
+    return snapshot_->hostsPerLocality();
   }
   const std::vector<std::vector<HostSharedPtr>>& healthyHostsPerLocality() const override {
-    return *healthy_hosts_per_locality_;
+    return snapshot_->healthyHostsPerLocality();
+  }
+  const std::vector<uint32_t>& localityWeights() const override {
+    return snapshot_->localityWeights();
   }
   Common::CallbackHandle* addMemberUpdateCb(MemberUpdateCb callback) const override {
     return member_update_cb_helper_.add(callback);
@@ -210,10 +298,7 @@ protected:
   }
 
 private:
-  HostVectorConstSharedPtr hosts_;
-  HostVectorConstSharedPtr healthy_hosts_;
-  HostListsConstSharedPtr hosts_per_locality_;
-  HostListsConstSharedPtr healthy_hosts_per_locality_;
+  HostSetSnapshotConstSharedPtr snapshot_;
   // TODO(mattklein123): Remove mutable.
   mutable Common::CallbackManager<const std::vector<HostSharedPtr>&,
                                   const std::vector<HostSharedPtr>&>
@@ -241,6 +326,10 @@ public:
   uint32_t perConnectionBufferLimitBytes() const override {
     return per_connection_buffer_limit_bytes_;
   }
+  const Optional<std::chrono::milliseconds>& idleTimeout() const override { return idle_timeout_; }
+  const Optional<std::chrono::milliseconds>& maxPendingTime() const override {
+    return max_pending_time_;
+  }
   uint64_t features() const override { return features_; }
   const Http::Http2Settings& http2Settings() const override { return http2_settings_; }
   LoadBalancerType lbType() const override { return lb_type_; }
@@ -249,6 +338,7 @@ public:
   const std::string& name() const override { return name_; }
   ResourceManager& resourceManager(ResourcePriority priority) const override;
   Ssl::ClientContext* sslContext() const override { return ssl_ctx_.get(); }
+  uint64_t tlsContextHash() const override { return tls_context_hash_; }
   ClusterStats& stats() const override { return stats_; }
   Stats::Scope& statsScope() const override { return *stats_scope_; }
   ClusterLoadReportStats& loadReportStats() const override { return load_report_stats_; }
@@ -260,9 +350,9 @@ public:
 private:
   struct ResourceManagers {
     ResourceManagers(const envoy::api::v2::Cluster& config, Runtime::Loader& runtime,
-                     const std::string& cluster_name);
+                     const std::string& cluster_name, Stats::Scope& stats_scope);
     ResourceManagerImplPtr load(const envoy::api::v2::Cluster& config, Runtime::Loader& runtime,
-                                const std::string& cluster_name,
+                                const std::string& cluster_name, Stats::Scope& stats_scope,
                                 const envoy::api::v2::RoutingPriority& priority);
 
     typedef std::array<ResourceManagerImplPtr, NumResourcePriorities> Managers;
@@ -277,11 +367,14 @@ private:
   const uint64_t max_requests_per_connection_;
   const std::chrono::milliseconds connect_timeout_;
   const uint32_t per_connection_buffer_limit_bytes_;
+  Optional<std::chrono::milliseconds> idle_timeout_;
+  Optional<std::chrono::milliseconds> max_pending_time_;
   Stats::ScopePtr stats_scope_;
   mutable ClusterStats stats_;
   Stats::IsolatedStoreImpl load_report_stats_store_;
   mutable ClusterLoadReportStats load_report_stats_;
   Ssl::ClientContextPtr ssl_ctx_;
+  uint64_t tls_context_hash_{};
   const uint64_t features_;
   const Http::Http2Settings http2_settings_;
   mutable ResourceManagers resource_managers_;
@@ -335,9 +428,6 @@ protected:
                   Runtime::Loader& runtime, Stats::Store& stats,
                   Ssl::ContextManager& ssl_context_manager, bool added_via_api);
 
-  static HostVectorConstSharedPtr createHealthyHostList(const std::vector<HostSharedPtr>& hosts);
-  static HostListsConstSharedPtr
-  createHealthyHostLists(const std::vector<std::vector<HostSharedPtr>>& hosts);
   void runUpdateCallbacks(const std::vector<HostSharedPtr>& hosts_added,
                           const std::vector<HostSharedPtr>& hosts_removed) override;
 
@@ -0,0 +1,31 @@
+#include "server/config/http/request_coalescing.h"
+
+#include <string>
+
+#include "envoy/registry/registry.h"
+
+#include "common/http/filter/request_coalescing_filter.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+HttpFilterFactoryCb RequestCoalescingFilterConfig::createFilterFactory(
+    const Json::Object&, const std::string& stats_prefix, FactoryContext& context) {
+  Http::RequestCoalescingFilterConfigSharedPtr config(new Http::RequestCoalescingFilterConfig(
+      stats_prefix, context.scope(), context.threadLocal()));
+  return [config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamFilter(
+        Http::StreamFilterSharedPtr{new Http::RequestCoalescingFilter(config)});
+  };
+}
+
+/**
+ * Static registration for the request coalescing filter. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<RequestCoalescingFilterConfig, NamedHttpFilterConfigFactory>
+    register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include "envoy/server/filter_config.h"
+
+#include "common/config/well_known_names.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+/**
+ * Config registration for the request coalescing filter. @see NamedHttpFilterConfigFactory.
+ */
+class RequestCoalescingFilterConfig : public NamedHttpFilterConfigFactory {
+public:
+  HttpFilterFactoryCb createFilterFactory(const Json::Object&, const std::string& stats_prefix,
+                                          FactoryContext& context) override;
+  std::string name() override { return Config::HttpFilterNames::get().REQUEST_COALESCING; }
+};
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
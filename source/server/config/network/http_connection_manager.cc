@@ -129,8 +129,8 @@ HttpConnectionManagerConfig::HttpConnectionManagerConfig(
           stats_prefix_, context_.listenerScope())) {
 
   route_config_provider_ = Router::RouteConfigProviderUtil::create(
-      config, context_.runtime(), context_.clusterManager(), context_.scope(), stats_prefix_,
-      context_.initManager(), route_config_provider_manager_);
+      config, context_.runtime(), context_.clusterManager(), context_.threadLocal(),
+      context_.scope(), stats_prefix_, context_.initManager(), route_config_provider_manager_);
 
   switch (config.forward_client_cert_details()) {
   case envoy::api::v2::filter::http::HttpConnectionManager::SANITIZE:
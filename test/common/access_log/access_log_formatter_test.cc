@@ -36,7 +36,8 @@ TEST(ResponseFlagUtilsTest, toShortStringConversion) {
       std::make_pair(ResponseFlag::NoRouteFound, "NR"),
       std::make_pair(ResponseFlag::DelayInjected, "DI"),
       std::make_pair(ResponseFlag::FaultInjected, "FI"),
-      std::make_pair(ResponseFlag::RateLimited, "RL")};
+      std::make_pair(ResponseFlag::RateLimited, "RL"),
+      std::make_pair(ResponseFlag::UpstreamPendingTimeout, "UQ")};
 
   for (const auto& testCase : expected) {
     NiceMock<MockRequestInfo> request_info;
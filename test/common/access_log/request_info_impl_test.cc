@@ -91,7 +91,8 @@ TEST(RequestInfoImplTest, ResponseFlagTest) {
                                                    NoRouteFound,
                                                    DelayInjected,
                                                    FaultInjected,
-                                                   RateLimited};
+                                                   RateLimited,
+                                                   UpstreamPendingTimeout};
 
   RequestInfoImpl request_info(Http::Protocol::Http2);
   for (ResponseFlag flag : responseFlags) {
@@ -9,5 +9,6 @@ TEST(Hash, xxHash) {
   EXPECT_EQ(8917841378505826757U, HashUtil::xxHash64("foo\nbar"));
   EXPECT_EQ(4400747396090729504U, HashUtil::xxHash64("lyft"));
   EXPECT_EQ(17241709254077376921U, HashUtil::xxHash64(""));
+  EXPECT_EQ(14071536367944281277U, HashUtil::xxHash64("foo", 1));
 }
 } // namespace Envoy
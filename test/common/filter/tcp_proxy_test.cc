@@ -590,7 +590,10 @@ TEST_F(TcpProxyTest, UpstreamConnectionLimit) {
       }
     )EOF");
   factory_context_.cluster_manager_.thread_local_cluster_.cluster_.info_->resource_manager_.reset(
-      new Upstream::ResourceManagerImpl(factory_context_.runtime_loader_, "fake_key", 0, 0, 0, 0));
+      new Upstream::ResourceManagerImpl(
+          factory_context_.runtime_loader_, "fake_key",
+          factory_context_.cluster_manager_.thread_local_cluster_.cluster_.info_->stats_store_, "",
+          0, 0, 0, 0));
 
   // setup sets up expectation for tcpConnForCluster but this test is expected to NOT call that
   filter_.reset(new TcpProxy(config_, factory_context_.cluster_manager_));
@@ -113,6 +113,31 @@ TEST_F(AsyncClientImplTest, BasicStream) {
                      .value());
 }
 
+// Upstream write buffer watermarks are passed on to the stream callbacks.
+TEST_F(AsyncClientImplTest, StreamWatermarks) {
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](StreamDecoder& decoder,
+                           ConnectionPool::Callbacks& callbacks) -> ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(stream_encoder_, cm_.conn_pool_.host_);
+        response_decoder_ = &decoder;
+        return nullptr;
+      }));
+
+  TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  AsyncClient::Stream* stream =
+      client_.start(stream_callbacks_, Optional<std::chrono::milliseconds>(), false);
+  stream->sendHeaders(headers, false);
+
+  EXPECT_CALL(stream_callbacks_, onAboveWriteBufferHighWatermark());
+  stream_encoder_.stream_.runHighWatermarkCallbacks();
+  EXPECT_CALL(stream_callbacks_, onBelowWriteBufferLowWatermark());
+  stream_encoder_.stream_.runLowWatermarkCallbacks();
+
+  EXPECT_CALL(stream_callbacks_, onReset());
+  stream->reset();
+}
+
 TEST_F(AsyncClientImplTest, Basic) {
   message_->body().reset(new Buffer::OwnedImpl("test body"));
   Buffer::Instance& data = *message_->body();
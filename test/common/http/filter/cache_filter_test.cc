@@ -0,0 +1,297 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/filter/cache_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_loader.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class CacheFilterTest : public testing::Test {
+public:
+  CacheFilterTest() {
+    std::string json = R"EOF(
+    {
+      "max_cache_bytes" : 4096,
+      "max_entry_bytes" : 1024
+    }
+    )EOF";
+
+    Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json);
+    config_.reset(new CacheFilterConfig(*json_config, "", store_, tls_, time_source_));
+    ON_CALL(time_source_, currentTime()).WillByDefault(Invoke([this]() { return now_; }));
+    decoder_callbacks_.route_->route_entry_.opaque_config_.emplace(
+        CacheFilter::ROUTE_OPAQUE_CONFIG_KEY, "true");
+  }
+
+  std::unique_ptr<CacheFilter> createFilter() {
+    std::unique_ptr<CacheFilter> filter(new CacheFilter(config_));
+    filter->setDecoderFilterCallbacks(decoder_callbacks_);
+    filter->setEncoderFilterCallbacks(encoder_callbacks_);
+    return filter;
+  }
+
+  // Run a GET /config request that misses the cache and is answered by the upstream.
+  void missAndRespond(TestHeaderMapImpl&& response_headers, const std::string& body) {
+    missAndRespond({{":method", "GET"}, {":path", "/config"}, {":authority", "foo"}},
+                   std::move(response_headers), body);
+  }
+
+  void missAndRespond(TestHeaderMapImpl&& request_headers, TestHeaderMapImpl&& response_headers,
+                      const std::string& body) {
+    std::unique_ptr<CacheFilter> filter = createFilter();
+    EXPECT_EQ(FilterHeadersStatus::Continue, filter->decodeHeaders(request_headers, true));
+    EXPECT_EQ(FilterHeadersStatus::Continue,
+              filter->encodeHeaders(response_headers, body.empty()));
+    if (!body.empty()) {
+      Buffer::OwnedImpl data(body);
+      EXPECT_EQ(FilterDataStatus::Continue, filter->encodeData(data, true));
+    }
+  }
+
+  Stats::IsolatedStoreImpl store_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  MonotonicTime now_;
+  CacheFilterConfigSharedPtr config_;
+  NiceMock<MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+  NiceMock<MockStreamEncoderFilterCallbacks> encoder_callbacks_;
+};
+
+TEST_F(CacheFilterTest, CacheControlParse) {
+  TestHeaderMapImpl headers{{"cache-control", "Max-Age=10, no-cache, private"}};
+  CacheControl cache_control = CacheControl::parse(headers.get(LowerCaseString("cache-control")));
+  EXPECT_TRUE(cache_control.no_cache_);
+  EXPECT_TRUE(cache_control.private_);
+  EXPECT_FALSE(cache_control.no_store_);
+  EXPECT_EQ(std::chrono::seconds(10), cache_control.max_age_.value());
+
+  TestHeaderMapImpl shared_headers{{"cache-control", "s-maxage=20, max-age=10, no-store"}};
+  cache_control = CacheControl::parse(shared_headers.get(LowerCaseString("cache-control")));
+  EXPECT_TRUE(cache_control.no_store_);
+  EXPECT_EQ(std::chrono::seconds(20), cache_control.max_age_.value());
+
+  EXPECT_FALSE(CacheControl::parse(nullptr).max_age_.valid());
+}
+
+TEST_F(CacheFilterTest, MissThenHit) {
+  missAndRespond({{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(1U, config_->stats().rq_miss_.value());
+  EXPECT_EQ(1U, config_->stats().insert_.value());
+
+  now_ += std::chrono::seconds(5);
+  std::unique_ptr<CacheFilter> filter = createFilter();
+  TestHeaderMapImpl expected_headers{
+      {":status", "200"}, {"cache-control", "max-age=60"}, {"age", "5"}};
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(HeaderMapEqualRef(&expected_headers), false));
+  EXPECT_CALL(decoder_callbacks_, encodeData(BufferStringEqual("hello"), true));
+  TestHeaderMapImpl request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter->decodeHeaders(request_headers, true));
+  EXPECT_EQ(1U, config_->stats().rq_hit_.value());
+}
+
+// The Age of the upstream response counts towards the age of the cached response.
+TEST_F(CacheFilterTest, StoredAge) {
+  missAndRespond({{":status", "200"}, {"cache-control", "max-age=60"}, {"age", "30"}}, "hello");
+
+  now_ += std::chrono::seconds(5);
+  std::unique_ptr<CacheFilter> filter = createFilter();
+  TestHeaderMapImpl expected_headers{
+      {":status", "200"}, {"cache-control", "max-age=60"}, {"age", "35"}};
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(HeaderMapEqualRef(&expected_headers), false));
+  EXPECT_CALL(decoder_callbacks_, encodeData(BufferStringEqual("hello"), true));
+  TestHeaderMapImpl request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter->decodeHeaders(request_headers, true));
+
+  // 30 seconds in the cache are enough to make the response stale.
+  now_ += std::chrono::seconds(25);
+  filter = createFilter();
+  TestHeaderMapImpl stale_request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->decodeHeaders(stale_request_headers, true));
+  EXPECT_EQ(1U, config_->stats().rq_hit_.value());
+  EXPECT_EQ(2U, config_->stats().rq_miss_.value());
+}
+
+TEST_F(CacheFilterTest, RouteNotEnabled) {
+  decoder_callbacks_.route_->route_entry_.opaque_config_.clear();
+  missAndRespond({{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(0U, config_->stats().rq_miss_.value());
+  EXPECT_EQ(0U, config_->cache().size());
+}
+
+TEST_F(CacheFilterTest, NotCacheable) {
+  missAndRespond({{":method", "POST"}, {":path", "/config"}, {":authority", "foo"}},
+                 {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  missAndRespond({{":status", "200"}, {"cache-control", "no-store"}}, "hello");
+  missAndRespond({{":status", "200"}, {"cache-control", "private, max-age=60"}}, "hello");
+  missAndRespond({{":status", "500"}, {"cache-control", "max-age=60"}}, "hello");
+  missAndRespond({{":status", "200"}}, "hello");
+  missAndRespond({{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "*"}}, "hello");
+  missAndRespond({{":status", "200"}, {"cache-control", "max-age=60"}}, std::string(2048, 'a'));
+  EXPECT_EQ(0U, config_->cache().size());
+}
+
+TEST_F(CacheFilterTest, Vary) {
+  missAndRespond(TestHeaderMapImpl{{":method", "GET"},
+                                   {":path", "/config"},
+                                   {":authority", "foo"},
+                                   {"accept-encoding", "gzip"}},
+                 {{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "Accept-Encoding"}},
+                 "hello");
+
+  // A request with a different value for the vary header is a miss.
+  std::unique_ptr<CacheFilter> filter = createFilter();
+  TestHeaderMapImpl other_request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->decodeHeaders(other_request_headers, true));
+  EXPECT_EQ(2U, config_->stats().rq_miss_.value());
+
+  filter = createFilter();
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, false));
+  EXPECT_CALL(decoder_callbacks_, encodeData(BufferStringEqual("hello"), true));
+  TestHeaderMapImpl request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}, {"accept-encoding", "gzip"}};
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter->decodeHeaders(request_headers, true));
+  EXPECT_EQ(1U, config_->stats().rq_hit_.value());
+}
+
+TEST_F(CacheFilterTest, Revalidate) {
+  missAndRespond({{":status", "200"}, {"cache-control", "max-age=10"}, {"etag", "\"abc\""}},
+                 "hello");
+
+  // The response is stale, so the request is sent upstream with a conditional header.
+  now_ += std::chrono::seconds(20);
+  std::unique_ptr<CacheFilter> filter = createFilter();
+  TestHeaderMapImpl request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->decodeHeaders(request_headers, true));
+  EXPECT_STREQ("\"abc\"", request_headers.get_("if-none-match").c_str());
+
+  // The upstream confirms the stored response, which is served instead of the 304.
+  TestHeaderMapImpl response_headers{{":status", "304"}, {"cache-control", "max-age=30"}};
+  EXPECT_CALL(encoder_callbacks_, addEncodedData(BufferStringEqual("hello"), false));
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->encodeHeaders(response_headers, true));
+  EXPECT_STREQ("200", response_headers.get_(":status").c_str());
+  EXPECT_STREQ("\"abc\"", response_headers.get_("etag").c_str());
+  EXPECT_STREQ("0", response_headers.get_("age").c_str());
+  EXPECT_EQ(1U, config_->stats().rq_validated_.value());
+
+  // The refreshed response uses the max-age from the 304.
+  now_ += std::chrono::seconds(20);
+  filter = createFilter();
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, false));
+  EXPECT_CALL(decoder_callbacks_, encodeData(BufferStringEqual("hello"), true));
+  TestHeaderMapImpl fresh_request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter->decodeHeaders(fresh_request_headers, true));
+}
+
+// A 304 that is followed by an empty body, as an HTTP/2 upstream may send it, is replaced too.
+TEST_F(CacheFilterTest, RevalidateNotModifiedWithBody) {
+  missAndRespond({{":status", "200"}, {"cache-control", "max-age=10"}, {"etag", "\"abc\""}},
+                 "hello");
+
+  now_ += std::chrono::seconds(20);
+  std::unique_ptr<CacheFilter> filter = createFilter();
+  TestHeaderMapImpl request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->decodeHeaders(request_headers, true));
+
+  TestHeaderMapImpl response_headers{{":status", "304"}};
+  EXPECT_CALL(encoder_callbacks_, addEncodedData(_, _)).Times(0);
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->encodeHeaders(response_headers, false));
+  EXPECT_STREQ("200", response_headers.get_(":status").c_str());
+  EXPECT_EQ(1U, config_->stats().rq_validated_.value());
+
+  // Any data sent with the 304 is dropped and the stored body is sent in its place.
+  Buffer::OwnedImpl data("ignored");
+  EXPECT_EQ(FilterDataStatus::Continue, filter->encodeData(data, false));
+  EXPECT_EQ(0U, data.length());
+  Buffer::OwnedImpl last_data;
+  EXPECT_EQ(FilterDataStatus::Continue, filter->encodeData(last_data, true));
+  EXPECT_EQ("hello", TestUtility::bufferToString(last_data));
+}
+
+TEST_F(CacheFilterTest, RevalidateReplaced) {
+  missAndRespond({{":status", "200"}, {"etag", "\"abc\""}}, "hello");
+
+  std::unique_ptr<CacheFilter> filter = createFilter();
+  TestHeaderMapImpl request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->decodeHeaders(request_headers, true));
+  EXPECT_STREQ("\"abc\"", request_headers.get_("if-none-match").c_str());
+
+  TestHeaderMapImpl response_headers{{":status", "500"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->encodeHeaders(response_headers, true));
+  EXPECT_EQ(0U, config_->stats().rq_validated_.value());
+  EXPECT_EQ(0U, config_->cache().size());
+}
+
+TEST_F(CacheFilterTest, Trailers) {
+  std::unique_ptr<CacheFilter> filter = createFilter();
+  TestHeaderMapImpl request_headers{
+      {":method", "GET"}, {":path", "/config"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->decodeHeaders(request_headers, true));
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"cache-control", "max-age=60"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter->encodeHeaders(response_headers, false));
+  Buffer::OwnedImpl data("hello");
+  EXPECT_EQ(FilterDataStatus::Continue, filter->encodeData(data, false));
+  TestHeaderMapImpl trailers{{"grpc-status", "0"}};
+  EXPECT_EQ(FilterTrailersStatus::Continue, filter->encodeTrailers(trailers));
+  EXPECT_EQ(0U, config_->cache().size());
+}
+
+TEST_F(CacheFilterTest, LruEviction) {
+  CacheFilterStats stats = config_->stats();
+  ResponseCache cache(64, stats);
+  const std::vector<std::pair<LowerCaseString, std::string>> no_vary;
+  TestHeaderMapImpl headers;
+  auto response = [&](size_t size) {
+    return std::make_shared<const CachedResponse>(headers, std::string(size, 'a'), now_,
+                                                  std::chrono::seconds(1), no_vary);
+  };
+
+  cache.insert("a", response(30));
+  cache.insert("b", response(30));
+  EXPECT_EQ(60U, cache.bytes());
+
+  // Touch "a" so that "b" is evicted first.
+  EXPECT_NE(nullptr, cache.lookup("a"));
+  cache.insert("c", response(30));
+  EXPECT_EQ(nullptr, cache.lookup("b"));
+  EXPECT_NE(nullptr, cache.lookup("a"));
+  EXPECT_NE(nullptr, cache.lookup("c"));
+  EXPECT_EQ(1U, stats.evict_.value());
+
+  // Entries larger than the whole budget are never inserted.
+  cache.insert("d", response(128));
+  EXPECT_EQ(nullptr, cache.lookup("d"));
+  EXPECT_EQ(2U, cache.size());
+
+  cache.remove("a");
+  EXPECT_EQ(30U, cache.bytes());
+}
+
+} // namespace Http
+} // namespace Envoy
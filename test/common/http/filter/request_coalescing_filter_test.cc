@@ -0,0 +1,209 @@
+#include <memory>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/filter/request_coalescing_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/buffer/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class RequestCoalescingFilterTest : public testing::Test {
+public:
+  struct Stream {
+    Stream(RequestCoalescingFilterConfigSharedPtr config, const std::string& key_headers)
+        : filter_(config) {
+      decoder_callbacks_.route_->route_entry_.opaque_config_.emplace(
+          RequestCoalescingFilter::ROUTE_OPAQUE_CONFIG_KEY, "true");
+      if (!key_headers.empty()) {
+        decoder_callbacks_.route_->route_entry_.opaque_config_.emplace(
+            RequestCoalescingFilter::ROUTE_OPAQUE_CONFIG_HEADERS_KEY, key_headers);
+      }
+      filter_.setDecoderFilterCallbacks(decoder_callbacks_);
+      filter_.setEncoderFilterCallbacks(encoder_callbacks_);
+    }
+
+    NiceMock<MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+    NiceMock<MockStreamEncoderFilterCallbacks> encoder_callbacks_;
+    RequestCoalescingFilter filter_;
+  };
+
+  RequestCoalescingFilterTest() : config_(new RequestCoalescingFilterConfig("", store_, tls_)) {}
+
+  std::unique_ptr<Stream> createStream(const std::string& key_headers = "") {
+    return std::unique_ptr<Stream>{new Stream(config_, key_headers)};
+  }
+
+  Stats::IsolatedStoreImpl store_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  RequestCoalescingFilterConfigSharedPtr config_;
+  TestHeaderMapImpl request_headers_{{":method", "GET"}, {":path", "/"}, {":authority", "foo"}};
+};
+
+TEST_F(RequestCoalescingFilterTest, FollowersReceiveLeaderResponse) {
+  std::unique_ptr<Stream> leader = createStream();
+  std::unique_ptr<Stream> follower1 = createStream();
+  std::unique_ptr<Stream> follower2 = createStream();
+
+  EXPECT_EQ(FilterHeadersStatus::Continue, leader->filter_.decodeHeaders(request_headers_, true));
+  EXPECT_EQ(FilterHeadersStatus::StopIteration,
+            follower1->filter_.decodeHeaders(request_headers_, true));
+  EXPECT_EQ(FilterHeadersStatus::StopIteration,
+            follower2->filter_.decodeHeaders(request_headers_, true));
+  EXPECT_EQ(1U, store_.counter("request_coalescing.rq_leader").value());
+  EXPECT_EQ(2U, store_.counter("request_coalescing.rq_coalesced").value());
+
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  for (Stream* follower : {follower1.get(), follower2.get()}) {
+    EXPECT_CALL(follower->decoder_callbacks_,
+                encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
+    EXPECT_CALL(follower->decoder_callbacks_, encodeData(BufferStringEqual("hello"), false));
+    EXPECT_CALL(follower->decoder_callbacks_, encodeTrailers_(_));
+  }
+  EXPECT_EQ(FilterHeadersStatus::Continue, leader->filter_.encodeHeaders(response_headers, false));
+
+  // A request arriving after the response started becomes a new leader.
+  std::unique_ptr<Stream> late = createStream();
+  EXPECT_EQ(FilterHeadersStatus::Continue, late->filter_.decodeHeaders(request_headers_, true));
+
+  Buffer::OwnedImpl data("hello");
+  EXPECT_EQ(FilterDataStatus::Continue, leader->filter_.encodeData(data, false));
+  TestHeaderMapImpl response_trailers{{"grpc-status", "0"}};
+  EXPECT_EQ(FilterTrailersStatus::Continue, leader->filter_.encodeTrailers(response_trailers));
+  EXPECT_EQ("hello", TestUtility::bufferToString(data));
+
+  follower1->filter_.onDestroy();
+  follower2->filter_.onDestroy();
+  leader->filter_.onDestroy();
+  late->filter_.onDestroy();
+  EXPECT_EQ(2U, store_.counter("request_coalescing.rq_leader").value());
+  EXPECT_TRUE(config_->inFlight().empty());
+}
+
+TEST_F(RequestCoalescingFilterTest, KeyHeaders) {
+  std::unique_ptr<Stream> leader = createStream("accept-encoding");
+  std::unique_ptr<Stream> other = createStream("accept-encoding");
+  std::unique_ptr<Stream> follower = createStream("accept-encoding");
+
+  request_headers_.addCopy("accept-encoding", "gzip");
+  TestHeaderMapImpl other_headers{
+      {":method", "GET"}, {":path", "/"}, {":authority", "foo"}, {"accept-encoding", "br"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, leader->filter_.decodeHeaders(request_headers_, true));
+  EXPECT_EQ(FilterHeadersStatus::Continue, other->filter_.decodeHeaders(other_headers, true));
+  EXPECT_EQ(FilterHeadersStatus::StopIteration,
+            follower->filter_.decodeHeaders(request_headers_, true));
+  EXPECT_EQ(2U, store_.counter("request_coalescing.rq_leader").value());
+  EXPECT_EQ(1U, store_.counter("request_coalescing.rq_coalesced").value());
+
+  EXPECT_CALL(follower->decoder_callbacks_, encodeHeaders_(_, true));
+  EXPECT_CALL(other->decoder_callbacks_, encodeHeaders_(_, _)).Times(0);
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  leader->filter_.encodeHeaders(response_headers, true);
+
+  follower->filter_.onDestroy();
+  leader->filter_.onDestroy();
+  other->filter_.onDestroy();
+}
+
+TEST_F(RequestCoalescingFilterTest, NotCoalesced) {
+  std::unique_ptr<Stream> stream1 = createStream();
+  std::unique_ptr<Stream> stream2 = createStream();
+
+  // Requests with a body are never coalesced.
+  TestHeaderMapImpl post_headers{{":method", "POST"}, {":path", "/"}, {":authority", "foo"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream1->filter_.decodeHeaders(post_headers, true));
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream2->filter_.decodeHeaders(request_headers_, false));
+  EXPECT_EQ(0U, store_.counter("request_coalescing.rq_leader").value());
+
+  // Nor are requests on routes that do not enable coalescing.
+  stream1->decoder_callbacks_.route_->route_entry_.opaque_config_.clear();
+  stream2->decoder_callbacks_.route_->route_entry_.opaque_config_.clear();
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream1->filter_.decodeHeaders(request_headers_, true));
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream2->filter_.decodeHeaders(request_headers_, true));
+  EXPECT_EQ(0U, store_.counter("request_coalescing.rq_leader").value());
+
+  stream1->filter_.onDestroy();
+  stream2->filter_.onDestroy();
+}
+
+TEST_F(RequestCoalescingFilterTest, LeaderDestroyedBeforeResponse) {
+  std::unique_ptr<Stream> leader = createStream();
+  std::unique_ptr<Stream> follower1 = createStream();
+  std::unique_ptr<Stream> follower2 = createStream();
+
+  leader->filter_.decodeHeaders(request_headers_, true);
+  follower1->filter_.decodeHeaders(request_headers_, true);
+  follower2->filter_.decodeHeaders(request_headers_, true);
+
+  EXPECT_CALL(follower1->decoder_callbacks_, continueDecoding());
+  EXPECT_CALL(follower2->decoder_callbacks_, continueDecoding()).Times(0);
+  leader->filter_.onDestroy();
+  EXPECT_EQ(1U, store_.counter("request_coalescing.rq_promoted").value());
+
+  // The promoted leader now fans out to the remaining follower.
+  EXPECT_CALL(follower2->decoder_callbacks_, encodeHeaders_(_, true));
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  follower1->filter_.encodeHeaders(response_headers, true);
+
+  follower2->filter_.onDestroy();
+  follower1->filter_.onDestroy();
+  EXPECT_TRUE(config_->inFlight().empty());
+}
+
+TEST_F(RequestCoalescingFilterTest, LeaderDestroyedAfterResponseStarted) {
+  std::unique_ptr<Stream> leader = createStream();
+  std::unique_ptr<Stream> follower = createStream();
+
+  leader->filter_.decodeHeaders(request_headers_, true);
+  follower->filter_.decodeHeaders(request_headers_, true);
+
+  EXPECT_CALL(follower->decoder_callbacks_, encodeHeaders_(_, false));
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  leader->filter_.encodeHeaders(response_headers, false);
+
+  EXPECT_CALL(follower->decoder_callbacks_, resetStream());
+  leader->filter_.onDestroy();
+  EXPECT_EQ(1U, store_.counter("request_coalescing.rq_reset").value());
+  follower->filter_.onDestroy();
+}
+
+TEST_F(RequestCoalescingFilterTest, FollowerDestroyed) {
+  std::unique_ptr<Stream> leader = createStream();
+  std::unique_ptr<Stream> follower1 = createStream();
+  std::unique_ptr<Stream> follower2 = createStream();
+
+  leader->filter_.decodeHeaders(request_headers_, true);
+  follower1->filter_.decodeHeaders(request_headers_, true);
+  follower2->filter_.decodeHeaders(request_headers_, true);
+  follower1->filter_.onDestroy();
+
+  // A follower reset while a response is being fanned out is skipped for the rest of the fan out.
+  EXPECT_CALL(follower1->decoder_callbacks_, encodeHeaders_(_, _)).Times(0);
+  EXPECT_CALL(follower2->decoder_callbacks_, encodeHeaders_(_, false))
+      .WillOnce(Invoke([&](HeaderMap&, bool) -> void { follower2->filter_.onDestroy(); }));
+  EXPECT_CALL(follower2->decoder_callbacks_, encodeData(_, _)).Times(0);
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  leader->filter_.encodeHeaders(response_headers, false);
+  Buffer::OwnedImpl data("hello");
+  leader->filter_.encodeData(data, true);
+
+  leader->filter_.onDestroy();
+  EXPECT_EQ(0U, store_.counter("request_coalescing.rq_reset").value());
+}
+
+} // namespace Http
+} // namespace Envoy
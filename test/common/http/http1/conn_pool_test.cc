@@ -186,8 +186,8 @@ struct ActiveTestRequest {
  * Verify that connections are closed when requested.
  */
 TEST_F(Http1ConnPoolImplTest, CloseConnections) {
-  cluster_->resource_manager_.reset(
-      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 2, 1024, 1024, 1));
+  cluster_->resource_manager_.reset(new Upstream::ResourceManagerImpl(
+      runtime_, "fake_key", cluster_->stats_store_, "", 2, 1024, 1024, 1));
   InSequence s;
 
   ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
@@ -209,6 +209,8 @@ TEST_F(Http1ConnPoolImplTest, CloseConnections) {
 TEST_F(Http1ConnPoolImplTest, VerifyTimingStats) {
   EXPECT_CALL(cluster_->stats_store_,
               deliverHistogramToSinks(Property(&Stats::Metric::name, "upstream_cx_connect_ms"), _));
+  EXPECT_CALL(cluster_->stats_store_,
+              deliverHistogramToSinks(Property(&Stats::Metric::name, "upstream_rq_pending_ms"), _));
   EXPECT_CALL(cluster_->stats_store_,
               deliverHistogramToSinks(Property(&Stats::Metric::name, "upstream_cx_length_ms"), _));
 
@@ -262,12 +264,69 @@ TEST_F(Http1ConnPoolImplTest, MultipleRequestAndResponse) {
   dispatcher_.clearDeferredDeleteList();
 }
 
+/**
+ * Test that the most recently used connection is reused first.
+ */
+TEST_F(Http1ConnPoolImplTest, LifoReuse) {
+  cluster_->resource_manager_.reset(new Upstream::ResourceManagerImpl(
+      runtime_, "fake_key", cluster_->stats_store_, "", 2, 1024, 1024, 1));
+  InSequence s;
+
+  ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
+  r1.startRequest();
+  ActiveTestRequest r2(*this, 1, ActiveTestRequest::Type::CreateConnection);
+  r2.startRequest();
+  r1.completeResponse(false);
+  r2.completeResponse(false);
+
+  // Both connections are idle, and the second one finished last.
+  ActiveTestRequest r3(*this, 1, ActiveTestRequest::Type::Immediate);
+  r3.startRequest();
+  r3.completeResponse(false);
+
+  ActiveTestRequest r4(*this, 1, ActiveTestRequest::Type::Immediate);
+  r4.startRequest();
+  r4.completeResponse(false);
+
+  conn_pool_.closeConnections();
+  EXPECT_CALL(conn_pool_, onClientDestroy()).Times(2);
+  dispatcher_.clearDeferredDeleteList();
+}
+
+/**
+ * Test that idle connections are closed once the idle timeout fires.
+ */
+TEST_F(Http1ConnPoolImplTest, IdleTimeout) {
+  cluster_->idle_timeout_.value(std::chrono::milliseconds(1000));
+  InSequence s;
+
+  ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
+  r1.startRequest();
+  Event::MockTimer* idle_timer = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  r1.completeResponse(false);
+
+  // Reusing the connection disarms the timer until it is idle again.
+  EXPECT_CALL(*idle_timer, disableTimer());
+  ActiveTestRequest r2(*this, 0, ActiveTestRequest::Type::Immediate);
+  r2.startRequest();
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  r2.completeResponse(false);
+
+  EXPECT_CALL(*idle_timer, disableTimer());
+  EXPECT_CALL(conn_pool_, onClientDestroy());
+  idle_timer->callback_();
+  dispatcher_.clearDeferredDeleteList();
+
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_idle_timeout_.value());
+}
+
 /**
  * Test when we overflow max pending requests.
  */
 TEST_F(Http1ConnPoolImplTest, MaxPendingRequests) {
-  cluster_->resource_manager_.reset(
-      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 1, 1, 1024, 1));
+  cluster_->resource_manager_.reset(new Upstream::ResourceManagerImpl(
+      runtime_, "fake_key", cluster_->stats_store_, "", 1, 1, 1024, 1));
 
   NiceMock<Http::MockStreamDecoder> outer_decoder;
   ConnPoolCallbacks callbacks;
@@ -290,6 +349,34 @@ TEST_F(Http1ConnPoolImplTest, MaxPendingRequests) {
   EXPECT_EQ(1U, cluster_->stats_.upstream_rq_pending_overflow_.value());
 }
 
+/**
+ * Test that a request that waits too long for a connection is failed.
+ */
+TEST_F(Http1ConnPoolImplTest, MaxPendingTime) {
+  cluster_->max_pending_time_.value(std::chrono::milliseconds(500));
+
+  // The connect timer is created first, and mock timers are matched in reverse order.
+  Event::MockTimer* pending_timer = new Event::MockTimer(&dispatcher_);
+  NiceMock<Http::MockStreamDecoder> outer_decoder;
+  ConnPoolCallbacks callbacks;
+  conn_pool_.expectClientCreate();
+  EXPECT_CALL(*pending_timer, enableTimer(std::chrono::milliseconds(500)));
+  Http::ConnectionPool::Cancellable* handle = conn_pool_.newStream(outer_decoder, callbacks);
+  EXPECT_NE(nullptr, handle);
+
+  EXPECT_CALL(callbacks.pool_failure_, ready());
+  pending_timer->callback_();
+  EXPECT_EQ(1U, cluster_->stats_.upstream_rq_pending_timeout_.value());
+
+  // The connection is kept for later requests.
+  EXPECT_CALL(*conn_pool_.test_clients_[0].connect_timer_, disableTimer());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+
+  EXPECT_CALL(conn_pool_, onClientDestroy());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
 /**
  * Tests a connection failure before a request is bound which should result in the pending request
  * getting purged.
@@ -520,8 +607,8 @@ TEST_F(Http1ConnPoolImplTest, MaxRequestsPerConnection) {
 TEST_F(Http1ConnPoolImplTest, ConcurrentConnections) {
   InSequence s;
 
-  cluster_->resource_manager_.reset(
-      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 2, 1024, 1024, 1));
+  cluster_->resource_manager_.reset(new Upstream::ResourceManagerImpl(
+      runtime_, "fake_key", cluster_->stats_store_, "", 2, 1024, 1024, 1));
   ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
   r1.startRequest();
 
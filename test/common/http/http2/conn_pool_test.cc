@@ -383,10 +383,43 @@ TEST_F(Http2ConnPoolImplTest, ConnectTimeout) {
   EXPECT_EQ(1U, cluster_->stats_.upstream_rq_pending_failure_eject_.value());
 }
 
+TEST_F(Http2ConnPoolImplTest, IdleTimeout) {
+  InSequence s;
+  cluster_->idle_timeout_.value(std::chrono::milliseconds(1000));
+
+  expectClientCreate();
+  ActiveTestRequest r1(*this, 0);
+  EXPECT_CALL(r1.inner_encoder_, encodeHeaders(_, true));
+  r1.callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+  expectClientConnect(0);
+
+  // The timer is armed once the connection has no active streams.
+  EXPECT_CALL(r1.decoder_, decodeHeaders_(_, true));
+  Event::MockTimer* idle_timer = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  r1.inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+
+  // A new stream disarms it.
+  EXPECT_CALL(*idle_timer, disableTimer());
+  ActiveTestRequest r2(*this, 0);
+  EXPECT_CALL(r2.inner_encoder_, encodeHeaders(_, true));
+  r2.callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+  EXPECT_CALL(r2.decoder_, decodeHeaders_(_, true));
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  r2.inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+
+  EXPECT_CALL(*idle_timer, disableTimer());
+  idle_timer->callback_();
+  EXPECT_CALL(*this, onClientDestroy());
+  dispatcher_.clearDeferredDeleteList();
+
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_idle_timeout_.value());
+}
+
 TEST_F(Http2ConnPoolImplTest, MaxGlobalRequests) {
   InSequence s;
-  cluster_->resource_manager_.reset(
-      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 1024, 1024, 1, 1));
+  cluster_->resource_manager_.reset(new Upstream::ResourceManagerImpl(
+      runtime_, "fake_key", cluster_->stats_store_, "", 1024, 1024, 1, 1));
 
   expectClientCreate();
   ActiveTestRequest r1(*this, 0);
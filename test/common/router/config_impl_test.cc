@@ -233,6 +233,10 @@ TEST(RouteMatcherTest, TestRoutes) {
   EXPECT_EQ("ats", config.route(genHeaders("api.lyft.com", "/api/application_data", "GET"), 0)
                        ->routeEntry()
                        ->clusterName());
+  EXPECT_EQ(cm.internClusterName("ats").get(),
+            config.route(genHeaders("api.lyft.com", "/api/leads/me", "GET"), 0)
+                ->routeEntry()
+                ->internedClusterName());
 
   EXPECT_EQ("locations",
             config.route(genHeaders("api.lyft.com", "/api/locations?works=true", "GET"), 0)
@@ -807,6 +811,123 @@ TEST(RouteMatcherTest, HeaderMatchedRouting) {
   }
 }
 
+TEST(RouteMatcherTest, RouteCache) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "local_service",
+      "domains": ["www.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "local_service_with_headers",
+          "headers" : [
+            {"name": "test_header", "value": "test"}
+          ]
+        },
+        {
+          "prefix": "/bar",
+          "cluster_header": "some_header"
+        },
+        {
+          "prefix": "/",
+          "cluster": "local_service_without_headers"
+        }
+      ]
+    },
+    {
+      "name": "wildcard",
+      "domains": ["*.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "wildcard"
+        }
+      ]
+    }
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImplConstSharedPtr config(
+      new ConfigImpl(parseRouteConfigurationFromJson(json), runtime, cm, true));
+  EXPECT_TRUE(config->routeCacheable());
+  CachingConfigImpl cached_config(config, 2);
+
+  // Repeated lookups return the memoized route.
+  RouteConstSharedPtr route = cached_config.route(genHeaders("www.lyft.com", "/", "GET"), 0);
+  EXPECT_EQ("local_service_without_headers", route->routeEntry()->clusterName());
+  EXPECT_EQ(route, cached_config.route(genHeaders("www.lyft.com", "/", "GET"), 0));
+  EXPECT_EQ(1U, cached_config.size());
+
+  // Headers used for matching are part of the key.
+  {
+    Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/", "GET");
+    headers.addCopy("test_header", "test");
+    EXPECT_EQ("local_service_with_headers",
+              cached_config.route(headers, 0)->routeEntry()->clusterName());
+  }
+  {
+    Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/bar", "GET");
+    headers.addCopy("some_header", "some_cluster");
+    EXPECT_EQ("some_cluster", cached_config.route(headers, 0)->routeEntry()->clusterName());
+  }
+  {
+    Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/bar", "GET");
+    headers.addCopy("some_header", "other_cluster");
+    EXPECT_EQ("other_cluster", cached_config.route(headers, 0)->routeEntry()->clusterName());
+  }
+  EXPECT_EQ(2U, cached_config.size());
+
+  // Misses are memoized too.
+  EXPECT_EQ("wildcard", cached_config.route(genHeaders("foo.lyft.com", "/", "GET"), 0)
+                            ->routeEntry()
+                            ->clusterName());
+  EXPECT_EQ(nullptr, cached_config.route(genHeaders("foo.com", "/", "GET"), 0));
+  EXPECT_EQ(nullptr, cached_config.route(genHeaders("foo.com", "/", "GET"), 0));
+  EXPECT_EQ(2U, cached_config.size());
+
+  // The first lookup was evicted.
+  EXPECT_NE(route, cached_config.route(genHeaders("www.lyft.com", "/", "GET"), 0));
+}
+
+TEST(RouteMatcherTest, RouteCacheNotCacheable) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "www2",
+      "domains": ["www.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "something_else",
+          "runtime": {
+            "key": "some_key",
+            "default": 50
+          }
+        },
+        {
+          "prefix": "/",
+          "cluster": "www2"
+        }
+      ]
+    }
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImplConstSharedPtr config(
+      new ConfigImpl(parseRouteConfigurationFromJson(json), runtime, cm, true));
+  EXPECT_FALSE(config->routeCacheable());
+  EXPECT_EQ(config, CachingConfigImpl::create(config));
+}
+
 class RouterMatcherHashPolicyTest : public testing::Test {
 public:
   RouterMatcherHashPolicyTest()
@@ -1148,6 +1269,8 @@ TEST(RouteMatcherTest, ClusterHeader) {
     headers.addCopy("some_header", "some_cluster");
     Router::RouteConstSharedPtr route = config.route(headers, 0);
     EXPECT_EQ("some_cluster", route->routeEntry()->clusterName());
+    // Header selected clusters are looked up by name.
+    EXPECT_EQ(nullptr, route->routeEntry()->internedClusterName());
 
     // Make sure things forward and don't crash.
     EXPECT_EQ(std::chrono::milliseconds(0), route->routeEntry()->timeout());
@@ -1913,6 +2036,10 @@ TEST(RouteMatcherTest, WeightedClusters) {
     EXPECT_EQ("cluster1", config.route(headers, 115)->routeEntry()->clusterName());
     EXPECT_EQ("cluster2", config.route(headers, 445)->routeEntry()->clusterName());
     EXPECT_EQ("cluster3", config.route(headers, 560)->routeEntry()->clusterName());
+
+    // Each weighted cluster is resolved through its interned name.
+    EXPECT_EQ(cm.internClusterName("cluster2").get(),
+              config.route(headers, 445)->routeEntry()->internedClusterName());
   }
 
   // Make sure weighted cluster entries call through to the parent when needed.
@@ -2819,6 +2946,9 @@ TEST(MetadataMatchCriteriaImpl, Merge) {
 
   EXPECT_EQ((*it)->name(), "c");
   EXPECT_EQ((*it)->value().value().string_value(), "override3");
+
+  // Merged criteria are distinct from their parent, so they are identified separately.
+  EXPECT_NE(parent_matches.id(), matches->id());
 }
 
 TEST(RoutEntryMetadataMatchTest, ParsesMetadata) {
@@ -73,7 +73,7 @@ public:
     interval_timer_ = new Event::MockTimer(&dispatcher_);
     EXPECT_CALL(init_manager_, registerTarget(_));
     rds_ = RouteConfigProviderUtil::create(parseHttpConnectionManagerFromJson(config_json),
-                                           runtime_, cm_, store_, "foo.", init_manager_,
+                                           runtime_, cm_, tls_, store_, "foo.", init_manager_,
                                            *route_config_provider_manager_);
     expectRequest();
     EXPECT_EQ("", rds_->versionInfo());
@@ -128,7 +128,7 @@ TEST_F(RdsImplTest, RdsAndStatic) {
     )EOF";
 
   EXPECT_THROW(RouteConfigProviderUtil::create(parseHttpConnectionManagerFromJson(config_json),
-                                               runtime_, cm_, store_, "foo.", init_manager_,
+                                               runtime_, cm_, tls_, store_, "foo.", init_manager_,
                                                *route_config_provider_manager_),
                EnvoyException);
 }
@@ -151,7 +151,7 @@ TEST_F(RdsImplTest, LocalInfoNotDefined) {
   local_info_.node_.set_cluster("");
   local_info_.node_.set_id("");
   EXPECT_THROW(RouteConfigProviderUtil::create(parseHttpConnectionManagerFromJson(config_json),
-                                               runtime_, cm_, store_, "foo.", init_manager_,
+                                               runtime_, cm_, tls_, store_, "foo.", init_manager_,
                                                *route_config_provider_manager_),
                EnvoyException);
 }
@@ -175,8 +175,8 @@ TEST_F(RdsImplTest, UnknownCluster) {
   interval_timer_ = new Event::MockTimer(&dispatcher_);
   EXPECT_THROW(dynamic_cast<RdsRouteConfigProviderImpl*>(
                    RouteConfigProviderUtil::create(parseHttpConnectionManagerFromJson(config_json),
-                                                   runtime_, cm_, store_, "foo.", init_manager_,
-                                                   *route_config_provider_manager_)
+                                                   runtime_, cm_, tls_, store_, "foo.",
+                                                   init_manager_, *route_config_provider_manager_)
                        .get())
                    ->initialize([] {}),
                EnvoyException);
@@ -52,6 +52,8 @@ public:
   const Optional<Http::StreamResetReason> remote_refused_stream_reset_{
       Http::StreamResetReason::RemoteRefusedStreamReset};
   const Optional<Http::StreamResetReason> overflow_reset_{Http::StreamResetReason::Overflow};
+  const Optional<Http::StreamResetReason> pending_timeout_reset_{
+      Http::StreamResetReason::PendingTimeout};
   const Optional<Http::StreamResetReason> connect_failure_{
       Http::StreamResetReason::ConnectionFailure};
 };
@@ -83,6 +85,13 @@ TEST_F(RouterRetryStateImplTest, Policy5xxResetOverflow) {
   EXPECT_EQ(RetryStatus::No, state_->shouldRetry(nullptr, overflow_reset_, callback_));
 }
 
+TEST_F(RouterRetryStateImplTest, Policy5xxResetPendingTimeout) {
+  Http::TestHeaderMapImpl request_headers{{"x-envoy-retry-on", "5xx"}};
+  setup(request_headers);
+  EXPECT_TRUE(state_->enabled());
+  EXPECT_EQ(RetryStatus::No, state_->shouldRetry(nullptr, pending_timeout_reset_, callback_));
+}
+
 TEST_F(RouterRetryStateImplTest, Policy5xxRemoteReset) {
   Http::TestHeaderMapImpl request_headers{{"x-envoy-retry-on", "5xx"}};
   setup(request_headers);
@@ -242,8 +251,25 @@ TEST_F(RouterRetryStateImplTest, RouteConfigNoHeaderConfig) {
 }
 
 TEST_F(RouterRetryStateImplTest, NoAvailableRetries) {
-  cluster_.resource_manager_.reset(
-      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 0, 0, 0, 0));
+  cluster_.resource_manager_.reset(new Upstream::ResourceManagerImpl(
+      runtime_, "fake_key", cluster_.stats_store_, "", 0, 0, 0, 0));
+
+  Http::TestHeaderMapImpl request_headers{{"x-envoy-retry-on", "connect-failure"}};
+  setup(request_headers);
+  EXPECT_TRUE(state_->enabled());
+
+  EXPECT_EQ(RetryStatus::NoOverflow, state_->shouldRetry(nullptr, connect_failure_, callback_));
+  EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_overflow_.value());
+  EXPECT_EQ(0UL, cluster_.stats().upstream_rq_retry_budget_exhausted_.value());
+}
+
+TEST_F(RouterRetryStateImplTest, RetryBudgetExhausted) {
+  cluster_.resource_manager_.reset(new Upstream::ResourceManagerImpl(
+      runtime_, "fake_key.", cluster_.stats_store_, "", 0, 0, 0, 10));
+  ON_CALL(runtime_.snapshot_, getInteger("fake_key.retry_budget.budget_percent", 0))
+      .WillByDefault(Return(20));
+  ON_CALL(runtime_.snapshot_, getInteger("fake_key.retry_budget.min_retry_concurrency", 3))
+      .WillByDefault(Return(0));
 
   Http::TestHeaderMapImpl request_headers{{"x-envoy-retry-on", "connect-failure"}};
   setup(request_headers);
@@ -251,6 +277,7 @@ TEST_F(RouterRetryStateImplTest, NoAvailableRetries) {
 
   EXPECT_EQ(RetryStatus::NoOverflow, state_->shouldRetry(nullptr, connect_failure_, callback_));
   EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_overflow_.value());
+  EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_budget_exhausted_.value());
 }
 
 TEST_F(RouterRetryStateImplTest, MaxRetriesHeader) {
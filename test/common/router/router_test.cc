@@ -8,6 +8,7 @@
 #include "common/upstream/upstream_impl.h"
 
 #include "test/common/http/common.h"
+#include "test/mocks/buffer/mocks.h"
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/local_info/mocks.h"
 #include "test/mocks/network/mocks.h"
@@ -24,7 +25,6 @@
 using testing::AssertionFailure;
 using testing::AssertionResult;
 using testing::AssertionSuccess;
-using testing::AtLeast;
 using testing::Invoke;
 using testing::MockFunction;
 using testing::NiceMock;
@@ -58,10 +58,10 @@ public:
 
 class RouterTestBase : public testing::Test {
 public:
-  RouterTestBase(bool start_child_span)
+  RouterTestBase(bool start_child_span, bool emit_dynamic_stats = true)
       : shadow_writer_(new MockShadowWriter()),
         config_("test.", local_info_, stats_store_, cm_, runtime_, random_,
-                ShadowWriterPtr{shadow_writer_}, true, start_child_span),
+                ShadowWriterPtr{shadow_writer_}, emit_dynamic_stats, start_child_span),
         router_(config_) {
     router_.setDecoderFilterCallbacks(callbacks_);
     upstream_locality_.set_zone("to_az");
@@ -179,6 +179,30 @@ TEST_F(RouterTest, PoolFailureWithPriority) {
   EXPECT_TRUE(verifyHostUpstreamStats(0, 1));
 }
 
+TEST_F(RouterTest, PoolFailurePendingTimeout) {
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder&, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        callbacks.onPoolFailure(Http::ConnectionPool::PoolFailureReason::Timeout, nullptr);
+        return nullptr;
+      }));
+
+  Http::TestHeaderMapImpl response_headers{
+      {":status", "503"}, {"content-length", "57"}, {"content-type", "text/plain"}};
+  EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
+  EXPECT_CALL(callbacks_, encodeData(_, true));
+  EXPECT_CALL(callbacks_.request_info_,
+              setResponseFlag(AccessLog::ResponseFlag::UpstreamPendingTimeout));
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+  EXPECT_TRUE(verifyHostUpstreamStats(0, 0));
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->load_report_stats_store_
+                    .counter("upstream_rq_dropped")
+                    .value());
+}
+
 TEST_F(RouterTest, HashPolicy) {
   ON_CALL(callbacks_.route_->route_entry_, hashPolicy())
       .WillByDefault(Return(&callbacks_.route_->route_entry_.hash_policy_));
@@ -483,6 +507,34 @@ TEST_F(RouterTest, MaintenanceMode) {
                     .value());
 }
 
+TEST_F(RouterTest, AdaptiveConcurrencyLimit) {
+  NiceMock<Runtime::MockLoader>& runtime = cm_.thread_local_cluster_.cluster_.info_->runtime_;
+  ON_CALL(runtime.snapshot_, getInteger("fake_keyadaptive_concurrency.enabled", 0))
+      .WillByDefault(Return(1));
+  ON_CALL(runtime.snapshot_, getInteger("fake_keyadaptive_concurrency.max_limit", 1024))
+      .WillByDefault(Return(0));
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _)).Times(0);
+
+  Http::TestHeaderMapImpl response_headers{{":status", "503"},
+                                           {"content-length", "35"},
+                                           {"content-type", "text/plain"},
+                                           {"x-envoy-overloaded", "true"}};
+  EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
+  EXPECT_CALL(callbacks_, encodeData(_, true));
+  EXPECT_CALL(callbacks_.request_info_, setResponseFlag(AccessLog::ResponseFlag::UpstreamOverflow));
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("upstream_rq_concurrency_limited")
+                    .value());
+  EXPECT_TRUE(verifyHostUpstreamStats(0, 0));
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->load_report_stats_store_
+                    .counter("upstream_rq_dropped")
+                    .value());
+}
+
 TEST_F(RouterTest, NoRetriesOverflow) {
   NiceMock<Http::MockStreamEncoder> encoder1;
   Http::StreamDecoder* response_decoder = nullptr;
@@ -1329,29 +1381,90 @@ TEST_F(RouterTest, Shadow) {
   expectResponseTimerCreate();
 
   EXPECT_CALL(runtime_.snapshot_, featureEnabled("bar", 0, 43, 10000)).WillOnce(Return(true));
+  NiceMock<MockShadowStream> shadow_stream;
+  EXPECT_CALL(*shadow_writer_, shadow_("foo", _, false, std::chrono::milliseconds(10), _))
+      .WillOnce(Invoke([&](const std::string&, Http::HeaderMap& shadow_headers, bool,
+                           std::chrono::milliseconds, uint32_t) -> ShadowStream* {
+        EXPECT_STREQ("host", shadow_headers.Host()->value().c_str());
+        return &shadow_stream;
+      }));
 
   Http::TestHeaderMapImpl headers;
   HttpTestUtility::addDefaultHeaders(headers);
   router_.decodeHeaders(headers, false);
 
-  Buffer::InstancePtr body_data(new Buffer::OwnedImpl("hello"));
-  EXPECT_EQ(Http::FilterDataStatus::StopIterationAndBuffer, router_.decodeData(*body_data, false));
+  Buffer::OwnedImpl body_data("hello");
+  EXPECT_CALL(shadow_stream, sendData(BufferStringEqual("hello"), false));
+  EXPECT_CALL(encoder, encodeData(BufferStringEqual("hello"), false));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(body_data, false));
 
   Http::TestHeaderMapImpl trailers{{"some", "trailer"}};
-  EXPECT_CALL(callbacks_, decodingBuffer())
-      .Times(AtLeast(1))
-      .WillRepeatedly(Return(body_data.get()));
-  EXPECT_CALL(*shadow_writer_, shadow_("foo", _, std::chrono::milliseconds(10)))
-      .WillOnce(Invoke(
-          [](const std::string&, Http::MessagePtr& request, std::chrono::milliseconds) -> void {
-            EXPECT_NE(nullptr, request->body());
-            EXPECT_NE(nullptr, request->trailers());
-          }));
+  EXPECT_CALL(shadow_stream, sendTrailers(HeaderMapEqualRef(&trailers)));
   router_.decodeTrailers(trailers);
 
   Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
   response_decoder->decodeHeaders(std::move(response_headers), true);
   EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
+
+  // The shadow stream outlives the primary request once it has been ended.
+  EXPECT_CALL(shadow_stream, cancel()).Times(0);
+  router_.onDestroy();
+}
+
+TEST_F(RouterTest, ShadowHeadersOnly) {
+  callbacks_.route_->route_entry_.shadow_policy_.cluster_ = "foo";
+  callbacks_.route_->route_entry_.shadow_policy_.runtime_key_ = "bar";
+  ON_CALL(callbacks_, streamId()).WillByDefault(Return(43));
+
+  NiceMock<Http::MockStreamEncoder> encoder;
+  Http::StreamDecoder* response_decoder = nullptr;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder = &decoder;
+        callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("bar", 0, 43, 10000)).WillOnce(Return(true));
+  EXPECT_CALL(*shadow_writer_, shadow_("foo", _, true, std::chrono::milliseconds(10), _))
+      .WillOnce(Return(nullptr));
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder->decodeHeaders(std::move(response_headers), true);
+  EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
+}
+
+TEST_F(RouterTest, ShadowCancelledOnDownstreamReset) {
+  callbacks_.route_->route_entry_.shadow_policy_.cluster_ = "foo";
+  callbacks_.route_->route_entry_.shadow_policy_.runtime_key_ = "bar";
+  ON_CALL(callbacks_, streamId()).WillByDefault(Return(43));
+
+  NiceMock<Http::MockStreamEncoder> encoder;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder&, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("bar", 0, 43, 10000)).WillOnce(Return(true));
+  NiceMock<MockShadowStream> shadow_stream;
+  EXPECT_CALL(*shadow_writer_, shadow_("foo", _, false, std::chrono::milliseconds(10), _))
+      .WillOnce(Return(&shadow_stream));
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, false);
+
+  EXPECT_CALL(encoder.stream_, resetStream(Http::StreamResetReason::LocalReset));
+  EXPECT_CALL(shadow_stream, cancel());
+  router_.onDestroy();
 }
 
 TEST_F(RouterTest, AltStatName) {
@@ -1847,6 +1960,103 @@ TEST_F(WatermarkTest, RetryRequestNotComplete) {
   encoder1.stream_.resetStream(Http::StreamResetReason::RemoteReset);
 }
 
+// A shadowed body larger than the buffer limit is streamed to the shadow in full as long as the
+// shadow stream never has to hold more than the limit.
+TEST_F(WatermarkTest, ShadowLargerThanLimit) {
+  EXPECT_CALL(callbacks_, decoderBufferLimit()).WillOnce(Return(10));
+  router_.setDecoderFilterCallbacks(callbacks_);
+  callbacks_.route_->route_entry_.shadow_policy_.cluster_ = "foo";
+  callbacks_.route_->route_entry_.shadow_policy_.runtime_key_ = "bar";
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("bar", 0, _, 10000)).WillOnce(Return(true));
+  NiceMock<MockShadowStream> shadow_stream;
+  EXPECT_CALL(*shadow_writer_, shadow_("foo", _, false, _, 10)).WillOnce(Return(&shadow_stream));
+  sendRequest(false);
+
+  Buffer::OwnedImpl data("123456");
+  EXPECT_CALL(shadow_stream, sendData(BufferStringEqual("123456"), false));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(data, false));
+
+  Buffer::OwnedImpl more_data("7890123");
+  EXPECT_CALL(shadow_stream, sendData(BufferStringEqual("7890123"), false));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(more_data, false));
+
+  Buffer::OwnedImpl last_data("456789");
+  EXPECT_CALL(shadow_stream, sendData(BufferStringEqual("456789"), true));
+  EXPECT_CALL(shadow_stream, cancel()).Times(0);
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(last_data, true));
+  EXPECT_EQ(0U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("retry_or_shadow_abandoned")
+                    .value());
+
+  sendResponse();
+}
+
+// If the shadow stream gives up because it is holding more than the buffer limit, the shadow is
+// abandoned but the primary request is unaffected.
+TEST_F(WatermarkTest, ShadowAbandoned) {
+  EXPECT_CALL(callbacks_, decoderBufferLimit()).WillOnce(Return(10));
+  router_.setDecoderFilterCallbacks(callbacks_);
+  callbacks_.route_->route_entry_.shadow_policy_.cluster_ = "foo";
+  callbacks_.route_->route_entry_.shadow_policy_.runtime_key_ = "bar";
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("bar", 0, _, 10000)).WillOnce(Return(true));
+  NiceMock<MockShadowStream> shadow_stream;
+  EXPECT_CALL(*shadow_writer_, shadow_("foo", _, false, _, 10)).WillOnce(Return(&shadow_stream));
+  sendRequest(false);
+
+  Buffer::OwnedImpl data("123456");
+  EXPECT_CALL(shadow_stream, sendData(BufferStringEqual("123456"), false));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(data, false));
+
+  Buffer::OwnedImpl more_data("7890123");
+  EXPECT_CALL(shadow_stream, sendData(BufferStringEqual("7890123"), false))
+      .WillOnce(Return(false));
+  EXPECT_CALL(encoder_, encodeData(BufferStringEqual("7890123"), false));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(more_data, false));
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("retry_or_shadow_abandoned")
+                    .value());
+
+  // The abandoned shadow stream is not used again.
+  Buffer::OwnedImpl last_data("456789");
+  EXPECT_CALL(shadow_stream, sendData(_, _)).Times(0);
+  EXPECT_CALL(shadow_stream, cancel()).Times(0);
+  EXPECT_CALL(encoder_, encodeData(BufferStringEqual("456789"), true));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(last_data, true));
+
+  sendResponse();
+}
+
+class RouterTestNoDynamicStats : public RouterTestBase {
+public:
+  RouterTestNoDynamicStats() : RouterTestBase(false, false) {}
+};
+
+// Outlier detection still gets response times when dynamic stats are disabled.
+TEST_F(RouterTestNoDynamicStats, PutResponseTime) {
+  NiceMock<Http::MockStreamEncoder> encoder;
+  Http::StreamDecoder* response_decoder = nullptr;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder = &decoder;
+        callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+
+  EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(200));
+  EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putResponseTime(_));
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder->decodeHeaders(std::move(response_headers), true);
+  EXPECT_EQ(0U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("zone.zone_name.to_az.upstream_rq_200")
+                    .value());
+}
+
 class RouterTestChildSpan : public RouterTestBase {
 public:
   RouterTestChildSpan() : RouterTestBase(true) {}
@@ -1,62 +1,231 @@
 #include <chrono>
 #include <string>
 
+#include "common/buffer/buffer_impl.h"
+#include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
-#include "common/http/message_impl.h"
 #include "common/router/shadow_writer_impl.h"
 
+#include "test/mocks/buffer/mocks.h"
+#include "test/mocks/http/mocks.h"
 #include "test/mocks/upstream/mocks.h"
+#include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 using testing::Invoke;
+using testing::ReturnRef;
 using testing::_;
 
 namespace Envoy {
 namespace Router {
 
-TEST(ShadowWriterImplTest, All) {
-  Upstream::MockClusterManager cm;
-  ShadowWriterImpl writer(cm);
-
-  // Success case
-  Http::MessagePtr message(new Http::RequestMessageImpl());
-  message->headers().insertHost().value(std::string("cluster1"));
-  EXPECT_CALL(cm, httpAsyncClientForCluster("foo")).WillOnce(ReturnRef(cm.async_client_));
-  Http::MockAsyncClientRequest request(&cm.async_client_);
-  Http::AsyncClient::Callbacks* callback;
-  EXPECT_CALL(cm.async_client_,
-              send_(_, _, Optional<std::chrono::milliseconds>(std::chrono::milliseconds(5))))
-      .WillOnce(
-          Invoke([&](Http::MessagePtr& inner_message, Http::AsyncClient::Callbacks& callbacks,
-                     const Optional<std::chrono::milliseconds>&) -> Http::AsyncClient::Request* {
-            EXPECT_EQ(message, inner_message);
-            EXPECT_STREQ("cluster1-shadow", message->headers().Host()->value().c_str());
-            callback = &callbacks;
-            return &request;
-          }));
-  writer.shadow("foo", std::move(message), std::chrono::milliseconds(5));
-
-  Http::MessagePtr response(new Http::RequestMessageImpl());
-  callback->onSuccess(std::move(response));
-
-  // Failure case
-  message.reset(new Http::RequestMessageImpl());
-  message->headers().insertHost().value(std::string("cluster2"));
-  EXPECT_CALL(cm, httpAsyncClientForCluster("bar")).WillOnce(ReturnRef(cm.async_client_));
-  EXPECT_CALL(cm.async_client_,
-              send_(_, _, Optional<std::chrono::milliseconds>(std::chrono::milliseconds(10))))
-      .WillOnce(
-          Invoke([&](Http::MessagePtr& inner_message, Http::AsyncClient::Callbacks& callbacks,
-                     const Optional<std::chrono::milliseconds>&) -> Http::AsyncClient::Request* {
-            EXPECT_EQ(message, inner_message);
-            EXPECT_STREQ("cluster2-shadow", message->headers().Host()->value().c_str());
-            callback = &callbacks;
-            return &request;
-          }));
-  writer.shadow("bar", std::move(message), std::chrono::milliseconds(10));
-  callback->onFailure(Http::AsyncClient::FailureReason::Reset);
+class ShadowWriterImplTest : public testing::Test {
+public:
+  ShadowStream* shadow(const std::string& host, bool end_stream, uint32_t buffer_limit = 0) {
+    EXPECT_CALL(cm_, httpAsyncClientForCluster("foo")).WillOnce(ReturnRef(cm_.async_client_));
+    EXPECT_CALL(cm_.async_client_,
+                start(_, Optional<std::chrono::milliseconds>(std::chrono::milliseconds(5)), false))
+        .WillOnce(Invoke([this](Http::AsyncClient::StreamCallbacks& callbacks,
+                                const Optional<std::chrono::milliseconds>&,
+                                bool) -> Http::AsyncClient::Stream* {
+          callbacks_ = &callbacks;
+          return &stream_;
+        }));
+    EXPECT_CALL(stream_, sendHeaders(_, end_stream))
+        .WillOnce(Invoke([&host](Http::HeaderMap& headers, bool) -> void {
+          EXPECT_EQ(host + "-shadow", headers.Host()->value().c_str());
+        }));
+
+    Http::HeaderMapPtr headers{new Http::TestHeaderMapImpl{{":authority", host}}};
+    return writer_.shadow("foo", std::move(headers), end_stream, std::chrono::milliseconds(5),
+                          buffer_limit);
+  }
+
+  void expectDeleted() { EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_)); }
+
+  Upstream::MockClusterManager cm_;
+  ShadowWriterImpl writer_{cm_};
+  Http::MockAsyncClientStream stream_;
+  Http::AsyncClient::StreamCallbacks* callbacks_{};
+};
+
+TEST_F(ShadowWriterImplTest, HeadersOnly) {
+  EXPECT_EQ(nullptr, shadow("cluster1", true));
+
+  // The response is discarded.
+  expectDeleted();
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}},
+                        true);
+}
+
+TEST_F(ShadowWriterImplTest, StreamedRequest) {
+  ShadowStream* shadow_stream = shadow("cluster1", false);
+  ASSERT_NE(nullptr, shadow_stream);
+
+  Buffer::OwnedImpl data("hello");
+  EXPECT_CALL(stream_, sendData(BufferStringEqual("hello"), false));
+  EXPECT_TRUE(shadow_stream->sendData(data, false));
+
+  Http::TestHeaderMapImpl trailers{{"some", "trailer"}};
+  EXPECT_CALL(stream_, sendTrailers(HeaderMapEqualRef(&trailers)));
+  shadow_stream->sendTrailers(trailers);
+
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}},
+                        false);
+  Buffer::OwnedImpl response_data("world");
+  expectDeleted();
+  callbacks_->onData(response_data, true);
+}
+
+// Only data held back while the shadow upstream is backed up counts against the buffer limit, so a
+// body larger than the limit is shadowed in full.
+TEST_F(ShadowWriterImplTest, BodyLargerThanLimit) {
+  ShadowStream* shadow_stream = shadow("cluster1", false, 10);
+
+  Buffer::OwnedImpl data("123456");
+  EXPECT_CALL(stream_, sendData(BufferStringEqual("123456"), false));
+  EXPECT_TRUE(shadow_stream->sendData(data, false));
+
+  Buffer::OwnedImpl more_data("7890123");
+  EXPECT_CALL(stream_, sendData(BufferStringEqual("7890123"), false));
+  EXPECT_TRUE(shadow_stream->sendData(more_data, false));
+
+  Buffer::OwnedImpl last_data("456789");
+  EXPECT_CALL(stream_, sendData(BufferStringEqual("456789"), true));
+  EXPECT_CALL(stream_, reset()).Times(0);
+  EXPECT_TRUE(shadow_stream->sendData(last_data, true));
+
+  expectDeleted();
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}},
+                        true);
+}
+
+TEST_F(ShadowWriterImplTest, HeldAboveHighWatermark) {
+  ShadowStream* shadow_stream = shadow("cluster1", false, 10);
+
+  // Nothing is written to the backed up shadow upstream until it drains.
+  callbacks_->onAboveWriteBufferHighWatermark();
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  EXPECT_CALL(stream_, sendTrailers(_)).Times(0);
+  Buffer::OwnedImpl data("hello");
+  EXPECT_TRUE(shadow_stream->sendData(data, false));
+  Buffer::OwnedImpl more_data("world");
+  EXPECT_TRUE(shadow_stream->sendData(more_data, false));
+  Http::TestHeaderMapImpl trailers{{"some", "trailer"}};
+  shadow_stream->sendTrailers(trailers);
+
+  testing::Mock::VerifyAndClearExpectations(&stream_);
+  EXPECT_CALL(stream_, sendData(BufferStringEqual("helloworld"), false));
+  EXPECT_CALL(stream_, sendTrailers(HeaderMapEqualRef(&trailers)));
+  callbacks_->onBelowWriteBufferLowWatermark();
+
+  expectDeleted();
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}},
+                        true);
+}
+
+TEST_F(ShadowWriterImplTest, ResetWhileFlushingHeldData) {
+  ShadowStream* shadow_stream = shadow("cluster1", false, 10);
+
+  callbacks_->onAboveWriteBufferHighWatermark();
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  Buffer::OwnedImpl data("hello");
+  EXPECT_TRUE(shadow_stream->sendData(data, false));
+  shadow_stream->sendTrailers(Http::TestHeaderMapImpl{{"some", "trailer"}});
+
+  // The stream is reset inline by the flush, so the held trailers are not sent.
+  testing::Mock::VerifyAndClearExpectations(&stream_);
+  EXPECT_CALL(stream_, sendData(BufferStringEqual("hello"), false))
+      .WillOnce(Invoke([this](Buffer::Instance&, bool) -> void { callbacks_->onReset(); }));
+  EXPECT_CALL(stream_, sendTrailers(_)).Times(0);
+  expectDeleted();
+  callbacks_->onBelowWriteBufferLowWatermark();
+}
+
+TEST_F(ShadowWriterImplTest, HeldEndStream) {
+  ShadowStream* shadow_stream = shadow("cluster1", false, 10);
+
+  callbacks_->onAboveWriteBufferHighWatermark();
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  Buffer::OwnedImpl data("hello");
+  EXPECT_TRUE(shadow_stream->sendData(data, true));
+
+  testing::Mock::VerifyAndClearExpectations(&stream_);
+  EXPECT_CALL(stream_, sendData(BufferStringEqual("hello"), true));
+  callbacks_->onBelowWriteBufferLowWatermark();
+
+  // Once flushed, further watermark events are ignored.
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  callbacks_->onAboveWriteBufferHighWatermark();
+  callbacks_->onBelowWriteBufferLowWatermark();
+
+  expectDeleted();
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}},
+                        true);
+}
+
+TEST_F(ShadowWriterImplTest, AbandonedOverLimit) {
+  ShadowStream* shadow_stream = shadow("cluster1", false, 10);
+
+  callbacks_->onAboveWriteBufferHighWatermark();
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  Buffer::OwnedImpl data("123456");
+  EXPECT_TRUE(shadow_stream->sendData(data, false));
+
+  // Holding more than the limit gives up on the shadow.
+  EXPECT_CALL(stream_, reset()).WillOnce(Invoke([this]() -> void { callbacks_->onReset(); }));
+  expectDeleted();
+  Buffer::OwnedImpl more_data("7890123");
+  EXPECT_FALSE(shadow_stream->sendData(more_data, false));
+}
+
+TEST_F(ShadowWriterImplTest, RemoteResetWhileHolding) {
+  ShadowStream* shadow_stream = shadow("cluster1", false, 10);
+
+  callbacks_->onAboveWriteBufferHighWatermark();
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  Buffer::OwnedImpl data("hello");
+  EXPECT_TRUE(shadow_stream->sendData(data, true));
+
+  // The held data is dropped and the stream cleans up since both sides are complete.
+  expectDeleted();
+  callbacks_->onReset();
+}
+
+TEST_F(ShadowWriterImplTest, Cancel) {
+  ShadowStream* shadow_stream = shadow("cluster1", false);
+
+  EXPECT_CALL(stream_, reset()).WillOnce(Invoke([this]() -> void { callbacks_->onReset(); }));
+  expectDeleted();
+  shadow_stream->cancel();
+}
+
+TEST_F(ShadowWriterImplTest, RemoteResetBeforeRequestComplete) {
+  ShadowStream* shadow_stream = shadow("cluster1", false);
+  callbacks_->onReset();
+
+  // Data sent after the shadow upstream reset is dropped.
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  EXPECT_CALL(stream_, reset()).Times(0);
+  Buffer::OwnedImpl data("hello");
+  shadow_stream->sendData(data, false);
+  expectDeleted();
+  shadow_stream->sendData(data, true);
+}
+
+TEST_F(ShadowWriterImplTest, ResponseBeforeRequestComplete) {
+  ShadowStream* shadow_stream = shadow("cluster1", false);
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "400"}}},
+                        true);
+
+  // Ending the request tears down the async stream rather than sending more data to it.
+  EXPECT_CALL(stream_, sendTrailers(_)).Times(0);
+  EXPECT_CALL(stream_, reset()).WillOnce(Invoke([this]() -> void { callbacks_->onReset(); }));
+  expectDeleted();
+  shadow_stream->sendTrailers(Http::TestHeaderMapImpl{{"some", "trailer"}});
 }
 
 } // namespace Router
@@ -153,6 +153,16 @@ TEST_F(RuntimeImplTest, OverrideFolderDoesNotExist) {
   EXPECT_EQ("hello", loader->snapshot().get("file1"));
 }
 
+TEST_F(RuntimeImplTest, Generation) {
+  setup();
+  run("test/common/runtime/test_data/current", "envoy_override");
+  const uint64_t generation = loader->snapshot().generation();
+
+  setup();
+  run("test/common/runtime/test_data/current", "envoy_override");
+  EXPECT_NE(generation, loader->snapshot().generation());
+}
+
 TEST(NullRuntimeImplTest, All) {
   MockRandomGenerator generator;
   NullLoaderImpl loader(generator);
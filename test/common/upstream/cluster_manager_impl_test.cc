@@ -473,6 +473,52 @@ TEST_F(ClusterManagerImplTest, ShutdownOrder) {
   EXPECT_EQ(3U, cluster.info().use_count());
 }
 
+// Workers share the primary cluster's host lists rather than copies of them.
+TEST_F(ClusterManagerImplTest, ThreadLocalHostSetSharesPrimarySnapshot) {
+  const std::string json =
+      fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("cluster_1")}));
+
+  create(parseBootstrapFromJson(json));
+  const Cluster& cluster = cluster_manager_->clusters().begin()->second;
+  const HostSet& host_set = cluster_manager_->get("cluster_1")->hostSet();
+  EXPECT_EQ(&cluster.hosts(), &host_set.hosts());
+  EXPECT_EQ(&cluster.healthyHosts(), &host_set.healthyHosts());
+}
+
+// Consistent hashing load balancers use rings and tables built by the cluster manager.
+TEST_F(ClusterManagerImplTest, ConsistentHashLoadBalancers) {
+  const std::string json = R"EOF(
+  {
+    "clusters": [
+    {
+      "name": "cluster_1",
+      "connect_timeout_ms": 250,
+      "type": "static",
+      "lb_type": "ring_hash",
+      "hosts": [{"url": "tcp://127.0.0.1:8000"}, {"url": "tcp://127.0.0.1:8001"}]
+    },
+    {
+      "name": "cluster_2",
+      "connect_timeout_ms": 250,
+      "type": "static",
+      "lb_type": "ring_hash",
+      "hosts": [{"url": "tcp://127.0.0.1:8000"}, {"url": "tcp://127.0.0.1:8001"}]
+    }]
+  }
+  )EOF";
+
+  ON_CALL(factory_.runtime_.snapshot_, getInteger("upstream.use_maglev.cluster_2", 0))
+      .WillByDefault(Return(1));
+  create(parseBootstrapFromJson(json));
+
+  EXPECT_EQ(LoadBalancerType::RingHash, cluster_manager_->get("cluster_1")->info()->lbType());
+  EXPECT_NE(nullptr, cluster_manager_->get("cluster_1")->loadBalancer().chooseHost(nullptr));
+  EXPECT_EQ(LoadBalancerType::Maglev, cluster_manager_->get("cluster_2")->info()->lbType());
+  EXPECT_NE(nullptr, cluster_manager_->get("cluster_2")->loadBalancer().chooseHost(nullptr));
+
+  factory_.tls_.shutdownThread();
+}
+
 TEST_F(ClusterManagerImplTest, InitializeOrder) {
   const std::string json = fmt::sprintf(
       R"EOF(
@@ -654,6 +700,9 @@ TEST_F(ClusterManagerImplTest, DynamicAddRemove) {
   EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp));
   EXPECT_EQ(cp, cluster_manager_->httpConnPoolForCluster("fake_cluster", ResourcePriority::Default,
                                                          nullptr));
+  // The thread local cluster hands out the same pool.
+  EXPECT_EQ(cp, cluster_manager_->get("fake_cluster")
+                    ->httpConnPool(ResourcePriority::Default, nullptr));
 
   // Now remove it. This should drain the connection pool.
   Http::ConnectionPool::Instance::DrainedCb drained_cb;
@@ -676,6 +725,152 @@ TEST_F(ClusterManagerImplTest, DynamicAddRemove) {
   EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster2.get()));
 }
 
+// Interned lookups cache the thread local cluster and must see CDS updates and removals.
+TEST_F(ClusterManagerImplTest, InternedClusterNames) {
+  const std::string json = R"EOF(
+  {
+    "clusters": []
+  }
+  )EOF";
+
+  create(parseBootstrapFromJson(json));
+
+  InternedClusterNameConstSharedPtr interned = cluster_manager_->internClusterName("fake_cluster");
+  EXPECT_EQ(interned, cluster_manager_->internClusterName("fake_cluster"));
+  EXPECT_EQ("fake_cluster", interned->name_);
+  EXPECT_NE(interned->index_, cluster_manager_->internClusterName("other_cluster")->index_);
+
+  // Names can be interned before the cluster exists.
+  EXPECT_EQ(nullptr, cluster_manager_->get(*interned));
+
+  std::shared_ptr<MockCluster> cluster1(new NiceMock<MockCluster>());
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster1));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(defaultStaticCluster("fake_cluster")));
+  ThreadLocalCluster* tl_cluster1 = cluster_manager_->get(*interned);
+  EXPECT_EQ(cluster1->info_, tl_cluster1->info());
+  EXPECT_EQ(tl_cluster1, cluster_manager_->get(*interned));
+  EXPECT_EQ(tl_cluster1, cluster_manager_->get("fake_cluster"));
+
+  // An update replaces the thread local cluster.
+  auto update_cluster = defaultStaticCluster("fake_cluster");
+  update_cluster.mutable_per_connection_buffer_limit_bytes()->set_value(12345);
+  std::shared_ptr<MockCluster> cluster2(new NiceMock<MockCluster>());
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster2));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(update_cluster));
+  EXPECT_EQ(cluster2->info_, cluster_manager_->get(*interned)->info());
+
+  EXPECT_TRUE(cluster_manager_->removePrimaryCluster("fake_cluster"));
+  EXPECT_EQ(nullptr, cluster_manager_->get(*interned));
+
+  std::shared_ptr<MockCluster> cluster3(new NiceMock<MockCluster>());
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster3));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(defaultStaticCluster("fake_cluster")));
+  EXPECT_EQ(cluster3->info_, cluster_manager_->get(*interned)->info());
+
+  // Once released, the index is reused for another name, which must not see the cached lookup.
+  const uint32_t index = interned->index_;
+  interned.reset();
+  InternedClusterNameConstSharedPtr other = cluster_manager_->internClusterName("other_cluster");
+  EXPECT_EQ(index, other->index_);
+  EXPECT_EQ(nullptr, cluster_manager_->get(*other));
+
+  factory_.tls_.shutdownThread();
+}
+
+// Reloading route tables with fresh cluster names does not grow the interned names.
+TEST_F(ClusterManagerImplTest, InternedClusterNamesReleased) {
+  const std::string json = R"EOF(
+  {
+    "clusters": []
+  }
+  )EOF";
+
+  create(parseBootstrapFromJson(json));
+
+  std::vector<InternedClusterNameConstSharedPtr> old_config;
+  for (uint32_t version = 0; version < 100; version++) {
+    // The new table is loaded while the old one is still in use.
+    std::vector<InternedClusterNameConstSharedPtr> new_config;
+    for (uint32_t i = 0; i < 3; i++) {
+      new_config.push_back(
+          cluster_manager_->internClusterName(fmt::format("v{}_{}", version, i)));
+      EXPECT_GT(6U, new_config.back()->index_);
+    }
+    old_config = std::move(new_config);
+  }
+
+  // A name that was released is interned again as a new name.
+  InternedClusterNameConstSharedPtr first = cluster_manager_->internClusterName("v0_0");
+  EXPECT_EQ("v0_0", first->name_);
+  EXPECT_GT(6U, first->index_);
+
+  factory_.tls_.shutdownThread();
+}
+
+// With lazy thread local clusters, API added clusters are only created on a worker when they are
+// first used, and are evicted again once idle.
+TEST_F(ClusterManagerImplTest, LazyThreadLocalClusters) {
+  const std::string json = R"EOF(
+  {
+    "clusters": []
+  }
+  )EOF";
+
+  ON_CALL(factory_.runtime_.snapshot_, featureEnabled("upstream.lazy_thread_local_clusters", 0))
+      .WillByDefault(Return(true));
+  Event::MockTimer* idle_timer = new NiceMock<Event::MockTimer>(&factory_.tls_.dispatcher_);
+  create(parseBootstrapFromJson(json));
+
+  std::shared_ptr<MockCluster> cluster1(new NiceMock<MockCluster>());
+  ON_CALL(*cluster1->info_, addedViaApi()).WillByDefault(Return(true));
+  cluster1->hosts_ = {makeTestHost(cluster1->info_, "tcp://127.0.0.1:80")};
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster1));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(defaultStaticCluster("fake_cluster")));
+
+  // The cluster is created with the latest membership on first use.
+  EXPECT_EQ(1UL, cluster_manager_->get("fake_cluster")->hostSet().hosts().size());
+  Http::ConnectionPool::MockInstance* cp = new Http::ConnectionPool::MockInstance();
+  EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp));
+  EXPECT_EQ(cp, cluster_manager_->httpConnPoolForCluster("fake_cluster", ResourcePriority::Default,
+                                                         nullptr));
+
+  // The cluster was used during the first interval, so it survives the first sweep and is evicted
+  // by the second, which drains its connection pool. Every sweep arms the timer again.
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(300000))).Times(4);
+  idle_timer->callback_();
+  Http::ConnectionPool::Instance::DrainedCb drained_cb;
+  EXPECT_CALL(*cp, addDrainedCallback(_)).WillOnce(SaveArg<0>(&drained_cb));
+  idle_timer->callback_();
+  drained_cb();
+
+  // Updates are applied once the cluster is created again.
+  cluster1->hosts_.push_back(makeTestHost(cluster1->info_, "tcp://127.0.0.1:81"));
+  cluster1->runCallbacks({cluster1->hosts_.back()}, {});
+  EXPECT_EQ(2UL, cluster_manager_->get("fake_cluster")->hostSet().hosts().size());
+  cluster1->hosts_.pop_back();
+  cluster1->runCallbacks({}, {});
+  EXPECT_EQ(1UL, cluster_manager_->get("fake_cluster")->hostSet().hosts().size());
+
+  // Handing out the async client keeps the cluster around.
+  cluster_manager_->httpAsyncClientForCluster("fake_cluster");
+  Http::ConnectionPool::MockInstance* cp2 = new Http::ConnectionPool::MockInstance();
+  EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp2));
+  EXPECT_EQ(cp2, cluster_manager_->httpConnPoolForCluster("fake_cluster",
+                                                          ResourcePriority::Default, nullptr));
+  EXPECT_CALL(*cp2, addDrainedCallback(_)).Times(0);
+  idle_timer->callback_();
+  idle_timer->callback_();
+  EXPECT_TRUE(Mock::VerifyAndClearExpectations(cp2));
+
+  EXPECT_CALL(*cp2, addDrainedCallback(_)).WillOnce(SaveArg<0>(&drained_cb));
+  EXPECT_TRUE(cluster_manager_->removePrimaryCluster("fake_cluster"));
+  EXPECT_EQ(nullptr, cluster_manager_->get("fake_cluster"));
+  drained_cb();
+
+  factory_.tls_.shutdownThread();
+  EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster1.get()));
+}
+
 TEST_F(ClusterManagerImplTest, AddOrUpdatePrimaryClusterStaticExists) {
   const std::string json =
       fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("some_cluster")}));
@@ -0,0 +1,99 @@
+#include <memory>
+#include <vector>
+
+#include "common/upstream/edf_scheduler.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Upstream {
+
+TEST(EdfSchedulerTest, Empty) {
+  EdfScheduler<uint32_t> sched;
+  EXPECT_TRUE(sched.empty());
+  EXPECT_EQ(nullptr, sched.pick());
+}
+
+// Entries with equal weights are picked round robin in insertion order.
+TEST(EdfSchedulerTest, Unweighted) {
+  EdfScheduler<uint32_t> sched;
+  constexpr uint32_t num_entries = 128;
+  std::shared_ptr<uint32_t> entries[num_entries];
+
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    entries[i] = std::make_shared<uint32_t>(i);
+    sched.add(1, entries[i]);
+  }
+  EXPECT_EQ(num_entries, sched.size());
+
+  for (uint32_t rounds = 0; rounds < 3; ++rounds) {
+    for (uint32_t i = 0; i < num_entries; ++i) {
+      auto peek = sched.pick();
+      EXPECT_EQ(i, *peek);
+      sched.add(1, peek);
+    }
+  }
+}
+
+// Entries are picked in proportion to their weights.
+TEST(EdfSchedulerTest, Weighted) {
+  EdfScheduler<uint32_t> sched;
+  constexpr uint32_t num_entries = 128;
+  std::shared_ptr<uint32_t> entries[num_entries];
+  uint32_t pick_count[num_entries] = {};
+
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    entries[i] = std::make_shared<uint32_t>(i);
+    sched.add(i + 1, entries[i]);
+  }
+
+  for (uint32_t i = 0; i < (num_entries * (1 + num_entries)) / 2; ++i) {
+    auto peek = sched.pick();
+    ++pick_count[*peek];
+    sched.add(*peek + 1, peek);
+  }
+
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    EXPECT_EQ(i + 1, pick_count[i]);
+  }
+}
+
+// Picks of a heavy entry are spread between picks of lighter entries rather than bunched up.
+TEST(EdfSchedulerTest, Interleaved) {
+  EdfScheduler<uint32_t> sched;
+  auto light = std::make_shared<uint32_t>(0);
+  auto heavy = std::make_shared<uint32_t>(1);
+  sched.add(1, light);
+  sched.add(4, heavy);
+
+  const std::vector<uint32_t> expected = {1, 1, 1, 0, 1, 1, 1, 1, 0, 1};
+  for (uint32_t expected_entry : expected) {
+    auto peek = sched.pick();
+    EXPECT_EQ(expected_entry, *peek);
+    sched.add(*peek == 0 ? 1 : 4, peek);
+  }
+}
+
+// pickAndAdd() picks in the same order as pick() followed by add().
+TEST(EdfSchedulerTest, PickAndAdd) {
+  EdfScheduler<uint32_t> sched;
+  EdfScheduler<uint32_t> expected_sched;
+  for (uint32_t i = 0; i < 8; ++i) {
+    auto entry = std::make_shared<uint32_t>(i);
+    sched.add(i + 1, entry);
+    expected_sched.add(i + 1, entry);
+  }
+
+  for (uint32_t i = 0; i < 100; ++i) {
+    auto expected = expected_sched.pick();
+    expected_sched.add(*expected + 1, expected);
+    EXPECT_EQ(expected, sched.pickAndAdd([](const uint32_t& entry) { return entry + 1; }));
+  }
+  EXPECT_EQ(8, sched.size());
+
+  EdfScheduler<uint32_t> empty_sched;
+  EXPECT_EQ(nullptr, empty_sched.pickAndAdd([](const uint32_t&) { return 1; }));
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -167,6 +167,62 @@ TEST_F(EdsTest, EndpointMetadata) {
   EXPECT_TRUE(hosts[1]->canary());
 }
 
+// Validate that onConfigUpdate() keeps existing hosts, adds new hosts and removes missing hosts,
+// ignoring duplicate addresses.
+TEST_F(EdsTest, EndpointAddsAndRemoves) {
+  Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> resources;
+  auto* cluster_load_assignment = resources.Add();
+  cluster_load_assignment->set_cluster_name("fare");
+
+  const auto set_endpoints = [cluster_load_assignment](
+                                 const std::vector<std::pair<std::string, uint32_t>>& endpoints) {
+    cluster_load_assignment->clear_endpoints();
+    auto* locality_lb_endpoints = cluster_load_assignment->add_endpoints();
+    for (const auto& endpoint : endpoints) {
+      auto* lb_endpoint = locality_lb_endpoints->add_lb_endpoints();
+      lb_endpoint->mutable_endpoint()->mutable_address()->mutable_socket_address()->set_address(
+          endpoint.first);
+      lb_endpoint->mutable_load_balancing_weight()->set_value(endpoint.second);
+    }
+  };
+
+  std::vector<HostSharedPtr> hosts_added;
+  std::vector<HostSharedPtr> hosts_removed;
+  cluster_->addMemberUpdateCb(
+      [&](const std::vector<HostSharedPtr>& added, const std::vector<HostSharedPtr>& removed) {
+        hosts_added = added;
+        hosts_removed = removed;
+      });
+
+  set_endpoints({{"1.2.3.4", 1}, {"2.3.4.5", 1}, {"3.4.5.6", 1}});
+  cluster_->initialize([] {});
+  cluster_->onConfigUpdate(resources);
+  const std::vector<HostSharedPtr> initial_hosts = cluster_->hosts();
+  EXPECT_EQ(3UL, initial_hosts.size());
+  EXPECT_EQ(3UL, hosts_added.size());
+
+  set_endpoints({{"2.3.4.5", 3}, {"4.5.6.7", 1}, {"4.5.6.7", 2}});
+  cluster_->onConfigUpdate(resources);
+
+  const auto& hosts = cluster_->hosts();
+  EXPECT_EQ(2UL, hosts.size());
+  EXPECT_EQ(initial_hosts[1], hosts[0]);
+  EXPECT_EQ(3U, hosts[0]->weight());
+  EXPECT_EQ("4.5.6.7:0", hosts[1]->address()->asString());
+  EXPECT_EQ(1U, hosts[1]->weight());
+
+  EXPECT_EQ(std::vector<HostSharedPtr>({hosts[1]}), hosts_added);
+  EXPECT_EQ(std::vector<HostSharedPtr>({initial_hosts[0], initial_hosts[2]}), hosts_removed);
+
+  // An identical update does not change the host set.
+  hosts_added.clear();
+  hosts_removed.clear();
+  cluster_->onConfigUpdate(resources);
+  EXPECT_EQ(2UL, cluster_->hosts().size());
+  EXPECT_TRUE(hosts_added.empty());
+  EXPECT_TRUE(hosts_removed.empty());
+}
+
 // Validate that onConfigUpdate() updates the endpoint locality.
 TEST_F(EdsTest, EndpointLocality) {
   Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> resources;
@@ -267,5 +323,58 @@ TEST_F(EdsTest, EndpointHostsPerLocality) {
             Locality(cluster_->hostsPerLocality()[3][0]->locality()));
 }
 
+// Validate that onConfigUpdate() propagates locality weights, populating localities even when
+// the local locality has no upstream hosts.
+TEST_F(EdsTest, EndpointLocalityWeights) {
+  Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> resources;
+  auto* cluster_load_assignment = resources.Add();
+  cluster_load_assignment->set_cluster_name("fare");
+  uint32_t port = 1000;
+  auto add_hosts_to_locality = [cluster_load_assignment, &port](const std::string& region,
+                                                                 uint32_t n, uint32_t weight) {
+    auto* endpoints = cluster_load_assignment->add_endpoints();
+    endpoints->mutable_locality()->set_region(region);
+    if (weight > 0) {
+      endpoints->mutable_load_balancing_weight()->set_value(weight);
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+      auto* socket_address = endpoints->add_lb_endpoints()
+                                 ->mutable_endpoint()
+                                 ->mutable_address()
+                                 ->mutable_socket_address();
+      socket_address->set_address("1.2.3.4");
+      socket_address->set_port_value(port++);
+    }
+  };
+
+  add_hosts_to_locality("oceania", 1, 3);
+  add_hosts_to_locality("asia", 2, 1);
+
+  bool initialized = false;
+  cluster_->initialize([&initialized] { initialized = true; });
+  EXPECT_NO_THROW(cluster_->onConfigUpdate(resources));
+  EXPECT_TRUE(initialized);
+
+  // The local locality (us-east-1a) comes first, without hosts or weight.
+  ASSERT_EQ(3, cluster_->hostsPerLocality().size());
+  EXPECT_EQ(0, cluster_->hostsPerLocality()[0].size());
+  EXPECT_EQ(2, cluster_->hostsPerLocality()[1].size());
+  EXPECT_EQ(1, cluster_->hostsPerLocality()[2].size());
+  EXPECT_EQ(std::vector<uint32_t>({0, 1, 3}), cluster_->localityWeights());
+
+  // Weight changes are applied even if no host changed.
+  cluster_load_assignment->mutable_endpoints(1)->mutable_load_balancing_weight()->set_value(2);
+  EXPECT_NO_THROW(cluster_->onConfigUpdate(resources));
+  EXPECT_EQ(std::vector<uint32_t>({0, 2, 3}), cluster_->localityWeights());
+
+  // Removing all weights returns to unweighted localities.
+  cluster_load_assignment->mutable_endpoints(0)->clear_load_balancing_weight();
+  cluster_load_assignment->mutable_endpoints(1)->clear_load_balancing_weight();
+  EXPECT_NO_THROW(cluster_->onConfigUpdate(resources));
+  EXPECT_TRUE(cluster_->localityWeights().empty());
+  EXPECT_TRUE(cluster_->hostsPerLocality().empty());
+}
+
 } // namespace Upstream
 } // namespace Envoy
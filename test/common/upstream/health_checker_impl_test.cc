@@ -6,6 +6,7 @@
 #include "common/buffer/buffer_impl.h"
 #include "common/config/cds_json.h"
 #include "common/http/headers.h"
+#include "common/http/http2/codec_impl.h"
 #include "common/json/json_loader.h"
 #include "common/network/utility.h"
 #include "common/protobuf/utility.h"
@@ -14,9 +15,11 @@
 
 #include "test/common/http/common.h"
 #include "test/common/upstream/utility.h"
+#include "test/mocks/http/mocks.h"
 #include "test/mocks/network/mocks.h"
 #include "test/mocks/redis/mocks.h"
 #include "test/mocks/runtime/mocks.h"
+#include "test/mocks/ssl/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
@@ -61,9 +64,10 @@ TEST(HealthCheckerFactoryTest, createRedis) {
   Runtime::MockLoader runtime;
   Runtime::MockRandomGenerator random;
   Event::MockDispatcher dispatcher;
+  SharedHealthCheckSessionMap shared_sessions;
   EXPECT_NE(nullptr, dynamic_cast<RedisHealthCheckerImpl*>(
                          HealthCheckerFactory::create(parseHealthCheckFromJson(json), cluster,
-                                                      runtime, random, dispatcher)
+                                                      runtime, random, dispatcher, shared_sessions)
                              .get()));
 }
 
@@ -75,13 +79,16 @@ TEST(HealthCheckerFactoryTest, MissingFieldiException) {
   Runtime::MockLoader runtime;
   Runtime::MockRandomGenerator random;
   Event::MockDispatcher dispatcher;
+  SharedHealthCheckSessionMap shared_sessions;
   envoy::api::v2::HealthCheck health_check;
   // No health checker type set
-  EXPECT_THROW(HealthCheckerFactory::create(health_check, cluster, runtime, random, dispatcher),
+  EXPECT_THROW(HealthCheckerFactory::create(health_check, cluster, runtime, random, dispatcher,
+                                            shared_sessions),
                EnvoyException);
   health_check.mutable_http_health_check();
   // No timeout field set.
-  EXPECT_THROW(HealthCheckerFactory::create(health_check, cluster, runtime, random, dispatcher),
+  EXPECT_THROW(HealthCheckerFactory::create(health_check, cluster, runtime, random, dispatcher,
+                                            shared_sessions),
                MissingFieldException);
 }
 
@@ -129,7 +136,8 @@ public:
     )EOF";
 
     health_checker_.reset(new TestHttpHealthCheckerImpl(*cluster_, parseHealthCheckFromJson(json),
-                                                        dispatcher_, runtime_, random_));
+                                                        dispatcher_, runtime_, random_,
+                                                        shared_sessions_));
     health_checker_->addHostCheckCompleteCb([this](HostSharedPtr host, bool changed_state) -> void {
       onHostStatus(host, changed_state);
     });
@@ -150,7 +158,8 @@ public:
     )EOF";
 
     health_checker_.reset(new TestHttpHealthCheckerImpl(*cluster_, parseHealthCheckFromJson(json),
-                                                        dispatcher_, runtime_, random_));
+                                                        dispatcher_, runtime_, random_,
+                                                        shared_sessions_));
     health_checker_->addHostCheckCompleteCb([this](HostSharedPtr host, bool changed_state) -> void {
       onHostStatus(host, changed_state);
     });
@@ -217,6 +226,7 @@ public:
 
   std::shared_ptr<MockCluster> cluster_;
   NiceMock<Event::MockDispatcher> dispatcher_;
+  SharedHealthCheckSessionMap shared_sessions_;
   std::vector<TestSessionPtr> test_sessions_;
   std::shared_ptr<TestHttpHealthCheckerImpl> health_checker_;
   NiceMock<Runtime::MockLoader> runtime_;
@@ -243,6 +253,81 @@ TEST_F(HttpHealthCheckerImplTest, Success) {
   EXPECT_TRUE(cluster_->hosts_[0]->healthy());
 }
 
+// HTTP/2 clusters can run health checks over HTTP/2.
+TEST_F(HttpHealthCheckerImplTest, Http2) {
+  setupNoServiceValidationHC();
+  EXPECT_EQ(Http::CodecClient::Type::HTTP1, health_checker_->codecClientType());
+
+  ON_CALL(runtime_.snapshot_, featureEnabled("health_check.http2", 0)).WillByDefault(Return(true));
+  setupNoServiceValidationHC();
+  EXPECT_EQ(Http::CodecClient::Type::HTTP1, health_checker_->codecClientType());
+
+  ON_CALL(*cluster_->info_, features()).WillByDefault(Return(ClusterInfo::Features::HTTP2));
+  setupNoServiceValidationHC();
+  EXPECT_EQ(Http::CodecClient::Type::HTTP2, health_checker_->codecClientType());
+
+  // Run a check with the real HTTP/2 codecs on both ends. The server codec resets requests that
+  // are missing a required pseudo header such as :scheme.
+  Stats::IsolatedStoreImpl stats_store;
+  NiceMock<Network::MockConnection> server_connection;
+  NiceMock<Http::MockServerConnectionCallbacks> server_callbacks;
+  Http::Http2::ServerConnectionImpl server(server_connection, server_callbacks, stats_store,
+                                           Http::Http2Settings());
+  Network::ReadFilterSharedPtr client_read_filter;
+  Buffer::OwnedImpl to_server;
+  Buffer::OwnedImpl to_client;
+  ON_CALL(server_connection, write(_))
+      .WillByDefault(Invoke([&](Buffer::Instance& data) -> void { to_client.move(data); }));
+  auto exchange_frames = [&]() -> void {
+    while (to_server.length() > 0 || to_client.length() > 0) {
+      server.dispatch(to_server);
+      client_read_filter->onData(to_client, false);
+    }
+  };
+
+  cluster_->hosts_ = {makeTestHost(cluster_->info_, "tcp://127.0.0.1:80")};
+  cluster_->info_->stats().upstream_cx_total_.inc();
+  Event::MockTimer* timeout_timer = new Event::MockTimer(&dispatcher_);
+  Event::MockTimer* interval_timer = new Event::MockTimer(&dispatcher_);
+  NiceMock<Network::MockClientConnection>* client_connection =
+      new NiceMock<Network::MockClientConnection>();
+  ON_CALL(*client_connection, write(_))
+      .WillByDefault(Invoke([&](Buffer::Instance& data) -> void { to_server.move(data); }));
+  EXPECT_CALL(*client_connection, addReadFilter(_)).WillOnce(SaveArg<0>(&client_read_filter));
+  EXPECT_CALL(dispatcher_, createClientConnection_(_, _)).WillOnce(Return(client_connection));
+  EXPECT_CALL(*health_checker_, createCodecClient_(_))
+      .WillOnce(Invoke([](Upstream::Host::CreateConnectionData& conn_data) -> Http::CodecClient* {
+        return new Http::CodecClientProd(Http::CodecClient::Type::HTTP2,
+                                         std::move(conn_data.connection_),
+                                         conn_data.host_description_);
+      }));
+  EXPECT_CALL(*timeout_timer, enableTimer(_));
+  health_checker_->start();
+
+  Http::StreamEncoder* response_encoder{};
+  NiceMock<Http::MockStreamDecoder> request_decoder;
+  EXPECT_CALL(server_callbacks, newStream(_))
+      .WillOnce(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoder = &encoder;
+        return request_decoder;
+      }));
+  EXPECT_CALL(request_decoder, decodeHeaders_(_, true))
+      .WillOnce(Invoke([](Http::HeaderMapPtr& headers, bool) -> void {
+        EXPECT_STREQ("http", headers->Scheme()->value().c_str());
+        EXPECT_STREQ("/healthcheck", headers->Path()->value().c_str());
+      }));
+  exchange_frames();
+  ASSERT_NE(nullptr, response_encoder);
+
+  EXPECT_CALL(*this, onHostStatus(_, false));
+  EXPECT_CALL(*interval_timer, enableTimer(_));
+  EXPECT_CALL(*timeout_timer, disableTimer());
+  Http::TestHeaderMapImpl response_headers{{":status", "200"}};
+  response_encoder->encodeHeaders(response_headers, true);
+  exchange_frames();
+  EXPECT_TRUE(cluster_->hosts_[0]->healthy());
+}
+
 TEST_F(HttpHealthCheckerImplTest, SuccessServiceCheck) {
   setupServiceValidationHC();
   EXPECT_CALL(runtime_.snapshot_, featureEnabled("health_check.verify_cluster", 100))
@@ -735,7 +820,8 @@ public:
     )EOF";
 
     health_checker_.reset(new TcpHealthCheckerImpl(*cluster_, parseHealthCheckFromJson(json),
-                                                   dispatcher_, runtime_, random_));
+                                                   dispatcher_, runtime_, random_,
+                                                   shared_sessions_));
   }
 
   void setupNoData() {
@@ -752,7 +838,8 @@ public:
     )EOF";
 
     health_checker_.reset(new TcpHealthCheckerImpl(*cluster_, parseHealthCheckFromJson(json),
-                                                   dispatcher_, runtime_, random_));
+                                                   dispatcher_, runtime_, random_,
+                                                   shared_sessions_));
   }
 
   void expectSessionCreate() {
@@ -768,6 +855,7 @@ public:
 
   std::shared_ptr<MockCluster> cluster_;
   NiceMock<Event::MockDispatcher> dispatcher_;
+  SharedHealthCheckSessionMap shared_sessions_;
   std::shared_ptr<TcpHealthCheckerImpl> health_checker_;
   Network::MockClientConnection* connection_{};
   Event::MockTimer* timeout_timer_{};
@@ -956,6 +1044,168 @@ TEST_F(TcpHealthCheckerImplTest, PassiveFailureCrossThreadRemoveClusterRace) {
   EXPECT_EQ(0UL, cluster_->info_->stats_store_.counter("health_check.passive_failure").value());
 }
 
+// Clusters with the same health check config share a single session for the same endpoint.
+TEST_F(TcpHealthCheckerImplTest, SharedSessions) {
+  InSequence s;
+
+  ON_CALL(runtime_.snapshot_, featureEnabled("health_check.shared_sessions", 0))
+      .WillByDefault(Return(true));
+  setupNoData();
+  std::shared_ptr<MockCluster> cluster2(new NiceMock<MockCluster>());
+  std::shared_ptr<TcpHealthCheckerImpl> health_checker2(new TcpHealthCheckerImpl(
+      *cluster2, parseHealthCheckFromJson(R"EOF(
+    {
+      "type": "tcp",
+      "timeout_ms": 1000,
+      "interval_ms": 1000,
+      "unhealthy_threshold": 2,
+      "healthy_threshold": 2,
+      "send": [],
+      "receive": []
+    }
+    )EOF"),
+      dispatcher_, runtime_, random_, shared_sessions_));
+
+  cluster_->hosts_ = {makeTestHost(cluster_->info_, "tcp://127.0.0.1:80")};
+  cluster_->hosts_[0]->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+  cluster2->hosts_ = {makeTestHost(cluster2->info_, "tcp://127.0.0.1:80")};
+  cluster2->hosts_[0]->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+
+  expectSessionCreate();
+  expectClientCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  // The second cluster does not connect to the host itself.
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  health_checker2->start();
+
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  EXPECT_TRUE(cluster_->hosts_[0]->healthy());
+  EXPECT_TRUE(cluster2->hosts_[0]->healthy());
+  EXPECT_EQ(1UL, cluster_->info_->stats_store_.counter("health_check.attempt").value());
+  EXPECT_EQ(0UL, cluster2->info_->stats_store_.counter("health_check.attempt").value());
+  EXPECT_EQ(1UL, cluster2->info_->stats_store_.counter("health_check.success").value());
+
+  // Once the first cluster's host is gone, the second cluster runs the checks, starting on the
+  // regular schedule.
+  expectSessionCreate();
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  std::vector<HostSharedPtr> removed = std::move(cluster_->hosts_);
+  cluster_->hosts_.clear();
+  cluster_->runCallbacks({}, removed);
+
+  expectClientCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  interval_timer_->callback_();
+  EXPECT_EQ(1UL, cluster2->info_->stats_store_.counter("health_check.attempt").value());
+
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  EXPECT_EQ(2UL, cluster2->info_->stats_store_.counter("health_check.success").value());
+  EXPECT_EQ(1UL, cluster_->info_->stats_store_.counter("health_check.success").value());
+}
+
+// Clusters with different TLS settings do not share sessions.
+TEST_F(TcpHealthCheckerImplTest, SharedSessionsRequireSameTls) {
+  ON_CALL(runtime_.snapshot_, featureEnabled("health_check.shared_sessions", 0))
+      .WillByDefault(Return(true));
+  ON_CALL(runtime_.snapshot_, getInteger("health_check.initial_jitter_percent", 0))
+      .WillByDefault(Return(50));
+  setupNoData();
+  std::shared_ptr<MockCluster> cluster2(new NiceMock<MockCluster>());
+  Ssl::MockClientContext ssl_context;
+  ON_CALL(*cluster2->info_, sslContext()).WillByDefault(Return(&ssl_context));
+  ON_CALL(*cluster2->info_, tlsContextHash()).WillByDefault(Return(1));
+  std::shared_ptr<TcpHealthCheckerImpl> health_checker2(new TcpHealthCheckerImpl(
+      *cluster2, parseHealthCheckFromJson(R"EOF(
+    {
+      "type": "tcp",
+      "timeout_ms": 1000,
+      "interval_ms": 1000,
+      "unhealthy_threshold": 2,
+      "healthy_threshold": 2,
+      "send": [],
+      "receive": []
+    }
+    )EOF"),
+      dispatcher_, runtime_, random_, shared_sessions_));
+
+  cluster_->hosts_ = {makeTestHost(cluster_->info_, "tcp://127.0.0.1:80")};
+  cluster2->hosts_ = {makeTestHost(cluster2->info_, "tcp://127.0.0.1:80")};
+
+  // The first checks are delayed, so both sessions only arm their interval timers.
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  health_checker_->start();
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  health_checker2->start();
+  EXPECT_EQ(2UL, shared_sessions_.size());
+}
+
+// Clusters with the same TLS settings share sessions, even though each has its own TLS context.
+TEST_F(TcpHealthCheckerImplTest, SharedSessionsWithSameTls) {
+  ON_CALL(runtime_.snapshot_, featureEnabled("health_check.shared_sessions", 0))
+      .WillByDefault(Return(true));
+  ON_CALL(runtime_.snapshot_, getInteger("health_check.initial_jitter_percent", 0))
+      .WillByDefault(Return(50));
+  Ssl::MockClientContext ssl_context;
+  ON_CALL(*cluster_->info_, sslContext()).WillByDefault(Return(&ssl_context));
+  ON_CALL(*cluster_->info_, tlsContextHash()).WillByDefault(Return(1));
+  setupNoData();
+  std::shared_ptr<MockCluster> cluster2(new NiceMock<MockCluster>());
+  Ssl::MockClientContext ssl_context2;
+  ON_CALL(*cluster2->info_, sslContext()).WillByDefault(Return(&ssl_context2));
+  ON_CALL(*cluster2->info_, tlsContextHash()).WillByDefault(Return(1));
+  std::shared_ptr<TcpHealthCheckerImpl> health_checker2(new TcpHealthCheckerImpl(
+      *cluster2, parseHealthCheckFromJson(R"EOF(
+    {
+      "type": "tcp",
+      "timeout_ms": 1000,
+      "interval_ms": 1000,
+      "unhealthy_threshold": 2,
+      "healthy_threshold": 2,
+      "send": [],
+      "receive": []
+    }
+    )EOF"),
+      dispatcher_, runtime_, random_, shared_sessions_));
+
+  cluster_->hosts_ = {makeTestHost(cluster_->info_, "tcp://127.0.0.1:80")};
+  cluster2->hosts_ = {makeTestHost(cluster2->info_, "tcp://127.0.0.1:80")};
+
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  health_checker_->start();
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  new NiceMock<Event::MockTimer>(&dispatcher_);
+  health_checker2->start();
+  EXPECT_EQ(1UL, shared_sessions_.size());
+}
+
+// The first check can be spread over the interval.
+TEST_F(TcpHealthCheckerImplTest, InitialJitter) {
+  InSequence s;
+
+  ON_CALL(runtime_.snapshot_, getInteger("health_check.initial_jitter_percent", 0))
+      .WillByDefault(Return(50));
+  setupNoData();
+  cluster_->hosts_ = {makeTestHost(cluster_->info_, "tcp://127.0.0.1:80")};
+  expectSessionCreate();
+  EXPECT_CALL(random_, random()).WillOnce(Return(45000));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(15000)));
+  health_checker_->start();
+
+  expectClientCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  interval_timer_->callback_();
+}
+
 class RedisHealthCheckerImplTest : public testing::Test, public Redis::ConnPool::ClientFactory {
 public:
   RedisHealthCheckerImplTest() : cluster_(new NiceMock<MockCluster>()) {
@@ -970,7 +1220,8 @@ public:
     )EOF";
 
     health_checker_.reset(new RedisHealthCheckerImpl(*cluster_, parseHealthCheckFromJson(json),
-                                                     dispatcher_, runtime_, random_, *this));
+                                                     dispatcher_, runtime_, random_,
+                                                     shared_sessions_, *this));
   }
 
   Redis::ConnPool::ClientPtr create(Upstream::HostConstSharedPtr, Event::Dispatcher&,
@@ -999,6 +1250,7 @@ public:
 
   std::shared_ptr<MockCluster> cluster_;
   NiceMock<Event::MockDispatcher> dispatcher_;
+  SharedHealthCheckSessionMap shared_sessions_;
   NiceMock<Runtime::MockLoader> runtime_;
   NiceMock<Runtime::MockRandomGenerator> random_;
   Event::MockTimer* timeout_timer_{};
@@ -1,3 +1,5 @@
+#include <chrono>
+
 #include "common/network/utility.h"
 #include "common/upstream/host_utility.h"
 #include "common/upstream/upstream_impl.h"
@@ -25,5 +27,59 @@ TEST(HostUtilityTest, All) {
   EXPECT_EQ("/failed_outlier_check", HostUtility::healthFlagsToString(*host));
 }
 
+TEST(HostUtilityTest, RecordResponseTime) {
+  ClusterInfoConstSharedPtr cluster{new MockClusterInfo()};
+  HostSharedPtr host = makeTestHost(cluster, "tcp://127.0.0.1:80");
+  const MonotonicTime now(std::chrono::seconds(1000));
+  EXPECT_EQ(0UL, host->stats().rq_time_ewma_.value());
+  EXPECT_EQ(0UL, host->responseTimeAverage(now));
+
+  // The first sample seeds the average.
+  host->recordResponseTime(std::chrono::microseconds(800), now);
+  EXPECT_EQ(800UL, host->stats().rq_time_ewma_.value());
+  EXPECT_EQ(800UL, host->responseTimeAverage(now));
+
+  host->recordResponseTime(std::chrono::microseconds(1600), now);
+  EXPECT_EQ(900UL, host->stats().rq_time_ewma_.value());
+
+  host->recordResponseTime(std::chrono::microseconds(100), now);
+  EXPECT_EQ(800UL, host->stats().rq_time_ewma_.value());
+
+  // Responses under a microsecond still leave the average non zero.
+  HostSharedPtr fast_host = makeTestHost(cluster, "tcp://127.0.0.1:81");
+  fast_host->recordResponseTime(std::chrono::microseconds(0), now);
+  EXPECT_EQ(1UL, fast_host->stats().rq_time_ewma_.value());
+}
+
+// Averages of a few microseconds still follow their samples.
+TEST(ResponseTimeAverageTest, SmallAverages) {
+  ResponseTimeAverage average;
+  const MonotonicTime now(std::chrono::seconds(1000));
+  average.record(std::chrono::microseconds(7), now);
+  for (int i = 0; i < 50; i++) {
+    average.record(std::chrono::microseconds(1), now);
+  }
+  EXPECT_EQ(1UL, average.value(now));
+}
+
+// A host that had a slow response and then gets no traffic, for example because latency aware
+// load balancing avoids it, recovers.
+TEST(ResponseTimeAverageTest, RecoversAfterSlowResponse) {
+  ResponseTimeAverage average;
+  const MonotonicTime now(std::chrono::seconds(1000));
+  average.record(std::chrono::microseconds(1000), now);
+  average.record(std::chrono::microseconds(100000), now);
+  EXPECT_EQ(13375UL, average.value(now));
+
+  // Without responses the average decays towards 0, halving every DecayHalfLife.
+  EXPECT_EQ(6688UL, average.value(now + ResponseTimeAverage::DecayHalfLife));
+  const MonotonicTime later = now + 6 * ResponseTimeAverage::DecayHalfLife;
+  EXPECT_EQ(209UL, average.value(later));
+
+  // The first response after the idle period mostly replaces the slow average.
+  average.record(std::chrono::microseconds(1000), later);
+  EXPECT_EQ(1169UL, average.value(later));
+}
+
 } // namespace Upstream
 } // namespace Envoy
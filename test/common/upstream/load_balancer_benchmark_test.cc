@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/config/metadata.h"
+#include "common/config/well_known_names.h"
+#include "common/network/utility.h"
+#include "common/runtime/runtime_impl.h"
+#include "common/upstream/load_balancer_impl.h"
+#include "common/upstream/maglev_lb.h"
+#include "common/upstream/ring_hash_lb.h"
+#include "common/upstream/subset_lb.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/mocks/upstream/mocks.h"
+
+#include "api/cds.pb.h"
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Upstream {
+namespace {
+
+// Produces the same sequence on every run, so that different builds pick from the same hosts with
+// the same random values and only the timings differ.
+class DeterministicRandomGenerator : public Runtime::RandomGenerator {
+public:
+  // Runtime::RandomGenerator
+  uint64_t random() override { return generator_(); }
+  std::string uuid() override { NOT_IMPLEMENTED; }
+
+private:
+  std::mt19937_64 generator_{1};
+};
+
+class BenchmarkMetadataMatchCriteria : public Router::MetadataMatchCriteria {
+public:
+  BenchmarkMetadataMatchCriteria(const std::string& name, const std::string& value) {
+    ProtobufWkt::Value pb_value;
+    pb_value.set_string_value(value);
+    criteria_.emplace_back(std::make_shared<const Criterion>(name, HashedValue(pb_value)));
+  }
+
+  // Router::MetadataMatchCriteria
+  const std::vector<Router::MetadataMatchCriterionConstSharedPtr>&
+  metadataMatchCriteria() const override {
+    return criteria_;
+  }
+  uint64_t id() const override { return 1; }
+
+private:
+  struct Criterion : public Router::MetadataMatchCriterion {
+    Criterion(const std::string& name, const HashedValue& value) : name_(name), value_(value) {}
+
+    // Router::MetadataMatchCriterion
+    const std::string& name() const override { return name_; }
+    const HashedValue& value() const override { return value_; }
+
+    const std::string name_;
+    const HashedValue value_;
+  };
+
+  std::vector<Router::MetadataMatchCriterionConstSharedPtr> criteria_;
+};
+
+class BenchmarkLoadBalancerContext : public LoadBalancerContext {
+public:
+  // Upstream::LoadBalancerContext
+  Optional<uint64_t> computeHashKey() override { return hash_key_; }
+  const Router::MetadataMatchCriteria* metadataMatchCriteria() const override {
+    return metadata_match_criteria_;
+  }
+  const Network::Connection* downstreamConnection() const override { return nullptr; }
+
+  Optional<uint64_t> hash_key_;
+  const Router::MetadataMatchCriteria* metadata_match_criteria_{};
+};
+
+/**
+ * The host set a benchmark runs against.
+ */
+struct Layout {
+  uint32_t num_hosts_;
+  // Hosts are spread round robin across this many localities. With more than one locality, the
+  // localities are weighted 1, 2, 3, ...
+  uint32_t num_localities_;
+  // If set, every tenth host has weight 10 instead of 1.
+  bool skewed_weights_;
+};
+
+/**
+ * Load balancer benchmarks, for evaluating load balancer changes. They are slow and should not be
+ * run as part of unit tests. To run them, use:
+ *
+ * bazel test //test/common/upstream:load_balancer_benchmark_test --test_output=all
+ *   --test_arg=--gtest_also_run_disabled_tests [--test_arg=--gtest_filter=*RoundRobin*]
+ *
+ * For each load balancer and host layout the benchmark reports:
+ * - build: time to construct the load balancer for the initial host set.
+ * - pick: average chooseHost() time.
+ * - max/cov: the most loaded host's share of picks relative to its expected share, and the
+ *   coefficient of variation of that ratio across hosts. The expected share takes into account the
+ *   host and locality weights that the load balancer honours.
+ * - rebuild: time for the host set update and load balancer rebuild after removing 1% of hosts.
+ * - moved: for hashing load balancers, the percentage of hash keys that moved to a different host
+ *   without their host having been removed. Zero means minimal disruption.
+ *
+ * Hosts, weights and random numbers are the same on every run.
+ */
+class DISABLED_LoadBalancerBenchmarkTest : public testing::Test {
+public:
+  DISABLED_LoadBalancerBenchmarkTest()
+      : stats_(ClusterInfoImpl::generateStats(stats_store_)), runtime_(random_) {
+    envoy::api::v2::Cluster::LbSubsetConfig subset_config;
+    subset_config.set_fallback_policy(envoy::api::v2::Cluster::LbSubsetConfig::ANY_ENDPOINT);
+    subset_config.add_subset_selectors()->add_keys("version");
+    subset_info_.reset(new LoadBalancerSubsetInfoImpl(subset_config));
+  }
+
+  void run(LoadBalancerType type, bool subset) {
+    const std::vector<Layout> layouts = {
+        {10, 1, false},    {100, 1, false},  {1000, 1, false}, {10000, 1, false},
+        {50000, 1, false}, {1000, 1, true},  {50000, 1, true}, {1000, 3, false},
+        {50000, 3, false}, {50000, 3, true},
+    };
+
+    std::cout << fmt::format("{:>6} {:>4} {:>6} | {:>11} {:>9} {:>7} {:>7} {:>11} {:>7}", "hosts",
+                             "loc", "skewed", "build(us)", "pick(ns)", "max", "cov",
+                             "rebuild(us)", "moved%")
+              << std::endl;
+    for (const Layout& layout : layouts) {
+      runLayout(type, subset, layout);
+    }
+  }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  static double elapsedUs(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  void runLayout(LoadBalancerType type, bool subset, const Layout& layout) {
+    host_set_.reset(new HostSetImpl());
+    std::vector<HostSharedPtr> hosts = makeHosts(layout);
+    updateHosts(hosts, layout, hosts, {});
+
+    Clock::time_point start = Clock::now();
+    LoadBalancerPtr lb = makeLoadBalancer(type, subset);
+    const double build_us = elapsedUs(start);
+
+    const bool hashing = type == LoadBalancerType::RingHash || type == LoadBalancerType::Maglev;
+    BenchmarkMetadataMatchCriteria criteria("version", "even");
+    BenchmarkLoadBalancerContext context;
+    if (subset) {
+      context.metadata_match_criteria_ = &criteria;
+    }
+
+    // Picked hosts are only recorded in the timed loop and counted afterwards, so that the
+    // accounting does not add to the pick time.
+    std::unordered_map<const Host*, size_t> host_index;
+    for (size_t i = 0; i < hosts.size(); i++) {
+      host_index[hosts[i].get()] = i;
+    }
+    std::vector<uint64_t> picks_per_host(hosts.size());
+    const uint64_t picks = std::max<uint64_t>(1000000, 20 * layout.num_hosts_);
+    std::vector<const Host*> picked(picks);
+
+    start = Clock::now();
+    for (uint64_t i = 0; i < picks; i++) {
+      if (hashing) {
+        context.hash_key_ = random_.random();
+      }
+      picked[i] = lb->chooseHost(&context).get();
+    }
+    const double pick_ns = elapsedUs(start) * 1000 / picks;
+
+    for (const Host* host : picked) {
+      picks_per_host[host_index[host]]++;
+    }
+
+    double max_ratio = 0;
+    double sum_ratio = 0;
+    double sum_ratio_squared = 0;
+    const std::vector<double> shares = expectedShares(type, subset, layout, hosts);
+    size_t hosts_with_share = 0;
+    for (size_t i = 0; i < hosts.size(); i++) {
+      if (shares[i] == 0) {
+        EXPECT_EQ(0UL, picks_per_host[i]);
+        continue;
+      }
+      const double ratio = picks_per_host[i] / (shares[i] * picks);
+      max_ratio = std::max(max_ratio, ratio);
+      sum_ratio += ratio;
+      sum_ratio_squared += ratio * ratio;
+      hosts_with_share++;
+    }
+    const double mean_ratio = sum_ratio / hosts_with_share;
+    const double cov =
+        std::sqrt(std::max(0.0, sum_ratio_squared / hosts_with_share - mean_ratio * mean_ratio)) /
+        mean_ratio;
+
+    // Remember which host each of a sample of hash keys maps to before the membership change.
+    std::vector<uint64_t> keys;
+    std::vector<const Host*> hosts_before;
+    if (hashing) {
+      for (uint32_t i = 0; i < 10000; i++) {
+        context.hash_key_ = random_.random();
+        keys.push_back(context.hash_key_.value());
+        hosts_before.push_back(lb->chooseHost(&context).get());
+      }
+    }
+
+    // Remove every hundredth host, or a single host for small clusters. The removed hosts are kept
+    // alive by the removed vector, so their pointers can be compared below.
+    std::vector<HostSharedPtr> remaining;
+    std::vector<HostSharedPtr> removed;
+    for (size_t i = 0; i < hosts.size(); i++) {
+      (i % 100 == 1 ? removed : remaining).push_back(hosts[i]);
+    }
+    start = Clock::now();
+    updateHosts(remaining, layout, {}, removed);
+    const double rebuild_us = elapsedUs(start);
+
+    std::string moved = "-";
+    if (hashing) {
+      std::unordered_set<const Host*> removed_hosts;
+      for (const auto& host : removed) {
+        removed_hosts.insert(host.get());
+      }
+      uint64_t moved_keys = 0;
+      for (size_t i = 0; i < keys.size(); i++) {
+        context.hash_key_ = keys[i];
+        if (removed_hosts.count(hosts_before[i]) == 0 &&
+            lb->chooseHost(&context).get() != hosts_before[i]) {
+          moved_keys++;
+        }
+      }
+      moved = fmt::format("{:.2f}", 100.0 * moved_keys / keys.size());
+    }
+
+    std::cout << fmt::format("{:>6} {:>4} {:>6} | {:>11.0f} {:>9.1f} {:>7.3f} {:>7.3f} {:>11.0f} "
+                             "{:>7}",
+                             layout.num_hosts_, layout.num_localities_,
+                             layout.skewed_weights_ ? "yes" : "no", build_us, pick_ns, max_ratio,
+                             cov, rebuild_us, moved)
+              << std::endl;
+  }
+
+  std::vector<HostSharedPtr> makeHosts(const Layout& layout) {
+    std::vector<HostSharedPtr> hosts;
+    hosts.reserve(layout.num_hosts_);
+    for (uint32_t i = 0; i < layout.num_hosts_; i++) {
+      envoy::api::v2::Metadata metadata;
+      Config::Metadata::mutableMetadataValue(metadata, Config::MetadataFilters::get().ENVOY_LB,
+                                             "version")
+          .set_string_value(i % 2 == 0 ? "even" : "odd");
+      envoy::api::v2::Locality locality;
+      locality.set_zone(std::to_string(i % layout.num_localities_));
+      const uint32_t weight = layout.skewed_weights_ && i % 10 == 0 ? 10 : 1;
+      const std::string url =
+          fmt::format("tcp://10.{}.{}.{}:80", i >> 16, (i >> 8) & 0xff, i & 0xff);
+      hosts.emplace_back(new HostImpl(info_, "", Network::Utility::resolveUrl(url), metadata,
+                                      weight, locality));
+    }
+    return hosts;
+  }
+
+  // Updates the host set, with all hosts healthy. Multiple localities are weighted 1, 2, 3, ...
+  void updateHosts(const std::vector<HostSharedPtr>& hosts, const Layout& layout,
+                   const std::vector<HostSharedPtr>& added,
+                   const std::vector<HostSharedPtr>& removed) {
+    HostVectorSharedPtr all_hosts(new std::vector<HostSharedPtr>(hosts));
+    HostListsSharedPtr hosts_per_locality(new std::vector<std::vector<HostSharedPtr>>());
+    std::shared_ptr<std::vector<uint32_t>> locality_weights;
+    if (layout.num_localities_ > 1) {
+      hosts_per_locality->resize(layout.num_localities_);
+      locality_weights = std::make_shared<std::vector<uint32_t>>();
+      for (uint32_t i = 0; i < layout.num_localities_; i++) {
+        locality_weights->push_back(i + 1);
+      }
+      for (const auto& host : hosts) {
+        (*hosts_per_locality)[std::stoul(host->locality().zone())].push_back(host);
+      }
+    }
+
+    host_set_->updateHosts(all_hosts, all_hosts, hosts_per_locality, hosts_per_locality,
+                           locality_weights, added, removed);
+  }
+
+  LoadBalancerPtr makeLoadBalancer(LoadBalancerType type, bool subset) {
+    if (subset) {
+      return LoadBalancerPtr{new SubsetLoadBalancer(type, *host_set_, nullptr, stats_, runtime_,
+                                                    random_, *subset_info_)};
+    }
+
+    switch (type) {
+    case LoadBalancerType::RoundRobin:
+      return LoadBalancerPtr{
+          new RoundRobinLoadBalancer(*host_set_, nullptr, stats_, runtime_, random_)};
+    case LoadBalancerType::LeastRequest:
+      return LoadBalancerPtr{
+          new LeastRequestLoadBalancer(*host_set_, nullptr, stats_, runtime_, random_)};
+    case LoadBalancerType::Random:
+      return LoadBalancerPtr{
+          new RandomLoadBalancer(*host_set_, nullptr, stats_, runtime_, random_)};
+    case LoadBalancerType::RingHash:
+      return LoadBalancerPtr{new RingHashLoadBalancer(*host_set_, stats_, runtime_, random_)};
+    case LoadBalancerType::Maglev:
+      return LoadBalancerPtr{new MaglevLoadBalancer(*host_set_, stats_, runtime_, random_)};
+    case LoadBalancerType::OriginalDst:
+      NOT_REACHED;
+    }
+
+    NOT_REACHED;
+  }
+
+  // The share of picks each host should get from a perfect load balancer of the given type.
+  static std::vector<double> expectedShares(LoadBalancerType type, bool subset,
+                                            const Layout& layout,
+                                            const std::vector<HostSharedPtr>& hosts) {
+    // The hashing load balancers ignore host and locality weights, and the random load balancer
+    // ignores host weights. Round robin and least request honour both.
+    const bool hashing = type == LoadBalancerType::RingHash || type == LoadBalancerType::Maglev;
+    const bool host_weights = !hashing && type != LoadBalancerType::Random;
+    const bool locality_weights = !hashing && layout.num_localities_ > 1;
+
+    std::vector<double> locality_totals(layout.num_localities_);
+    std::vector<double> weights(hosts.size());
+    for (size_t i = 0; i < hosts.size(); i++) {
+      // The subset load balancer benchmark only selects hosts with even indices.
+      if (subset && i % 2 != 0) {
+        continue;
+      }
+      weights[i] = host_weights ? hosts[i]->weight() : 1;
+      locality_totals[locality_weights ? i % layout.num_localities_ : 0] += weights[i];
+    }
+
+    double locality_weight_sum = 0;
+    for (uint32_t i = 0; i < layout.num_localities_; i++) {
+      locality_weight_sum += i + 1;
+    }
+
+    std::vector<double> shares(hosts.size());
+    for (size_t i = 0; i < hosts.size(); i++) {
+      if (locality_weights) {
+        const uint32_t locality = i % layout.num_localities_;
+        shares[i] =
+            (locality + 1) / locality_weight_sum * weights[i] / locality_totals[locality];
+      } else {
+        shares[i] = weights[i] / locality_totals[0];
+      }
+    }
+    return shares;
+  }
+
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_;
+  DeterministicRandomGenerator random_;
+  Runtime::NullLoaderImpl runtime_;
+  std::shared_ptr<NiceMock<MockClusterInfo>> info_{new NiceMock<MockClusterInfo>()};
+  std::unique_ptr<LoadBalancerSubsetInfo> subset_info_;
+  std::unique_ptr<HostSetImpl> host_set_;
+};
+
+TEST_F(DISABLED_LoadBalancerBenchmarkTest, RoundRobin) {
+  run(LoadBalancerType::RoundRobin, false);
+}
+
+TEST_F(DISABLED_LoadBalancerBenchmarkTest, LeastRequest) {
+  run(LoadBalancerType::LeastRequest, false);
+}
+
+TEST_F(DISABLED_LoadBalancerBenchmarkTest, Random) { run(LoadBalancerType::Random, false); }
+
+TEST_F(DISABLED_LoadBalancerBenchmarkTest, RingHash) { run(LoadBalancerType::RingHash, false); }
+
+TEST_F(DISABLED_LoadBalancerBenchmarkTest, Maglev) { run(LoadBalancerType::Maglev, false); }
+
+TEST_F(DISABLED_LoadBalancerBenchmarkTest, SubsetRoundRobin) {
+  run(LoadBalancerType::RoundRobin, true);
+}
+
+} // namespace
+} // namespace Upstream
+} // namespace Envoy
@@ -93,6 +93,152 @@ TEST_F(RoundRobinLoadBalancerTest, MaxUnhealthyPanic) {
   EXPECT_EQ(3UL, stats_.lb_healthy_panic_.value());
 }
 
+TEST_F(RoundRobinLoadBalancerTest, Weighted) {
+  init(false);
+  cluster_.healthy_hosts_ = {makeTestHost(cluster_.info_, "tcp://127.0.0.1:80", 1),
+                             makeTestHost(cluster_.info_, "tcp://127.0.0.1:81", 2)};
+  cluster_.hosts_ = cluster_.healthy_hosts_;
+  stats_.max_host_weight_.set(2UL);
+  cluster_.runCallbacks({}, {});
+
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+
+  // With weighting disabled hosts are picked in order. Runtime is re-read on host set updates.
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.weight_enabled", 1))
+      .WillRepeatedly(Return(0));
+  cluster_.runCallbacks({}, {});
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+}
+
+// Runtime values are cached by the load balancer rather than read on every pick.
+TEST_F(RoundRobinLoadBalancerTest, RuntimeCached) {
+  init(false);
+  cluster_.healthy_hosts_ = {makeTestHost(cluster_.info_, "tcp://127.0.0.1:80")};
+  cluster_.hosts_ = {cluster_.healthy_hosts_[0],
+                     makeTestHost(cluster_.info_, "tcp://127.0.0.1:81")};
+  cluster_.runCallbacks({}, {});
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
+      .WillOnce(Return(50));
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
+  }
+  EXPECT_EQ(0UL, stats_.lb_healthy_panic_.value());
+
+  // Health changes take effect right away.
+  cluster_.healthy_hosts_.clear();
+  lb_->chooseHost(nullptr);
+  EXPECT_EQ(1UL, stats_.lb_healthy_panic_.value());
+
+  // A host set update picks up the new threshold.
+  cluster_.healthy_hosts_ = {cluster_.hosts_[0]};
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
+      .WillOnce(Return(51));
+  cluster_.runCallbacks({}, {});
+  lb_->chooseHost(nullptr);
+  lb_->chooseHost(nullptr);
+  EXPECT_EQ(3UL, stats_.lb_healthy_panic_.value());
+}
+
+// A new runtime snapshot is picked up without a host set update.
+TEST_F(RoundRobinLoadBalancerTest, RuntimeReloaded) {
+  init(false);
+  cluster_.healthy_hosts_ = {makeTestHost(cluster_.info_, "tcp://127.0.0.1:80")};
+  cluster_.hosts_ = {cluster_.healthy_hosts_[0],
+                     makeTestHost(cluster_.info_, "tcp://127.0.0.1:81")};
+  cluster_.runCallbacks({}, {});
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
+      .WillOnce(Return(50))
+      .WillOnce(Return(51));
+  lb_->chooseHost(nullptr);
+  lb_->chooseHost(nullptr);
+  EXPECT_EQ(0UL, stats_.lb_healthy_panic_.value());
+
+  EXPECT_CALL(runtime_.snapshot_, generation()).WillRepeatedly(Return(1));
+  lb_->chooseHost(nullptr);
+  lb_->chooseHost(nullptr);
+  EXPECT_EQ(2UL, stats_.lb_healthy_panic_.value());
+}
+
+// Localities are picked by weight before a host is picked within the locality.
+TEST_F(RoundRobinLoadBalancerTest, LocalityWeighted) {
+  init(false);
+  HostSharedPtr host_a = makeTestHost(cluster_.info_, "tcp://127.0.0.1:80");
+  HostSharedPtr host_b = makeTestHost(cluster_.info_, "tcp://127.0.0.1:81");
+  cluster_.hosts_ = {host_a, host_b};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  cluster_.hosts_per_locality_ = {{host_a}, {host_b}};
+  cluster_.healthy_hosts_per_locality_ = cluster_.hosts_per_locality_;
+  cluster_.locality_weights_ = {1, 2};
+  cluster_.runCallbacks({}, {});
+
+  EXPECT_EQ(host_b, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_b, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_b, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_b, lb_->chooseHost(nullptr));
+
+  // A locality with weight 0 gets no traffic.
+  cluster_.locality_weights_ = {0, 2};
+  cluster_.runCallbacks({}, {});
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(host_b, lb_->chooseHost(nullptr));
+  }
+}
+
+// A locality's weight shrinks once too few of its hosts are healthy.
+TEST_F(RoundRobinLoadBalancerTest, LocalityWeightedDegraded) {
+  init(false);
+  HostSharedPtr host_a = makeTestHost(cluster_.info_, "tcp://127.0.0.1:80");
+  HostSharedPtr host_b = makeTestHost(cluster_.info_, "tcp://127.0.0.1:81");
+  std::vector<HostSharedPtr> locality_b = {
+      host_b, makeTestHost(cluster_.info_, "tcp://127.0.0.1:82"),
+      makeTestHost(cluster_.info_, "tcp://127.0.0.1:83"),
+      makeTestHost(cluster_.info_, "tcp://127.0.0.1:84")};
+  cluster_.hosts_ = {host_a, host_b, locality_b[1], locality_b[2], locality_b[3]};
+  cluster_.healthy_hosts_ = {host_a, host_b, locality_b[1], locality_b[2]};
+  cluster_.hosts_per_locality_ = {{host_a}, locality_b};
+  cluster_.healthy_hosts_per_locality_ = {{host_a}, {host_b, locality_b[1], locality_b[2]}};
+  cluster_.locality_weights_ = {1, 1};
+  cluster_.runCallbacks({}, {});
+
+  // 3 of 4 hosts healthy is within the overprovisioning factor, so localities alternate.
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(locality_b[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_b, lb_->chooseHost(nullptr));
+
+  // With 1 of 4 hosts healthy, the second locality's weight is 1 * 0.25 * 1.4 = 0.35.
+  cluster_.healthy_hosts_ = {host_a, host_b};
+  cluster_.healthy_hosts_per_locality_ = {{host_a}, {host_b}};
+  cluster_.runCallbacks({}, {});
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
+      .WillRepeatedly(Return(0));
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_b, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  EXPECT_EQ(host_b, lb_->chooseHost(nullptr));
+
+  // Without healthy hosts, a locality gets no traffic.
+  cluster_.healthy_hosts_ = {host_a};
+  cluster_.healthy_hosts_per_locality_ = {{host_a}, {}};
+  cluster_.runCallbacks({}, {});
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(host_a, lb_->chooseHost(nullptr));
+  }
+}
+
 TEST_F(RoundRobinLoadBalancerTest, ZoneAwareSmallCluster) {
   init(true);
   HostVectorSharedPtr hosts(
@@ -108,12 +254,12 @@ TEST_F(RoundRobinLoadBalancerTest, ZoneAwareSmallCluster) {
   cluster_.healthy_hosts_ = *hosts;
   cluster_.healthy_hosts_per_locality_ = *hosts_per_locality;
   local_cluster_hosts_->updateHosts(hosts, hosts, hosts_per_locality, hosts_per_locality,
-                                    empty_host_vector_, empty_host_vector_);
+                                    nullptr, empty_host_vector_, empty_host_vector_);
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(6));
 
@@ -128,7 +274,7 @@ TEST_F(RoundRobinLoadBalancerTest, ZoneAwareSmallCluster) {
       .WillRepeatedly(Return(1));
   // Trigger reload.
   local_cluster_hosts_->updateHosts(hosts, hosts, hosts_per_locality, hosts_per_locality,
-                                    empty_host_vector_, empty_host_vector_);
+                                    nullptr, empty_host_vector_, empty_host_vector_);
   EXPECT_EQ(cluster_.healthy_hosts_per_locality_[0][0], lb_->chooseHost(nullptr));
 }
 
@@ -150,13 +296,13 @@ TEST_F(RoundRobinLoadBalancerTest, NoZoneAwareDifferentZoneSize) {
   cluster_.hosts_ = *hosts;
   cluster_.healthy_hosts_per_locality_ = *upstream_hosts_per_locality;
   local_cluster_hosts_->updateHosts(hosts, hosts, local_hosts_per_locality,
-                                    local_hosts_per_locality, empty_host_vector_,
+                                    local_hosts_per_locality, nullptr, empty_host_vector_,
                                     empty_host_vector_);
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
 
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
   EXPECT_EQ(1U, stats_.lb_zone_number_differs_.value());
@@ -175,8 +321,8 @@ TEST_F(RoundRobinLoadBalancerTest, ZoneAwareRoutingLargeZoneSwitchOnOff) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(3));
 
@@ -184,7 +330,7 @@ TEST_F(RoundRobinLoadBalancerTest, ZoneAwareRoutingLargeZoneSwitchOnOff) {
   cluster_.hosts_ = *hosts;
   cluster_.healthy_hosts_per_locality_ = *hosts_per_locality;
   local_cluster_hosts_->updateHosts(hosts, hosts, hosts_per_locality, hosts_per_locality,
-                                    empty_host_vector_, empty_host_vector_);
+                                    nullptr, empty_host_vector_, empty_host_vector_);
 
   // There is only one host in the given zone for zone aware routing.
   EXPECT_EQ(cluster_.healthy_hosts_per_locality_[0][0], lb_->chooseHost(nullptr));
@@ -192,9 +338,10 @@ TEST_F(RoundRobinLoadBalancerTest, ZoneAwareRoutingLargeZoneSwitchOnOff) {
   EXPECT_EQ(cluster_.healthy_hosts_per_locality_[0][0], lb_->chooseHost(nullptr));
   EXPECT_EQ(2U, stats_.lb_zone_routing_all_directly_.value());
 
-  // Disable runtime global zone routing.
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(false));
+  // Disable runtime global zone routing. It is picked up once a new snapshot is loaded.
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(0));
+  EXPECT_CALL(runtime_.snapshot_, generation()).WillRepeatedly(Return(1));
   EXPECT_EQ(cluster_.healthy_hosts_[2], lb_->chooseHost(nullptr));
 }
 
@@ -225,8 +372,8 @@ TEST_F(RoundRobinLoadBalancerTest, ZoneAwareRoutingSmallZone) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(5));
 
@@ -234,7 +381,7 @@ TEST_F(RoundRobinLoadBalancerTest, ZoneAwareRoutingSmallZone) {
   cluster_.hosts_ = *upstream_hosts;
   cluster_.healthy_hosts_per_locality_ = *upstream_hosts_per_locality;
   local_cluster_hosts_->updateHosts(local_hosts, local_hosts, local_hosts_per_locality,
-                                    local_hosts_per_locality, empty_host_vector_,
+                                    local_hosts_per_locality, nullptr, empty_host_vector_,
                                     empty_host_vector_);
 
   // There is only one host in the given zone for zone aware routing.
@@ -264,8 +411,8 @@ TEST_F(RoundRobinLoadBalancerTest, LowPrecisionForDistribution) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(1));
 
@@ -303,7 +450,7 @@ TEST_F(RoundRobinLoadBalancerTest, LowPrecisionForDistribution) {
 
   // To trigger update callback.
   local_cluster_hosts_->updateHosts(local_hosts, local_hosts, local_hosts_per_locality,
-                                    local_hosts_per_locality, empty_host_vector_,
+                                    local_hosts_per_locality, nullptr, empty_host_vector_,
                                     empty_host_vector_);
 
   // Force request out of small zone and to randomly select zone.
@@ -323,7 +470,7 @@ TEST_F(RoundRobinLoadBalancerTest, NoZoneAwareRoutingOneZone) {
   cluster_.hosts_ = *hosts;
   cluster_.healthy_hosts_per_locality_ = *hosts_per_locality;
   local_cluster_hosts_->updateHosts(hosts, hosts, hosts_per_locality, hosts_per_locality,
-                                    empty_host_vector_, empty_host_vector_);
+                                    nullptr, empty_host_vector_, empty_host_vector_);
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
 }
 
@@ -341,7 +488,7 @@ TEST_F(RoundRobinLoadBalancerTest, NoZoneAwareRoutingNotHealthy) {
   cluster_.hosts_ = *hosts;
   cluster_.healthy_hosts_per_locality_ = *hosts_per_locality;
   local_cluster_hosts_->updateHosts(hosts, hosts, hosts_per_locality, hosts_per_locality,
-                                    empty_host_vector_, empty_host_vector_);
+                                    nullptr, empty_host_vector_, empty_host_vector_);
 
   // local zone has no healthy hosts, take from the all healthy hosts.
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
@@ -364,8 +511,9 @@ TEST_F(RoundRobinLoadBalancerTest, NoZoneAwareRoutingLocalEmpty) {
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillOnce(Return(50))
       .WillOnce(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillOnce(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillOnce(Return(100))
+      .WillOnce(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillOnce(Return(1));
 
@@ -373,7 +521,7 @@ TEST_F(RoundRobinLoadBalancerTest, NoZoneAwareRoutingLocalEmpty) {
   cluster_.hosts_ = *upstream_hosts;
   cluster_.healthy_hosts_per_locality_ = *upstream_hosts_per_locality;
   local_cluster_hosts_->updateHosts(local_hosts, local_hosts, local_hosts_per_locality,
-                                    local_hosts_per_locality, empty_host_vector_,
+                                    local_hosts_per_locality, nullptr, empty_host_vector_,
                                     empty_host_vector_);
 
   // Local cluster is not OK, we'll do regular routing.
@@ -399,6 +547,7 @@ TEST_F(LeastRequestLoadBalancerTest, NoHosts) { EXPECT_EQ(nullptr, lb_.chooseHos
 TEST_F(LeastRequestLoadBalancerTest, SingleHost) {
   cluster_.healthy_hosts_ = {makeTestHost(cluster_.info_, "tcp://127.0.0.1:80")};
   cluster_.hosts_ = cluster_.healthy_hosts_;
+  cluster_.runCallbacks({}, {});
 
   // Host weight is 1.
   {
@@ -409,7 +558,7 @@ TEST_F(LeastRequestLoadBalancerTest, SingleHost) {
 
   // Host weight is 100.
   {
-    EXPECT_CALL(random_, random()).WillOnce(Return(2));
+    EXPECT_CALL(random_, random()).Times(0);
     stats_.max_host_weight_.set(100UL);
     EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
   }
@@ -417,17 +566,17 @@ TEST_F(LeastRequestLoadBalancerTest, SingleHost) {
   std::vector<HostSharedPtr> empty;
   {
     cluster_.runCallbacks(empty, empty);
-    EXPECT_CALL(random_, random()).WillOnce(Return(2));
+    EXPECT_CALL(random_, random()).Times(0);
     EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
   }
 
   {
     std::vector<HostSharedPtr> remove_hosts;
     remove_hosts.push_back(cluster_.hosts_[0]);
-    cluster_.runCallbacks(empty, remove_hosts);
-    EXPECT_CALL(random_, random()).Times(0);
     cluster_.healthy_hosts_.clear();
     cluster_.hosts_.clear();
+    cluster_.runCallbacks(empty, remove_hosts);
+    EXPECT_CALL(random_, random()).Times(0);
     EXPECT_EQ(nullptr, lb_.chooseHost(nullptr));
   }
 }
@@ -479,43 +628,29 @@ TEST_F(LeastRequestLoadBalancerTest, WeightImbalance) {
   stats_.max_host_weight_.set(3UL);
 
   cluster_.hosts_ = cluster_.healthy_hosts_;
+  cluster_.runCallbacks({}, {});
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.weight_enabled", 1))
       .WillRepeatedly(Return(1));
-  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
-      .WillRepeatedly(Return(50));
-
-  // As max weight higher then 1 we do random host pick and keep it for weight requests.
-  EXPECT_CALL(random_, random()).WillOnce(Return(1));
-  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 
-  // Same host stays as we have to hit it 3 times.
-  cluster_.healthy_hosts_[0]->stats().rq_active_.set(2);
+  // As max weight is higher than 1, hosts are picked by weight, interleaved as evenly as
+  // possible.
+  cluster_.healthy_hosts_[0]->stats().rq_active_.set(0);
   cluster_.healthy_hosts_[1]->stats().rq_active_.set(1);
   EXPECT_CALL(random_, random()).Times(0);
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
-
-  // Same host stays as we have to hit it 3 times.
-  EXPECT_CALL(random_, random()).Times(0);
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
-
-  // Get random host after previous one was selected 3 times in a row.
-  EXPECT_CALL(random_, random()).WillOnce(Return(2));
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
-
-  // Select second host again.
-  EXPECT_CALL(random_, random()).WillOnce(Return(1));
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 
   // Set weight to 1, we will switch to the two random hosts mode.
   stats_.max_host_weight_.set(1UL);
   EXPECT_CALL(random_, random()).WillOnce(Return(2)).WillOnce(Return(3));
-  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
-
-  EXPECT_CALL(random_, random()).WillOnce(Return(2)).WillOnce(Return(2));
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+
+  EXPECT_CALL(random_, random()).WillOnce(Return(3)).WillOnce(Return(3));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 }
 
 TEST_F(LeastRequestLoadBalancerTest, WeightImbalanceCallbacks) {
@@ -524,11 +659,12 @@ TEST_F(LeastRequestLoadBalancerTest, WeightImbalanceCallbacks) {
   stats_.max_host_weight_.set(3UL);
 
   cluster_.hosts_ = cluster_.healthy_hosts_;
+  cluster_.runCallbacks({}, {});
 
-  EXPECT_CALL(random_, random()).WillOnce(Return(1));
+  EXPECT_CALL(random_, random()).Times(0);
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 
-  // Same host stays as we have to hit it 3 times, but we remove it and fire callback.
+  // Remove the heavier host and fire callback, after which it is no longer picked.
   std::vector<HostSharedPtr> empty;
   std::vector<HostSharedPtr> hosts_removed;
   hosts_removed.push_back(cluster_.hosts_[1]);
@@ -536,7 +672,66 @@ TEST_F(LeastRequestLoadBalancerTest, WeightImbalanceCallbacks) {
   cluster_.healthy_hosts_.erase(cluster_.healthy_hosts_.begin() + 1);
   cluster_.runCallbacks(empty, hosts_removed);
 
-  EXPECT_CALL(random_, random()).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+}
+
+TEST_F(LeastRequestLoadBalancerTest, WeightedP2c) {
+  cluster_.healthy_hosts_ = {makeTestHost(cluster_.info_, "tcp://127.0.0.1:80", 1),
+                             makeTestHost(cluster_.info_, "tcp://127.0.0.1:81", 3)};
+  stats_.max_host_weight_.set(3UL);
+  cluster_.hosts_ = cluster_.healthy_hosts_;
+  cluster_.runCallbacks({}, {});
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.least_request.weighted_p2c", 0))
+      .WillRepeatedly(Return(1));
+
+  // (0 + 1) / 1 > (1 + 1) / 3, so the heavier host wins despite having more active requests.
+  cluster_.healthy_hosts_[0]->stats().rq_active_.set(0);
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(1);
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
+
+  // (0 + 1) / 1 < (3 + 1) / 3.
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(3);
+  EXPECT_CALL(random_, random()).WillOnce(Return(1)).WillOnce(Return(0));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+
+  // Latency is ignored unless enabled.
+  cluster_.healthy_hosts_[0]->recordResponseTime(std::chrono::microseconds(10000),
+                                                 std::chrono::steady_clock::now());
+  cluster_.healthy_hosts_[1]->recordResponseTime(std::chrono::microseconds(1000),
+                                                 std::chrono::steady_clock::now());
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+}
+
+TEST_F(LeastRequestLoadBalancerTest, WeightedP2cLatencyAware) {
+  cluster_.healthy_hosts_ = {makeTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
+                             makeTestHost(cluster_.info_, "tcp://127.0.0.1:81")};
+  cluster_.hosts_ = cluster_.healthy_hosts_;
+  cluster_.runCallbacks({}, {});
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.least_request.weighted_p2c", 0))
+      .WillRepeatedly(Return(1));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.least_request.latency_aware", 0))
+      .WillRepeatedly(Return(1));
+
+  // Without a latency average for both hosts only active requests are compared.
+  cluster_.healthy_hosts_[0]->stats().rq_active_.set(1);
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(2);
+  cluster_.healthy_hosts_[0]->recordResponseTime(std::chrono::microseconds(10000),
+                                                 std::chrono::steady_clock::now());
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+
+  // 2 * 10000 > 3 * 1000, so the faster host wins despite having more active requests.
+  cluster_.healthy_hosts_[1]->recordResponseTime(std::chrono::microseconds(1000),
+                                                 std::chrono::steady_clock::now());
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
+
+  // With much more load the slower host wins again.
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(29);
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
 }
 
@@ -38,8 +38,8 @@ public:
   DISABLED_SimulationTest() : stats_(ClusterInfoImpl::generateStats(stats_store_)) {
     ON_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50U))
         .WillByDefault(Return(50U));
-    ON_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-        .WillByDefault(Return(true));
+    ON_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+        .WillByDefault(Return(100));
     ON_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
         .WillByDefault(Return(6));
   }
@@ -96,7 +96,7 @@ public:
         per_zone_local->push_back((*local_per_zone_hosts)[zone]);
       }
       local_host_set_->updateHosts(originating_hosts, originating_hosts, per_zone_local,
-                                   per_zone_local, empty_vector_, empty_vector_);
+                                   per_zone_local, nullptr, empty_vector_, empty_vector_);
 
       HostConstSharedPtr selected = lb.chooseHost(nullptr);
       hits[selected->address()->asString()]++;
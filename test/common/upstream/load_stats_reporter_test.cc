@@ -1,6 +1,9 @@
+#include "common/network/utility.h"
 #include "common/stats/stats_impl.h"
 #include "common/upstream/load_stats_reporter.h"
+#include "common/upstream/upstream_impl.h"
 
+#include "test/common/upstream/utility.h"
 #include "test/mocks/event/mocks.h"
 #include "test/mocks/grpc/mocks.h"
 #include "test/mocks/upstream/mocks.h"
@@ -101,5 +104,52 @@ TEST_F(LoadStatsReporterTest, RemoteStreamClose) {
   retry_timer_cb_();
 }
 
+// Validate that only localities with traffic since the last report are reported.
+TEST_F(LoadStatsReporterTest, IdleLocalitiesSkipped) {
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage({});
+  createLoadStatsReporter();
+
+  NiceMock<MockCluster> cluster;
+  envoy::api::v2::Locality winter;
+  winter.set_sub_zone("winter");
+  envoy::api::v2::Locality dragon;
+  dragon.set_sub_zone("dragon");
+  HostSharedPtr winter_host{new HostImpl(cluster.info_, "",
+                                         Network::Utility::resolveUrl("tcp://127.0.0.1:80"),
+                                         envoy::api::v2::Metadata::default_instance(), 1, winter)};
+  HostSharedPtr dragon_host{new HostImpl(cluster.info_, "",
+                                         Network::Utility::resolveUrl("tcp://127.0.0.1:81"),
+                                         envoy::api::v2::Metadata::default_instance(), 1, dragon)};
+  cluster.hosts_ = {winter_host, dragon_host};
+  cluster.hosts_per_locality_ = {{winter_host}, {dragon_host}};
+  ON_CALL(cm_, clusters())
+      .WillByDefault(Return(ClusterManager::ClusterInfoMap{{"foo", cluster}}));
+
+  deliverLoadStatsResponse({"foo"});
+  winter_host->stats().rq_success_.inc();
+  winter_host->stats().rq_success_.inc();
+  winter_host->stats().rq_error_.inc();
+
+  {
+    envoy::api::v2::ClusterStats expected_cluster_stats;
+    expected_cluster_stats.set_cluster_name("foo");
+    auto* locality_stats = expected_cluster_stats.add_upstream_locality_stats();
+    locality_stats->mutable_locality()->MergeFrom(winter);
+    locality_stats->set_total_successful_requests(2);
+    locality_stats->set_total_error_requests(1);
+    expectSendMessage({expected_cluster_stats});
+    response_timer_cb_();
+  }
+
+  // Counts are reset by each report, so an idle interval reports no localities.
+  {
+    envoy::api::v2::ClusterStats expected_cluster_stats;
+    expected_cluster_stats.set_cluster_name("foo");
+    expectSendMessage({expected_cluster_stats});
+    response_timer_cb_();
+  }
+}
+
 } // namespace Upstream
 } // namespace Envoy
@@ -0,0 +1,161 @@
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/upstream/maglev_lb.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/common/upstream/utility.h"
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Upstream {
+
+class TestLoadBalancerContext : public LoadBalancerContext {
+public:
+  TestLoadBalancerContext(uint64_t hash_key) : hash_key_(hash_key) {}
+
+  // Upstream::LoadBalancerContext
+  Optional<uint64_t> computeHashKey() override { return hash_key_; }
+  const Router::MetadataMatchCriteria* metadataMatchCriteria() const override { return nullptr; }
+  const Network::Connection* downstreamConnection() const override { return nullptr; }
+
+  Optional<uint64_t> hash_key_;
+};
+
+class MaglevLoadBalancerTest : public testing::Test {
+public:
+  MaglevLoadBalancerTest() : stats_(ClusterInfoImpl::generateStats(stats_store_)) {}
+
+  std::vector<HostSharedPtr> makeHosts(uint32_t num_hosts) {
+    std::vector<HostSharedPtr> hosts;
+    for (uint32_t i = 0; i < num_hosts; i++) {
+      hosts.push_back(makeTestHost(cluster_.info_, fmt::format("tcp://127.0.0.1:{}", 80 + i)));
+    }
+    return hosts;
+  }
+
+  NiceMock<MockCluster> cluster_;
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<Runtime::MockRandomGenerator> random_;
+  MaglevLoadBalancer lb_{cluster_, stats_, runtime_, random_};
+};
+
+TEST_F(MaglevLoadBalancerTest, NoHost) { EXPECT_EQ(nullptr, lb_.chooseHost(nullptr)); };
+
+// The table is built as described in the Maglev paper, so hosts have shares that differ by at most
+// one slot.
+TEST_F(MaglevLoadBalancerTest, Table) {
+  const std::vector<HostSharedPtr> hosts = makeHosts(4);
+  MaglevTable table(hosts, 17);
+
+  const std::vector<uint32_t> expected = {1, 1, 1, 0, 3, 3, 2, 3, 2, 2, 2, 0, 0, 1, 0, 3, 0};
+  for (uint64_t i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(hosts[expected[i]], table.chooseHost(hosts, i));
+    EXPECT_EQ(hosts[expected[i]], table.chooseHost(hosts, i + 17));
+  }
+
+  EXPECT_EQ(nullptr, MaglevTable({}, 17).chooseHost({}, 0));
+}
+
+// Removing a host only moves the slots owned by that host, plus a small number of others.
+TEST_F(MaglevLoadBalancerTest, MinimalDisruption) {
+  const std::vector<HostSharedPtr> hosts = makeHosts(10);
+  MaglevTable table(hosts, MaglevTable::DefaultTableSize);
+
+  const HostSharedPtr removed = hosts[3];
+  std::vector<HostSharedPtr> new_hosts = hosts;
+  new_hosts.erase(new_hosts.begin() + 3);
+  MaglevTable new_table(new_hosts, MaglevTable::DefaultTableSize);
+
+  uint64_t slots = 0;
+  uint64_t moved = 0;
+  for (uint64_t i = 0; i < MaglevTable::DefaultTableSize; i++) {
+    EXPECT_NE(removed, new_table.chooseHost(new_hosts, i));
+    if (table.chooseHost(hosts, i) != removed) {
+      slots++;
+      if (table.chooseHost(hosts, i) != new_table.chooseHost(new_hosts, i)) {
+        moved++;
+      }
+    }
+  }
+
+  EXPECT_LT(moved * 100, slots);
+}
+
+TEST_F(MaglevLoadBalancerTest, Basic) {
+  cluster_.hosts_ = makeHosts(4);
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  cluster_.runCallbacks({}, {});
+
+  MaglevTable table(cluster_.hosts_);
+  const std::vector<uint64_t> hashes = {0, 1, 1000, 65537, std::numeric_limits<uint64_t>::max()};
+  for (uint64_t hash : hashes) {
+    TestLoadBalancerContext context(hash);
+    EXPECT_EQ(table.chooseHost(cluster_.hosts_, hash), lb_.chooseHost(&context));
+  }
+
+  // Without a hash key a random host is chosen.
+  EXPECT_CALL(random_, random()).WillOnce(Return(3));
+  EXPECT_EQ(table.chooseHost(cluster_.hosts_, 3), lb_.chooseHost(nullptr));
+  EXPECT_EQ(0UL, stats_.lb_healthy_panic_.value());
+
+  // In panic mode the table for all hosts is used.
+  cluster_.healthy_hosts_.clear();
+  cluster_.runCallbacks({}, {});
+  {
+    TestLoadBalancerContext context(0);
+    EXPECT_EQ(table.chooseHost(cluster_.hosts_, 0), lb_.chooseHost(&context));
+  }
+  EXPECT_EQ(1UL, stats_.lb_healthy_panic_.value());
+}
+
+TEST_F(MaglevLoadBalancerTest, HealthyHosts) {
+  cluster_.hosts_ = makeHosts(4);
+  cluster_.healthy_hosts_ = {cluster_.hosts_[0], cluster_.hosts_[1], cluster_.hosts_[2]};
+  cluster_.runCallbacks({}, {});
+
+  MaglevTable table(cluster_.healthy_hosts_);
+  for (uint64_t hash = 0; hash < 100; hash++) {
+    TestLoadBalancerContext context(hash);
+    HostConstSharedPtr host = lb_.chooseHost(&context);
+    EXPECT_EQ(table.chooseHost(cluster_.healthy_hosts_, hash), host);
+    EXPECT_NE(cluster_.hosts_[3], host);
+  }
+}
+
+// Tables built outside of the load balancer are used as is and swapped in by the owner.
+TEST_F(MaglevLoadBalancerTest, SharedTables) {
+  MaglevLoadBalancer::TablesConstSharedPtr tables;
+  MaglevLoadBalancer lb(cluster_, stats_, runtime_, random_, tables);
+  EXPECT_EQ(nullptr, lb.chooseHost(nullptr));
+
+  cluster_.hosts_ = makeHosts(2);
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  cluster_.runCallbacks({}, {});
+
+  // The load balancer does not build its own tables.
+  EXPECT_EQ(nullptr, lb.chooseHost(nullptr));
+
+  tables =
+      std::make_shared<const MaglevLoadBalancer::Tables>(cluster_.hosts_, cluster_.healthy_hosts_);
+  for (uint64_t hash = 0; hash < 10; hash++) {
+    TestLoadBalancerContext context(hash);
+    EXPECT_EQ(tables->healthy_hosts_table_.chooseHost(cluster_.healthy_hosts_, hash),
+              lb.chooseHost(&context));
+    EXPECT_NE(nullptr, lb.chooseHost(&context));
+  }
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -409,8 +409,8 @@ TEST_F(OriginalDstClusterTest, MultipleClusters) {
     HostVectorSharedPtr healthy_hosts(new std::vector<HostSharedPtr>(cluster_->hosts()));
     const HostListsConstSharedPtr empty_host_lists{new std::vector<std::vector<HostSharedPtr>>()};
 
-    second.updateHosts(new_hosts, healthy_hosts, empty_host_lists, empty_host_lists, added,
-                       removed);
+    second.updateHosts(new_hosts, healthy_hosts, empty_host_lists, empty_host_lists, nullptr,
+                       added, removed);
   });
 
   EXPECT_CALL(membership_updated_, ready());
@@ -1,7 +1,9 @@
 #include <chrono>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "envoy/common/optional.h"
@@ -319,6 +321,61 @@ TEST_F(OutlierDetectorImplTest, BasicFlowSuccessRate) {
   EXPECT_EQ(-1, detector->successRateEjectionThreshold());
 }
 
+TEST_F(OutlierDetectorImplTest, BasicFlowLatency) {
+  ON_CALL(runtime_.snapshot_, featureEnabled("outlier_detection.latency_ejection", 0))
+      .WillByDefault(Return(true));
+  ON_CALL(runtime_.snapshot_, featureEnabled("outlier_detection.enforcing_latency", 100))
+      .WillByDefault(Return(true));
+  EXPECT_CALL(cluster_, addMemberUpdateCb(_));
+  addHosts({
+      "tcp://127.0.0.1:80",
+      "tcp://127.0.0.1:81",
+      "tcp://127.0.0.1:82",
+      "tcp://127.0.0.1:83",
+      "tcp://127.0.0.1:84",
+  });
+
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  std::shared_ptr<DetectorImpl> detector(DetectorImpl::create(
+      cluster_, empty_outlier_detection_, dispatcher_, runtime_, time_source_, event_logger_));
+  detector->addChangedStateCb([&](HostSharedPtr host) -> void { checker_.check(host); });
+
+  // One slow host among fast ones.
+  for (const HostSharedPtr& host : cluster_.hosts_) {
+    for (int i = 0; i < 100; i++) {
+      host->outlierDetector().putResponseTime(std::chrono::milliseconds(10));
+    }
+  }
+  for (int i = 0; i < 100; i++) {
+    cluster_.hosts_[4]->outlierDetector().putResponseTime(std::chrono::milliseconds(500));
+  }
+
+  EXPECT_CALL(time_source_, currentTime())
+      .Times(2)
+      .WillRepeatedly(Return(MonotonicTime(std::chrono::milliseconds(10000))));
+  EXPECT_CALL(checker_, check(cluster_.hosts_[4]));
+  EXPECT_CALL(*event_logger_,
+              logEject(std::static_pointer_cast<const HostDescription>(cluster_.hosts_[4]), _,
+                       EjectionType::Latency, true));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  interval_timer_->callback_();
+  EXPECT_TRUE(cluster_.hosts_[4]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  EXPECT_EQ(1UL,
+            cluster_.info_->stats_store_.counter("outlier_detection.ejections_latency").value());
+
+  // Without enough response times in the next interval there are no more ejections.
+  for (int i = 0; i < 10; i++) {
+    cluster_.hosts_[3]->outlierDetector().putResponseTime(std::chrono::milliseconds(500));
+  }
+  EXPECT_CALL(time_source_, currentTime())
+      .WillOnce(Return(MonotonicTime(std::chrono::milliseconds(20000))));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  interval_timer_->callback_();
+  EXPECT_FALSE(cluster_.hosts_[3]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  EXPECT_EQ(1UL,
+            cluster_.info_->stats_store_.counter("outlier_detection.ejections_latency").value());
+}
+
 TEST_F(OutlierDetectorImplTest, RemoveWhileEjected) {
   EXPECT_CALL(cluster_, addMemberUpdateCb(_));
   addHosts({"tcp://127.0.0.1:80"});
@@ -581,6 +638,60 @@ TEST(OutlierDetectionEventLoggerImplTest, All) {
   Json::Factory::loadFromString(log4);
 }
 
+TEST(OutlierLatencyAccumulator, Buckets) {
+  EXPECT_EQ(0UL, LatencyAccumulator::bucketIndex(0));
+  for (uint64_t time_ms : {1, 2, 3, 4, 5, 6, 7, 8, 12, 100, 1000, 65535}) {
+    const size_t index = LatencyAccumulator::bucketIndex(time_ms);
+    EXPECT_LE(LatencyAccumulator::bucketLowerBound(index), time_ms);
+    EXPECT_GT(LatencyAccumulator::bucketLowerBound(index + 1), time_ms);
+  }
+  EXPECT_EQ(LatencyAccumulator::NumBuckets - 1,
+            LatencyAccumulator::bucketIndex(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(OutlierLatencyAccumulator, P99) {
+  LatencyAccumulator accumulator;
+  for (int i = 0; i < 99; i++) {
+    accumulator.putResponseTime(std::chrono::milliseconds(4));
+  }
+  accumulator.putResponseTime(std::chrono::milliseconds(1000));
+  EXPECT_FALSE(accumulator.getP99(1).valid());
+
+  accumulator.updateCurrentWriter();
+  EXPECT_EQ(4UL, accumulator.getP99(100).value());
+  EXPECT_FALSE(accumulator.getP99(101).valid());
+
+  accumulator.putResponseTime(std::chrono::milliseconds(4));
+  accumulator.putResponseTime(std::chrono::milliseconds(1000));
+  accumulator.updateCurrentWriter();
+  EXPECT_EQ(LatencyAccumulator::bucketLowerBound(LatencyAccumulator::bucketIndex(1000)),
+            accumulator.getP99(2).value());
+}
+
+// Response times recorded on different threads are merged when the window ends.
+TEST(OutlierLatencyAccumulator, MultipleThreads) {
+  LatencyAccumulator accumulator;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 5; i++) {
+    threads.emplace_back([&accumulator, i]() -> void {
+      for (int j = 0; j < 20; j++) {
+        accumulator.putResponseTime(std::chrono::milliseconds(i == 0 && j == 0 ? 1000 : 4));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  accumulator.updateCurrentWriter();
+  EXPECT_EQ(4UL, accumulator.getP99(100).value());
+  EXPECT_FALSE(accumulator.getP99(101).valid());
+
+  // The shards are cleared for the next window.
+  accumulator.updateCurrentWriter();
+  EXPECT_FALSE(accumulator.getP99(1).valid());
+}
+
 TEST(OutlierUtility, SRThreshold) {
   std::vector<HostSuccessRatePair> data = {
       HostSuccessRatePair(nullptr, 50),  HostSuccessRatePair(nullptr, 100),
@@ -1,3 +1,9 @@
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "common/stats/stats_impl.h"
 #include "common/upstream/resource_manager_impl.h"
 
 #include "test/mocks/runtime/mocks.h"
@@ -13,8 +19,9 @@ namespace Upstream {
 
 TEST(ResourceManagerImplTest, RuntimeResourceManager) {
   NiceMock<Runtime::MockLoader> runtime;
+  Stats::IsolatedStoreImpl stats;
   ResourceManagerImpl resource_manager(
-      runtime, "circuit_breakers.runtime_resource_manager_test.default.", 0, 0, 0, 1);
+      runtime, "circuit_breakers.runtime_resource_manager_test.default.", stats, "", 0, 0, 0, 1);
 
   EXPECT_CALL(
       runtime.snapshot_,
@@ -45,6 +52,157 @@ TEST(ResourceManagerImplTest, RuntimeResourceManager) {
       .WillRepeatedly(Return(0U));
   EXPECT_EQ(0U, resource_manager.retries().max());
   EXPECT_FALSE(resource_manager.retries().canCreate());
+  EXPECT_FALSE(resource_manager.retryBudgetActive());
+}
+
+TEST(ResourceManagerImplTest, RetryBudget) {
+  NiceMock<Runtime::MockLoader> runtime;
+  Stats::IsolatedStoreImpl stats;
+  ResourceManagerImpl resource_manager(runtime, "circuit_breakers.retry_budget_test.default.",
+                                       stats, "", 1024, 1024, 1024, 1);
+
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.retry_budget_test.default.retry_budget.budget_percent", 0U))
+      .WillByDefault(Return(20U));
+  ON_CALL(runtime.snapshot_,
+          getInteger(
+              "circuit_breakers.retry_budget_test.default.retry_budget.min_retry_concurrency", 3U))
+      .WillByDefault(Return(3U));
+  EXPECT_TRUE(resource_manager.retryBudgetActive());
+
+  // With no outstanding requests the minimum retry concurrency applies.
+  EXPECT_EQ(3U, resource_manager.retries().max());
+
+  // 20% of 20 outstanding requests.
+  for (uint64_t i = 0; i < 10; i++) {
+    resource_manager.requests().inc();
+    resource_manager.pendingRequests().inc();
+  }
+  EXPECT_EQ(4U, resource_manager.retries().max());
+  for (uint64_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(resource_manager.retries().canCreate());
+    resource_manager.retries().inc();
+  }
+  EXPECT_FALSE(resource_manager.retries().canCreate());
+
+  // The budget shrinks as outstanding requests drain.
+  for (uint64_t i = 0; i < 10; i++) {
+    resource_manager.requests().dec();
+    resource_manager.pendingRequests().dec();
+  }
+  EXPECT_EQ(3U, resource_manager.retries().max());
+  EXPECT_FALSE(resource_manager.retries().canCreate());
+  for (uint64_t i = 0; i < 4; i++) {
+    resource_manager.retries().dec();
+  }
+  EXPECT_TRUE(resource_manager.retries().canCreate());
+}
+
+TEST(ResourceManagerImplTest, AdaptiveConcurrency) {
+  NiceMock<Runtime::MockLoader> runtime;
+  Stats::IsolatedStoreImpl stats;
+  ResourceManagerImpl resource_manager(runtime, "circuit_breakers.adaptive_test.default.", stats,
+                                       "circuit_breakers.default.", 1024, 1024, 100, 3);
+  Resource& adaptive_requests = resource_manager.adaptiveRequests();
+  Stats::Gauge& limit = stats.gauge("circuit_breakers.default.adaptive_concurrency.limit");
+  auto record_window = [&](uint64_t rtt_us) {
+    for (uint64_t i = 0; i < 10; i++) {
+      resource_manager.recordRequestRtt(std::chrono::microseconds(rtt_us));
+    }
+  };
+
+  // Disabled by default.
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), adaptive_requests.max());
+  EXPECT_TRUE(adaptive_requests.canCreate());
+  record_window(1000);
+  EXPECT_EQ(0U, limit.value());
+
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.adaptive_test.default.adaptive_concurrency.enabled", 0))
+      .WillByDefault(Return(1));
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.adaptive_test.default.adaptive_concurrency.window_samples",
+                     100))
+      .WillByDefault(Return(10));
+
+  // The limit starts at the static max_requests threshold, and the first window only measures the
+  // minimum round trip time.
+  EXPECT_EQ(100U, adaptive_requests.max());
+  record_window(1000);
+  EXPECT_EQ(100U, limit.value());
+  EXPECT_EQ(1000U,
+            stats.gauge("circuit_breakers.default.adaptive_concurrency.min_rtt_us").value());
+
+  // Queueing upstream shrinks the limit: 100 * 0.5 + 10, then 60 * 0.5 + 7.7.
+  record_window(4000);
+  EXPECT_EQ(60U, adaptive_requests.max());
+  EXPECT_EQ(4000U,
+            stats.gauge("circuit_breakers.default.adaptive_concurrency.sample_rtt_us").value());
+  record_window(4000);
+  EXPECT_EQ(37U, adaptive_requests.max());
+
+  // Once latency recovers the limit only grows while it is at least half used.
+  record_window(1000);
+  EXPECT_EQ(37U, adaptive_requests.max());
+  for (uint64_t i = 0; i < 20; i++) {
+    adaptive_requests.inc();
+  }
+  record_window(1000);
+  EXPECT_EQ(43U, adaptive_requests.max());
+  EXPECT_EQ(43U, limit.value());
+
+  for (uint64_t i = 20; i < 43; i++) {
+    EXPECT_TRUE(adaptive_requests.canCreate());
+    adaptive_requests.inc();
+  }
+  EXPECT_FALSE(adaptive_requests.canCreate());
+  for (uint64_t i = 0; i < 43; i++) {
+    adaptive_requests.dec();
+  }
+
+  // The limit is kept within min_limit.
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.adaptive_test.default.adaptive_concurrency.min_limit", 3))
+      .WillByDefault(Return(40));
+  record_window(100000);
+  EXPECT_EQ(40U, adaptive_requests.max());
+
+  // Other resources are not affected.
+  EXPECT_EQ(100U, resource_manager.requests().max());
+}
+
+// Samples recorded concurrently from several threads still close complete windows.
+TEST(ResourceManagerImplTest, AdaptiveConcurrencyMultipleThreads) {
+  NiceMock<Runtime::MockLoader> runtime;
+  Stats::IsolatedStoreImpl stats;
+  ResourceManagerImpl resource_manager(runtime, "circuit_breakers.adaptive_test.default.", stats,
+                                       "circuit_breakers.default.", 1024, 1024, 100, 3);
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.adaptive_test.default.adaptive_concurrency.enabled", 0))
+      .WillByDefault(Return(1));
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.adaptive_test.default.adaptive_concurrency.window_samples",
+                     100))
+      .WillByDefault(Return(10));
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&resource_manager]() -> void {
+      for (int j = 0; j < 250; j++) {
+        resource_manager.recordRequestRtt(std::chrono::microseconds(1000));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(1000U,
+            stats.gauge("circuit_breakers.default.adaptive_concurrency.min_rtt_us").value());
+  EXPECT_EQ(1000U,
+            stats.gauge("circuit_breakers.default.adaptive_concurrency.sample_rtt_us").value());
+  EXPECT_EQ(100U, stats.gauge("circuit_breakers.default.adaptive_concurrency.limit").value());
+  EXPECT_EQ(100U, resource_manager.adaptiveRequests().max());
 }
 
 } // namespace Upstream
@@ -3,6 +3,7 @@
 
 #include "envoy/router/router.h"
 
+#include "common/common/hash.h"
 #include "common/network/utility.h"
 #include "common/upstream/ring_hash_lb.h"
 #include "common/upstream/upstream_impl.h"
@@ -60,39 +61,37 @@ TEST_F(RingHashLoadBalancerTest, Basic) {
       .WillByDefault(Return(12));
   cluster_.runCallbacks({}, {});
 
-  // This is the hash ring built using the default hash (probably murmur2) on GCC 5.4.
-  // TODO(mattklein123): Compile in and use murmur3 or city so we know exactly
-  // what we are going to get.
-  // ring hash: host=127.0.0.1:85 hash=1358027074129602068
-  // ring hash: host=127.0.0.1:83 hash=4361834613929391114
-  // ring hash: host=127.0.0.1:84 hash=7224494972555149682
-  // ring hash: host=127.0.0.1:81 hash=7701421856454313576
-  // ring hash: host=127.0.0.1:82 hash=8649315368077433379
-  // ring hash: host=127.0.0.1:84 hash=8739448859063030639
-  // ring hash: host=127.0.0.1:81 hash=9887544217113020895
-  // ring hash: host=127.0.0.1:82 hash=10150910876324007731
-  // ring hash: host=127.0.0.1:83 hash=15168472011420622455
-  // ring hash: host=127.0.0.1:80 hash=15427156902705414897
-  // ring hash: host=127.0.0.1:85 hash=16375050414328759093
-  // ring hash: host=127.0.0.1:80 hash=17613279263364193813
+  // This is the hash ring built using xxHash64.
+  // ring hash: host=127.0.0.1:83 hash=842294666033307227
+  // ring hash: host=127.0.0.1:84 hash=2231552554775993225
+  // ring hash: host=127.0.0.1:85 hash=3617836676629228985
+  // ring hash: host=127.0.0.1:80 hash=5454692015285649509
+  // ring hash: host=127.0.0.1:81 hash=7859399908942313493
+  // ring hash: host=127.0.0.1:82 hash=8241336090459785962
+  // ring hash: host=127.0.0.1:84 hash=12589998527382061165
+  // ring hash: host=127.0.0.1:82 hash=12882406409176325258
+  // ring hash: host=127.0.0.1:80 hash=13838424394637650569
+  // ring hash: host=127.0.0.1:85 hash=14454039294846722197
+  // ring hash: host=127.0.0.1:81 hash=16064866803292627174
+  // ring hash: host=127.0.0.1:83 hash=17869494589454488074
   {
     TestLoadBalancerContext context(0);
-    EXPECT_EQ(cluster_.hosts_[5], lb_.chooseHost(&context));
+    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
   }
   {
     TestLoadBalancerContext context(std::numeric_limits<uint64_t>::max());
-    EXPECT_EQ(cluster_.hosts_[5], lb_.chooseHost(&context));
+    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
   }
   {
-    TestLoadBalancerContext context(1358027074129602068);
-    EXPECT_EQ(cluster_.hosts_[5], lb_.chooseHost(&context));
+    TestLoadBalancerContext context(842294666033307227);
+    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
   }
   {
-    TestLoadBalancerContext context(1358027074129602069);
-    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
+    TestLoadBalancerContext context(842294666033307228);
+    EXPECT_EQ(cluster_.hosts_[4], lb_.chooseHost(&context));
   }
   {
-    EXPECT_CALL(random_, random()).WillOnce(Return(10150910876324007730UL));
+    EXPECT_CALL(random_, random()).WillOnce(Return(12882406409176325257UL));
     EXPECT_EQ(cluster_.hosts_[2], lb_.chooseHost(nullptr));
   }
   EXPECT_EQ(0UL, stats_.lb_healthy_panic_.value());
@@ -101,7 +100,7 @@ TEST_F(RingHashLoadBalancerTest, Basic) {
   cluster_.runCallbacks({}, {});
   {
     TestLoadBalancerContext context(0);
-    EXPECT_EQ(cluster_.hosts_[5], lb_.chooseHost(&context));
+    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
   }
   EXPECT_EQ(1UL, stats_.lb_healthy_panic_.value());
 }
@@ -113,35 +112,67 @@ TEST_F(RingHashLoadBalancerTest, UnevenHosts) {
       .WillByDefault(Return(3));
   cluster_.runCallbacks({}, {});
 
-  // This is the hash ring built using the default hash (probably murmur2) on GCC 5.4.
-  // TODO(mattklein123): Compile in and use murmur3 or city so we know exactly
-  // what we are going to get.
-  // ring hash: host=127.0.0.1:81 hash=7701421856454313576
-  // ring hash: host=127.0.0.1:81 hash=9887544217113020895
-  // ring hash: host=127.0.0.1:80 hash=15427156902705414897
-  // ring hash: host=127.0.0.1:80 hash=17613279263364193813
+  // This is the hash ring built using xxHash64.
+  // ring hash: host=127.0.0.1:80 hash=5454692015285649509
+  // ring hash: host=127.0.0.1:81 hash=7859399908942313493
+  // ring hash: host=127.0.0.1:80 hash=13838424394637650569
+  // ring hash: host=127.0.0.1:81 hash=16064866803292627174
   {
     TestLoadBalancerContext context(0);
-    EXPECT_EQ(cluster_.hosts_[1], lb_.chooseHost(&context));
+    EXPECT_EQ(cluster_.hosts_[0], lb_.chooseHost(&context));
   }
 
   cluster_.hosts_ = {makeTestHost(cluster_.info_, "tcp://127.0.0.1:81"),
                      makeTestHost(cluster_.info_, "tcp://127.0.0.1:82")};
   cluster_.runCallbacks({}, {});
 
-  // This is the hash ring built using the default hash (probably murmur2) on GCC 5.4.
-  // TODO(mattklein123): Compile in and use murmur3 or city so we know exactly
-  // what we are going to get.
-  // ring hash: host=127.0.0.1:81 hash=7701421856454313576
-  // ring hash: host=127.0.0.1:82 hash=8649315368077433379
-  // ring hash: host=127.0.0.1:81 hash=9887544217113020895
-  // ring hash: host=127.0.0.1:82 hash=10150910876324007731
+  // This is the hash ring built using xxHash64.
+  // ring hash: host=127.0.0.1:81 hash=7859399908942313493
+  // ring hash: host=127.0.0.1:82 hash=8241336090459785962
+  // ring hash: host=127.0.0.1:82 hash=12882406409176325258
+  // ring hash: host=127.0.0.1:81 hash=16064866803292627174
   {
     TestLoadBalancerContext context(0);
     EXPECT_EQ(cluster_.hosts_[0], lb_.chooseHost(&context));
   }
 }
 
+// Rings built outside of the load balancer are used as is and swapped in by the owner.
+TEST_F(RingHashLoadBalancerTest, SharedRings) {
+  RingHashLoadBalancer::RingsConstSharedPtr rings;
+  RingHashLoadBalancer lb(cluster_, stats_, runtime_, random_, rings);
+  EXPECT_EQ(nullptr, lb.chooseHost(nullptr));
+
+  cluster_.hosts_ = {makeTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
+                     makeTestHost(cluster_.info_, "tcp://127.0.0.1:81")};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  ON_CALL(runtime_.snapshot_, getInteger("upstream.ring_hash.min_ring_size", _))
+      .WillByDefault(Return(3));
+  cluster_.runCallbacks({}, {});
+
+  // The load balancer does not build its own rings.
+  EXPECT_EQ(nullptr, lb.chooseHost(nullptr));
+
+  rings = std::make_shared<const RingHashLoadBalancer::Rings>(runtime_, cluster_.hosts_,
+                                                              cluster_.healthy_hosts_);
+  {
+    TestLoadBalancerContext context(0);
+    EXPECT_EQ(cluster_.hosts_[0], lb.chooseHost(&context));
+  }
+  {
+    TestLoadBalancerContext context(5454692015285649510UL);
+    EXPECT_EQ(cluster_.hosts_[1], lb.chooseHost(&context));
+  }
+
+  // Sharing the rings with another load balancer does not rebuild them.
+  RingHashLoadBalancer other_lb(cluster_, stats_, runtime_, random_, rings);
+  {
+    TestLoadBalancerContext context(0);
+    EXPECT_EQ(cluster_.hosts_[0], other_lb.chooseHost(&context));
+  }
+  EXPECT_EQ(0UL, stats_.lb_healthy_panic_.value());
+}
+
 /**
  * This test is for simulation only and should not be run as part of unit tests. In order to run the
  * simulation remove the DISABLED_ prefix from the TEST_F invocation. Run bazel with
@@ -185,7 +216,7 @@ TEST_F(DISABLED_RingHashLoadBalancerTest, DetermineSpread) {
   cluster_.runCallbacks({}, {});
 
   for (uint64_t i = 0; i < keys_to_simulate; i++) {
-    TestLoadBalancerContext context(std::hash<std::string>()(fmt::format("{}", i)));
+    TestLoadBalancerContext context(HashUtil::xxHash64(fmt::format("{}", i)));
     hit_counter[lb_.chooseHost(&context)->address()->asString()] += 1;
   }
 
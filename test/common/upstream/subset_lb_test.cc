@@ -42,7 +42,7 @@ private:
 
 class TestMetadataMatchCriteria : public Router::MetadataMatchCriteria {
 public:
-  TestMetadataMatchCriteria(const std::map<std::string, std::string> matches) {
+  TestMetadataMatchCriteria(const std::map<std::string, std::string> matches) : id_(next_id_++) {
     for (const auto& it : matches) {
       ProtobufWkt::Value v;
       v.set_string_value(it.second);
@@ -56,11 +56,16 @@ public:
   metadataMatchCriteria() const override {
     return matches_;
   }
+  uint64_t id() const override { return id_; }
 
 private:
+  static uint64_t next_id_;
   std::vector<Router::MetadataMatchCriterionConstSharedPtr> matches_;
+  const uint64_t id_;
 };
 
+uint64_t TestMetadataMatchCriteria::next_id_ = 1;
+
 class TestLoadBalancerContext : public LoadBalancerContext {
 public:
   TestLoadBalancerContext(
@@ -149,7 +154,7 @@ public:
 
     local_host_set_.reset(new HostSetImpl());
     local_host_set_->updateHosts(local_hosts_, local_hosts_, local_hosts_per_locality_,
-                                 local_hosts_per_locality_, {}, {});
+                                 local_hosts_per_locality_, nullptr, {}, {});
 
     lb_.reset(new SubsetLoadBalancer(lb_type_, cluster_, local_host_set_.get(), stats_, runtime_,
                                      random_, subset_info_));
@@ -237,7 +242,7 @@ public:
 
     if (GetParam() == REMOVES_FIRST && !remove.empty()) {
       local_host_set_->updateHosts(local_hosts_, local_hosts_, local_hosts_per_locality_,
-                                   local_hosts_per_locality_, {}, remove);
+                                   local_hosts_per_locality_, nullptr, {}, remove);
     }
 
     for (const auto& host : add) {
@@ -248,11 +253,11 @@ public:
     if (GetParam() == REMOVES_FIRST) {
       if (!add.empty()) {
         local_host_set_->updateHosts(local_hosts_, local_hosts_, local_hosts_per_locality_,
-                                     local_hosts_per_locality_, add, {});
+                                     local_hosts_per_locality_, nullptr, add, {});
       }
     } else if (!add.empty() || !remove.empty()) {
       local_host_set_->updateHosts(local_hosts_, local_hosts_, local_hosts_per_locality_,
-                                   local_hosts_per_locality_, add, remove);
+                                   local_hosts_per_locality_, nullptr, add, remove);
     }
   }
 
@@ -447,6 +452,34 @@ TEST_P(SubsetLoadBalancerTest, BalancesSubsetAfterUpdate) {
   EXPECT_EQ(3U, stats_.lb_subsets_created_.value());
 }
 
+// Lookups are cached per criteria, but the cache must not hide subsets created by later updates.
+TEST_P(SubsetLoadBalancerTest, CachedSubsetAfterUpdate) {
+  EXPECT_CALL(subset_info_, fallbackPolicy())
+      .WillRepeatedly(Return(envoy::api::v2::Cluster::LbSubsetConfig::NO_FALLBACK));
+
+  std::vector<std::set<std::string>> subset_keys = {{"version"}};
+  EXPECT_CALL(subset_info_, subsetKeys()).WillRepeatedly(ReturnRef(subset_keys));
+
+  init({
+      {"tcp://127.0.0.1:80", {{"version", "1.0"}}},
+      {"tcp://127.0.0.1:81", {{"version", "1.1"}}},
+  });
+
+  TestLoadBalancerContext context_10({{"version", "1.0"}});
+  TestLoadBalancerContext context_12({{"version", "1.2"}});
+
+  EXPECT_EQ(cluster_.hosts_[0], lb_->chooseHost(&context_10));
+  EXPECT_EQ(cluster_.hosts_[0], lb_->chooseHost(&context_10));
+  EXPECT_EQ(nullptr, lb_->chooseHost(&context_12));
+  EXPECT_EQ(nullptr, lb_->chooseHost(&context_12));
+
+  modifyHosts({makeHost("tcp://127.0.0.1:8000", {{"version", "1.2"}})}, {cluster_.hosts_[0]});
+
+  EXPECT_EQ(nullptr, lb_->chooseHost(&context_10));
+  EXPECT_EQ(cluster_.hosts_[1], lb_->chooseHost(&context_12));
+  EXPECT_EQ(3U, stats_.lb_subsets_selected_.value());
+}
+
 TEST_P(SubsetLoadBalancerTest, UpdateRemovingLastSubsetHost) {
   EXPECT_CALL(subset_info_, fallbackPolicy())
       .WillRepeatedly(Return(envoy::api::v2::Cluster::LbSubsetConfig::ANY_ENDPOINT));
@@ -652,7 +685,8 @@ TEST_F(SubsetLoadBalancerTest, LoadBalancerTypes) {
 
   auto types =
       std::vector<LoadBalancerType>({LoadBalancerType::RoundRobin, LoadBalancerType::LeastRequest,
-                                     LoadBalancerType::Random, LoadBalancerType::RingHash});
+                                     LoadBalancerType::Random, LoadBalancerType::RingHash,
+                                     LoadBalancerType::Maglev});
 
   for (const auto& it : types) {
     lb_type_ = it;
@@ -671,8 +705,8 @@ TEST_F(SubsetLoadBalancerTest, ZoneAwareFallback) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(2));
 
@@ -714,8 +748,8 @@ TEST_P(SubsetLoadBalancerTest, ZoneAwareFallbackAfterUpdate) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(2));
 
@@ -773,8 +807,8 @@ TEST_F(SubsetLoadBalancerTest, ZoneAwareFallbackDefaultSubset) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(2));
 
@@ -827,8 +861,8 @@ TEST_P(SubsetLoadBalancerTest, ZoneAwareFallbackDefaultSubsetAfterUpdate) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(2));
 
@@ -891,8 +925,8 @@ TEST_F(SubsetLoadBalancerTest, ZoneAwareBalancesSubsets) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(2));
 
@@ -944,8 +978,8 @@ TEST_P(SubsetLoadBalancerTest, ZoneAwareBalancesSubsetsAfterUpdate) {
 
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-  EXPECT_CALL(runtime_.snapshot_, featureEnabled("upstream.zone_routing.enabled", 100))
-      .WillRepeatedly(Return(true));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.enabled", 100))
+      .WillRepeatedly(Return(100));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
       .WillRepeatedly(Return(2));
 
@@ -28,6 +28,7 @@
 using testing::ContainerEq;
 using testing::Invoke;
 using testing::NiceMock;
+using testing::Return;
 using testing::_;
 
 namespace Envoy {
@@ -347,6 +348,53 @@ TEST(HostImplTest, HostnameCanaryAndLocality) {
   EXPECT_EQ("world", host.locality().sub_zone());
 }
 
+TEST(HostSetImplTest, Snapshot) {
+  MockCluster cluster;
+  HostSharedPtr host1 = makeTestHost(cluster.info_, "tcp://10.0.0.1:1234");
+  HostSharedPtr host2 = makeTestHost(cluster.info_, "tcp://10.0.0.2:1234");
+  host2->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+
+  HostSetImpl host_set;
+  EXPECT_TRUE(host_set.hosts().empty());
+  EXPECT_TRUE(host_set.localityWeights().empty());
+
+  // Healthy lists are derived when the snapshot is built.
+  HostSetSnapshotConstSharedPtr snapshot = std::make_shared<const HostSetSnapshot>(
+      std::make_shared<const std::vector<HostSharedPtr>>(std::vector<HostSharedPtr>{host1, host2}),
+      std::make_shared<const std::vector<std::vector<HostSharedPtr>>>(
+          std::vector<std::vector<HostSharedPtr>>{{host1}, {host2}}),
+      std::make_shared<const std::vector<uint32_t>>(std::vector<uint32_t>{1, 2}));
+  EXPECT_EQ(std::vector<HostSharedPtr>({host1}), snapshot->healthyHosts());
+  EXPECT_EQ(std::vector<std::vector<HostSharedPtr>>({{host1}, {}}),
+            snapshot->healthyHostsPerLocality());
+
+  uint32_t callbacks = 0;
+  host_set.addMemberUpdateCb(
+      [&](const std::vector<HostSharedPtr>&, const std::vector<HostSharedPtr>&) { callbacks++; });
+
+  // Host sets sharing a snapshot see the same lists.
+  HostSetImpl other_host_set;
+  host_set.updateHosts(snapshot, {host1, host2}, {});
+  other_host_set.updateHosts(snapshot, {host1, host2}, {});
+  EXPECT_EQ(1U, callbacks);
+  EXPECT_EQ(&host_set.hosts(), &other_host_set.hosts());
+  EXPECT_EQ(&host_set.healthyHostsPerLocality(), &other_host_set.healthyHostsPerLocality());
+  EXPECT_EQ(std::vector<uint32_t>({1, 2}), host_set.localityWeights());
+
+  // Refreshing health shares the membership lists and rebuilds the healthy ones.
+  host2->healthFlagClear(Host::HealthFlag::FAILED_ACTIVE_HC);
+  HostSetSnapshotConstSharedPtr refreshed = snapshot->refreshHealth();
+  EXPECT_EQ(&snapshot->hosts(), &refreshed->hosts());
+  EXPECT_EQ(&snapshot->hostsPerLocality(), &refreshed->hostsPerLocality());
+  EXPECT_EQ(&snapshot->localityWeights(), &refreshed->localityWeights());
+  EXPECT_EQ(std::vector<HostSharedPtr>({host1, host2}), refreshed->healthyHosts());
+  EXPECT_EQ(std::vector<std::vector<HostSharedPtr>>({{host1}, {host2}}),
+            refreshed->healthyHostsPerLocality());
+
+  // The old snapshot is unchanged.
+  EXPECT_EQ(std::vector<HostSharedPtr>({host1}), snapshot->healthyHosts());
+}
+
 TEST(StaticClusterImplTest, EmptyHostname) {
   Stats::IsolatedStoreImpl stats;
   Ssl::MockContextManager ssl_context_manager;
@@ -371,6 +419,76 @@ TEST(StaticClusterImplTest, EmptyHostname) {
   EXPECT_FALSE(cluster.info()->addedViaApi());
 }
 
+TEST(StaticClusterImplTest, IdleTimeout) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "random",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}]
+  }
+  )EOF";
+
+  NiceMock<MockClusterManager> cm;
+  {
+    StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                              false);
+    EXPECT_FALSE(cluster.info()->idleTimeout().valid());
+  }
+
+  // The global default applies to every cluster.
+  ON_CALL(runtime.snapshot_, getInteger("upstream.idle_timeout_ms", 0))
+      .WillByDefault(Return(60000));
+  {
+    StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                              false);
+    EXPECT_EQ(std::chrono::milliseconds(60000), cluster.info()->idleTimeout().value());
+  }
+
+  // A per cluster value overrides it.
+  ON_CALL(runtime.snapshot_, getInteger("upstream.idle_timeout_ms.staticcluster", 60000))
+      .WillByDefault(Return(0));
+  {
+    StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                              false);
+    EXPECT_FALSE(cluster.info()->idleTimeout().valid());
+  }
+}
+
+TEST(StaticClusterImplTest, MaxPendingTime) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "random",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}]
+  }
+  )EOF";
+
+  NiceMock<MockClusterManager> cm;
+  {
+    StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                              false);
+    EXPECT_FALSE(cluster.info()->maxPendingTime().valid());
+  }
+
+  ON_CALL(runtime.snapshot_, getInteger("upstream.max_pending_time_ms.staticcluster", 0))
+      .WillByDefault(Return(500));
+  {
+    StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                              false);
+    EXPECT_EQ(std::chrono::milliseconds(500), cluster.info()->maxPendingTime().value());
+  }
+}
+
 TEST(StaticClusterImplTest, RingHash) {
   Stats::IsolatedStoreImpl stats;
   Ssl::MockContextManager ssl_context_manager;
@@ -395,6 +513,30 @@ TEST(StaticClusterImplTest, RingHash) {
   EXPECT_TRUE(cluster.info()->addedViaApi());
 }
 
+TEST(StaticClusterImplTest, Maglev) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "ring_hash",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}]
+  }
+  )EOF";
+
+  ON_CALL(runtime.snapshot_, getInteger("upstream.use_maglev.staticcluster", 0))
+      .WillByDefault(Return(1));
+  NiceMock<MockClusterManager> cm;
+  StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                            true);
+  cluster.initialize([] {});
+
+  EXPECT_EQ(LoadBalancerType::Maglev, cluster.info()->lbType());
+}
+
 TEST(StaticClusterImplTest, OutlierDetector) {
   Stats::IsolatedStoreImpl stats;
   Ssl::MockContextManager ssl_context_manager;
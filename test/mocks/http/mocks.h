@@ -382,6 +382,8 @@ public:
   MOCK_METHOD2(onData, void(Buffer::Instance& data, bool end_stream));
   MOCK_METHOD1(onTrailers_, void(HeaderMap& headers));
   MOCK_METHOD0(onReset, void());
+  MOCK_METHOD0(onAboveWriteBufferHighWatermark, void());
+  MOCK_METHOD0(onBelowWriteBufferLowWatermark, void());
 };
 
 class MockAsyncClientRequest : public AsyncClient::Request {
@@ -39,6 +39,11 @@ MockRateLimitPolicy::MockRateLimitPolicy() {
 
 MockRateLimitPolicy::~MockRateLimitPolicy() {}
 
+MockShadowStream::MockShadowStream() {
+  ON_CALL(*this, sendData(_, _)).WillByDefault(Return(true));
+}
+MockShadowStream::~MockShadowStream() {}
+
 MockShadowWriter::MockShadowWriter() {}
 MockShadowWriter::~MockShadowWriter() {}
 
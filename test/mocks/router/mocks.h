@@ -126,19 +126,31 @@ public:
   std::string runtime_key_;
 };
 
+class MockShadowStream : public ShadowStream {
+public:
+  MockShadowStream();
+  ~MockShadowStream();
+
+  // Router::ShadowStream
+  MOCK_METHOD2(sendData, bool(Buffer::Instance& data, bool end_stream));
+  MOCK_METHOD1(sendTrailers, void(const Http::HeaderMap& trailers));
+  MOCK_METHOD0(cancel, void());
+};
+
 class MockShadowWriter : public ShadowWriter {
 public:
   MockShadowWriter();
   ~MockShadowWriter();
 
   // Router::ShadowWriter
-  void shadow(const std::string& cluster, Http::MessagePtr&& request,
-              std::chrono::milliseconds timeout) override {
-    shadow_(cluster, request, timeout);
+  ShadowStream* shadow(const std::string& cluster, Http::HeaderMapPtr&& headers, bool end_stream,
+                       std::chrono::milliseconds timeout, uint32_t buffer_limit) override {
+    return shadow_(cluster, *headers, end_stream, timeout, buffer_limit);
   }
 
-  MOCK_METHOD3(shadow_, void(const std::string& cluster, Http::MessagePtr& request,
-                             std::chrono::milliseconds timeout));
+  MOCK_METHOD5(shadow_, ShadowStream*(const std::string& cluster, Http::HeaderMap& headers,
+                                      bool end_stream, std::chrono::milliseconds timeout,
+                                      uint32_t buffer_limit));
 };
 
 class TestVirtualCluster : public VirtualCluster {
@@ -183,6 +195,7 @@ public:
   // Router::MetadataMatchCriteria
   MOCK_CONST_METHOD0(metadataMatchCriteria,
                      const std::vector<MetadataMatchCriterionConstSharedPtr>&());
+  MOCK_CONST_METHOD0(id, uint64_t());
 };
 
 class MockRouteEntry : public RouteEntry {
@@ -192,6 +205,7 @@ public:
 
   // Router::Config
   MOCK_CONST_METHOD0(clusterName, const std::string&());
+  MOCK_CONST_METHOD0(internedClusterName, const Upstream::InternedClusterName*());
   MOCK_CONST_METHOD2(finalizeRequestHeaders,
                      void(Http::HeaderMap& headers, const AccessLog::RequestInfo& request_info));
   MOCK_CONST_METHOD0(hashPolicy, const HashPolicy*());
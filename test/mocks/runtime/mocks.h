@@ -33,6 +33,7 @@ public:
                                           uint64_t random_value, uint16_t num_buckets));
   MOCK_CONST_METHOD1(get, const std::string&(const std::string& key));
   MOCK_CONST_METHOD2(getInteger, uint64_t(const std::string& key, uint64_t default_value));
+  MOCK_CONST_METHOD0(generation, uint64_t());
 };
 
 class MockLoader : public Loader {
@@ -24,9 +24,12 @@ MockLoadBalancerSubsetInfo::~MockLoadBalancerSubsetInfo() {}
 MockClusterInfo::MockClusterInfo()
     : stats_(ClusterInfoImpl::generateStats(stats_store_)),
       load_report_stats_(ClusterInfoImpl::generateLoadReportStats(load_report_stats_store_)),
-      resource_manager_(new Upstream::ResourceManagerImpl(runtime_, "fake_key", 1, 1024, 1024, 1)) {
+      resource_manager_(new Upstream::ResourceManagerImpl(runtime_, "fake_key", stats_store_,
+                                                          "", 1, 1024, 1024, 1)) {
 
   ON_CALL(*this, connectTimeout()).WillByDefault(Return(std::chrono::milliseconds(1)));
+  ON_CALL(*this, idleTimeout()).WillByDefault(ReturnRef(idle_timeout_));
+  ON_CALL(*this, maxPendingTime()).WillByDefault(ReturnRef(max_pending_time_));
   ON_CALL(*this, name()).WillByDefault(ReturnRef(name_));
   ON_CALL(*this, http2Settings()).WillByDefault(ReturnRef(http2_settings_));
   ON_CALL(*this, maxRequestsPerConnection())
@@ -43,6 +43,8 @@ public:
   MOCK_CONST_METHOD0(addedViaApi, bool());
   MOCK_CONST_METHOD0(connectTimeout, std::chrono::milliseconds());
   MOCK_CONST_METHOD0(perConnectionBufferLimitBytes, uint32_t());
+  MOCK_CONST_METHOD0(idleTimeout, const Optional<std::chrono::milliseconds>&());
+  MOCK_CONST_METHOD0(maxPendingTime, const Optional<std::chrono::milliseconds>&());
   MOCK_CONST_METHOD0(features, uint64_t());
   MOCK_CONST_METHOD0(http2Settings, const Http::Http2Settings&());
   MOCK_CONST_METHOD0(lbType, LoadBalancerType());
@@ -51,6 +53,7 @@ public:
   MOCK_CONST_METHOD0(name, const std::string&());
   MOCK_CONST_METHOD1(resourceManager, ResourceManager&(ResourcePriority priority));
   MOCK_CONST_METHOD0(sslContext, Ssl::ClientContext*());
+  MOCK_CONST_METHOD0(tlsContextHash, uint64_t());
   MOCK_CONST_METHOD0(stats, ClusterStats&());
   MOCK_CONST_METHOD0(statsScope, Stats::Scope&());
   MOCK_CONST_METHOD0(loadReportStats, ClusterLoadReportStats&());
@@ -60,6 +63,8 @@ public:
   std::string name_{"fake_cluster"};
   Http::Http2Settings http2_settings_{};
   uint64_t max_requests_per_connection_{};
+  Optional<std::chrono::milliseconds> idle_timeout_;
+  Optional<std::chrono::milliseconds> max_pending_time_;
   NiceMock<Stats::MockIsolatedStatsStore> stats_store_;
   ClusterStats stats_;
   NiceMock<Stats::MockIsolatedStatsStore> load_report_stats_store_;
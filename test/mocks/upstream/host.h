@@ -82,6 +82,9 @@ public:
   MOCK_CONST_METHOD0(healthChecker, HealthCheckHostMonitor&());
   MOCK_CONST_METHOD0(hostname, const std::string&());
   MOCK_CONST_METHOD0(stats, HostStats&());
+  MOCK_CONST_METHOD2(recordResponseTime,
+                     void(std::chrono::microseconds response_time, MonotonicTime now));
+  MOCK_CONST_METHOD1(responseTimeAverage, uint64_t(MonotonicTime now));
   MOCK_CONST_METHOD0(locality, const envoy::api::v2::Locality&());
 
   std::string hostname_;
@@ -133,6 +136,9 @@ public:
   MOCK_METHOD1(setHealthChecker_, void(HealthCheckHostMonitorPtr& health_checker));
   MOCK_METHOD1(setOutlierDetector_, void(Outlier::DetectorHostMonitorPtr& outlier_detector));
   MOCK_CONST_METHOD0(stats, HostStats&());
+  MOCK_CONST_METHOD2(recordResponseTime,
+                     void(std::chrono::microseconds response_time, MonotonicTime now));
+  MOCK_CONST_METHOD1(responseTimeAverage, uint64_t(MonotonicTime now));
   MOCK_CONST_METHOD0(weight, uint32_t());
   MOCK_METHOD1(weight, void(uint32_t new_weight));
   MOCK_CONST_METHOD0(used, bool());
@@ -27,6 +27,7 @@ MockCluster::MockCluster() {
   ON_CALL(*this, healthyHosts()).WillByDefault(ReturnRef(healthy_hosts_));
   ON_CALL(*this, hostsPerLocality()).WillByDefault(ReturnRef(hosts_per_locality_));
   ON_CALL(*this, healthyHostsPerLocality()).WillByDefault(ReturnRef(healthy_hosts_per_locality_));
+  ON_CALL(*this, localityWeights()).WillByDefault(ReturnRef(locality_weights_));
   ON_CALL(*this, info()).WillByDefault(Return(info_));
   ON_CALL(*this, initialize(_))
       .WillByDefault(Invoke([this](std::function<void()> callback) -> void {
@@ -55,6 +56,16 @@ MockClusterManager::MockClusterManager() {
   ON_CALL(*this, httpAsyncClientForCluster(_)).WillByDefault((ReturnRef(async_client_)));
   ON_CALL(*this, sourceAddress()).WillByDefault(ReturnRef(source_address_));
   ON_CALL(*this, adsMux()).WillByDefault(ReturnRef(ads_mux_));
+  ON_CALL(*this, sharedHealthCheckSessions())
+      .WillByDefault(ReturnRef(shared_health_check_sessions_));
+
+  // Getting a pool from the thread local cluster behaves like asking the cluster manager for it, so
+  // that expectations on httpConnPoolForCluster() cover both.
+  ON_CALL(thread_local_cluster_, httpConnPool(_, _))
+      .WillByDefault(Invoke([this](ResourcePriority priority, LoadBalancerContext* context) {
+        return httpConnPoolForCluster(thread_local_cluster_.cluster_.info_->name(), priority,
+                                      context);
+      }));
 
   // Matches are LIFO so "" will match first.
   ON_CALL(*this, get(_)).WillByDefault(Return(&thread_local_cluster_));
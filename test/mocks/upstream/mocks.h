@@ -4,6 +4,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "envoy/http/async_client.h"
@@ -43,6 +44,7 @@ public:
   MOCK_CONST_METHOD0(healthyHosts, const std::vector<HostSharedPtr>&());
   MOCK_CONST_METHOD0(hostsPerLocality, const std::vector<std::vector<HostSharedPtr>>&());
   MOCK_CONST_METHOD0(healthyHostsPerLocality, const std::vector<std::vector<HostSharedPtr>>&());
+  MOCK_CONST_METHOD0(localityWeights, const std::vector<uint32_t>&());
 
   // Upstream::Cluster
   MOCK_METHOD0(healthChecker, HealthChecker*());
@@ -57,6 +59,7 @@ public:
   std::vector<HostSharedPtr> healthy_hosts_;
   std::vector<std::vector<HostSharedPtr>> hosts_per_locality_;
   std::vector<std::vector<HostSharedPtr>> healthy_hosts_per_locality_;
+  std::vector<uint32_t> locality_weights_;
   Common::CallbackManager<const std::vector<HostSharedPtr>&, const std::vector<HostSharedPtr>&>
       member_update_cb_helper_;
   std::shared_ptr<MockClusterInfo> info_{new NiceMock<MockClusterInfo>()};
@@ -84,6 +87,8 @@ public:
   MOCK_METHOD0(hostSet, const HostSet&());
   MOCK_METHOD0(info, ClusterInfoConstSharedPtr());
   MOCK_METHOD0(loadBalancer, LoadBalancer&());
+  MOCK_METHOD2(httpConnPool, Http::ConnectionPool::Instance*(ResourcePriority priority,
+                                                             LoadBalancerContext* context));
 
   NiceMock<MockCluster> cluster_;
   NiceMock<MockLoadBalancer> lb_;
@@ -100,6 +105,20 @@ public:
     return {Network::ClientConnectionPtr{data.connection_}, data.host_description_};
   }
 
+  // Interned lookups forward to get() by name so that tests only need to set expectations on the
+  // latter.
+  InternedClusterNameConstSharedPtr internClusterName(const std::string& cluster) override {
+    InternedClusterNameConstSharedPtr& interned = interned_cluster_names_[cluster];
+    if (!interned) {
+      interned = std::make_shared<const InternedClusterName>(
+          cluster, interned_cluster_names_.size() - 1, interned_cluster_names_.size());
+    }
+    return interned;
+  }
+  ThreadLocalCluster* get(const InternedClusterName& cluster) override {
+    return get(cluster.name_);
+  }
+
   // Upstream::ClusterManager
   MOCK_METHOD1(addOrUpdatePrimaryCluster, bool(const envoy::api::v2::Cluster& cluster));
   MOCK_METHOD1(setInitializedCb, void(std::function<void()>));
@@ -117,12 +136,15 @@ public:
   MOCK_METHOD0(shutdown, void());
   MOCK_CONST_METHOD0(sourceAddress, const Network::Address::InstanceConstSharedPtr&());
   MOCK_METHOD0(adsMux, Config::GrpcMux&());
+  MOCK_METHOD0(sharedHealthCheckSessions, SharedHealthCheckSessionMap&());
 
   NiceMock<Http::ConnectionPool::MockInstance> conn_pool_;
   NiceMock<Http::MockAsyncClient> async_client_;
   NiceMock<MockThreadLocalCluster> thread_local_cluster_;
   Network::Address::InstanceConstSharedPtr source_address_;
   NiceMock<Config::MockGrpcMux> ads_mux_;
+  SharedHealthCheckSessionMap shared_health_check_sessions_;
+  std::unordered_map<std::string, InternedClusterNameConstSharedPtr> interned_cluster_names_;
 };
 
 class MockHealthChecker : public HealthChecker {
@@ -9,6 +9,7 @@
 #include "common/router/router.h"
 
 #include "server/config/http/buffer.h"
+#include "server/config/http/cache.h"
 #include "server/config/http/dynamo.h"
 #include "server/config/http/fault.h"
 #include "server/config/http/grpc_http1_bridge.h"
@@ -16,6 +17,7 @@
 #include "server/config/http/ip_tagging.h"
 #include "server/config/http/lua.h"
 #include "server/config/http/ratelimit.h"
+#include "server/config/http/request_coalescing.h"
 #include "server/config/http/router.h"
 #include "server/config/http/zipkin_http_tracer.h"
 #include "server/config/network/http_connection_manager.h"
@@ -96,6 +98,36 @@ TEST(HttpFilterConfigTest, BufferFilterWithEmptyProto) {
   cb(filter_callback);
 }
 
+TEST(HttpFilterConfigTest, CacheFilter) {
+  std::string json_string = R"EOF(
+  {
+    "max_cache_bytes" : 1048576,
+    "max_entry_bytes" : 65536
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
+  NiceMock<MockFactoryContext> context;
+  CacheFilterConfig factory;
+  HttpFilterFactoryCb cb = factory.createFilterFactory(*json_config, "stats", context);
+  Http::MockFilterChainFactoryCallbacks filter_callback;
+  EXPECT_CALL(filter_callback, addStreamFilter(_));
+  cb(filter_callback);
+}
+
+TEST(HttpFilterConfigTest, BadCacheFilterConfig) {
+  std::string json_string = R"EOF(
+  {
+    "max_entry_bytes" : 65536
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
+  NiceMock<MockFactoryContext> context;
+  CacheFilterConfig factory;
+  EXPECT_THROW(factory.createFilterFactory(*json_config, "stats", context), Json::Exception);
+}
+
 TEST(HttpFilterConfigTest, RateLimitFilter) {
   std::string json_string = R"EOF(
   {
@@ -127,6 +159,16 @@ TEST(HttpFilterConfigTest, BadRateLimitFilterConfig) {
   EXPECT_THROW(factory.createFilterFactory(*json_config, "stats", context), Json::Exception);
 }
 
+TEST(HttpFilterConfigTest, RequestCoalescingFilter) {
+  Json::ObjectSharedPtr json_config = Json::Factory::loadFromString("{}");
+  NiceMock<MockFactoryContext> context;
+  RequestCoalescingFilterConfig factory;
+  HttpFilterFactoryCb cb = factory.createFilterFactory(*json_config, "stats", context);
+  Http::MockFilterChainFactoryCallbacks filter_callback;
+  EXPECT_CALL(filter_callback, addStreamFilter(_));
+  cb(filter_callback);
+}
+
 TEST(HttpFilterConfigTest, DynamoFilter) {
   std::string json_string = R"EOF(
   {